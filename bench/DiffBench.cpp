@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "Differentiator.hpp"
+#include "RecursiveDescent.hpp"
+#include "Optimiser.hpp"
+#include "EGraph.hpp"
+
+#ifndef BENCH_CORPUS
+#define BENCH_CORPUS "bench/corpus.txt"
+#endif
+
+static const size_t BENCH_REPEATS    = 2000;
+static const size_t MAX_CORPUS_LINE  = 256;
+
+static double _seconds();
+
+static size_t _nodesCreated();
+
+static ErrorCode _benchExpression(char* expression, StepObserver* latexObserver);
+
+static ErrorCode _benchOptimise(Tree* derivative, double* time, size_t* optimisedSize);
+
+static ErrorCode _benchEGraph(Tree* derivative, double* time, size_t* egraphSize);
+
+int main(int argc, const char* const argv[])
+{
+    const char* corpusPath = argc > 1 ? argv[1] : BENCH_CORPUS;
+
+    FILE* corpus = fopen(corpusPath, "r");
+    MyAssertSoft(corpus, ERROR_BAD_FILE);
+
+    // the steps are written to nowhere, that is the cost of the trace
+    FILE* texFile = fopen("/dev/null", "w");
+    MyAssertSoft(texFile, ERROR_BAD_FILE, fclose(corpus));
+
+    StepObserver latexObserver = LatexObserver(texFile);
+
+    printf("%-45s %8s %8s %12s %10s %10s %10s %10s %10s %10s %10s\n", "expression", "nodes", "result", "allocations",
+           "quiet us", "tex us", "memo hits", "optimised", "opt us", "e-graph", "e-graph us");
+
+    char line[MAX_CORPUS_LINE] = "";
+    ErrorCode error = EVERYTHING_FINE;
+
+    while (!error && fgets(line, sizeof(line), corpus))
+    {
+        line[strcspn(line, "\n")] = '\0';
+        if (!*line)
+            continue;
+
+        error = _benchExpression(line, &latexObserver);
+    }
+
+    fclose(texFile);
+    fclose(corpus);
+
+    return error;
+}
+
+static double _seconds()
+{
+    timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+// node ids are given in order, so a new node tells how many were made before it
+static size_t _nodesCreated()
+{
+    TreeNodeResult probe = TreeNode::New({}, nullptr, nullptr);
+    if (probe.error)
+        return 0;
+
+    size_t id = probe.value->id;
+    probe.value->Delete();
+
+    return id;
+}
+
+static ErrorCode _benchExpression(char* expression, StepObserver* latexObserver)
+{
+    char name[MAX_CORPUS_LINE] = "";
+    snprintf(name, sizeof(name), "%s", expression);
+
+    Tree tree = {};
+    RETURN_ERROR(ParseExpression(&tree, expression));
+
+    size_t allocations = 0;
+    size_t resultSize  = 0;
+    DiffMemoStats stats = {};
+
+    double times[2] = {};
+    StepObserver* observers[2] = { nullptr, latexObserver };
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        double start = _seconds();
+        for (size_t repeat = 0; repeat < BENCH_REPEATS; repeat++)
+        {
+            size_t before = _nodesCreated();
+
+            TreeResult derivativeRes = Differentiate(&tree, 'x', observers[i], &stats);
+            RETURN_ERROR(derivativeRes.error, tree.Destructor());
+
+            allocations = _nodesCreated() - before - 1;
+            resultSize  = *derivativeRes.value.size;
+
+            RETURN_ERROR(derivativeRes.value.Destructor(), tree.Destructor());
+        }
+        times[i] = (_seconds() - start) / (double)BENCH_REPEATS;
+    }
+
+    TreeResult derivativeRes = Differentiate(&tree, 'x', nullptr, nullptr);
+    RETURN_ERROR(derivativeRes.error, tree.Destructor());
+
+    double optimiseTime  = 0;
+    size_t optimisedSize = 0;
+
+    double egraphTime = 0;
+    size_t egraphSize = 0;
+
+    ErrorCode error = _benchOptimise(&derivativeRes.value, &optimiseTime, &optimisedSize);
+    if (!error)
+        error = _benchEGraph(&derivativeRes.value, &egraphTime, &egraphSize);
+
+    RETURN_ERROR(derivativeRes.value.Destructor(), tree.Destructor());
+    RETURN_ERROR(error, tree.Destructor());
+
+    printf("%-45s %8zu %8zu %12zu %10.2f %10.2f %10zu %10zu %10.2f %10zu %10.0f\n", name, *tree.size, resultSize,
+           allocations, times[0] * 1e6, times[1] * 1e6, stats.hits, optimisedSize, optimiseTime * 1e6,
+           egraphSize, egraphTime * 1e6);
+
+    return tree.Destructor();
+}
+
+// every repeat simplifies a fresh copy, only Optimise itself is timed
+static ErrorCode _benchOptimise(Tree* derivative, double* time, size_t* optimisedSize)
+{
+    double total = 0;
+
+    for (size_t repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        TreeNodeResult copyRes = derivative->root->Copy();
+        RETURN_ERROR(copyRes.error);
+
+        Tree copy = {};
+        RETURN_ERROR(copy.Init(copyRes.value), copyRes.value->Delete());
+
+        double start = _seconds();
+        ErrorCode error = Optimise(&copy, nullptr);
+        total += _seconds() - start;
+
+        *optimisedSize = *copy.size;
+
+        RETURN_ERROR(error, copy.Destructor());
+        RETURN_ERROR(copy.Destructor());
+    }
+
+    *time = total / (double)BENCH_REPEATS;
+
+    return EVERYTHING_FINE;
+}
+
+// the optimised derivative is simplified once more, one run is enough as the saturation is limited by time
+static ErrorCode _benchEGraph(Tree* derivative, double* time, size_t* egraphSize)
+{
+    TreeNodeResult copyRes = derivative->root->Copy();
+    RETURN_ERROR(copyRes.error);
+
+    Tree copy = {};
+    RETURN_ERROR(copy.Init(copyRes.value), copyRes.value->Delete());
+
+    ErrorCode error = Optimise(&copy, nullptr);
+
+    double start = _seconds();
+    if (!error)
+        error = OptimiseByEGraph(&copy, NodeCountCost(), nullptr, nullptr);
+    *time = _seconds() - start;
+
+    *egraphSize = *copy.size;
+
+    RETURN_ERROR(error, copy.Destructor());
+    return copy.Destructor();
+}
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include "VectorMath.hpp"
+#include "DoubleDouble.hpp"
+#include "Evaluator.hpp"
+#include "RecursiveDescent.hpp"
+#include "MinMax.hpp"
+
+#ifndef BENCH_CORPUS
+#define BENCH_CORPUS "bench/corpus.txt"
+#endif
+
+static const size_t BENCH_POINTS         = 1 << 16;
+static const size_t BENCH_REPEATS        = 50;
+static const size_t BENCH_CORPUS_REPEATS = 20;
+static const size_t MAX_CORPUS_LINE      = 256;
+
+typedef void (*VecFunction_t)(const double* x, double* y, size_t count);
+
+struct BenchFunction
+{
+    const char*   name;
+    VecFunction_t function;
+    DoubleDouble  (*reference)(DoubleDouble x);
+    double        min;
+    double        max;
+};
+
+static const BenchFunction BENCH_FUNCTIONS[] =
+{
+    { "sin",    VecSin,    DDSin,    -100,    100    },
+    { "cos",    VecCos,    DDCos,    -100,    100    },
+    { "tan",    VecTan,    DDTan,    -100,    100    },
+    { "arcsin", VecArcsin, DDArcsin, -1,      1      },
+    { "arccos", VecArccos, DDArccos, -1,      1      },
+    { "arctan", VecArctan, DDArctan, -50,     50     },
+    { "exp",    VecExp,    DDExp,    -700,    700    },
+    { "ln",     VecLn,     DDLn,     1e-300,  1e300  },
+};
+
+static double _seconds();
+
+static double _random(double min, double max);
+
+static double _ulpError(double value, DoubleDouble reference);
+
+static void _benchFunctions();
+
+static ErrorCode _benchCorpus(const char* corpusPath);
+
+static ErrorCode _benchExpression(char* expression, const double* points, double* expected, double* results);
+
+int main(int argc, const char* const argv[])
+{
+    printf("best isa: %s\n\n", VECTOR_MATH_ISA_NAMES[VectorMathBestIsa()]);
+
+    _benchFunctions();
+
+    ErrorCode error = _benchCorpus(argc > 1 ? argv[1] : BENCH_CORPUS);
+    MyAssertSoft(!error, error);
+
+    return 0;
+}
+
+static double _seconds()
+{
+    timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+static double _random(double min, double max)
+{
+    double t = rand() / (double)RAND_MAX;
+
+    // ln is tested over many binades
+    if (min > 0)
+        return exp(log(min) + (log(max) - log(min)) * t);
+
+    return min + (max - min) * t;
+}
+
+static double _ulpError(double value, DoubleDouble reference)
+{
+    if (isnan(value) || isnan(reference.hi))
+        return isnan(value) && isnan(reference.hi) ? 0 : INFINITY;
+    if (isinf(reference.hi) || reference.hi == 0)
+        return value == reference.hi ? 0 : INFINITY;
+
+    double ulp = ldexp(1, ilogb(reference.hi) - DBL_MANT_DIG + 1);
+
+    return fabs((value - reference.hi) - reference.lo) / ulp;
+}
+
+static void _benchFunctions()
+{
+    double* x = (double*)calloc(BENCH_POINTS, sizeof(*x));
+    double* y = (double*)calloc(BENCH_POINTS, sizeof(*y));
+
+    printf("%-8s %-8s %10s %10s %10s\n", "function", "isa", "ns/value", "speedup", "max ulp");
+
+    for (size_t i = 0; i < sizeof(BENCH_FUNCTIONS) / sizeof(*BENCH_FUNCTIONS); i++)
+    {
+        const BenchFunction* bench = &BENCH_FUNCTIONS[i];
+
+        srand(1);
+        for (size_t point = 0; point < BENCH_POINTS; point++)
+            x[point] = _random(bench->min, bench->max);
+
+        double libmTime = 0;
+
+        for (int isa = VECTOR_MATH_LIBM; isa <= VECTOR_MATH_AVX512; isa++)
+        {
+            if (VectorMathSetIsa((VectorMathIsa)isa))
+                continue;
+
+            double start = _seconds();
+            for (size_t repeat = 0; repeat < BENCH_REPEATS; repeat++)
+                bench->function(x, y, BENCH_POINTS);
+            double time = (_seconds() - start) / (double)(BENCH_REPEATS * BENCH_POINTS);
+
+            if (isa == VECTOR_MATH_LIBM)
+                libmTime = time;
+
+            double maxError = 0;
+            for (size_t point = 0; point < BENCH_POINTS; point++)
+                maxError = max(maxError, _ulpError(y[point], bench->reference(DDFromDouble(x[point]))));
+
+            printf("%-8s %-8s %10.2f %10.2f %10.3f\n", bench->name, VECTOR_MATH_ISA_NAMES[isa],
+                   time * 1e9, libmTime / time, maxError);
+        }
+    }
+
+    VectorMathSetIsa(VectorMathBestIsa());
+
+    free(x);
+    free(y);
+}
+
+static ErrorCode _benchCorpus(const char* corpusPath)
+{
+    MyAssertSoft(corpusPath, ERROR_NULLPTR);
+
+    FILE* corpus = fopen(corpusPath, "r");
+    MyAssertSoft(corpus, ERROR_BAD_FILE);
+
+    double* points   = (double*)calloc(BENCH_POINTS, sizeof(*points));
+    double* expected = (double*)calloc(BENCH_POINTS, sizeof(*expected));
+    double* results  = (double*)calloc(BENCH_POINTS, sizeof(*results));
+
+    srand(1);
+    for (size_t point = 0; point < BENCH_POINTS; point++)
+        points[point] = _random(0.05, 3);
+
+    printf("\n%-45s %10s %10s %10s %12s\n", "expression", "libm ns", "vec ns", "speedup", "max rel diff");
+
+    char line[MAX_CORPUS_LINE] = "";
+    ErrorCode error = EVERYTHING_FINE;
+
+    while (!error && fgets(line, sizeof(line), corpus))
+    {
+        line[strcspn(line, "\n")] = '\0';
+        if (!*line)
+            continue;
+
+        error = _benchExpression(line, points, expected, results);
+    }
+
+    VectorMathSetIsa(VectorMathBestIsa());
+
+    fclose(corpus);
+    free(points);
+    free(expected);
+    free(results);
+
+    return error;
+}
+
+static ErrorCode _benchExpression(char* expression, const double* points, double* expected, double* results)
+{
+    char name[MAX_CORPUS_LINE] = "";
+    snprintf(name, sizeof(name), "%s", expression);
+
+    Tree tree = {};
+    RETURN_ERROR(ParseExpression(&tree, expression));
+
+    CompiledTree compiled = {};
+    RETURN_ERROR(compiled.Init(&tree), tree.Destructor());
+
+    double times[2] = {};
+    VectorMathIsa isas[2] = { VECTOR_MATH_LIBM, VectorMathBestIsa() };
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        VectorMathSetIsa(isas[i]);
+
+        double start = _seconds();
+        for (size_t repeat = 0; repeat < BENCH_CORPUS_REPEATS; repeat++)
+            RETURN_ERROR(EvaluateBatch(&compiled, points, i ? results : expected, BENCH_POINTS),
+                         compiled.Destructor(); tree.Destructor());
+        times[i] = (_seconds() - start) / (double)(BENCH_CORPUS_REPEATS * BENCH_POINTS);
+    }
+
+    double maxDiff = 0;
+    for (size_t point = 0; point < BENCH_POINTS; point++)
+        if (isfinite(expected[point]) && expected[point] != 0)
+            maxDiff = max(maxDiff, fabs(results[point] - expected[point]) / fabs(expected[point]));
+
+    printf("%-45s %10.2f %10.2f %10.2f %12.3g\n", name, times[0] * 1e9, times[1] * 1e9,
+           times[0] / times[1], maxDiff);
+
+    compiled.Destructor();
+
+    return tree.Destructor();
+}
@@ -0,0 +1,83 @@
+//! @file
+
+#ifndef BIG_FLOAT_HPP
+#define BIG_FLOAT_HPP
+
+#include <stdint.h>
+#include "Utils.hpp"
+
+[[maybe_unused]] static const size_t BIG_FLOAT_LIMB_BITS   = 32;
+[[maybe_unused]] static const size_t BIG_FLOAT_MAX_LIMBS   = 64; // 2048 bits, about 616 digits
+[[maybe_unused]] static const size_t BIG_FLOAT_GUARD_LIMBS = 2;
+[[maybe_unused]] static const size_t BIG_FLOAT_CAPACITY    = BIG_FLOAT_MAX_LIMBS + BIG_FLOAT_GUARD_LIMBS;
+
+/** @struct BigFloat
+ * @brief A binary floating point number with a runtime chosen precision.
+ * The value is sign * 0.mantissa * 2 ^ exponent, the mantissa is normalized
+ * so that the top bit of mantissa[0] is set.
+ * There are no infinities, overflows and poles give NaN.
+ *
+ * @var BigFloat::sign - -1, 0 or 1, zero has sign 0
+ * @var BigFloat::isNan - whether the number is NaN
+ * @var BigFloat::exponent - binary exponent
+ * @var BigFloat::limbs - precision, how many limbs of the mantissa are used
+ * @var BigFloat::mantissa - 32 bit limbs, most significant first
+ */
+struct BigFloat
+{
+    int sign;
+    bool isNan;
+    int64_t exponent;
+    size_t limbs;
+    uint32_t mantissa[BIG_FLOAT_CAPACITY];
+};
+
+/**
+ * @brief How many limbs are needed to hold digits decimal digits
+ *
+ * @param [in] digits - wanted significant digits
+ * @return size_t limbs, at most @ref BIG_FLOAT_MAX_LIMBS
+ */
+size_t BigFloatLimbsForDigits(size_t digits);
+
+BigFloat BigFloatFromDouble(double x, size_t limbs);
+
+double BigFloatToDouble(const BigFloat* x);
+
+/**
+ * @brief Rounds the number to a new precision
+ *
+ * @param [in] x - the number
+ * @param [in] limbs - new precision
+ * @return BigFloat
+ */
+BigFloat BigFloatSetPrecision(const BigFloat* x, size_t limbs);
+
+/**
+ * @brief Prints the number in scientific notation
+ *
+ * @param [in] x - the number
+ * @param [out] buffer - where to print
+ * @param [in] bufferSize - size of the buffer
+ * @param [in] digits - significant digits to print
+ * @return Error
+ */
+ErrorCode BigFloatToString(const BigFloat* x, char* buffer, size_t bufferSize, size_t digits);
+
+BigFloat BigFloatNeg(const BigFloat* x);
+BigFloat BigFloatAdd(const BigFloat* a, const BigFloat* b);
+BigFloat BigFloatSub(const BigFloat* a, const BigFloat* b);
+BigFloat BigFloatMul(const BigFloat* a, const BigFloat* b);
+BigFloat BigFloatDiv(const BigFloat* a, const BigFloat* b);
+BigFloat BigFloatSqrt(const BigFloat* x);
+BigFloat BigFloatPow(const BigFloat* base, const BigFloat* power);
+BigFloat BigFloatSin(const BigFloat* x);
+BigFloat BigFloatCos(const BigFloat* x);
+BigFloat BigFloatTan(const BigFloat* x);
+BigFloat BigFloatArcsin(const BigFloat* x);
+BigFloat BigFloatArccos(const BigFloat* x);
+BigFloat BigFloatArctan(const BigFloat* x);
+BigFloat BigFloatExp(const BigFloat* x);
+BigFloat BigFloatLn(const BigFloat* x);
+
+#endif
@@ -0,0 +1,125 @@
+//! @file
+
+#ifndef COMPILED_TREE_HPP
+#define COMPILED_TREE_HPP
+
+#include "Tree.hpp"
+
+[[maybe_unused]] static const size_t MAX_COMPILED_VARIABLES = 64;
+[[maybe_unused]] static const size_t EVAL_BLOCK_SIZE = 64;
+[[maybe_unused]] static const size_t EVAL_SCRATCH_ELEMENT_SIZE = 2 * sizeof(double);
+
+/** @struct CompiledInstruction
+ * @brief One step of a compiled tree. Operands refer to earlier instructions.
+ *
+ * @var CompiledInstruction::type - NUMBER_TYPE, VARIABLE_TYPE or OPERATION_TYPE
+ * @var CompiledInstruction::operation - the operation if type is OPERATION_TYPE
+ * @var CompiledInstruction::number - the constant if type is NUMBER_TYPE
+ * @var CompiledInstruction::variable - index in @ref CompiledTree::variables if type is VARIABLE_TYPE
+ * @var CompiledInstruction::left - index of the left operand instruction
+ * @var CompiledInstruction::right - index of the right operand instruction
+ */
+struct CompiledInstruction
+{
+    TreeElementType type;
+    Operation operation;
+    double number;
+    size_t variable;
+    size_t left;
+    size_t right;
+};
+
+struct CompiledIndexResult
+{
+    size_t value;
+    ErrorCode error;
+};
+
+/** @struct CompiledTree
+ * @brief One or more trees flattened into a postfix instruction list,
+ * so that evaluating them at a point needs no tree walk.
+ * Identical subtrees, also across different trees, become one instruction.
+ *
+ * @var CompiledTree::instructions - instructions in evaluation order
+ * @var CompiledTree::size - number of instructions
+ * @var CompiledTree::capacity - allocated instructions
+ * @var CompiledTree::variables - names of the variables, indexed by slot
+ * @var CompiledTree::variableCount - number of distinct variables
+ * @var CompiledTree::output - index of the instruction holding the result of the first tree
+ * @var CompiledTree::outputs - indices of the instructions holding the results of every tree
+ * @var CompiledTree::outputCount - number of compiled trees
+ * @var CompiledTree::scratch - evaluation registers, big enough for any evaluator
+ * @var CompiledTree::table - open addressing hash set of instruction indices,
+ * finds an instruction equal to a new one so that it is not pushed twice
+ * @var CompiledTree::tableCapacity - power of 2, SIZET_POISON marks empty slots
+ */
+struct CompiledTree
+{
+    CompiledInstruction* instructions;
+    size_t size;
+    size_t capacity;
+
+    char variables[MAX_COMPILED_VARIABLES];
+    size_t variableCount;
+
+    size_t output;
+    size_t* outputs;
+    size_t outputCount;
+
+    void* scratch;
+
+    size_t* table;
+    size_t tableCapacity;
+
+    /**
+     * @brief Compiles the tree
+     *
+     * @param [in] tree - the tree to compile, it is not changed
+     * @return Error
+     */
+    ErrorCode Init(Tree* tree);
+
+    /**
+     * @brief Compiles several trees together, for example f and its derivatives,
+     * so that their common subexpressions are computed once
+     *
+     * @param [in] trees - the trees to compile, they are not changed
+     * @param [in] count - number of trees
+     * @return Error
+     */
+    ErrorCode Init(Tree* const* trees, size_t count);
+
+    /**
+     * @brief Adds an instruction unless an equal one is already there,
+     * its operands must already be in the tree
+     *
+     * @param [in] instruction - the instruction
+     * @return CompiledIndexResult - index of the new or the equal instruction
+     */
+    CompiledIndexResult Push(CompiledInstruction instruction);
+
+    /**
+     * @brief Makes an instruction one more output and regrows the registers
+     *
+     * @param [in] index - the instruction
+     * @return Error
+     */
+    ErrorCode AddOutput(size_t index);
+
+    /**
+     * @brief Turns an instruction back into a tree, shared instructions are copied
+     *
+     * @param [in] index - the instruction
+     * @return TreeNodeResult - the root of the new tree
+     */
+    TreeNodeResult BuildNode(size_t index) const;
+
+    /**
+     * @brief Frees the instructions
+     *
+     * @return Error
+     */
+    ErrorCode Destructor();
+};
+
+#endif
@@ -0,0 +1,52 @@
+//! @file
+
+#ifndef COMPLEX_EVALUATOR_HPP
+#define COMPLEX_EVALUATOR_HPP
+
+#include <complex>
+#include "CompiledTree.hpp"
+#include "Differentiator.hpp"
+
+typedef std::complex<double> Complex_t;
+
+[[maybe_unused]] static const double COMPLEX_STEP = 1e-20;
+
+struct ComplexEvalResult
+{
+    Complex_t value;
+    ErrorCode error;
+};
+
+/**
+ * @brief Evaluates a compiled tree at a complex point, every variable gets the value z.
+ * ln, arcsin and the others are continued past their real domains on the principal branch.
+ *
+ * @param [in] compiled - the compiled tree
+ * @param [in] z - value of the variable
+ * @return ComplexEvalResult
+ */
+ComplexEvalResult EvaluateComplex(CompiledTree* compiled, Complex_t z);
+
+/**
+ * @brief Evaluates a compiled tree at many complex points.
+ * Points where a division by zero happens get NAN.
+ *
+ * @param [in] compiled - the compiled tree
+ * @param [in] zs - values of the variable
+ * @param [out] results - count values
+ * @param [in] count - number of points
+ * @return Error
+ */
+ErrorCode EvaluateComplexBatch(CompiledTree* compiled, const Complex_t* zs, Complex_t* results, size_t count);
+
+/**
+ * @brief Finds f'(x) as Im(f(x + ih)) / h. Has no cancellation, so h can be tiny.
+ *
+ * @param [in] compiled - the compiled tree of f
+ * @param [in] x - the point
+ * @param [in] h - the step, @ref COMPLEX_STEP if unsure
+ * @return EvalResult
+ */
+EvalResult ComplexStepDerivative(CompiledTree* compiled, double x, double h);
+
+#endif
@@ -0,0 +1,46 @@
+//! @file
+
+#ifndef COST_MODEL_HPP
+#define COST_MODEL_HPP
+
+#include "EvalProfiler.hpp"
+
+/** @struct CostModel
+ * @brief What @ref EGraphExtractor minimises. The cost of a tree is the cost of its top node
+ * plus the costs of its operands, every node must cost more than 0.
+ *
+ * @var CostModel::data - passed to the callback
+ * @var CostModel::nodeCost - cost of the node alone, left and right are the top nodes of its operands,
+ * nullptr if it has none
+ */
+struct CostModel
+{
+    void* data;
+
+    double (*nodeCost)(void* data, const TreeElement* node, const TreeElement* left, const TreeElement* right);
+};
+
+/**
+ * @brief Every node costs 1, the cheapest tree is the smallest one
+ *
+ * @return CostModel
+ */
+CostModel NodeCountCost();
+
+/**
+ * @brief A node costs the cycles its operation takes to evaluate at one point
+ *
+ * @param [in] profile - the cycles are taken from it for the operations it has seen,
+ * nullptr or the rest are estimated
+ * @return CostModel
+ */
+CostModel EvaluationCyclesCost(const EvalProfile* profile);
+
+/**
+ * @brief A node costs the characters @ref LatexWrite writes for it, brackets around the operands included
+ *
+ * @return CostModel
+ */
+CostModel LatexLengthCost();
+
+#endif
@@ -0,0 +1,226 @@
+//! @file
+
+#ifndef DERIVATIVES_HPP
+#define DERIVATIVES_HPP
+
+#include "CompiledTree.hpp"
+
+/** @struct Derivatives
+ * @brief A function and its derivatives of orders 1..order in one compiled tree.
+ * Every order is found from the previous one, so subexpressions and their
+ * derivatives are shared between all orders and found once.
+ *
+ * @var Derivatives::compiled - outputs[k] is the derivative of order k, outputs[0] is the function,
+ * evaluate all of them at once with @ref EvaluateMany
+ * @var Derivatives::sizes - sizes[k] is the number of nodes of the derivative of order k written out as a tree,
+ * SIZE_MAX if it does not fit into size_t
+ * @var Derivatives::instructions - instructions[k] is the number of instructions orders 0..k need together
+ * @var Derivatives::order - the highest order
+ */
+struct Derivatives
+{
+    CompiledTree compiled;
+
+    size_t* sizes;
+    size_t* instructions;
+    size_t order;
+
+    ErrorCode Destructor();
+};
+
+struct DerivativesResult
+{
+    Derivatives value;
+    ErrorCode error;
+};
+
+/**
+ * @brief Finds derivatives of orders 1..order.
+ * Every new node is simplified by the same rules as @ref Optimise,
+ * so each order comes out already optimised.
+ *
+ * @param [in] tree - the function, it is not changed
+ * @param [in] var - the variable, the others are constants
+ * @param [in] order - the highest order, at least 1
+ * @return DerivativesResult
+ */
+DerivativesResult DifferentiateN(Tree* tree, char var, size_t order);
+
+/**
+ * @brief Writes a derivative out as a tree, for printing or dumping
+ *
+ * @param [in] derivatives - derivatives from @ref DifferentiateN
+ * @param [in] order - which one, 0 is the function
+ * @return ERROR_BAD_SIZE if the tree would be bigger than MAX_TREE_SIZE
+ */
+TreeResult DerivativeTree(Derivatives* derivatives, size_t order);
+
+/**
+ * @brief Builds the Taylor polynomial of the function around the point,
+ * f(x0) + f'(x0) * (x - x0) + ... + f^(order)(x0) / order! * (x - x0) ^ order.
+ * The derivatives come from @ref DifferentiateN, so every order reuses the previous ones,
+ * and x0 is put into all of them in one pass over the shared instructions.
+ * Other variables stay in the coefficients.
+ *
+ * @param [in] tree - the function, it is not changed
+ * @param [in] var - the variable
+ * @param [in] x0 - the point
+ * @param [in] order - the degree
+ * @return TreeResult the polynomial simplified by @ref OptimiseByRules,
+ * ERROR_ZERO_DIVISION or ERROR_BAD_VALUE if the function or a derivative is not defined at x0,
+ * ERROR_BAD_SIZE if the polynomial would be bigger than MAX_TREE_SIZE
+ */
+TreeResult TaylorExpand(Tree* tree, char var, double x0, size_t order);
+
+/** @struct Gradient
+ * @brief A function and its partial derivatives by every variable in one compiled tree.
+ * Subtrees are shared between the partial derivatives,
+ * and a subtree without the variable gets 0 at once.
+ *
+ * @var Gradient::compiled - outputs[0] is the function,
+ * outputs[i + 1] is the partial derivative by compiled.variables[i]
+ * @var Gradient::sizes - sizes[i] is the number of nodes of outputs[i] written out as a tree,
+ * SIZE_MAX if it does not fit into size_t
+ * @var Gradient::count - number of variables
+ */
+struct Gradient
+{
+    CompiledTree compiled;
+
+    size_t* sizes;
+    size_t count;
+
+    ErrorCode Destructor();
+};
+
+struct GradientResult
+{
+    Gradient value;
+    ErrorCode error;
+};
+
+/**
+ * @brief Finds partial derivatives by all variables of the tree at once,
+ * simplified like in @ref DifferentiateN
+ *
+ * @param [in] tree - the function, it is not changed
+ * @return GradientResult
+ */
+GradientResult FindGradient(Tree* tree);
+
+/**
+ * @brief Writes a partial derivative out as a tree
+ *
+ * @param [in] gradient - gradient from @ref FindGradient
+ * @param [in] var - the variable
+ * @return ERROR_NOT_FOUND if there is no such variable,
+ * ERROR_BAD_SIZE if the tree would be bigger than MAX_TREE_SIZE
+ */
+TreeResult GradientTree(Gradient* gradient, char var);
+
+/** @struct Hessian
+ * @brief A function, its gradient and its second partial derivatives in one compiled tree.
+ * The second derivatives are found from the gradient instructions, by one variable at a time,
+ * so the derivatives of subexpressions are shared between a whole column. The matrix is symmetric,
+ * so only the entries (i, j) with i <= j are found.
+ *
+ * @var Hessian::compiled - outputs[0] is the function, outputs[i + 1] is the partial derivative
+ * by compiled.variables[i], the second derivatives follow column by column: (0, 0), (0, 1), (1, 1), (0, 2)...
+ * @var Hessian::sizes - sizes[k] is the number of nodes of outputs[k] written out as a tree,
+ * SIZE_MAX if it does not fit into size_t
+ * @var Hessian::count - number of variables
+ */
+struct Hessian
+{
+    CompiledTree compiled;
+
+    size_t* sizes;
+    size_t count;
+
+    ErrorCode Destructor();
+};
+
+struct HessianResult
+{
+    Hessian value;
+    ErrorCode error;
+};
+
+/**
+ * @brief Finds the gradient and the second partial derivatives by all variables of the tree,
+ * simplified like in @ref DifferentiateN.
+ * To get them only at a point use @ref EvaluateHessian, it does not build any derivative.
+ *
+ * @param [in] tree - the function, it is not changed
+ * @return HessianResult
+ */
+HessianResult FindHessian(Tree* tree);
+
+/**
+ * @brief Writes a second partial derivative out as a tree and simplifies it with @ref Optimise
+ *
+ * @param [in] hessian - hessian from @ref FindHessian
+ * @param [in] var1 - the first variable
+ * @param [in] var2 - the second variable, the order does not matter
+ * @return ERROR_NOT_FOUND if there is no such variable,
+ * ERROR_BAD_SIZE if the tree would be bigger than MAX_TREE_SIZE
+ */
+TreeResult HessianTree(Hessian* hessian, char var1, char var2);
+
+/** @struct Jacobian
+ * @brief Functions of a system and their partial derivatives by every variable in one compiled tree.
+ * A subexpression shared by the functions is compiled once, and so is its derivative by a variable.
+ * A function that does not have a variable gets no entry for it, the entry is a structural zero.
+ *
+ * @var Jacobian::compiled - outputs[i] is the function i, the entries that are not structural zeros
+ * follow column by column
+ * @var Jacobian::entries - entries[i * columns + j] is the output of the partial derivative of the function i
+ * by compiled.variables[j], SIZET_POISON for a structural zero
+ * @var Jacobian::sizes - sizes[k] is the number of nodes of outputs[k] written out as a tree,
+ * SIZE_MAX if it does not fit into size_t
+ * @var Jacobian::rows - number of functions
+ * @var Jacobian::columns - number of variables
+ * @var Jacobian::nonZero - number of entries that are not structural zeros
+ */
+struct Jacobian
+{
+    CompiledTree compiled;
+
+    size_t* entries;
+    size_t* sizes;
+
+    size_t rows;
+    size_t columns;
+    size_t nonZero;
+
+    ErrorCode Destructor();
+};
+
+struct JacobianResult
+{
+    Jacobian value;
+    ErrorCode error;
+};
+
+/**
+ * @brief Finds the partial derivatives of every function of a system by every variable,
+ * simplified like in @ref DifferentiateN. To get them at a point use @ref EvaluateJacobian.
+ *
+ * @param [in] trees - the functions, they are not changed
+ * @param [in] count - number of functions
+ * @return JacobianResult
+ */
+JacobianResult FindJacobian(Tree* const* trees, size_t count);
+
+/**
+ * @brief Writes an entry of the jacobian out as a tree
+ *
+ * @param [in] jacobian - jacobian from @ref FindJacobian
+ * @param [in] row - the function
+ * @param [in] var - the variable
+ * @return ERROR_INDEX_OUT_OF_BOUNDS if there is no such function, ERROR_NOT_FOUND if there is no such variable,
+ * ERROR_BAD_SIZE if the tree would be bigger than MAX_TREE_SIZE
+ */
+TreeResult JacobianTree(Jacobian* jacobian, size_t row, char var);
+
+#endif
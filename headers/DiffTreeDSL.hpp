@@ -64,6 +64,21 @@ do                                                                      \
     UPDATE_PRIORITY(name);                                              \
 } while (0)
 
+// like CREATE_OPERATION, but the node comes out simplified by @ref NewSimplifiedOperation,
+// every operand it leaves out goes to drop(dropArg, operand)
+#define CREATE_SIMPLIFIED(name, op, left, right, drop, dropArg)        \
+TreeNode* name = nullptr;                                               \
+do                                                                      \
+{                                                                       \
+    TreeNode* _dropped[2] = {};                                         \
+    TreeNodeResult _tempNode = NewSimplifiedOperation(op, left, right, _dropped); \
+    RETURN_ERROR(_tempNode.error);                                      \
+    name = _tempNode.value;                                             \
+    for (size_t _i = 0; _i < 2; _i++)                                   \
+        if (_dropped[_i])                                               \
+            RETURN_ERROR(drop(dropArg, _dropped[_i]));                  \
+} while (0)
+
 #define NODE_TYPE(node) ((node)->value.type)
 #define NODE_NUMBER(node) ((node)->value.value.number)
 #define NODE_VAR(node) ((node)->value.value.var)
@@ -3,6 +3,9 @@
 
 #include "Utils.hpp"
 #include "Tree.hpp"
+#include "CompiledTree.hpp"
+#include "StepObserver.hpp"
+#include "WorkPool.hpp"
 
 struct EvalResult
 {
@@ -12,6 +15,262 @@ struct EvalResult
 
 EvalResult Evaluate(Tree* tree, double var);
 
-TreeResult Differentiate(Tree* tree, FILE* texFile);
+/** @struct DiffMemoStats
+ * @brief How often @ref Differentiate met a subtree it had already differentiated
+ *
+ * @var DiffMemoStats::hits - repeated subtrees whose derivative was copied
+ * @var DiffMemoStats::misses - subtrees differentiated by the rules
+ * @var DiffMemoStats::reused - subtrees whose derivative was copied from a @ref DiffCache
+ * @var DiffMemoStats::reusedNodes - nodes of the derivative copied from a @ref DiffCache
+ */
+struct DiffMemoStats
+{
+    size_t hits;
+    size_t misses;
+
+    size_t reused;
+    size_t reusedNodes;
+};
+
+/** @struct DiffCacheEntry
+ * @brief A subtree differentiated by an earlier call and its derivative
+ *
+ * @var DiffCacheEntry::original - the subtree inside its block
+ * @var DiffCacheEntry::derivative - its simplified derivative inside the same block, or a copy of its own
+ * @var DiffCacheEntry::derivativeId - id of the derivative node, another node made at the same address has another one
+ * @var DiffCacheEntry::hash - structural hash of the subtree
+ * @var DiffCacheEntry::next - next entry with the same bucket, SIZET_POISON at the end
+ * @var DiffCacheEntry::generation - the last call the subtree was met in
+ * @var DiffCacheEntry::block - the block the entry points into
+ * @var DiffCacheEntry::ownsDerivative - the derivative was left out of the derivative of the block,
+ * so the entry has a copy
+ */
+struct DiffCacheEntry
+{
+    TreeNode* original;
+    TreeNode* derivative;
+    size_t derivativeId;
+    size_t hash;
+    size_t next;
+    size_t generation;
+    size_t block;
+    bool ownsDerivative;
+};
+
+/** @struct DiffCacheBlock
+ * @brief What one call differentiated, kept while some entry points into it
+ *
+ * @var DiffCacheBlock::function - the tree of the call, nullptr in a free block
+ * @var DiffCacheBlock::derivative - its simplified derivative, the caller reads it until the next call
+ * @var DiffCacheBlock::users - entries pointing into the block
+ */
+struct DiffCacheBlock
+{
+    TreeNode* function;
+    TreeNode* derivative;
+    size_t users;
+};
+
+/** @struct DiffCacheCopy
+ * @brief A derivative the current call copied from an entry
+ *
+ * @var DiffCacheCopy::node - root of the copy
+ * @var DiffCacheCopy::id - its id, another node made at the same address has another one
+ */
+struct DiffCacheCopy
+{
+    TreeNode* node;
+    size_t id;
+};
+
+/** @struct DiffCache
+ * @brief Derivatives kept between the calls of @ref DifferentiateIncremental.
+ * A call takes the tree over and keeps it with the derivative as a block, the entries point into the blocks,
+ * so neither the trees nor every subtree are copied. After a call only the subtrees of that call's tree are kept.
+ *
+ * @var DiffCache::var - the variable of the derivatives
+ * @var DiffCache::entries - the subtrees and their derivatives
+ * @var DiffCache::buckets - first entry of every bucket, there are at least as many buckets as entries
+ * @var DiffCache::blocks - trees the entries point into
+ * @var DiffCache::block - the block of the current call
+ * @var DiffCache::generation - number of the current call
+ * @var DiffCache::copies - derivatives the current call copied from the entries, simplified already
+ */
+struct DiffCache
+{
+    char var;
+
+    DiffCacheEntry* entries;
+    size_t size;
+    size_t capacity;
+
+    size_t* buckets;
+    size_t bucketCount;
+
+    DiffCacheBlock* blocks;
+    size_t blockCount;
+    size_t blockCapacity;
+    size_t block;
+
+    size_t generation;
+
+    DiffCacheCopy* copies;
+    size_t copyCount;
+    size_t copyCapacity;
+
+    /**
+     * @brief Makes an empty cache
+     *
+     * @return Error
+     */
+    ErrorCode Init();
+
+    /**
+     * @brief Deletes the cached trees
+     *
+     * @return Error
+     */
+    ErrorCode Destructor();
+};
+
+/** @enum DiffPath
+ * @brief How @ref DifferentiateWithBudget found the derivative
+ */
+enum DiffPath
+{
+    SYMBOLIC_DIFF_PATH,
+    NUMERIC_DIFF_PATH,
+};
+
+/** @struct BudgetedDerivative
+ * @brief The derivative as a tree if it fits into the budget, the compiled function otherwise.
+ * Evaluate it with @ref Evaluate(BudgetedDerivative*, double) whatever the path.
+ *
+ * @var BudgetedDerivative::path - which of the two it is
+ * @var BudgetedDerivative::var - the variable
+ * @var BudgetedDerivative::tree - the derivative on the symbolic path
+ * @var BudgetedDerivative::function - the function on the numeric path,
+ * its derivative is found at every point by @ref EvaluateDerivative
+ */
+struct BudgetedDerivative
+{
+    DiffPath path;
+    char var;
+
+    Tree tree;
+    CompiledTree function;
+
+    ErrorCode Destructor();
+};
+
+struct BudgetedDerivativeResult
+{
+    BudgetedDerivative value;
+    ErrorCode error;
+};
+
+/**
+ * @brief Differentiates the tree by the variable, telling the observer about every step.
+ * A subtree met again is not differentiated the second time, its derivative is copied.
+ *
+ * @param [in] tree - the function, it is not changed
+ * @param [in] var - the variable, the others are constants
+ * @param [in] observer - what is told about the steps, nullptr to run quietly
+ * @param [out] stats - memo hits and misses, may be nullptr
+ * @return TreeResult the derivative
+ */
+TreeResult Differentiate(Tree* tree, char var, StepObserver* observer, DiffMemoStats* stats);
+
+/**
+ * @brief Same as @ref Differentiate, but big operands of +, -, * and / are differentiated
+ * in parallel on the pool. Every task has its own memo and records its steps,
+ * the observer gets them after the join in the order @ref Differentiate would make them,
+ * so the log does not depend on the scheduling. A subtree repeated in both operands of a
+ * parallel operation is differentiated in each of them, not reused.
+ *
+ * @param [in] tree - the function, it is not changed
+ * @param [in] var - the variable, the others are constants
+ * @param [in] pool - the pool, not used by anyone else at the same time
+ * @param [in] observer - what is told about the steps, nullptr to run quietly
+ * @param [out] stats - memo hits and misses, may be nullptr
+ * @return TreeResult the derivative
+ */
+TreeResult DifferentiateParallel(Tree* tree, char var, WorkPool* pool, StepObserver* observer, DiffMemoStats* stats);
+
+/**
+ * @brief @ref Differentiate and @ref Optimise for an expression edited since the last call with the cache.
+ * A subtree that was in the last tree gets its simplified derivative copied from the cache, so only the changed
+ * part is differentiated, and only it and its ancestors are simplified, by a @ref SimplifyWorklist
+ * and @ref NormaliseChanged.
+ * Another variable than in the last call empties the cache.
+ *
+ * @param [in, out] tree - the function, the cache takes it over and leaves the tree empty
+ * @param [in] var - the variable, the others are constants
+ * @param [in, out] cache - derivatives of the last tree, gets the ones of this tree
+ * @param [in] observer - what is told about the steps, a copied derivative is a repeated one, nullptr to run quietly
+ * @param [out] stats - memo hits and misses and what was reused, may be nullptr
+ * @return TreeNodeResult the simplified derivative, it belongs to the cache and must not be changed,
+ * it lives until the next call
+ */
+TreeNodeResult DifferentiateIncremental(Tree* tree, char var, DiffCache* cache, StepObserver* observer,
+                                        DiffMemoStats* stats);
+
+/**
+ * @brief @ref Differentiate watching the size of the derivative. A subtree whose derivative has more nodes
+ * than the budget stops the differentiation, what was built is deleted and the function is compiled instead,
+ * so that its derivative is found numerically at every point. So a derivative is stopped
+ * at a few budgets of nodes, however big it would be.
+ *
+ * @param [in] tree - the function, it is not changed
+ * @param [in] var - the variable, the others are constants
+ * @param [in] budget - most nodes of the symbolic derivative, 0 or more than MAX_TREE_SIZE means MAX_TREE_SIZE
+ * @param [in] pool - where to differentiate in parallel like @ref DifferentiateParallel, may be nullptr
+ * @param [in] observer - what is told about the steps, on the numeric path it was told the steps made
+ * before the budget ran out, nullptr to run quietly
+ * @param [out] stats - memo hits and misses, may be nullptr
+ * @return BudgetedDerivativeResult
+ */
+BudgetedDerivativeResult DifferentiateWithBudget(Tree* tree, char var, size_t budget, WorkPool* pool,
+                                                 StepObserver* observer, DiffMemoStats* stats);
+
+/**
+ * @brief Evaluates the derivative, every variable gets the value var
+ *
+ * @param [in] derivative - derivative from @ref DifferentiateWithBudget
+ * @param [in] var - value of the variable
+ * @return EvalResult
+ */
+EvalResult Evaluate(BudgetedDerivative* derivative, double var);
+
+/**
+ * @brief Makes the derivative without finding it: an operation becomes one lazy node.
+ * When @ref Evaluate, @ref LatexWrite or @ref Tree::Dump reaches a lazy node, it is replaced
+ * by one rule, and the derivatives of the operands become lazy nodes in their turn. So only what
+ * is reached is found, and only once. Reaching changes the tree, so it is used by one thread at a time.
+ * Compiling and the other evaluators need @ref ExpandDerivatives first.
+ *
+ * @param [in] tree - the function, it is not changed
+ * @param [in] var - the variable, the others are constants
+ * @return TreeResult the lazy derivative
+ */
+TreeResult DifferentiateLazy(Tree* tree, char var);
+
+/**
+ * @brief Replaces a lazy node by its derivative until the node is not lazy,
+ * its operands may still be lazy. Other nodes are left as they are.
+ *
+ * @param [in] node - the node
+ * @return Error
+ */
+ErrorCode ExpandDerivative(TreeNode* node);
+
+/**
+ * @brief Expands every lazy node of the tree and simplifies around the expanded ones,
+ * the rest of the tree is not looked at
+ *
+ * @param [in] tree - the tree
+ * @return Error
+ */
+ErrorCode ExpandDerivatives(Tree* tree);
 
 #endif
@@ -0,0 +1,126 @@
+//! @file
+
+#ifndef DOUBLE_DOUBLE_HPP
+#define DOUBLE_DOUBLE_HPP
+
+#include <math.h>
+
+/** @struct DoubleDouble
+ * @brief An unevaluated sum hi + lo of two doubles, about 32 significant digits.
+ *
+ * @var DoubleDouble::hi - the leading part, hi == hi + lo rounded to double
+ * @var DoubleDouble::lo - the rounding error of hi
+ */
+struct DoubleDouble
+{
+    double hi;
+    double lo;
+};
+
+[[maybe_unused]] static const double DOUBLE_DOUBLE_EPSILON = 4.93038065763132e-32; // 2 ^ -104
+
+static inline DoubleDouble DDFromDouble(double x)
+{
+    return { x, 0 };
+}
+
+static inline double DDToDouble(DoubleDouble x)
+{
+    return x.hi + x.lo;
+}
+
+static inline DoubleDouble _ddQuickTwoSum(double a, double b)
+{
+    double s = a + b;
+    return { s, b - (s - a) };
+}
+
+static inline DoubleDouble _ddTwoSum(double a, double b)
+{
+    double s = a + b;
+    double bb = s - a;
+    return { s, (a - (s - bb)) + (b - bb) };
+}
+
+static inline DoubleDouble _ddTwoProd(double a, double b)
+{
+    double p = a * b;
+    return { p, fma(a, b, -p) };
+}
+
+static inline DoubleDouble DDNeg(DoubleDouble a)
+{
+    return { -a.hi, -a.lo };
+}
+
+static inline DoubleDouble DDAdd(DoubleDouble a, DoubleDouble b)
+{
+    DoubleDouble s = _ddTwoSum(a.hi, b.hi);
+    DoubleDouble t = _ddTwoSum(a.lo, b.lo);
+
+    s.lo += t.hi;
+    s = _ddQuickTwoSum(s.hi, s.lo);
+    s.lo += t.lo;
+
+    return _ddQuickTwoSum(s.hi, s.lo);
+}
+
+static inline DoubleDouble DDSub(DoubleDouble a, DoubleDouble b)
+{
+    return DDAdd(a, DDNeg(b));
+}
+
+static inline DoubleDouble DDMul(DoubleDouble a, DoubleDouble b)
+{
+    DoubleDouble p = _ddTwoProd(a.hi, b.hi);
+    p.lo += a.hi * b.lo + a.lo * b.hi;
+
+    return _ddQuickTwoSum(p.hi, p.lo);
+}
+
+static inline DoubleDouble DDMulDouble(DoubleDouble a, double b)
+{
+    DoubleDouble p = _ddTwoProd(a.hi, b);
+    p.lo += a.lo * b;
+
+    return _ddQuickTwoSum(p.hi, p.lo);
+}
+
+static inline DoubleDouble DDDiv(DoubleDouble a, DoubleDouble b)
+{
+    double q1 = a.hi / b.hi;
+    DoubleDouble r = DDSub(a, DDMulDouble(b, q1));
+
+    double q2 = r.hi / b.hi;
+    r = DDSub(r, DDMulDouble(b, q2));
+
+    double q3 = r.hi / b.hi;
+
+    DoubleDouble q = _ddQuickTwoSum(q1, q2);
+    return DDAdd(q, DDFromDouble(q3));
+}
+
+static inline DoubleDouble DDSqrt(DoubleDouble a)
+{
+    if (a.hi <= 0)
+        return DDFromDouble(a.hi == 0 ? 0 : NAN);
+
+    double x = 1 / sqrt(a.hi);
+    double ax = a.hi * x;
+
+    DoubleDouble diff = DDSub(a, _ddTwoProd(ax, ax));
+
+    return _ddTwoSum(ax, diff.hi * x * 0.5);
+}
+
+DoubleDouble DDPow(DoubleDouble base, DoubleDouble power);
+DoubleDouble DDSin(DoubleDouble x);
+DoubleDouble DDCos(DoubleDouble x);
+DoubleDouble DDTan(DoubleDouble x);
+DoubleDouble DDArcsin(DoubleDouble x);
+DoubleDouble DDArccos(DoubleDouble x);
+DoubleDouble DDArctan(DoubleDouble x);
+DoubleDouble DDExp(DoubleDouble x);
+DoubleDouble DDLn(DoubleDouble x);
+
+#endif
@@ -0,0 +1,227 @@
+//! @file
+
+#ifndef EGRAPH_HPP
+#define EGRAPH_HPP
+
+#include "Tree.hpp"
+#include "CostModel.hpp"
+
+// the same tree always gives the same result, so there is no time limit by default
+[[maybe_unused]] static const size_t DEFAULT_EGRAPH_NODES      = 5000;
+[[maybe_unused]] static const size_t DEFAULT_EGRAPH_ITERATIONS = 8;
+[[maybe_unused]] static const double DEFAULT_EGRAPH_SECONDS    = 0;
+
+/** @struct EGraphLimits
+ * @brief When @ref EGraph::Saturate gives up, what is found by then is still correct
+ *
+ * @var EGraphLimits::nodes - no rewrites are applied once the e-graph has that many nodes
+ * @var EGraphLimits::iterations - rounds of matching all the rules and applying what matched
+ * @var EGraphLimits::seconds - time of one call, 0 for no limit. It only guards against slow cases,
+ * where saturation stops then depends on the load of the machine
+ */
+struct EGraphLimits
+{
+    size_t nodes;
+    size_t iterations;
+    double seconds;
+};
+
+/** @enum SaturationStop
+ * @brief Why @ref EGraph::Saturate stopped
+ */
+enum SaturationStop
+{
+    SATURATED_STOP,
+    NODE_LIMIT_STOP,
+    ITERATION_LIMIT_STOP,
+    TIME_LIMIT_STOP,
+};
+
+/** @struct SaturationReport
+ * @brief What @ref EGraph::Saturate did
+ *
+ * @var SaturationReport::stop - why it stopped
+ * @var SaturationReport::iterations - rounds made
+ * @var SaturationReport::rewrites - rewrites applied, the ones adding nothing new included
+ * @var SaturationReport::nodes - nodes of the e-graph at the end
+ * @var SaturationReport::classes - classes of equal subtrees at the end
+ */
+struct SaturationReport
+{
+    SaturationStop stop;
+    size_t iterations;
+    size_t rewrites;
+    size_t nodes;
+    size_t classes;
+};
+
+/** @struct ENode
+ * @brief An operation on classes of @ref EGraph, or a number, or a variable
+ *
+ * @var ENode::value - what the node is, operations have their priority
+ * @var ENode::left, ENode::right - classes of the operands, SIZET_POISON if there is none
+ * @var ENode::parent - the next node on the way to the one naming the class, the node itself at the end
+ * @var ENode::live - false for a node found equal to another one, it is left out of the lists
+ * @var ENode::number - the number the class is equal to, kept in the node naming the class
+ * @var ENode::isNumber - whether the class is equal to a number
+ */
+struct ENode
+{
+    TreeElement_t value;
+    size_t left;
+    size_t right;
+
+    size_t parent;
+    bool live;
+
+    double number;
+    bool isNumber;
+};
+
+struct EClassResult
+{
+    size_t value;
+    ErrorCode error;
+};
+
+/** @struct EGraph
+ * @brief Subtrees known to be equal, kept together as classes. A class is named by one of its nodes,
+ * the operands of a node are classes, so one node stands for every combination of its operands.
+ * @ref EGraph::Saturate rewrites by the rules of SimplifyRules.hpp and EqualityRules.hpp
+ * without losing the old form, then @ref EGraphExtractor picks the cheapest tree of a class.
+ * A node is never removed, so classes may only grow and merge.
+ *
+ * @var EGraph::nodes - all the nodes, a class is named by the index of a node
+ * @var EGraph::size - number of nodes
+ * @var EGraph::capacity - allocated nodes
+ * @var EGraph::table - open addressing hash table of the live nodes,
+ * finds a node by its value and the classes of its operands
+ * @var EGraph::tableCapacity - a power of 2, at least twice the number of nodes
+ * @var EGraph::classStart - the live nodes of class c are classNodes[classStart[c]..classStart[c + 1]),
+ * made by @ref EGraph::Rebuild
+ * @var EGraph::parentStart - the live nodes having class c as an operand are
+ * parentNodes[parentStart[c]..parentStart[c + 1])
+ * @var EGraph::operationStart - the live nodes of operation o are operationNodes[operationStart[o]..operationStart[o + 1])
+ * @var EGraph::classCount - number of classes
+ * @var EGraph::clean - whether nothing was added or merged since the last @ref EGraph::Rebuild
+ */
+struct EGraph
+{
+    ENode* nodes;
+    size_t size;
+    size_t capacity;
+
+    size_t* table;
+    size_t tableCapacity;
+
+    size_t* classNodes;
+    size_t* classStart;
+    size_t* parentNodes;
+    size_t* parentStart;
+    size_t* operationNodes;
+    size_t operationStart[OPERATION_COUNT + 1];
+
+    size_t classCount;
+    bool clean;
+
+    ErrorCode Init();
+
+    /**
+     * @brief Adds the tree, its subtrees already in the e-graph are found and not added again.
+     * Lazy derivatives in the tree are expanded.
+     *
+     * @param [in] root - the tree
+     * @return EClassResult class of the tree
+     */
+    EClassResult Add(TreeNode* root);
+
+    /**
+     * @brief Gives the node naming the class now, classes are renamed when they merge
+     *
+     * @param [in] eclass - a class as given before
+     * @return size_t
+     */
+    size_t Find(size_t eclass);
+
+    /**
+     * @brief Merges the classes of equal nodes and puts the numbers operations on numbers are equal to
+     * into their classes, then makes the lists of the nodes. @ref EGraph::Saturate and @ref EGraphExtractor
+     * call it themselves after @ref EGraph::Add.
+     *
+     * @return Error, ERROR_BAD_VALUE if classes equal to different numbers would merge,
+     * the rules then disagree about the tree (as about 0 ^ 0) and nothing found is trusted
+     */
+    ErrorCode Rebuild();
+
+    /**
+     * @brief Applies every rule wherever it matches, round after round, until nothing new comes
+     * or a limit is reached. A rule matching too often in a round is left out for a few rounds,
+     * so that commutativity and associativity do not take all the nodes.
+     *
+     * @param [in] limits - the limits, nullptr for the default ones
+     * @param [out] report - what was done, may be nullptr
+     * @return Error, ERROR_BAD_VALUE as from @ref EGraph::Rebuild
+     */
+    ErrorCode Saturate(const EGraphLimits* limits, SaturationReport* report);
+
+    ErrorCode Destructor();
+};
+
+/** @struct EGraphExtractor
+ * @brief Finds the cheapest tree of every class under a cost model. The costs are kept between the calls:
+ * extracting several classes of one e-graph costs one pass, and after more trees are added
+ * or the e-graph is saturated further only the classes that changed and the ones using them are looked at.
+ * The best tree of a class is chosen alone, so a cost depending on the operands' top nodes
+ * (like the brackets of @ref LatexLengthCost) may be a little off.
+ *
+ * @var EGraphExtractor::model - the cost model
+ * @var EGraphExtractor::costs - cost of the cheapest tree of every class, INFINITY if none is known yet
+ * @var EGraphExtractor::best - top node of the cheapest tree of every class
+ * @var EGraphExtractor::known - nodes looked at, the e-graph's nodes from this on are new
+ * @var EGraphExtractor::capacity - allocated entries
+ */
+struct EGraphExtractor
+{
+    CostModel model;
+
+    double* costs;
+    size_t* best;
+    size_t known;
+    size_t capacity;
+
+    ErrorCode Init(CostModel model);
+
+    /**
+     * @brief Brings the costs up to date with the e-graph
+     *
+     * @param [in] graph - the e-graph, always the same one
+     * @return Error
+     */
+    ErrorCode Update(EGraph* graph);
+
+    /**
+     * @brief Builds the cheapest tree of the class
+     *
+     * @param [in] graph - the e-graph, always the same one
+     * @param [in] eclass - the class
+     * @return TreeResult ERROR_BAD_SIZE if the tree would be bigger than MAX_TREE_SIZE
+     */
+    TreeResult Extract(EGraph* graph, size_t eclass);
+
+    ErrorCode Destructor();
+};
+
+/**
+ * @brief Simplifies the tree with an e-graph: the tree is added, saturated and replaced by
+ * the cheapest equal tree. Unlike @ref Optimise it may go through bigger forms to reach a smaller one,
+ * and the result is never more expensive than the tree.
+ *
+ * @param [in] tree - the tree
+ * @param [in] model - what is minimised
+ * @param [in] limits - limits of the saturation, nullptr for the default ones
+ * @param [out] report - what the saturation did, may be nullptr
+ * @return Error
+ */
+ErrorCode OptimiseByEGraph(Tree* tree, CostModel model, const EGraphLimits* limits, SaturationReport* report);
+
+#endif
@@ -0,0 +1,53 @@
+// DEF_RULE(name, pattern, replacement, guard)
+//
+// Rules only @ref EGraph uses, together with SimplifyRules.hpp. Most of them do not make the tree
+// smaller, so @ref Optimise could go round in circles with them, but in an e-graph both sides are kept
+// and the extraction chooses. Written as in SimplifyRules.hpp, except that a replacement
+// may use a letter more than once, the e-graph shares the subtree.
+
+// order of the operands and brackets
+DEF_RULE(ADD_COMMUTE,       "u + v",                    "v + u",                    true)
+DEF_RULE(MUL_COMMUTE,       "u * v",                    "v * u",                    true)
+DEF_RULE(ADD_ASSOCIATE,     "u + v + w",                "u + (v + w)",              true)
+DEF_RULE(ADD_ASSOCIATE_BACK,"u + (v + w)",              "u + v + w",                true)
+DEF_RULE(MUL_ASSOCIATE,     "u * v * w",                "u * (v * w)",              true)
+DEF_RULE(MUL_ASSOCIATE_BACK,"u * (v * w)",              "u * v * w",                true)
+DEF_RULE(ADD_SUB,           "u + (v - w)",              "u + v - w",                true)
+DEF_RULE(ADD_SUB_BACK,      "u + v - w",                "u + (v - w)",              true)
+DEF_RULE(SUB_ADD,           "u - (v + w)",              "u - v - w",                true)
+DEF_RULE(SUB_SUB,           "u - v - w",                "u - (v + w)",              true)
+DEF_RULE(SUB_SUB_RIGHT,     "u - (v - w)",              "u + w - v",                true)
+DEF_RULE(SUB_SWAP,          "u - v + w",                "u + w - v",                true)
+
+// products and quotients
+DEF_RULE(MUL_DIV,           "u * (v / w)",              "u * v / w",                true)
+DEF_RULE(MUL_DIV_BACK,      "u * v / w",                "u * (v / w)",              true)
+DEF_RULE(DIV_MUL,           "u / v * w",                "u * w / v",                true)
+DEF_RULE(DIV_DIV,           "u / v / w",                "u / (v * w)",              true)
+DEF_RULE(DIV_DIV_RIGHT,     "u / (v / w)",              "u * w / v",                true)
+
+// distribution and common factors
+DEF_RULE(MUL_ADD,           "u * (v + w)",              "u * v + u * w",            true)
+DEF_RULE(MUL_SUB,           "u * (v - w)",              "u * v - u * w",            true)
+DEF_RULE(FACTOR_ADD,        "u * v + u * w",            "u * (v + w)",              true)
+DEF_RULE(FACTOR_SUB,        "u * v - u * w",            "u * (v - w)",              true)
+DEF_RULE(DIV_ADD,           "(u + v) / w",              "u / w + v / w",            true)
+DEF_RULE(DIV_SUB,           "(u - v) / w",              "u / w - v / w",            true)
+DEF_RULE(FRACTION_ADD,      "u / w + v / w",            "(u + v) / w",              true)
+DEF_RULE(FRACTION_SUB,      "u / w - v / w",            "(u - v) / w",              true)
+
+// powers, a root of a product is not the product of the roots when the factors are negative
+DEF_RULE(SQUARE,            "u ^ 2",                    "u * u",                    true)
+DEF_RULE(POWER_MUL,         "(u * v) ^ a",              "u ^ a * v ^ a",            NUMBER(a) == floor(NUMBER(a)))
+DEF_RULE(MUL_POWER,         "u ^ a * v ^ a",            "(u * v) ^ a",              NUMBER(a) == floor(NUMBER(a)))
+DEF_RULE(POWER_DIV,         "(u / v) ^ a",              "u ^ a / v ^ a",            NUMBER(a) == floor(NUMBER(a)))
+DEF_RULE(DIV_POWER,         "u ^ a / v ^ a",            "(u / v) ^ a",              NUMBER(a) == floor(NUMBER(a)))
+
+// exponents and trigonometry
+DEF_RULE(EXP_ADD,           "exp(u + v)",               "exp(u) * exp(v)",          true)
+DEF_RULE(EXP_SUB,           "exp(u - v)",               "exp(u) / exp(v)",          true)
+DEF_RULE(TAN_SIN_COS,       "tan(u)",                   "sin(u) / cos(u)",          true)
+DEF_RULE(SIN_DOUBLE,        "sin(2 * u)",               "2 * sin(u) * cos(u)",      true)
+DEF_RULE(SIN_DOUBLE_BACK,   "2 * sin(u) * cos(u)",      "sin(2 * u)",               true)
+DEF_RULE(COS_DOUBLE,        "cos(2 * u)",               "cos(u) ^ 2 - sin(u) ^ 2",  true)
+DEF_RULE(COS_DOUBLE_BACK,   "cos(u) ^ 2 - sin(u) ^ 2",  "cos(2 * u)",               true)
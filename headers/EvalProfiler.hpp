@@ -0,0 +1,103 @@
+//! @file
+
+#ifndef EVAL_PROFILER_HPP
+#define EVAL_PROFILER_HPP
+
+#include <stdint.h>
+#include "CompiledTree.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+#define DEF_FUNC(name, ...) + 1
+[[maybe_unused]] static const size_t OPERATION_COUNT = 0
+#include "DiffFunctions.hpp"
+;
+#undef DEF_FUNC
+
+[[maybe_unused]] static const size_t DEFAULT_HOTTEST_SUBTREES = 5;
+
+/**
+ * @brief Cycle counter used by the profiler, nanoseconds where there is no rdtsc
+ *
+ * @return uint64_t
+ */
+static inline uint64_t ProfilerTicks()
+{
+    #if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+    #else
+    timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+    #endif
+}
+
+/** @struct EvalProfile
+ * @brief Calls and cycles collected by @ref EvaluateBatchProfiled,
+ * accumulates over several runs until Reset.
+ *
+ * @var EvalProfile::points - how many points were evaluated
+ * @var EvalProfile::operationCalls - evaluations of each operation, per point
+ * @var EvalProfile::operationCycles - cycles spent in each operation
+ * @var EvalProfile::instructionCount - size of the profiled compiled tree
+ * @var EvalProfile::instructionCycles - cycles spent in each instruction alone
+ * @var EvalProfile::subtreeCycles - cycles of each instruction together with its operands,
+ * a shared subexpression counts in every subtree using it, filled by @ref EvalProfileWrite
+ */
+struct EvalProfile
+{
+    size_t points;
+
+    size_t   operationCalls [OPERATION_COUNT];
+    uint64_t operationCycles[OPERATION_COUNT];
+
+    size_t instructionCount;
+    uint64_t* instructionCycles;
+    uint64_t* subtreeCycles;
+
+    /**
+     * @brief Makes an empty profile for the compiled tree
+     *
+     * @param [in] compiled - the tree that is going to be profiled
+     * @return Error
+     */
+    ErrorCode Init(const CompiledTree* compiled);
+
+    /**
+     * @brief Zeroes all counters
+     *
+     * @return Error
+     */
+    ErrorCode Reset();
+
+    ErrorCode Destructor();
+};
+
+/**
+ * @brief Prints the operations table and the hottest subtrees in infix form
+ *
+ * @param [in] profile - collected profile
+ * @param [in] compiled - the profiled tree
+ * @param [in] file - where to print
+ * @param [in] hottestCount - how many subtrees to list
+ * @return Error
+ */
+ErrorCode EvalProfileWrite(EvalProfile* profile, const CompiledTree* compiled, FILE* file, size_t hottestCount);
+
+/**
+ * @brief Writes the hottest subtrees as formulas to a tex file
+ *
+ * @param [in] profile - collected profile
+ * @param [in] compiled - the profiled tree
+ * @param [in] texFile - the tex file
+ * @param [in] hottestCount - how many subtrees to list
+ * @return Error
+ */
+ErrorCode EvalProfileWriteTex(EvalProfile* profile, const CompiledTree* compiled, FILE* texFile,
+                              size_t hottestCount);
+
+#endif
@@ -0,0 +1,107 @@
+//! @file
+
+#ifndef EVALUATOR_HPP
+#define EVALUATOR_HPP
+
+#include "CompiledTree.hpp"
+#include "Differentiator.hpp"
+#include "Derivatives.hpp"
+#include "EvalProfiler.hpp"
+
+/**
+ * @brief Evaluates a compiled tree, every variable gets the value var
+ *
+ * @param [in] compiled - the compiled tree
+ * @param [in] var - value of the variable
+ * @return EvalResult
+ */
+EvalResult Evaluate(CompiledTree* compiled, double var);
+
+/**
+ * @brief Evaluates a compiled tree at many points.
+ * Points where a division by zero happens get NAN.
+ * Functions go through the kernels of VectorMath.hpp, so results
+ * can differ from Evaluate by the few ulp documented there.
+ *
+ * @param [in] compiled - the compiled tree
+ * @param [in] vars - values of the variable
+ * @param [out] results - count values
+ * @param [in] count - number of points
+ * @return Error
+ */
+ErrorCode EvaluateBatch(CompiledTree* compiled, const double* vars, double* results, size_t count);
+
+/**
+ * @brief Evaluates every tree of a compiled tree in one pass,
+ * shared subexpressions are computed once
+ *
+ * @param [in] compiled - trees compiled together
+ * @param [in] var - value of the variable
+ * @param [out] results - compiled->outputCount values, all NAN on error
+ * @return Error
+ */
+ErrorCode EvaluateMany(CompiledTree* compiled, double var, double* results);
+
+/**
+ * @brief Evaluates every tree of a compiled tree at many points in one pass.
+ * Points where a division by zero happens get NAN.
+ *
+ * @param [in] compiled - trees compiled together
+ * @param [in] vars - values of the variable
+ * @param [out] results - results of tree i go to results[i * count] .. results[i * count + count - 1]
+ * @param [in] count - number of points
+ * @return Error
+ */
+ErrorCode EvaluateManyBatch(CompiledTree* compiled, const double* vars, double* results, size_t count);
+
+/**
+ * @brief Finds the derivative of the first tree at a point without building it,
+ * the derivatives of all instructions along the variable go forward with their values.
+ * Every variable gets the value var like in @ref Evaluate, only the one chosen is differentiated by.
+ *
+ * @param [in] compiled - the compiled tree
+ * @param [in] variable - the variable to differentiate by, the derivative is 0 if the tree has none
+ * @param [in] var - value of the variables
+ * @return EvalResult
+ */
+EvalResult EvaluateDerivative(CompiledTree* compiled, char variable, double var);
+
+/**
+ * @brief Finds the gradient and the hessian of the first tree at a point without building any derivative.
+ * For every variable the derivatives of all instructions along it go forward and the adjoints
+ * with their derivatives go back (forward-over-reverse), so a column costs two passes over the instructions.
+ *
+ * @param [in] compiled - the compiled tree
+ * @param [in] point - point[i] is the value of compiled->variables[i]
+ * @param [out] gradient - compiled->variableCount values, may be nullptr
+ * @param [out] hessian - compiled->variableCount ^ 2 values row by row, all NAN on error
+ * @return Error
+ */
+ErrorCode EvaluateHessian(CompiledTree* compiled, const double* point, double* gradient, double* hessian);
+
+/**
+ * @brief Evaluates the functions of a system and their jacobian at a point in one pass over the instructions,
+ * the structural zeros are not computed
+ *
+ * @param [in] jacobian - jacobian from @ref FindJacobian
+ * @param [in] point - point[j] is the value of jacobian->compiled.variables[j]
+ * @param [out] values - jacobian->rows values of the functions, may be nullptr
+ * @param [out] matrix - jacobian->rows * jacobian->columns entries row by row, all NAN on error
+ * @return Error
+ */
+ErrorCode EvaluateJacobian(Jacobian* jacobian, const double* point, double* values, double* matrix);
+
+/**
+ * @brief @ref EvaluateBatch that also times every instruction into the profile
+ *
+ * @param [in] compiled - the compiled tree
+ * @param [in] vars - values of the variable
+ * @param [out] results - count values
+ * @param [in] count - number of points
+ * @param [in, out] profile - initialized for this compiled tree, the counters are added to
+ * @return Error
+ */
+ErrorCode EvaluateBatchProfiled(CompiledTree* compiled, const double* vars, double* results, size_t count,
+                                EvalProfile* profile);
+
+#endif
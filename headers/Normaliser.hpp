@@ -0,0 +1,43 @@
+//! @file
+
+#ifndef NORMALISER_HPP
+#define NORMALISER_HPP
+
+#include "Tree.hpp"
+#include "StepObserver.hpp"
+
+/**
+ * @brief Brings the polynomial and rational parts of the tree to a normal form. A part made of
+ * +, -, *, / and integer powers becomes a sum of terms, a term is a number times atoms in integer
+ * powers, an atom is a variable or any other subtree, normalised on its own. Like terms and powers
+ * of the same atom are collected, terms with the same denominator are put over it.
+ * A part is rewritten only if its normal form has fewer nodes, otherwise its own parts are tried.
+ *
+ * @param [in] tree - the tree
+ * @param [in] observer - what is told about the rewritten parts, nullptr to run quietly
+ * @return Error
+ */
+ErrorCode Normalise(Tree* tree, StepObserver* observer);
+
+/**
+ * @brief Tells if a subtree is in the normal form of @ref Normalise already
+ *
+ * @param [in] data - what was given with the check
+ * @param [in] node - root of the subtree
+ * @return true if it is
+ */
+typedef bool IsNormal_t(void* data, TreeNode* node);
+
+/**
+ * @brief @ref Normalise that does not look into the subtrees that are normal already,
+ * such a subtree inside a polynomial part is only converted, so the cost follows what has changed
+ *
+ * @param [in] tree - the tree
+ * @param [in] isNormal - tells which subtrees are normal
+ * @param [in] data - given to the check
+ * @param [in] observer - what is told about the rewritten parts, nullptr to run quietly
+ * @return Error
+ */
+ErrorCode NormaliseChanged(Tree* tree, IsNormal_t* isNormal, void* data, StepObserver* observer);
+
+#endif
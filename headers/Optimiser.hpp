@@ -2,7 +2,93 @@
 #define OPTIMISER_HPP
 
 #include "Tree.hpp"
+#include "StepObserver.hpp"
 
-ErrorCode Optimise(Tree* tree, FILE* texFile);
+/**
+ * @brief Simplifies the tree in place by the rules of SimplifyRules.hpp, then brings it to the normal form
+ * of @ref Normalise, telling the observer about every step
+ *
+ * @param [in] tree - the tree
+ * @param [in] observer - what is told about the steps, nullptr to run quietly
+ * @return Error
+ */
+ErrorCode Optimise(Tree* tree, StepObserver* observer);
+
+/**
+ * @brief Simplifies the tree in place only by the rules of SimplifyRules.hpp, the sums and products
+ * keep their shape, so x - a stays x - a and is not multiplied out
+ *
+ * @param [in] tree - the tree
+ * @param [in] observer - what is told about the steps, nullptr to run quietly
+ * @return Error
+ */
+ErrorCode OptimiseByRules(Tree* tree, StepObserver* observer);
+
+/** @struct SimplifyEntry
+ * @brief A node of @ref SimplifyWorklist
+ *
+ * @var SimplifyEntry::node - the node
+ * @var SimplifyEntry::depth - distance from the root
+ */
+struct SimplifyEntry
+{
+    TreeNode* node;
+    size_t depth;
+};
+
+/** @struct SimplifyWorklist
+ * @brief Simplifies only around the nodes that changed, so the cost follows the amount of change
+ * and not the size of the tree. The deepest node is taken first and puts its parent into the list,
+ * as a rule may compare whole operands, a change anywhere below a node may let it be rewritten.
+ * Going deepest first, a node is never deleted while still in the list and comes out of it once. Until
+ * @ref SimplifyWorklist::Run the nodes in the list must not be deleted or moved.
+ *
+ * @var SimplifyWorklist::entries - binary heap of the nodes, the deepest is on top,
+ * the same nodes are next to each other
+ * @var SimplifyWorklist::size - number of entries
+ * @var SimplifyWorklist::capacity - allocated entries
+ */
+struct SimplifyWorklist
+{
+    SimplifyEntry* entries;
+    size_t size;
+    size_t capacity;
+
+    ErrorCode Init();
+
+    /**
+     * @brief Tells that the node has changed, its subtree must already be simplified
+     *
+     * @param [in] node - the node
+     * @return Error
+     */
+    ErrorCode Push(TreeNode* node);
+
+    /**
+     * @brief Simplifies the nodes and their ancestors until nothing changes, leaves the list empty
+     *
+     * @param [in] observer - what is told about the steps, nullptr to run quietly
+     * @return Error
+     */
+    ErrorCode Run(StepObserver* observer);
+
+    ErrorCode Destructor();
+};
+
+/**
+ * @brief Makes the operation node already simplified by the rules of @ref Optimise
+ * that only look at the operands: two numbers are folded, 0 * u and 0 / u become 0,
+ * 1 * u, u + 0, u - 0, u / 1 and u ^ 1 become u, u ^ 0 and 1 ^ u become 1.
+ * A division by 0 is left as it is for @ref Optimise to report.
+ * The result is a new node or one of the operands, the operands it does not use
+ * are not deleted but given back, somebody may still point to them.
+ *
+ * @param [in] operation - the operation
+ * @param [in] left - the left operand
+ * @param [in] right - the right operand, nullptr for functions of one argument
+ * @param [out] dropped - the operands left out of the result, nullptr in the rest
+ * @return TreeNodeResult
+ */
+TreeNodeResult NewSimplifiedOperation(Operation operation, TreeNode* left, TreeNode* right, TreeNode* dropped[2]);
 
 #endif
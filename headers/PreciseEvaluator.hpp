@@ -0,0 +1,83 @@
+//! @file
+
+#ifndef PRECISE_EVALUATOR_HPP
+#define PRECISE_EVALUATOR_HPP
+
+#include "CompiledTree.hpp"
+#include "DoubleDouble.hpp"
+#include "BigFloat.hpp"
+
+/** @enum EvalPrecision
+ * @brief Arithmetic used to get a value
+ */
+enum EvalPrecision
+{
+    DOUBLE_PRECISION,
+    DOUBLE_DOUBLE_PRECISION,
+    MULTI_PRECISION,
+};
+
+struct DoubleDoubleEvalResult
+{
+    DoubleDouble value;
+    ErrorCode error;
+};
+
+struct BigFloatEvalResult
+{
+    BigFloat value;
+    ErrorCode error;
+};
+
+/** @struct AutoEvalValue
+ * @brief Value found by @ref EvaluateAuto
+ *
+ * @var AutoEvalValue::value - the value rounded to double
+ * @var AutoEvalValue::relativeError - estimated relative error of the arithmetic used
+ * @var AutoEvalValue::precision - the arithmetic that was enough
+ * @var AutoEvalValue::limbs - precision of the multiprecision retry, if it happened
+ */
+struct AutoEvalValue
+{
+    double value;
+    double relativeError;
+    EvalPrecision precision;
+    size_t limbs;
+};
+
+struct AutoEvalResult
+{
+    AutoEvalValue value;
+    ErrorCode error;
+};
+
+/**
+ * @brief Evaluates a compiled tree in double-double arithmetic, every variable gets the value var
+ *
+ * @param [in] compiled - the compiled tree
+ * @param [in] var - value of the variable
+ * @return DoubleDoubleEvalResult
+ */
+DoubleDoubleEvalResult EvaluateDoubleDouble(CompiledTree* compiled, DoubleDouble var);
+
+/**
+ * @brief Evaluates a compiled tree with the precision of var, every variable gets the value var
+ *
+ * @param [in] compiled - the compiled tree
+ * @param [in] var - value of the variable
+ * @return BigFloatEvalResult
+ */
+BigFloatEvalResult EvaluateBigFloat(CompiledTree* compiled, const BigFloat* var);
+
+/**
+ * @brief Evaluates in double together with a running error bound and retries in
+ * double-double or multiprecision only when the bound is above relativeTolerance
+ *
+ * @param [in] compiled - the compiled tree
+ * @param [in] var - value of the variable
+ * @param [in] relativeTolerance - wanted relative error of the result
+ * @return AutoEvalResult
+ */
+AutoEvalResult EvaluateAuto(CompiledTree* compiled, double var, double relativeTolerance);
+
+#endif
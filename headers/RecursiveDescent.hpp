@@ -5,4 +5,6 @@
 
 ErrorCode ParseExpression(Tree* tree, char* string);
 
+ErrorCode ParseSystem(Tree* trees, size_t capacity, size_t* count, char* string);
+
 #endif
@@ -0,0 +1,47 @@
+//! @file
+
+#ifndef REWRITE_RULES_HPP
+#define REWRITE_RULES_HPP
+
+#include "Tree.hpp"
+
+// a pattern variable is a small latin letter
+static const size_t RULE_VARIABLE_COUNT = 26;
+
+/** @struct RuleMatch
+ * @brief A rule of SimplifyRules.hpp that applies to a node
+ *
+ * @var RuleMatch::rule - index of the rule in the table
+ * @var RuleMatch::bound - bound[u - 'a'] is the subtree the pattern variable u stands for
+ */
+struct RuleMatch
+{
+    size_t rule;
+    TreeNode* bound[RULE_VARIABLE_COUNT];
+};
+
+/**
+ * @brief Finds the first rule of SimplifyRules.hpp that applies to the node. On the first call the patterns
+ * are compiled into a discrimination tree, which reads the node once for all the rules together,
+ * so the cost depends on how many rules nearly match and not on how many there are.
+ *
+ * @param [in] node - the node, its operands must already be simplified
+ * @param [out] match - the rule and what its variables stand for
+ * @param [out] found - whether some rule applies
+ * @return Error, ERROR_ZERO_DIVISION for a number divided by 0
+ */
+ErrorCode FindRule(TreeNode* node, RuleMatch* match, bool* found);
+
+/**
+ * @brief Makes the node the replacement of the rule. The subtrees of the variables are moved into
+ * the replacement, the rest of the old node is deleted, the new nodes come out simplified.
+ * The node itself stays where it was, only its own counts are out of date.
+ * On an error the node becomes a NAN number.
+ *
+ * @param [in] node - the node
+ * @param [in] match - what @ref FindRule found for it
+ * @return Error
+ */
+ErrorCode ApplyRule(TreeNode* node, RuleMatch* match);
+
+#endif
@@ -0,0 +1,84 @@
+// DEF_RULE(name, pattern, replacement, guard)
+//
+// Rules of @ref Optimise, the first one in the table that applies to a node is used.
+// In the patterns a, b and c stand for numbers, the other letters for any subtrees,
+// a letter met twice for equal subtrees. A replacement uses a letter at most once.
+// Operations of the replacement with numbers on both sides are computed at once.
+// The guard may use BOUND(u) - the subtree of u, NUMBER(a) - the number of a
+// and IS_NUMBER(u) - whether u is a number.
+
+// numbers, a division by 0 is reported by Optimise
+DEF_RULE(FOLD_ADD,          "a + b",                    "a + b",        true)
+DEF_RULE(FOLD_SUB,          "a - b",                    "a - b",        true)
+DEF_RULE(FOLD_MUL,          "a * b",                    "a * b",        true)
+DEF_RULE(FOLD_DIV,          "a / b",                    "a / b",        NUMBER(b) != 0)
+DEF_RULE(FOLD_POWER,        "a ^ b",                    "a ^ b",        true)
+
+// neutral and absorbing elements
+DEF_RULE(ADD_ZERO_LEFT,     "0 + u",                    "u",            true)
+DEF_RULE(ADD_ZERO_RIGHT,    "u + 0",                    "u",            true)
+DEF_RULE(SUB_ZERO,          "u - 0",                    "u",            true)
+DEF_RULE(MUL_ZERO_LEFT,     "0 * u",                    "0",            true)
+DEF_RULE(MUL_ZERO_RIGHT,    "u * 0",                    "0",            true)
+DEF_RULE(MUL_ONE_LEFT,      "1 * u",                    "u",            true)
+DEF_RULE(MUL_ONE_RIGHT,     "u * 1",                    "u",            true)
+DEF_RULE(DIV_ZERO,          "0 / u",                    "0",            true)
+DEF_RULE(DIV_ONE,           "u / 1",                    "u",            true)
+DEF_RULE(POWER_ZERO_BASE,   "0 ^ u",                    "0",            true)
+DEF_RULE(POWER_ONE_BASE,    "1 ^ u",                    "1",            true)
+DEF_RULE(POWER_ZERO,        "u ^ 0",                    "1",            true)
+DEF_RULE(POWER_ONE,         "u ^ 1",                    "u",            true)
+
+// numbers go first in products, so that they meet
+DEF_RULE(MUL_NUMBER_FIRST,  "u * a",                    "a * u",        !IS_NUMBER(u))
+DEF_RULE(MUL_NUMBERS,       "a * (b * u)",              "a * b * u",    true)
+
+// like terms
+DEF_RULE(SUB_SAME,          "u - u",                    "0",            true)
+DEF_RULE(ADD_SAME,          "u + u",                    "2 * u",        true)
+DEF_RULE(ADD_LIKE,          "a * u + b * u",            "(a + b) * u",  true)
+DEF_RULE(ADD_LIKE_LEFT,     "a * u + u",                "(a + 1) * u",  true)
+DEF_RULE(ADD_LIKE_RIGHT,    "u + a * u",                "(a + 1) * u",  true)
+DEF_RULE(SUB_LIKE,          "a * u - b * u",            "(a - b) * u",  true)
+DEF_RULE(SUB_LIKE_LEFT,     "a * u - u",                "(a - 1) * u",  true)
+DEF_RULE(SUB_LIKE_RIGHT,    "u - a * u",                "(1 - a) * u",  true)
+
+// powers of the same base
+DEF_RULE(MUL_SAME,          "u * u",                    "u ^ 2",        true)
+DEF_RULE(MUL_POWER_LEFT,    "u ^ a * u",                "u ^ (a + 1)",  true)
+DEF_RULE(MUL_POWER_RIGHT,   "u * u ^ a",                "u ^ (a + 1)",  true)
+DEF_RULE(MUL_POWERS,        "u ^ a * u ^ b",            "u ^ (a + b)",  true)
+DEF_RULE(DIV_SAME,          "u / u",                    "1",            true)
+DEF_RULE(DIV_POWER_LEFT,    "u ^ a / u",                "u ^ (a - 1)",  true)
+DEF_RULE(DIV_POWER_RIGHT,   "u / u ^ a",                "u ^ (1 - a)",  true)
+DEF_RULE(DIV_POWERS,        "u ^ a / u ^ b",            "u ^ (a - b)",  true)
+DEF_RULE(POWER_POWER,       "(u ^ a) ^ b",              "u ^ (a * b)",  NUMBER(b) == floor(NUMBER(b)))
+
+// functions at their zeros
+DEF_RULE(SIN_ZERO,          "sin(0)",                   "0",            true)
+DEF_RULE(COS_ZERO,          "cos(0)",                   "1",            true)
+DEF_RULE(TAN_ZERO,          "tan(0)",                   "0",            true)
+DEF_RULE(ARCSIN_ZERO,       "arcsin(0)",                "0",            true)
+DEF_RULE(ARCCOS_ONE,        "arccos(1)",                "0",            true)
+DEF_RULE(ARCTAN_ZERO,       "arctan(0)",                "0",            true)
+DEF_RULE(EXP_ZERO,          "exp(0)",                   "1",            true)
+DEF_RULE(LN_ONE,            "ln(1)",                    "0",            true)
+
+// inverse functions
+DEF_RULE(SIN_ARCSIN,        "sin(arcsin(u))",           "u",            true)
+DEF_RULE(COS_ARCCOS,        "cos(arccos(u))",           "u",            true)
+DEF_RULE(TAN_ARCTAN,        "tan(arctan(u))",           "u",            true)
+DEF_RULE(LN_EXP,            "ln(exp(u))",               "u",            true)
+DEF_RULE(EXP_LN,            "exp(ln(u))",               "u",            true)
+
+// trigonometry and exponents
+DEF_RULE(SIN2_ADD_COS2,     "sin(u) ^ 2 + cos(u) ^ 2",  "1",            true)
+DEF_RULE(COS2_ADD_SIN2,     "cos(u) ^ 2 + sin(u) ^ 2",  "1",            true)
+DEF_RULE(ONE_SUB_SIN2,      "1 - sin(u) ^ 2",           "cos(u) ^ 2",   true)
+DEF_RULE(ONE_SUB_COS2,      "1 - cos(u) ^ 2",           "sin(u) ^ 2",   true)
+DEF_RULE(SIN_DIV_COS,       "sin(u) / cos(u)",          "tan(u)",       true)
+DEF_RULE(TAN_MUL_COS,       "tan(u) * cos(u)",          "sin(u)",       true)
+DEF_RULE(COS_MUL_TAN,       "cos(u) * tan(u)",          "sin(u)",       true)
+DEF_RULE(EXP_MUL_EXP,       "exp(u) * exp(v)",          "exp(u + v)",   true)
+DEF_RULE(EXP_DIV_EXP,       "exp(u) / exp(v)",          "exp(u - v)",   true)
+DEF_RULE(EXP_POWER,         "exp(u) ^ a",               "exp(a * u)",   true)
@@ -0,0 +1,76 @@
+//! @file
+
+#ifndef STEP_OBSERVER_HPP
+#define STEP_OBSERVER_HPP
+
+#include <stdio.h>
+#include "Tree.hpp"
+
+/** @struct StepObserver
+ * @brief What @ref Differentiate and @ref Optimise tell about every step they make.
+ * Any callback may be nullptr, then that step is not reported and costs nothing
+ * but the check, so an observer of nullptrs (or no observer at all) is the quiet fast path.
+ *
+ * @var StepObserver::data - passed to every callback
+ * @var StepObserver::derivativeStart - a tree is going to be differentiated
+ * @var StepObserver::leafDerivative - derivative of a number or a variable
+ * @var StepObserver::needDerivative - the derivative of the node is needed for the current rule
+ * @var StepObserver::foundDerivative - a rule found the derivative of the node
+ * @var StepObserver::repeatedDerivative - the node was already differentiated, its derivative is copied
+ * @var StepObserver::optimiseStart - a tree is going to be simplified
+ * @var StepObserver::simplifyStart - the node is going to be simplified
+ * @var StepObserver::simplified - the node has been simplified
+ */
+struct StepObserver
+{
+    void* data;
+
+    ErrorCode (*derivativeStart)   (void* data, TreeNode* function);
+    ErrorCode (*leafDerivative)    (void* data, TreeNode* leaf, TreeNode* derivative);
+    ErrorCode (*needDerivative)    (void* data, TreeNode* node);
+    ErrorCode (*foundDerivative)   (void* data, TreeNode* node, TreeNode* derivative);
+    ErrorCode (*repeatedDerivative)(void* data, TreeNode* node, TreeNode* derivative);
+
+    ErrorCode (*optimiseStart)     (void* data, TreeNode* root);
+    ErrorCode (*simplifyStart)     (void* data, TreeNode* node);
+    ErrorCode (*simplified)        (void* data, TreeNode* node);
+};
+
+/** @struct StepCounts
+ * @brief Steps counted by @ref CountingObserver
+ */
+struct StepCounts
+{
+    size_t derivatives;
+    size_t leafDerivatives;
+    size_t foundDerivatives;
+    size_t repeatedDerivatives;
+
+    size_t optimisations;
+    size_t simplifications;
+};
+
+#define OBSERVE(observer, step, ...)                                    \
+do                                                                      \
+{                                                                       \
+    if ((observer) && (observer)->step)                                 \
+        RETURN_ERROR((observer)->step((observer)->data, __VA_ARGS__));  \
+} while (0)
+
+/**
+ * @brief Observer writing every step to a tex file, what the program does by default
+ *
+ * @param [in] texFile - the tex file
+ * @return StepObserver
+ */
+StepObserver LatexObserver(FILE* texFile);
+
+/**
+ * @brief Observer only counting the steps
+ *
+ * @param [out] counts - counters, they are added to, not zeroed
+ * @return StepObserver
+ */
+StepObserver CountingObserver(StepCounts* counts);
+
+#endif
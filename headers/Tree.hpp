@@ -6,6 +6,26 @@
 #include "TreeSettings.hpp"
 #include "Utils.hpp"
 
+/** @brief Set of variables, one bit per variable */
+typedef uint64_t VariableMask;
+
+/**
+ * @brief Bit of the variable in a @ref VariableMask. Every letter has its own bit,
+ * anything else shares the last one, so a mask may only say too much, never too little.
+ *
+ * @param [in] var - the variable
+ * @return VariableMask
+ */
+static inline VariableMask VariableBit(char var)
+{
+    if ('a' <= var && var <= 'z')
+        return (VariableMask)1 << (var - 'a');
+    if ('A' <= var && var <= 'Z')
+        return (VariableMask)1 << (var - 'A' + 26);
+
+    return (VariableMask)1 << 63;
+}
+
 struct TreeNodeResult;
 /** @struct TreeNode
  * @brief A binary tree node containing value and ptrs to children
@@ -16,6 +36,8 @@ struct TreeNodeResult;
  * @var TreeNode::parent - TreeNode* parent
  * @var TreeNode::id - size_t id - unique id of a node, used for dumping
  * @var TreeNode::nodeCount - number of all nodes going from the current one
+ * @var TreeNode::variables - variables of all nodes going from the current one,
+ * kept by @ref TreeNode::New, @ref TreeNode::SetLeft, @ref TreeNode::SetRight and @ref TreeNode::Delete
 */
 
 void PrintTreeElement(FILE* file, TreeElement* treeEl);
@@ -33,6 +55,8 @@ struct TreeNode
     size_t nodeCount;
     #endif
 
+    VariableMask variables;
+
     /**
      * @brief Returns a new node result
      *
@@ -72,6 +96,12 @@ struct TreeNode
      * @return Error
      */
     ErrorCode SetRight(TreeNode* right);
+
+    /**
+     * @brief Recalculates @ref TreeNode::nodeCount and @ref TreeNode::variables
+     * from the children, unlike @ref TreeNode::SetLeft the parents are not updated
+     */
+    void UpdateCounts();
 };
 struct TreeNodeResult
 {
@@ -143,7 +173,7 @@ struct Tree
 
     #ifdef SIZE_VERIFICATION
     /**
-     * @brief Recalculates @ref TreeNode::nodeCount for every node in tree
+     * @brief Recalculates @ref TreeNode::nodeCount and @ref TreeNode::variables for every node in tree
      *
      * @return Error
      */
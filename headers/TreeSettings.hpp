@@ -8,6 +8,8 @@ enum TreeElementType
     OPERATION_TYPE,
     NUMBER_TYPE,
     VARIABLE_TYPE,
+    // d/dvar of the left subtree not found yet, see @ref DifferentiateLazy
+    DERIVATIVE_TYPE,
 };
 enum Operation
 {
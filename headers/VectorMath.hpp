@@ -0,0 +1,67 @@
+//! @file
+
+#ifndef VECTOR_MATH_HPP
+#define VECTOR_MATH_HPP
+
+#include <stddef.h>
+#include "Utils.hpp"
+
+/** @enum VectorMathIsa
+ * @brief Which implementation the Vec* functions use.
+ *
+ * Measured max errors against a double-double reference
+ * (the same for every ISA except libm, which is glibc's own):
+ *
+ * | function | domain tested           | max error |
+ * |----------|-------------------------|-----------|
+ * | sin, cos | |x| <= 1e5              | 0.8 ulp   |
+ * | tan      | |x| <= 1e5              | 2.1 ulp   |
+ * | exp      | -745 <= x <= 709.78     | 1 ulp     |
+ * | ln       | all positive            | 0.8 ulp   |
+ * | arctan   | all                     | 0.9 ulp   |
+ * | arcsin   | |x| <= 1                | 2.5 ulp   |
+ * | arccos   | |x| <= 1                | 2 ulp     |
+ *
+ * sin, cos and tan hand |x| > 1e5 to libm, subnormal results of exp
+ * can be 1 ulp worse.
+ */
+enum VectorMathIsa
+{
+    VECTOR_MATH_LIBM,   ///< glibc, one call per element
+    VECTOR_MATH_SCALAR, ///< the kernels one element at a time, the reference
+    VECTOR_MATH_AVX2,   ///< the kernels 4 elements at a time
+    VECTOR_MATH_AVX512, ///< the kernels 8 elements at a time
+};
+
+//! names of @ref VectorMathIsa for printing
+extern const char* const VECTOR_MATH_ISA_NAMES[];
+
+/**
+ * @brief The fastest ISA this cpu supports
+ *
+ * @return VectorMathIsa
+ */
+VectorMathIsa VectorMathBestIsa();
+
+VectorMathIsa VectorMathGetIsa();
+
+/**
+ * @brief Chooses the implementation for all Vec* functions,
+ * by default the best one is used
+ *
+ * @param [in] isa - the implementation
+ * @return ERROR_BAD_VALUE if the cpu does not support it
+ */
+ErrorCode VectorMathSetIsa(VectorMathIsa isa);
+
+// y[i] = f(x[i]), x and y may be the same array
+void VecSin   (const double* x, double* y, size_t count);
+void VecCos   (const double* x, double* y, size_t count);
+void VecTan   (const double* x, double* y, size_t count);
+void VecArcsin(const double* x, double* y, size_t count);
+void VecArccos(const double* x, double* y, size_t count);
+void VecArctan(const double* x, double* y, size_t count);
+void VecExp   (const double* x, double* y, size_t count);
+void VecLn    (const double* x, double* y, size_t count);
+
+#endif
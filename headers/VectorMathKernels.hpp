@@ -0,0 +1,372 @@
+// The kernels behind VectorMath.hpp, included once per ISA by VectorMath.cpp.
+// The includer defines
+// VEC_NAME(name) - makes a name unique for the ISA
+// VEC_WIDTH      - lanes in a vector
+// VecDouble_t    - VEC_WIDTH doubles
+// VecInt_t       - VEC_WIDTH int64_t
+// VEC_SQRT(x)    - square root of every lane
+// With VEC_WIDTH 1 these are plain double and int64_t and comparisons give bool,
+// so every kernel only uses what works the same on scalars and GCC vectors.
+
+static inline VecDouble_t VEC_NAME(_set)(double x)
+{
+    VecDouble_t zero = {};
+    return zero + x;
+}
+
+// rounds to the nearest integer and also gives it as an int64_t, |x| < 2 ^ 51.
+// Bigger lanes are clamped, their results are thrown away by the callers, but the bits
+// of x + VEC_ROUND_MAGIC minus the magic's bits would overflow for them
+static inline VecDouble_t VEC_NAME(_round)(VecDouble_t x, VecInt_t* integer)
+{
+    VecDouble_t clamped = x > VEC_ROUND_MAX ? VEC_NAME(_set)(VEC_ROUND_MAX) : x;
+    clamped = clamped < -VEC_ROUND_MAX ? VEC_NAME(_set)(-VEC_ROUND_MAX) : clamped;
+
+    VecDouble_t shifted = clamped + VEC_ROUND_MAGIC;
+    *integer = __builtin_bit_cast(VecInt_t, shifted) - __builtin_bit_cast(int64_t, VEC_ROUND_MAGIC);
+
+    return shifted - VEC_ROUND_MAGIC;
+}
+
+static inline VecDouble_t VEC_NAME(_fromInt)(VecInt_t x)
+{
+    return __builtin_bit_cast(VecDouble_t, x + __builtin_bit_cast(int64_t, VEC_ROUND_MAGIC)) - VEC_ROUND_MAGIC;
+}
+
+// 2 ^ k for -1022 <= k <= 1023
+static inline VecDouble_t VEC_NAME(_pow2)(VecInt_t k)
+{
+    return __builtin_bit_cast(VecDouble_t, ((k + 1023) & 0x7ff) << 52);
+}
+
+// e ^ x = 2 ^ k * e ^ r, |r| <= ln2 / 2, e ^ r by its Taylor series up to r ^ 13
+static inline VecDouble_t VEC_NAME(_exp)(VecDouble_t x)
+{
+    VecDouble_t clamped = x > VEC_EXP_CLAMP_MAX ? VEC_NAME(_set)(VEC_EXP_CLAMP_MAX) : x;
+    clamped = clamped < VEC_EXP_CLAMP_MIN ? VEC_NAME(_set)(VEC_EXP_CLAMP_MIN) : clamped;
+
+    VecInt_t k = {};
+    VecDouble_t kd = VEC_NAME(_round)(clamped * VEC_LOG2E, &k);
+
+    VecDouble_t r = (clamped - kd * VEC_LN2_HI) - kd * VEC_LN2_LO;
+
+    VecDouble_t poly = VEC_NAME(_set)(VEC_EXP_COEFFS[0]);
+    for (size_t i = 1; i < sizeof(VEC_EXP_COEFFS) / sizeof(*VEC_EXP_COEFFS); i++)
+        poly = poly * r + VEC_EXP_COEFFS[i];
+
+    VecDouble_t expR = 1 + (r + r * r * poly);
+
+    // two steps so that neither 2 ^ 1024 nor subnormal 2 ^ k are needed
+    VecInt_t k1 = k >> 1;
+    VecDouble_t result = expR * VEC_NAME(_pow2)(k1) * VEC_NAME(_pow2)(k - k1);
+
+    result = x > VEC_EXP_MAX ? VEC_NAME(_set)(INFINITY) : result;
+    result = x < VEC_EXP_MIN ? VEC_NAME(_set)(0)        : result;
+
+    return x != x ? x : result;
+}
+
+// x = 2 ^ e * m, sqrt(2) / 2 <= m < sqrt(2), ln(m) = ln(1 + f) by fdlibm's polynomial in s = f / (2 + f)
+static inline VecDouble_t VEC_NAME(_ln)(VecDouble_t x)
+{
+    VecInt_t subnormal = x < VEC_DOUBLE_MIN;
+    VecDouble_t scaled = subnormal ? x * VEC_SUBNORMAL_SCALE : x;
+
+    VecInt_t bits = __builtin_bit_cast(VecInt_t, scaled);
+    VecInt_t e = ((bits >> 52) & 0x7ff) - 1023;
+    e = subnormal ? e - VEC_SUBNORMAL_SCALE_LOG2 : e;
+
+    VecDouble_t m = __builtin_bit_cast(VecDouble_t, (bits & VEC_MANTISSA_MASK) | VEC_ONE_BITS);
+
+    VecInt_t big = m > M_SQRT2;
+    m = big ? m * 0.5 : m;
+    e = big ? e + 1   : e;
+
+    VecDouble_t f = m - 1;
+    VecDouble_t s = f / (2 + f);
+    VecDouble_t z = s * s;
+    VecDouble_t w = z * z;
+
+    VecDouble_t odd  = w * (VEC_LN_COEFFS[1] + w * (VEC_LN_COEFFS[3] + w * VEC_LN_COEFFS[5]));
+    VecDouble_t even = z * (VEC_LN_COEFFS[0] + w * (VEC_LN_COEFFS[2] + w * (VEC_LN_COEFFS[4] + w * VEC_LN_COEFFS[6])));
+    VecDouble_t R = odd + even;
+
+    VecDouble_t halfF2 = 0.5 * f * f;
+    VecDouble_t ed = VEC_NAME(_fromInt)(e);
+
+    VecDouble_t result = ed * VEC_LN2_HI - ((halfF2 - (s * (halfF2 + R) + ed * VEC_LN2_LO)) - f);
+
+    result = x == INFINITY ? x                               : result;
+    result = x == 0        ? VEC_NAME(_set)(-INFINITY)       : result;
+    result = x < 0         ? VEC_NAME(_set)(NAN)             : result;
+
+    return x != x ? x : result;
+}
+
+// x = k * pi / 2 + r + tail, |r| <= pi / 4, pi / 2 is split in 33 bit parts so k * part is exact
+static inline VecDouble_t VEC_NAME(_reducePi2)(VecDouble_t x, VecDouble_t* tail, VecInt_t* quadrant)
+{
+    VecDouble_t kd = VEC_NAME(_round)(x * M_2_PI, quadrant);
+
+    VecDouble_t a = x - kd * VEC_PI2_1;
+    VecDouble_t b = kd * VEC_PI2_2;
+
+    // two sum, a - b is not exact when it does not cancel
+    VecDouble_t r = a - b;
+    VecDouble_t bb = a - r;
+    VecDouble_t lo = ((a - (r + bb)) + (bb - b)) - kd * VEC_PI2_3 - kd * VEC_PI2_3_TAIL;
+
+    VecDouble_t hi = r + lo;
+    *tail = lo - (hi - r);
+
+    return hi;
+}
+
+// fdlibm's __kernel_sin
+static inline VecDouble_t VEC_NAME(_sinPoly)(VecDouble_t r, VecDouble_t tail)
+{
+    VecDouble_t z = r * r;
+    VecDouble_t v = z * r;
+
+    VecDouble_t poly = VEC_NAME(_set)(VEC_SIN_COEFFS[5]);
+    for (size_t i = 5; i-- > 1;)
+        poly = poly * z + VEC_SIN_COEFFS[i];
+
+    return r - ((z * (0.5 * tail - v * poly) - tail) - v * VEC_SIN_COEFFS[0]);
+}
+
+// fdlibm's __kernel_cos
+static inline VecDouble_t VEC_NAME(_cosPoly)(VecDouble_t r, VecDouble_t tail)
+{
+    VecDouble_t z = r * r;
+
+    VecDouble_t poly = VEC_NAME(_set)(VEC_COS_COEFFS[5]);
+    for (size_t i = 5; i-- > 0;)
+        poly = poly * z + VEC_COS_COEFFS[i];
+
+    VecDouble_t halfZ = 0.5 * z;
+    VecDouble_t w = 1 - halfZ;
+
+    return w + (((1 - w) - halfZ) + (z * z * poly - r * tail));
+}
+
+// sin(x + offset * pi / 2)
+static inline VecDouble_t VEC_NAME(_sinQuadrant)(VecDouble_t x, int64_t offset)
+{
+    VecDouble_t tail = {};
+    VecInt_t quadrant = {};
+    VecDouble_t r = VEC_NAME(_reducePi2)(x, &tail, &quadrant);
+    quadrant = quadrant + offset;
+
+    VecDouble_t result = (quadrant & 1) != 0 ? VEC_NAME(_cosPoly)(r, tail) : VEC_NAME(_sinPoly)(r, tail);
+
+    return (quadrant & 2) != 0 ? -result : result;
+}
+
+static inline VecDouble_t VEC_NAME(_sin)(VecDouble_t x)
+{
+    // keeps the sign of -0
+    return x == 0 ? x : VEC_NAME(_sinQuadrant)(x, 0);
+}
+
+static inline VecDouble_t VEC_NAME(_cos)(VecDouble_t x)
+{
+    return VEC_NAME(_sinQuadrant)(x, 1);
+}
+
+// tan(k * pi / 2 + r) = tan(r) or -1 / tan(r)
+static inline VecDouble_t VEC_NAME(_tan)(VecDouble_t x)
+{
+    VecDouble_t tail = {};
+    VecInt_t quadrant = {};
+    VecDouble_t r = VEC_NAME(_reducePi2)(x, &tail, &quadrant);
+
+    VecDouble_t sinR = VEC_NAME(_sinPoly)(r, tail);
+    VecDouble_t cosR = VEC_NAME(_cosPoly)(r, tail);
+
+    VecDouble_t result = (quadrant & 1) != 0 ? -cosR / sinR : sinR / cosR;
+
+    return x == 0 ? x : result;
+}
+
+// arctan(t) = arctan(c) + arctan(u), u = (t - c) / (1 + c * t), |u| < 7 / 16,
+// the reduction and the polynomial are fdlibm's
+static inline VecDouble_t VEC_NAME(_arctan)(VecDouble_t x)
+{
+    VecDouble_t t = x < 0 ? -x : x;
+
+    VecInt_t reduced = t >= VEC_ATAN_BOUNDS[0];
+
+    // c is 0.5, 1, 1.5 or infinity, u = (t - c) / (1 + c * t) written so that nothing overflows
+    VecDouble_t numerator   = 2 * t - 1;
+    VecDouble_t denominator = 2 + t;
+    VecDouble_t baseHi = VEC_NAME(_set)(VEC_ATAN_HI[0]);
+    VecDouble_t baseLo = VEC_NAME(_set)(VEC_ATAN_LO[0]);
+
+    VecInt_t range = t >= VEC_ATAN_BOUNDS[1];
+    numerator   = range ? t - 1 : numerator;
+    denominator = range ? t + 1 : denominator;
+    baseHi      = range ? VEC_NAME(_set)(VEC_ATAN_HI[1]) : baseHi;
+    baseLo      = range ? VEC_NAME(_set)(VEC_ATAN_LO[1]) : baseLo;
+
+    range = t >= VEC_ATAN_BOUNDS[2];
+    numerator   = range ? t - 1.5     : numerator;
+    denominator = range ? 1 + 1.5 * t : denominator;
+    baseHi      = range ? VEC_NAME(_set)(VEC_ATAN_HI[2]) : baseHi;
+    baseLo      = range ? VEC_NAME(_set)(VEC_ATAN_LO[2]) : baseLo;
+
+    range = t >= VEC_ATAN_BOUNDS[3];
+    numerator   = range ? VEC_NAME(_set)(-1) : numerator;
+    denominator = range ? t                  : denominator;
+    baseHi      = range ? VEC_NAME(_set)(VEC_ATAN_HI[3]) : baseHi;
+    baseLo      = range ? VEC_NAME(_set)(VEC_ATAN_LO[3]) : baseLo;
+
+    VecDouble_t u = reduced ? numerator / denominator : t;
+
+    VecDouble_t z = u * u;
+    VecDouble_t w = z * z;
+
+    VecDouble_t even = VEC_NAME(_set)(VEC_ATAN_COEFFS[10]);
+    for (size_t i = 10; i >= 2; i -= 2)
+        even = even * w + VEC_ATAN_COEFFS[i - 2];
+
+    VecDouble_t odd = VEC_NAME(_set)(VEC_ATAN_COEFFS[9]);
+    for (size_t i = 9; i >= 3; i -= 2)
+        odd = odd * w + VEC_ATAN_COEFFS[i - 2];
+
+    VecDouble_t polyPart = u * (z * even + w * odd);
+
+    VecDouble_t result = reduced ? baseHi - ((polyPart - baseLo) - u) : u - polyPart;
+
+    result = x < 0 ? -result : result;
+
+    return x == 0 ? x : result;
+}
+
+// arcsin(x) = arctan(x / sqrt((1 - x) * (1 + x)))
+static inline VecDouble_t VEC_NAME(_arcsin)(VecDouble_t x)
+{
+    VecDouble_t cosY = VEC_SQRT((1 - x) * (1 + x));
+
+    return VEC_NAME(_arctan)(x / cosY);
+}
+
+// arccos(x) = 2 * arctan(sqrt((1 - x) / (1 + x)))
+static inline VecDouble_t VEC_NAME(_arccos)(VecDouble_t x)
+{
+    VecDouble_t tanHalf = VEC_SQRT((1 - x) / (1 + x));
+
+    return 2 * VEC_NAME(_arctan)(tanHalf);
+}
+
+static inline bool VEC_NAME(_allSet)(VecInt_t mask)
+{
+    int64_t lanes[VEC_WIDTH] = {};
+    memcpy(lanes, &mask, sizeof(mask));
+
+    for (size_t lane = 0; lane < VEC_WIDTH; lane++)
+        if (!lanes[lane])
+            return false;
+
+    return true;
+}
+
+// kernel of VEC_WIDTH values, lanes with |x| > limit go to fallback instead
+static inline VecDouble_t VEC_NAME(_applyOnce)(VecDouble_t (*kernel)(VecDouble_t),
+                                               double (*fallback)(double), double limit,
+                                               VecDouble_t x)
+{
+    VecDouble_t y = kernel(x);
+
+    if (!fallback || VEC_NAME(_allSet)((x < 0 ? -x : x) <= limit))
+        return y;
+
+    double in[VEC_WIDTH] = {};
+    double out[VEC_WIDTH] = {};
+    memcpy(in, &x, sizeof(x));
+    memcpy(out, &y, sizeof(y));
+
+    for (size_t lane = 0; lane < VEC_WIDTH; lane++)
+        if (!(fabs(in[lane]) <= limit))
+            out[lane] = fallback(in[lane]);
+
+    memcpy(&y, out, sizeof(y));
+
+    return y;
+}
+
+static inline void VEC_NAME(_applyKernel)(VecDouble_t (*kernel)(VecDouble_t),
+                                          double (*fallback)(double), double limit,
+                                          const double* x, double* y, size_t count)
+{
+    size_t start = 0;
+
+    for (; start + VEC_WIDTH <= count; start += VEC_WIDTH)
+    {
+        VecDouble_t v = {};
+        memcpy(&v, x + start, sizeof(v));
+        v = VEC_NAME(_applyOnce)(kernel, fallback, limit, v);
+        memcpy(y + start, &v, sizeof(v));
+    }
+
+    if (start == count)
+        return;
+
+    // the tail is padded with zeros, every kernel takes them
+    double tail[VEC_WIDTH] = {};
+    memcpy(tail, x + start, (count - start) * sizeof(*tail));
+
+    VecDouble_t v = {};
+    memcpy(&v, tail, sizeof(v));
+    v = VEC_NAME(_applyOnce)(kernel, fallback, limit, v);
+    memcpy(tail, &v, sizeof(v));
+
+    memcpy(y + start, tail, (count - start) * sizeof(*tail));
+}
+
+static void VEC_NAME(Sin)(const double* x, double* y, size_t count)
+{
+    VEC_NAME(_applyKernel)(VEC_NAME(_sin), sin, VEC_SIN_COS_MAX, x, y, count);
+}
+
+static void VEC_NAME(Cos)(const double* x, double* y, size_t count)
+{
+    VEC_NAME(_applyKernel)(VEC_NAME(_cos), cos, VEC_SIN_COS_MAX, x, y, count);
+}
+
+static void VEC_NAME(Tan)(const double* x, double* y, size_t count)
+{
+    VEC_NAME(_applyKernel)(VEC_NAME(_tan), tan, VEC_SIN_COS_MAX, x, y, count);
+}
+
+static void VEC_NAME(Arcsin)(const double* x, double* y, size_t count)
+{
+    VEC_NAME(_applyKernel)(VEC_NAME(_arcsin), nullptr, 0, x, y, count);
+}
+
+static void VEC_NAME(Arccos)(const double* x, double* y, size_t count)
+{
+    VEC_NAME(_applyKernel)(VEC_NAME(_arccos), nullptr, 0, x, y, count);
+}
+
+static void VEC_NAME(Arctan)(const double* x, double* y, size_t count)
+{
+    VEC_NAME(_applyKernel)(VEC_NAME(_arctan), nullptr, 0, x, y, count);
+}
+
+static void VEC_NAME(Exp)(const double* x, double* y, size_t count)
+{
+    VEC_NAME(_applyKernel)(VEC_NAME(_exp), nullptr, 0, x, y, count);
+}
+
+static void VEC_NAME(Ln)(const double* x, double* y, size_t count)
+{
+    VEC_NAME(_applyKernel)(VEC_NAME(_ln), nullptr, 0, x, y, count);
+}
+
+static const VectorMathTable VEC_NAME(TABLE) =
+{
+    VEC_NAME(Sin),    VEC_NAME(Cos),    VEC_NAME(Tan),
+    VEC_NAME(Arcsin), VEC_NAME(Arccos), VEC_NAME(Arctan),
+    VEC_NAME(Exp),    VEC_NAME(Ln),
+};
@@ -0,0 +1,97 @@
+//! @file
+
+#ifndef WORK_POOL_HPP
+#define WORK_POOL_HPP
+
+#include <pthread.h>
+#include "Utils.hpp"
+
+/** @struct WorkTask
+ * @brief A piece of work for @ref WorkPool, lives in its creator's memory until waited for
+ *
+ * @var WorkTask::run - the work
+ * @var WorkTask::arg - passed to run
+ * @var WorkTask::error - what run returned, valid after Wait
+ * @var WorkTask::done - set when run has finished
+ */
+struct WorkTask
+{
+    ErrorCode (*run)(void* arg);
+    void* arg;
+
+    ErrorCode error;
+    bool done;
+};
+
+/** @struct WorkDeque
+ * @brief Tasks of one worker. The owner takes the newest ones, thieves take the oldest ones.
+ */
+struct WorkDeque
+{
+    pthread_mutex_t mutex;
+
+    WorkTask** tasks;
+    size_t head;
+    size_t tail;
+    size_t capacity;
+};
+
+/** @struct WorkPool
+ * @brief Fork-join pool with work stealing. A task spawns subtasks into its worker's deque
+ * and waits for them, running other tasks meanwhile, idle workers steal from the others.
+ * Worker 0 is the thread calling @ref WorkPool::Run, so only one Run at a time.
+ *
+ * @var WorkPool::workerCount - number of workers with the calling thread
+ * @var WorkPool::deques - a deque per worker
+ * @var WorkPool::threads - workers 1..workerCount - 1
+ * @var WorkPool::pending - tasks in all deques
+ */
+struct WorkPool
+{
+    size_t workerCount;
+    WorkDeque* deques;
+    pthread_t* threads;
+
+    pthread_mutex_t runMutex;
+    pthread_mutex_t sleepMutex;
+    pthread_cond_t  sleepCondition;
+
+    size_t pending;
+    bool stop;
+
+    /**
+     * @brief Starts the workers
+     *
+     * @param [in] workerCount - number of workers counting the calling thread, 0 for one per cpu
+     * @return Error
+     */
+    ErrorCode Init(size_t workerCount);
+
+    /**
+     * @brief Runs the task on the calling thread as worker 0, the pool helps with its subtasks
+     *
+     * @param [in] task - the root task
+     * @return what the task returned
+     */
+    ErrorCode Run(WorkTask* task);
+
+    /**
+     * @brief Lets other workers take the task, runs it at once outside of the pool
+     *
+     * @param [in] task - the task
+     * @return Error
+     */
+    ErrorCode Spawn(WorkTask* task);
+
+    /**
+     * @brief Runs other tasks until the spawned task is done
+     *
+     * @param [in] task - the task
+     * @return what the task returned
+     */
+    ErrorCode Wait(WorkTask* task);
+
+    ErrorCode Destructor();
+};
+
+#endif
@@ -0,0 +1,984 @@
+#include <math.h>
+#include <string.h>
+#include "BigFloat.hpp"
+#include "MinMax.hpp"
+
+static const size_t WORK_LIMBS        = 2 * BIG_FLOAT_CAPACITY + 2;
+static const int    EXP_HALVINGS      = 24;
+static const double MAX_EXP_ARGUMENT  = 1e15;
+static const double MAX_TRIG_ARGUMENT = 1e15;
+static const double LOG10_2           = 0.30102999566398120;
+static const double LOG2_10           = 3.32192809488736235;
+static const int64_t MAX_INTEGER_POWER = (int64_t)1 << 31;
+
+static BigFloat PI_CACHE  = {};
+static BigFloat LN2_CACHE = {};
+
+static BigFloat _bigNan(size_t limbs);
+
+static BigFloat _bigZero(size_t limbs);
+
+static BigFloat _bigFromInt(int64_t x, size_t limbs);
+
+static BigFloat _bigPack(int sign, int64_t exponent, const uint32_t* work, size_t length, size_t limbs);
+
+static void _shiftInto(uint32_t* dst, size_t dstLength, const uint32_t* src, size_t srcLength, size_t bitOffset);
+
+static int _bigCompareAbs(const BigFloat* a, const BigFloat* b);
+
+static BigFloat _bigAddSigned(const BigFloat* a, const BigFloat* b, int bSign);
+
+static BigFloat _bigDivSmall(const BigFloat* a, uint32_t divisor);
+
+static BigFloat _bigMulPow2(const BigFloat* a, int64_t power);
+
+static bool _bigIsNegligible(const BigFloat* term, const BigFloat* sum, size_t limbs);
+
+static bool _bigToInteger(const BigFloat* x, int64_t* integer);
+
+static BigFloat _bigIntegerPow(const BigFloat* base, int64_t power);
+
+static BigFloat _bigArctanInverse(uint32_t inverse, size_t limbs);
+
+static BigFloat _bigPi(size_t limbs);
+
+static BigFloat _bigLn2(size_t limbs);
+
+static void _bigSinCos(const BigFloat* x, BigFloat* sinx, BigFloat* cosx);
+
+static size_t _workLimbs(size_t limbs);
+
+size_t BigFloatLimbsForDigits(size_t digits)
+{
+    size_t limbs = (size_t)ceil((double)digits * LOG2_10 / BIG_FLOAT_LIMB_BITS) + 1;
+
+    return min(max(limbs, (size_t)2), BIG_FLOAT_MAX_LIMBS);
+}
+
+static size_t _workLimbs(size_t limbs)
+{
+    return min(limbs + BIG_FLOAT_GUARD_LIMBS, BIG_FLOAT_CAPACITY);
+}
+
+static BigFloat _bigNan(size_t limbs)
+{
+    BigFloat result = {};
+    result.isNan = true;
+    result.limbs = limbs;
+
+    return result;
+}
+
+static BigFloat _bigZero(size_t limbs)
+{
+    BigFloat result = {};
+    result.limbs = limbs;
+
+    return result;
+}
+
+static BigFloat _bigFromInt(int64_t x, size_t limbs)
+{
+    uint64_t absX = x < 0 ? (uint64_t)(-(x + 1)) + 1 : (uint64_t)x;
+    uint32_t work[2] = { (uint32_t)(absX >> 32), (uint32_t)absX };
+
+    return _bigPack(x < 0 ? -1 : 1, 64, work, 2, limbs);
+}
+
+BigFloat BigFloatFromDouble(double x, size_t limbs)
+{
+    limbs = min(max(limbs, (size_t)2), BIG_FLOAT_CAPACITY);
+
+    if (!isfinite(x))
+        return _bigNan(limbs);
+    if (x == 0)
+        return _bigZero(limbs);
+
+    int exponent = 0;
+    double fraction = frexp(fabs(x), &exponent);
+
+    uint64_t bits = (uint64_t)ldexp(fraction, 64);
+
+    BigFloat result = _bigZero(limbs);
+    result.sign = x < 0 ? -1 : 1;
+    result.exponent = exponent;
+    result.mantissa[0] = (uint32_t)(bits >> 32);
+    result.mantissa[1] = (uint32_t)bits;
+
+    return result;
+}
+
+double BigFloatToDouble(const BigFloat* x)
+{
+    if (x->isNan)
+        return NAN;
+    if (x->sign == 0)
+        return 0;
+
+    uint64_t bits = ((uint64_t)x->mantissa[0] << 32) | (x->limbs > 1 ? x->mantissa[1] : 0);
+
+    if (x->exponent > 2048)
+        return x->sign * INFINITY;
+    if (x->exponent < -2048)
+        return x->sign * 0.0;
+
+    return x->sign * ldexp((double)bits, (int)x->exponent - 64);
+}
+
+BigFloat BigFloatSetPrecision(const BigFloat* x, size_t limbs)
+{
+    limbs = min(max(limbs, (size_t)2), BIG_FLOAT_CAPACITY);
+
+    if (x->isNan)
+        return _bigNan(limbs);
+    if (x->sign == 0)
+        return _bigZero(limbs);
+
+    return _bigPack(x->sign, x->exponent, x->mantissa, x->limbs, limbs);
+}
+
+// work holds 0.work * 2 ^ exponent, the result is normalized and rounded to nearest
+static BigFloat _bigPack(int sign, int64_t exponent, const uint32_t* work, size_t length, size_t limbs)
+{
+    size_t first = 0;
+    while (first < length && work[first] == 0)
+        first++;
+
+    if (first == length)
+        return _bigZero(limbs);
+
+    int leadingZeros = __builtin_clz(work[first]);
+    exponent -= (int64_t)(first * BIG_FLOAT_LIMB_BITS) + leadingZeros;
+
+    BigFloat result = _bigZero(limbs);
+    result.sign = sign;
+    result.exponent = exponent;
+
+    uint32_t roundLimb = 0;
+
+    for (size_t i = 0; i <= limbs; i++)
+    {
+        size_t index = first + i;
+
+        uint32_t high = index     < length ? work[index]     : 0;
+        uint32_t low  = index + 1 < length ? work[index + 1] : 0;
+
+        uint32_t limb = leadingZeros ? (high << leadingZeros) | (low >> (32 - leadingZeros)) : high;
+
+        if (i < limbs)
+            result.mantissa[i] = limb;
+        else
+            roundLimb = limb;
+    }
+
+    if (roundLimb & 0x80000000u)
+    {
+        size_t i = limbs;
+        while (i > 0 && ++result.mantissa[i - 1] == 0)
+            i--;
+
+        if (i == 0)
+        {
+            result.mantissa[0] = 0x80000000u;
+            result.exponent++;
+        }
+    }
+
+    return result;
+}
+
+// places src into dst starting from the bit number bitOffset, bits that do not fit are dropped
+static void _shiftInto(uint32_t* dst, size_t dstLength, const uint32_t* src, size_t srcLength, size_t bitOffset)
+{
+    memset(dst, 0, dstLength * sizeof(*dst));
+
+    size_t limbOffset = bitOffset / BIG_FLOAT_LIMB_BITS;
+    size_t bitShift   = bitOffset % BIG_FLOAT_LIMB_BITS;
+
+    for (size_t i = 0; i < srcLength && i + limbOffset < dstLength; i++)
+    {
+        size_t j = i + limbOffset;
+
+        if (bitShift == 0)
+            dst[j] |= src[i];
+        else
+        {
+            dst[j] |= src[i] >> bitShift;
+            if (j + 1 < dstLength)
+                dst[j + 1] |= src[i] << (32 - bitShift);
+        }
+    }
+}
+
+static int _bigCompareAbs(const BigFloat* a, const BigFloat* b)
+{
+    if (a->sign == 0 || b->sign == 0)
+        return (a->sign != 0) - (b->sign != 0);
+
+    if (a->exponent != b->exponent)
+        return a->exponent > b->exponent ? 1 : -1;
+
+    size_t length = max(a->limbs, b->limbs);
+
+    for (size_t i = 0; i < length; i++)
+    {
+        uint32_t aLimb = i < a->limbs ? a->mantissa[i] : 0;
+        uint32_t bLimb = i < b->limbs ? b->mantissa[i] : 0;
+
+        if (aLimb != bLimb)
+            return aLimb > bLimb ? 1 : -1;
+    }
+
+    return 0;
+}
+
+BigFloat BigFloatNeg(const BigFloat* x)
+{
+    BigFloat result = *x;
+    result.sign = -result.sign;
+
+    return result;
+}
+
+static BigFloat _bigAddSigned(const BigFloat* a, const BigFloat* b, int bSign)
+{
+    size_t limbs = max(a->limbs, b->limbs);
+
+    if (a->isNan || b->isNan)
+        return _bigNan(limbs);
+
+    if (b->sign == 0)
+        return BigFloatSetPrecision(a, limbs);
+
+    if (a->sign == 0)
+    {
+        BigFloat result = BigFloatSetPrecision(b, limbs);
+        result.sign = bSign;
+        return result;
+    }
+
+    const BigFloat* big   = a;
+    const BigFloat* small = b;
+    int bigSign   = a->sign;
+    int smallSign = bSign;
+
+    if (_bigCompareAbs(a, b) < 0)
+    {
+        big   = b;
+        small = a;
+        bigSign   = bSign;
+        smallSign = a->sign;
+    }
+
+    // one limb in front for the carry and two behind for rounding
+    size_t length = limbs + 3;
+    uint64_t shift = (uint64_t)(big->exponent - small->exponent);
+
+    if (shift >= length * BIG_FLOAT_LIMB_BITS)
+    {
+        BigFloat result = BigFloatSetPrecision(big, limbs);
+        result.sign = bigSign;
+        return result;
+    }
+
+    uint32_t bigWork[WORK_LIMBS]   = {};
+    uint32_t smallWork[WORK_LIMBS] = {};
+
+    _shiftInto(bigWork,   length, big->mantissa,   big->limbs,   BIG_FLOAT_LIMB_BITS);
+    _shiftInto(smallWork, length, small->mantissa, small->limbs, BIG_FLOAT_LIMB_BITS + shift);
+
+    if (bigSign == smallSign)
+    {
+        uint64_t carry = 0;
+        for (size_t i = length; i-- > 0;)
+        {
+            uint64_t sum = (uint64_t)bigWork[i] + smallWork[i] + carry;
+            bigWork[i] = (uint32_t)sum;
+            carry = sum >> 32;
+        }
+    }
+    else
+    {
+        int64_t borrow = 0;
+        for (size_t i = length; i-- > 0;)
+        {
+            int64_t difference = (int64_t)bigWork[i] - smallWork[i] - borrow;
+            borrow = difference < 0;
+            bigWork[i] = (uint32_t)difference;
+        }
+    }
+
+    return _bigPack(bigSign, big->exponent + BIG_FLOAT_LIMB_BITS, bigWork, length, limbs);
+}
+
+BigFloat BigFloatAdd(const BigFloat* a, const BigFloat* b)
+{
+    return _bigAddSigned(a, b, b->sign);
+}
+
+BigFloat BigFloatSub(const BigFloat* a, const BigFloat* b)
+{
+    return _bigAddSigned(a, b, -b->sign);
+}
+
+BigFloat BigFloatMul(const BigFloat* a, const BigFloat* b)
+{
+    size_t limbs = max(a->limbs, b->limbs);
+
+    if (a->isNan || b->isNan)
+        return _bigNan(limbs);
+    if (a->sign == 0 || b->sign == 0)
+        return _bigZero(limbs);
+
+    uint32_t work[WORK_LIMBS] = {};
+
+    for (size_t i = a->limbs; i-- > 0;)
+    {
+        uint64_t carry = 0;
+        for (size_t j = b->limbs; j-- > 0;)
+        {
+            uint64_t product = (uint64_t)a->mantissa[i] * b->mantissa[j] + work[i + j + 1] + carry;
+            work[i + j + 1] = (uint32_t)product;
+            carry = product >> 32;
+        }
+        work[i] = (uint32_t)carry;
+    }
+
+    return _bigPack(a->sign * b->sign, a->exponent + b->exponent, work, a->limbs + b->limbs, limbs);
+}
+
+static BigFloat _bigDivSmall(const BigFloat* a, uint32_t divisor)
+{
+    if (a->isNan || divisor == 0)
+        return _bigNan(a->limbs);
+    if (a->sign == 0)
+        return *a;
+
+    uint32_t work[WORK_LIMBS] = {};
+    size_t length = a->limbs + 2;
+
+    uint64_t remainder = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        uint64_t current = (remainder << 32) | (i < a->limbs ? a->mantissa[i] : 0);
+        work[i] = (uint32_t)(current / divisor);
+        remainder = current % divisor;
+    }
+
+    return _bigPack(a->sign, a->exponent, work, length, a->limbs);
+}
+
+static BigFloat _bigMulPow2(const BigFloat* a, int64_t power)
+{
+    BigFloat result = *a;
+    if (result.sign != 0)
+        result.exponent += power;
+
+    return result;
+}
+
+// 1 / b is found by Newton r = r + r(1 - br) from a double seed
+BigFloat BigFloatDiv(const BigFloat* a, const BigFloat* b)
+{
+    size_t limbs = max(a->limbs, b->limbs);
+
+    if (a->isNan || b->isNan || b->sign == 0)
+        return _bigNan(limbs);
+    if (a->sign == 0)
+        return _bigZero(limbs);
+
+    BigFloat bScaled = BigFloatSetPrecision(b, limbs);
+    bScaled.exponent = 0;
+
+    BigFloat one = _bigFromInt(1, limbs);
+    BigFloat reciprocal = BigFloatFromDouble(1 / BigFloatToDouble(&bScaled), limbs);
+
+    for (size_t bits = 48; bits < 2 * limbs * BIG_FLOAT_LIMB_BITS; bits *= 2)
+    {
+        BigFloat product  = BigFloatMul(&bScaled, &reciprocal);
+        BigFloat residual = BigFloatSub(&one, &product);
+        BigFloat step     = BigFloatMul(&reciprocal, &residual);
+
+        reciprocal = BigFloatAdd(&reciprocal, &step);
+    }
+
+    reciprocal.exponent -= b->exponent;
+
+    BigFloat quotient = BigFloatMul(a, &reciprocal);
+
+    // q += r(a - bq) fixes the last bits
+    BigFloat bq       = BigFloatMul(b, &quotient);
+    BigFloat residual = BigFloatSub(a, &bq);
+    BigFloat step     = BigFloatMul(&reciprocal, &residual);
+
+    return BigFloatAdd(&quotient, &step);
+}
+
+// 1 / sqrt(x) by Newton y = y + y(1 - xy^2) / 2, then sqrt(x) = x * y
+BigFloat BigFloatSqrt(const BigFloat* x)
+{
+    if (x->isNan || x->sign < 0)
+        return _bigNan(x->limbs);
+    if (x->sign == 0)
+        return *x;
+
+    size_t limbs = x->limbs;
+
+    int64_t parity = x->exponent & 1;
+    BigFloat scaled = *x;
+    scaled.exponent = parity;
+
+    BigFloat one = _bigFromInt(1, limbs);
+    BigFloat y = BigFloatFromDouble(1 / sqrt(BigFloatToDouble(&scaled)), limbs);
+
+    for (size_t bits = 48; bits < 2 * limbs * BIG_FLOAT_LIMB_BITS; bits *= 2)
+    {
+        BigFloat y2       = BigFloatMul(&y, &y);
+        BigFloat xy2      = BigFloatMul(&scaled, &y2);
+        BigFloat residual = BigFloatSub(&one, &xy2);
+        BigFloat step     = BigFloatMul(&y, &residual);
+
+        step.exponent--;
+        y = BigFloatAdd(&y, &step);
+    }
+
+    BigFloat result = BigFloatMul(&scaled, &y);
+    result.exponent += (x->exponent - parity) / 2;
+
+    return result;
+}
+
+static bool _bigIsNegligible(const BigFloat* term, const BigFloat* sum, size_t limbs)
+{
+    if (term->sign == 0)
+        return true;
+    if (sum->sign == 0)
+        return false;
+
+    return term->exponent < sum->exponent - (int64_t)(limbs * BIG_FLOAT_LIMB_BITS) - 2;
+}
+
+// e ^ x = 2 ^ k * (e ^ (r / 2 ^ m)) ^ (2 ^ m), the series is summed for e ^ t - 1
+BigFloat BigFloatExp(const BigFloat* x)
+{
+    size_t limbs = x->limbs;
+    size_t work  = _workLimbs(limbs);
+
+    if (x->isNan)
+        return _bigNan(limbs);
+    if (x->sign == 0)
+        return _bigFromInt(1, limbs);
+
+    double xDouble = BigFloatToDouble(x);
+    if (fabs(xDouble) > MAX_EXP_ARGUMENT)
+        return xDouble > 0 ? _bigNan(limbs) : _bigZero(limbs);
+
+    int64_t k = (int64_t)nearbyint(xDouble / M_LN2);
+
+    BigFloat ln2  = _bigLn2(work);
+    BigFloat kBig = _bigFromInt(k, work);
+    BigFloat kLn2 = BigFloatMul(&kBig, &ln2);
+
+    BigFloat xWork = BigFloatSetPrecision(x, work);
+    BigFloat r = BigFloatSub(&xWork, &kLn2);
+    r = _bigMulPow2(&r, -EXP_HALVINGS);
+
+    BigFloat term = r;
+    BigFloat sum  = r;
+
+    for (uint32_t n = 2; !_bigIsNegligible(&term, &sum, work); n++)
+    {
+        term = BigFloatMul(&term, &r);
+        term = _bigDivSmall(&term, n);
+        sum  = BigFloatAdd(&sum, &term);
+    }
+
+    // (1 + s) ^ 2 - 1 = 2s + s ^ 2
+    for (int i = 0; i < EXP_HALVINGS; i++)
+    {
+        BigFloat square = BigFloatMul(&sum, &sum);
+        BigFloat twice  = _bigMulPow2(&sum, 1);
+
+        sum = BigFloatAdd(&twice, &square);
+    }
+
+    BigFloat one = _bigFromInt(1, work);
+    BigFloat result = BigFloatAdd(&sum, &one);
+    result.exponent += k;
+
+    return BigFloatSetPrecision(&result, limbs);
+}
+
+// x = m * 2 ^ e, ln(m) by Halley's iteration y = y + 2(m - e ^ y) / (m + e ^ y)
+BigFloat BigFloatLn(const BigFloat* x)
+{
+    size_t limbs = x->limbs;
+    size_t work  = _workLimbs(limbs);
+
+    if (x->isNan || x->sign <= 0)
+        return _bigNan(limbs);
+
+    BigFloat m = BigFloatSetPrecision(x, work);
+    m.exponent = 0;
+
+    BigFloat y = BigFloatFromDouble(log(BigFloatToDouble(&m)), work);
+
+    for (size_t bits = 48; bits < 2 * work * BIG_FLOAT_LIMB_BITS; bits *= 3)
+    {
+        BigFloat expY        = BigFloatExp(&y);
+        BigFloat numerator   = BigFloatSub(&m, &expY);
+        BigFloat denominator = BigFloatAdd(&m, &expY);
+        BigFloat step        = BigFloatDiv(&numerator, &denominator);
+
+        step.exponent++;
+        y = BigFloatAdd(&y, &step);
+    }
+
+    BigFloat ln2  = _bigLn2(work);
+    BigFloat e    = _bigFromInt(x->exponent, work);
+    BigFloat eLn2 = BigFloatMul(&e, &ln2);
+
+    BigFloat result = BigFloatAdd(&y, &eLn2);
+
+    return BigFloatSetPrecision(&result, limbs);
+}
+
+// x = k * pi / 2 + r, |r| <= pi / 4
+static void _bigSinCos(const BigFloat* x, BigFloat* sinx, BigFloat* cosx)
+{
+    size_t limbs = x->limbs;
+    size_t work  = _workLimbs(limbs);
+
+    double xDouble = BigFloatToDouble(x);
+
+    if (x->isNan || fabs(xDouble) > MAX_TRIG_ARGUMENT)
+    {
+        *sinx = _bigNan(limbs);
+        *cosx = _bigNan(limbs);
+        return;
+    }
+
+    BigFloat halfPi = _bigPi(work);
+    halfPi.exponent--;
+
+    int64_t k = (int64_t)nearbyint(xDouble / M_PI_2);
+
+    BigFloat kBig      = _bigFromInt(k, work);
+    BigFloat kHalfPi   = BigFloatMul(&kBig, &halfPi);
+    BigFloat xWork     = BigFloatSetPrecision(x, work);
+    BigFloat r         = BigFloatSub(&xWork, &kHalfPi);
+    BigFloat r2        = BigFloatMul(&r, &r);
+
+    BigFloat sinTerm = r;
+    BigFloat sinSum  = r;
+    BigFloat cosTerm = _bigFromInt(1, work);
+    BigFloat cosSum  = cosTerm;
+
+    for (uint32_t n = 1; !_bigIsNegligible(&cosTerm, &cosSum, work) ||
+                         !_bigIsNegligible(&sinTerm, &sinSum, work); n++)
+    {
+        cosTerm = BigFloatMul(&cosTerm, &r2);
+        cosTerm = _bigDivSmall(&cosTerm, (2 * n - 1) * (2 * n));
+        cosTerm.sign = -cosTerm.sign;
+
+        sinTerm = BigFloatMul(&sinTerm, &r2);
+        sinTerm = _bigDivSmall(&sinTerm, (2 * n) * (2 * n + 1));
+        sinTerm.sign = -sinTerm.sign;
+
+        cosSum = BigFloatAdd(&cosSum, &cosTerm);
+        sinSum = BigFloatAdd(&sinSum, &sinTerm);
+    }
+
+    sinSum = BigFloatSetPrecision(&sinSum, limbs);
+    cosSum = BigFloatSetPrecision(&cosSum, limbs);
+
+    switch (k & 3)
+    {
+        case 0:
+            *sinx = sinSum;
+            *cosx = cosSum;
+            break;
+        case 1:
+            *sinx = cosSum;
+            *cosx = BigFloatNeg(&sinSum);
+            break;
+        case 2:
+            *sinx = BigFloatNeg(&sinSum);
+            *cosx = BigFloatNeg(&cosSum);
+            break;
+        case 3:
+        default:
+            *sinx = BigFloatNeg(&cosSum);
+            *cosx = sinSum;
+            break;
+    }
+}
+
+BigFloat BigFloatSin(const BigFloat* x)
+{
+    BigFloat sinx = {}, cosx = {};
+    _bigSinCos(x, &sinx, &cosx);
+
+    return sinx;
+}
+
+BigFloat BigFloatCos(const BigFloat* x)
+{
+    BigFloat sinx = {}, cosx = {};
+    _bigSinCos(x, &sinx, &cosx);
+
+    return cosx;
+}
+
+BigFloat BigFloatTan(const BigFloat* x)
+{
+    BigFloat sinx = {}, cosx = {};
+    _bigSinCos(x, &sinx, &cosx);
+
+    return BigFloatDiv(&sinx, &cosx);
+}
+
+// arctan(x) = +-pi / 2 - arctan(1 / x) for |x| > 1, then Newton for tan(y) = x
+// from libm's atan: y -= (sin(y) - x * cos(y)) * cos(y)
+BigFloat BigFloatArctan(const BigFloat* x)
+{
+    size_t limbs = x->limbs;
+    size_t work  = _workLimbs(limbs);
+
+    if (x->isNan)
+        return _bigNan(limbs);
+    if (x->sign == 0)
+        return *x;
+
+    BigFloat one = _bigFromInt(1, work);
+
+    if (_bigCompareAbs(x, &one) > 0)
+    {
+        BigFloat absX = BigFloatSetPrecision(x, work);
+        absX.sign = 1;
+
+        BigFloat inverse = BigFloatDiv(&one, &absX);
+        BigFloat arctan  = BigFloatArctan(&inverse);
+
+        BigFloat halfPi = _bigPi(work);
+        halfPi.exponent--;
+
+        BigFloat result = BigFloatSub(&halfPi, &arctan);
+        result.sign = x->sign;
+
+        return BigFloatSetPrecision(&result, limbs);
+    }
+
+    BigFloat xWork = BigFloatSetPrecision(x, work);
+    BigFloat y = BigFloatFromDouble(atan(BigFloatToDouble(x)), work);
+
+    for (size_t bits = 48; bits < 2 * work * BIG_FLOAT_LIMB_BITS; bits *= 2)
+    {
+        BigFloat siny = {}, cosy = {};
+        _bigSinCos(&y, &siny, &cosy);
+
+        BigFloat xCosy    = BigFloatMul(&xWork, &cosy);
+        BigFloat residual = BigFloatSub(&siny, &xCosy);
+        BigFloat step     = BigFloatMul(&residual, &cosy);
+
+        y = BigFloatSub(&y, &step);
+    }
+
+    return BigFloatSetPrecision(&y, limbs);
+}
+
+// arcsin(x) = arctan(x / sqrt(1 - x ^ 2))
+BigFloat BigFloatArcsin(const BigFloat* x)
+{
+    size_t limbs = x->limbs;
+    size_t work  = _workLimbs(limbs);
+
+    BigFloat one = _bigFromInt(1, work);
+
+    int compare = _bigCompareAbs(x, &one);
+
+    if (x->isNan || compare > 0)
+        return _bigNan(limbs);
+
+    if (compare == 0)
+    {
+        BigFloat halfPi = _bigPi(limbs);
+        halfPi.exponent--;
+        halfPi.sign = x->sign;
+        return halfPi;
+    }
+
+    BigFloat xWork       = BigFloatSetPrecision(x, work);
+    BigFloat x2          = BigFloatMul(&xWork, &xWork);
+    BigFloat oneMinusX2  = BigFloatSub(&one, &x2);
+    BigFloat root        = BigFloatSqrt(&oneMinusX2);
+    BigFloat tangent     = BigFloatDiv(&xWork, &root);
+
+    BigFloat result = BigFloatArctan(&tangent);
+
+    return BigFloatSetPrecision(&result, limbs);
+}
+
+BigFloat BigFloatArccos(const BigFloat* x)
+{
+    size_t limbs = x->limbs;
+    size_t work  = _workLimbs(limbs);
+
+    BigFloat halfPi = _bigPi(work);
+    halfPi.exponent--;
+
+    BigFloat xWork  = BigFloatSetPrecision(x, work);
+    BigFloat arcsin = BigFloatArcsin(&xWork);
+    BigFloat result = BigFloatSub(&halfPi, &arcsin);
+
+    return BigFloatSetPrecision(&result, limbs);
+}
+
+static bool _bigToInteger(const BigFloat* x, int64_t* integer)
+{
+    if (x->isNan)
+        return false;
+
+    if (x->sign == 0)
+    {
+        *integer = 0;
+        return true;
+    }
+
+    if (x->exponent <= 0 || x->exponent > 62)
+        return false;
+
+    size_t integerBits = (size_t)x->exponent;
+    uint64_t value = 0;
+
+    for (size_t bit = 0; bit < x->limbs * BIG_FLOAT_LIMB_BITS; bit++)
+    {
+        bool isSet = (x->mantissa[bit / BIG_FLOAT_LIMB_BITS] >> (31 - bit % BIG_FLOAT_LIMB_BITS)) & 1;
+
+        if (bit < integerBits)
+            value = (value << 1) | isSet;
+        else if (isSet)
+            return false;
+    }
+
+    *integer = x->sign * (int64_t)value;
+
+    return true;
+}
+
+static BigFloat _bigIntegerPow(const BigFloat* base, int64_t power)
+{
+    size_t limbs = base->limbs;
+    size_t work  = _workLimbs(limbs);
+
+    uint64_t exponent = (uint64_t)(power < 0 ? -power : power);
+
+    BigFloat result = _bigFromInt(1, work);
+    BigFloat square = BigFloatSetPrecision(base, work);
+
+    while (exponent)
+    {
+        if (exponent & 1)
+            result = BigFloatMul(&result, &square);
+        exponent >>= 1;
+        if (exponent)
+            square = BigFloatMul(&square, &square);
+    }
+
+    if (power < 0)
+    {
+        BigFloat one = _bigFromInt(1, work);
+        result = BigFloatDiv(&one, &result);
+    }
+
+    return BigFloatSetPrecision(&result, limbs);
+}
+
+BigFloat BigFloatPow(const BigFloat* base, const BigFloat* power)
+{
+    size_t limbs = max(base->limbs, power->limbs);
+
+    if (base->isNan || power->isNan)
+        return _bigNan(limbs);
+
+    BigFloat baseWork = BigFloatSetPrecision(base, limbs);
+
+    int64_t integerPower = 0;
+    if (_bigToInteger(power, &integerPower) && llabs(integerPower) < MAX_INTEGER_POWER)
+        return _bigIntegerPow(&baseWork, integerPower);
+
+    if (base->sign < 0)
+        return _bigNan(limbs);
+    if (base->sign == 0)
+        return power->sign > 0 ? _bigZero(limbs) : _bigNan(limbs);
+
+    size_t work = _workLimbs(limbs);
+
+    baseWork = BigFloatSetPrecision(base, work);
+    BigFloat powerWork = BigFloatSetPrecision(power, work);
+
+    BigFloat lnBase  = BigFloatLn(&baseWork);
+    BigFloat product = BigFloatMul(&powerWork, &lnBase);
+    BigFloat result  = BigFloatExp(&product);
+
+    return BigFloatSetPrecision(&result, limbs);
+}
+
+// arctan(1 / n) = sum (-1) ^ k / ((2k + 1) * n ^ (2k + 1))
+static BigFloat _bigArctanInverse(uint32_t inverse, size_t limbs)
+{
+    BigFloat one = _bigFromInt(1, limbs);
+
+    BigFloat power = _bigDivSmall(&one, inverse);
+    BigFloat sum   = power;
+
+    for (uint32_t k = 1; ; k++)
+    {
+        power = _bigDivSmall(&power, inverse * inverse);
+
+        BigFloat term = _bigDivSmall(&power, 2 * k + 1);
+        if (_bigIsNegligible(&term, &sum, limbs))
+            break;
+
+        if (k & 1)
+            sum = BigFloatSub(&sum, &term);
+        else
+            sum = BigFloatAdd(&sum, &term);
+    }
+
+    return sum;
+}
+
+// pi = 16 arctan(1 / 5) - 4 arctan(1 / 239)
+static BigFloat _bigPi(size_t limbs)
+{
+    if (PI_CACHE.sign == 0)
+    {
+        BigFloat arctan5   = _bigArctanInverse(5,   BIG_FLOAT_CAPACITY);
+        BigFloat arctan239 = _bigArctanInverse(239, BIG_FLOAT_CAPACITY);
+
+        arctan5.exponent   += 4;
+        arctan239.exponent += 2;
+
+        PI_CACHE = BigFloatSub(&arctan5, &arctan239);
+    }
+
+    return BigFloatSetPrecision(&PI_CACHE, limbs);
+}
+
+// ln(2) = 2 artanh(1 / 3) = 2 * sum 1 / ((2k + 1) * 3 ^ (2k + 1))
+static BigFloat _bigLn2(size_t limbs)
+{
+    if (LN2_CACHE.sign == 0)
+    {
+        BigFloat one = _bigFromInt(1, BIG_FLOAT_CAPACITY);
+
+        BigFloat power = _bigDivSmall(&one, 3);
+        BigFloat sum   = power;
+
+        for (uint32_t k = 1; ; k++)
+        {
+            power = _bigDivSmall(&power, 9);
+
+            BigFloat term = _bigDivSmall(&power, 2 * k + 1);
+            if (_bigIsNegligible(&term, &sum, BIG_FLOAT_CAPACITY))
+                break;
+
+            sum = BigFloatAdd(&sum, &term);
+        }
+
+        sum.exponent++;
+        LN2_CACHE = sum;
+    }
+
+    return BigFloatSetPrecision(&LN2_CACHE, limbs);
+}
+
+ErrorCode BigFloatToString(const BigFloat* x, char* buffer, size_t bufferSize, size_t digits)
+{
+    MyAssertSoft(x, ERROR_NULLPTR);
+    MyAssertSoft(buffer, ERROR_NULLPTR);
+    MyAssertSoft(digits > 0, ERROR_BAD_NUMBER);
+    MyAssertSoft(bufferSize >= digits + 32, ERROR_INDEX_OUT_OF_BOUNDS);
+
+    if (x->isNan)
+    {
+        snprintf(buffer, bufferSize, "nan");
+        return EVERYTHING_FINE;
+    }
+    if (x->sign == 0)
+    {
+        snprintf(buffer, bufferSize, "0");
+        return EVERYTHING_FINE;
+    }
+
+    size_t work = _workLimbs(x->limbs);
+
+    // y = |x| / 10 ^ e10 in [1, 10)
+    int64_t e10 = (int64_t)floor((double)(x->exponent - 1) * LOG10_2);
+
+    BigFloat y = BigFloatSetPrecision(x, work);
+    y.sign = 1;
+
+    BigFloat ten = _bigFromInt(10, work);
+    BigFloat scale = _bigIntegerPow(&ten, e10 < 0 ? -e10 : e10);
+    y = e10 < 0 ? BigFloatMul(&y, &scale) : BigFloatDiv(&y, &scale);
+
+    while (y.exponent > 4 || (y.exponent == 4 && y.mantissa[0] >= 0xA0000000u))
+    {
+        y = _bigDivSmall(&y, 10);
+        e10++;
+    }
+    while (y.exponent < 1)
+    {
+        y = BigFloatMul(&y, &ten);
+        e10--;
+    }
+
+    char* digitChars = (char*)calloc(digits + 2, sizeof(*digitChars));
+    MyAssertSoft(digitChars, ERROR_NO_MEMORY);
+
+    for (size_t i = 0; i <= digits; i++)
+    {
+        uint32_t digit = y.sign == 0 || y.exponent <= 0 ? 0 : y.mantissa[0] >> (32 - y.exponent);
+        digitChars[i] = (char)digit;
+
+        BigFloat digitBig = _bigFromInt(digit, work);
+        y = BigFloatSub(&y, &digitBig);
+        y = BigFloatMul(&y, &ten);
+    }
+
+    // round by the extra digit
+    if (digitChars[digits] >= 5)
+    {
+        size_t i = digits;
+        while (i > 0 && ++digitChars[i - 1] == 10)
+        {
+            digitChars[i - 1] = 0;
+            i--;
+        }
+
+        if (i == 0)
+        {
+            digitChars[0] = 1;
+            e10++;
+        }
+    }
+
+    size_t position = 0;
+    if (x->sign < 0)
+        buffer[position++] = '-';
+
+    buffer[position++] = (char)('0' + digitChars[0]);
+    if (digits > 1)
+        buffer[position++] = '.';
+
+    for (size_t i = 1; i < digits; i++)
+        buffer[position++] = (char)('0' + digitChars[i]);
+
+    snprintf(buffer + position, bufferSize - position, "e%+lld", (long long)e10);
+
+    free(digitChars);
+
+    return EVERYTHING_FINE;
+}
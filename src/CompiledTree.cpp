@@ -0,0 +1,360 @@
+#include <stdlib.h>
+#include <string.h>
+#include "CompiledTree.hpp"
+#include "DiffTreeDSL.hpp"
+#include "MinMax.hpp"
+
+static const size_t DEFAULT_COMPILED_CAPACITY = 16;
+static const unsigned int INSTRUCTION_HASH_SEED = 0x5EED;
+
+static ErrorCode _reserveInstructions(CompiledTree* compiled, size_t capacity);
+
+static ErrorCode _allocateScratch(CompiledTree* compiled);
+
+static CompiledIndexResult _recCompile(CompiledTree* compiled, TreeNode* node);
+
+static CompiledIndexResult _getVariableSlot(CompiledTree* compiled, char var);
+
+static ErrorCode _rebuildTable(CompiledTree* compiled, size_t capacity);
+
+static bool _hasOneArg(Operation operation);
+
+static size_t _hashInstruction(const CompiledInstruction* instruction);
+
+static bool _sameInstruction(const CompiledInstruction* first, const CompiledInstruction* second);
+
+ErrorCode CompiledTree::Init(Tree* tree)
+{
+    return this->Init(&tree, 1);
+}
+
+ErrorCode CompiledTree::Init(Tree* const* trees, size_t count)
+{
+    MyAssertSoft(trees, ERROR_NULLPTR);
+    MyAssertSoft(count, ERROR_BAD_SIZE);
+
+    *this = {};
+
+    size_t capacity = DEFAULT_COMPILED_CAPACITY;
+    #ifdef SIZE_VERIFICATION
+    size_t totalSize = 0;
+    for (size_t i = 0; i < count; i++)
+        if (trees[i])
+            totalSize += *trees[i]->size;
+    capacity = max(capacity, totalSize);
+    #endif
+
+    RETURN_ERROR(_reserveInstructions(this, capacity));
+
+    this->outputs = (size_t*)calloc(count, sizeof(*this->outputs));
+    MyAssertSoft(this->outputs, ERROR_NO_MEMORY, this->Destructor());
+
+    RETURN_ERROR(_rebuildTable(this, DEFAULT_COMPILED_CAPACITY * 2), this->Destructor());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        MyAssertSoft(trees[i], ERROR_NULLPTR, this->Destructor());
+        MyAssertSoft(trees[i]->root, ERROR_NO_ROOT, this->Destructor());
+
+        CompiledIndexResult outputRes = _recCompile(this, trees[i]->root);
+        RETURN_ERROR(outputRes.error, this->Destructor());
+
+        this->outputs[i] = outputRes.value;
+    }
+
+    this->output = this->outputs[0];
+    this->outputCount = count;
+
+    RETURN_ERROR(_allocateScratch(this), this->Destructor());
+
+    return EVERYTHING_FINE;
+}
+
+CompiledIndexResult CompiledTree::Push(CompiledInstruction instruction)
+{
+    MyAssertSoftResult(this->table, SIZET_POISON, ERROR_NULLPTR);
+
+    if (instruction.type == OPERATION_TYPE)
+    {
+        if (instruction.left >= this->size)
+            return { SIZET_POISON, ERROR_INDEX_OUT_OF_BOUNDS };
+        if (_hasOneArg(instruction.operation))
+            instruction.right = 0;
+        else if (instruction.right >= this->size)
+            return { SIZET_POISON, ERROR_INDEX_OUT_OF_BOUNDS };
+    }
+
+    size_t slot = _hashInstruction(&instruction) & (this->tableCapacity - 1);
+    while (this->table[slot] != SIZET_POISON)
+    {
+        if (_sameInstruction(&this->instructions[this->table[slot]], &instruction))
+            return { this->table[slot], EVERYTHING_FINE };
+
+        slot = (slot + 1) & (this->tableCapacity - 1);
+    }
+
+    if (this->size == this->capacity)
+    {
+        ErrorCode error = _reserveInstructions(this, this->capacity * 2);
+        if (error)
+            return { SIZET_POISON, error };
+    }
+
+    size_t index = this->size++;
+    this->instructions[index] = instruction;
+    this->table[slot] = index;
+
+    // keeps the table at most half full
+    if (2 * this->size > this->tableCapacity)
+    {
+        ErrorCode error = _rebuildTable(this, this->tableCapacity * 2);
+        if (error)
+            return { SIZET_POISON, error };
+    }
+
+    return { index, EVERYTHING_FINE };
+}
+
+ErrorCode CompiledTree::AddOutput(size_t index)
+{
+    MyAssertSoft(index < this->size, ERROR_INDEX_OUT_OF_BOUNDS);
+
+    size_t* newOutputs = (size_t*)realloc(this->outputs, (this->outputCount + 1) * sizeof(*newOutputs));
+    MyAssertSoft(newOutputs, ERROR_NO_MEMORY);
+
+    this->outputs = newOutputs;
+    this->outputs[this->outputCount++] = index;
+    this->output = this->outputs[0];
+
+    return _allocateScratch(this);
+}
+
+TreeNodeResult CompiledTree::BuildNode(size_t index) const
+{
+    MyAssertSoftResult(index < this->size, nullptr, ERROR_INDEX_OUT_OF_BOUNDS);
+
+    const CompiledInstruction* instruction = &this->instructions[index];
+
+    TreeElement_t value = {};
+    value.type = instruction->type;
+
+    switch (instruction->type)
+    {
+        case NUMBER_TYPE:
+            value.value.number = instruction->number;
+            return TreeNode::New(value, nullptr, nullptr);
+        case VARIABLE_TYPE:
+            value.value.var = this->variables[instruction->variable];
+            return TreeNode::New(value, nullptr, nullptr);
+        case OPERATION_TYPE:
+            break;
+        default:
+            return { nullptr, ERROR_BAD_VALUE };
+    }
+
+    value.value.operation = instruction->operation;
+
+    TreeNodeResult leftRes = this->BuildNode(instruction->left);
+    RETURN_ERROR_RESULT(leftRes, nullptr);
+
+    TreeNodeResult rightRes = { nullptr, EVERYTHING_FINE };
+    if (!_hasOneArg(instruction->operation))
+    {
+        rightRes = this->BuildNode(instruction->right);
+        RETURN_ERROR_RESULT(rightRes, nullptr, leftRes.value->Delete());
+    }
+
+    TreeNodeResult nodeRes = TreeNode::New(value, leftRes.value, rightRes.value);
+    if (nodeRes.error)
+    {
+        leftRes.value->Delete();
+        if (rightRes.value)
+            rightRes.value->Delete();
+    }
+
+    return nodeRes;
+}
+
+ErrorCode CompiledTree::Destructor()
+{
+    free(this->instructions);
+    free(this->outputs);
+    free(this->scratch);
+    free(this->table);
+
+    *this = {};
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _reserveInstructions(CompiledTree* compiled, size_t capacity)
+{
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+
+    if (capacity <= compiled->capacity)
+        return EVERYTHING_FINE;
+
+    CompiledInstruction* newInstructions = (CompiledInstruction*)realloc(compiled->instructions,
+                                                                         capacity * sizeof(*newInstructions));
+    MyAssertSoft(newInstructions, ERROR_NO_MEMORY);
+
+    compiled->instructions = newInstructions;
+    compiled->capacity = capacity;
+
+    return EVERYTHING_FINE;
+}
+
+static size_t _hashInstruction(const CompiledInstruction* instruction)
+{
+    // packed without padding so that equal instructions hash equally
+    uint64_t key[6] = {};
+
+    key[0] = (uint64_t)instruction->type;
+    key[1] = (uint64_t)instruction->operation;
+    memcpy(&key[2], &instruction->number, sizeof(instruction->number));
+    key[3] = instruction->variable;
+    key[4] = instruction->left;
+    key[5] = instruction->right;
+
+    return CalculateHash(key, sizeof(key), INSTRUCTION_HASH_SEED);
+}
+
+static bool _sameInstruction(const CompiledInstruction* first, const CompiledInstruction* second)
+{
+    return first->type      == second->type                                         &&
+           first->operation == second->operation                                    &&
+           memcmp(&first->number, &second->number, sizeof(first->number)) == 0     &&
+           first->variable  == second->variable                                     &&
+           first->left      == second->left                                         &&
+           first->right     == second->right;
+}
+
+static ErrorCode _rebuildTable(CompiledTree* compiled, size_t capacity)
+{
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+
+    size_t* slots = (size_t*)calloc(capacity, sizeof(*slots));
+    MyAssertSoft(slots, ERROR_NO_MEMORY);
+
+    for (size_t i = 0; i < capacity; i++)
+        slots[i] = SIZET_POISON;
+
+    for (size_t index = 0; index < compiled->size; index++)
+    {
+        size_t slot = _hashInstruction(&compiled->instructions[index]) & (capacity - 1);
+        while (slots[slot] != SIZET_POISON)
+            slot = (slot + 1) & (capacity - 1);
+
+        slots[slot] = index;
+    }
+
+    free(compiled->table);
+    compiled->table = slots;
+    compiled->tableCapacity = capacity;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _allocateScratch(CompiledTree* compiled)
+{
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+
+    free(compiled->scratch);
+
+    compiled->scratch = calloc(compiled->size * EVAL_BLOCK_SIZE, EVAL_SCRATCH_ELEMENT_SIZE);
+    MyAssertSoft(compiled->scratch, ERROR_NO_MEMORY);
+
+    return EVERYTHING_FINE;
+}
+
+static bool _hasOneArg(Operation operation)
+{
+    switch (operation)
+    {
+        #define DEF_FUNC(name, priority, hasOneArg, ...)                        \
+        case name:                                                              \
+            return hasOneArg;
+
+        #include "DiffFunctions.hpp"
+
+        #undef DEF_FUNC
+
+        default:
+            return false;
+    }
+}
+
+static CompiledIndexResult _getVariableSlot(CompiledTree* compiled, char var)
+{
+    MyAssertSoftResult(compiled, SIZET_POISON, ERROR_NULLPTR);
+
+    for (size_t slot = 0; slot < compiled->variableCount; slot++)
+        if (compiled->variables[slot] == var)
+            return { slot, EVERYTHING_FINE };
+
+    if (compiled->variableCount == MAX_COMPILED_VARIABLES)
+        return { SIZET_POISON, ERROR_INDEX_OUT_OF_BOUNDS };
+
+    compiled->variables[compiled->variableCount] = var;
+
+    return { compiled->variableCount++, EVERYTHING_FINE };
+}
+
+static CompiledIndexResult _recCompile(CompiledTree* compiled, TreeNode* node)
+{
+    MyAssertSoftResult(compiled, SIZET_POISON, ERROR_NULLPTR);
+    MyAssertSoftResult(node, SIZET_POISON, ERROR_NULLPTR);
+
+    CompiledInstruction instruction = {};
+    instruction.type = NODE_TYPE(node);
+
+    switch (NODE_TYPE(node))
+    {
+        case NUMBER_TYPE:
+            instruction.number = NODE_NUMBER(node);
+            return compiled->Push(instruction);
+        case VARIABLE_TYPE:
+        {
+            CompiledIndexResult slotRes = _getVariableSlot(compiled, NODE_VAR(node));
+            RETURN_ERROR_RESULT(slotRes, SIZET_POISON);
+
+            instruction.variable = slotRes.value;
+            return compiled->Push(instruction);
+        }
+        case OPERATION_TYPE:
+            break;
+        default:
+            return { SIZET_POISON, ERROR_BAD_VALUE };
+    }
+
+    instruction.operation = NODE_OPERATION(node);
+
+    switch (NODE_OPERATION(node))
+    {
+        #define DEF_FUNC(name, priority, hasOneArg, ...)                        \
+        case name:                                                              \
+            if (!node->left || (hasOneArg) != !node->right)                     \
+                return { SIZET_POISON, ERROR_BAD_TREE };                        \
+            break;
+
+        #include "DiffFunctions.hpp"
+
+        #undef DEF_FUNC
+
+        default:
+            return { SIZET_POISON, ERROR_BAD_VALUE };
+    }
+
+    CompiledIndexResult leftRes = _recCompile(compiled, node->left);
+    RETURN_ERROR_RESULT(leftRes, SIZET_POISON);
+    instruction.left = leftRes.value;
+
+    if (node->right)
+    {
+        CompiledIndexResult rightRes = _recCompile(compiled, node->right);
+        RETURN_ERROR_RESULT(rightRes, SIZET_POISON);
+        instruction.right = rightRes.value;
+    }
+
+    return compiled->Push(instruction);
+}
@@ -0,0 +1,173 @@
+#include <math.h>
+#include "ComplexEvaluator.hpp"
+#include "MinMax.hpp"
+
+static const double MAX_INTEGER_POWER = 1 << 30;
+
+static Complex_t _complexPow(Complex_t base, Complex_t power);
+
+static inline Complex_t _evalComplexOperation(Operation operation, Complex_t left, Complex_t right);
+
+static void _evalComplexBlock(CompiledTree* compiled, const Complex_t* zs, Complex_t* results, size_t count);
+
+ComplexEvalResult EvaluateComplex(CompiledTree* compiled, Complex_t z)
+{
+    MyAssertSoftResult(compiled, NAN, ERROR_NULLPTR);
+    MyAssertSoftResult(compiled->instructions, NAN, ERROR_NULLPTR);
+
+    Complex_t* registers = (Complex_t*)compiled->scratch;
+
+    for (size_t i = 0; i < compiled->size; i++)
+    {
+        CompiledInstruction* instruction = &compiled->instructions[i];
+
+        switch (instruction->type)
+        {
+            case NUMBER_TYPE:
+                registers[i] = instruction->number;
+                break;
+            case VARIABLE_TYPE:
+                registers[i] = z;
+                break;
+            case OPERATION_TYPE:
+                if (instruction->operation == DIV_OPERATION && IsEqual(abs(registers[instruction->right]), 0))
+                    return { NAN, ERROR_ZERO_DIVISION };
+
+                registers[i] = _evalComplexOperation(instruction->operation,
+                                                     registers[instruction->left], registers[instruction->right]);
+                break;
+            default:
+                return { NAN, ERROR_BAD_VALUE };
+        }
+    }
+
+    return { registers[compiled->output], EVERYTHING_FINE };
+}
+
+ErrorCode EvaluateComplexBatch(CompiledTree* compiled, const Complex_t* zs, Complex_t* results, size_t count)
+{
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+    MyAssertSoft(compiled->instructions, ERROR_NULLPTR);
+    MyAssertSoft(zs, ERROR_NULLPTR);
+    MyAssertSoft(results, ERROR_NULLPTR);
+
+    for (size_t start = 0; start < count; start += EVAL_BLOCK_SIZE)
+        _evalComplexBlock(compiled, zs + start, results + start, min(EVAL_BLOCK_SIZE, count - start));
+
+    return EVERYTHING_FINE;
+}
+
+EvalResult ComplexStepDerivative(CompiledTree* compiled, double x, double h)
+{
+    MyAssertSoftResult(compiled, NAN, ERROR_NULLPTR);
+    MyAssertSoftResult(h > 0, NAN, ERROR_BAD_NUMBER);
+
+    ComplexEvalResult valueRes = EvaluateComplex(compiled, Complex_t(x, h));
+    RETURN_ERROR_RESULT(valueRes, NAN);
+
+    return { valueRes.value.imag() / h, EVERYTHING_FINE };
+}
+
+static void _evalComplexBlock(CompiledTree* compiled, const Complex_t* zs, Complex_t* results, size_t count)
+{
+    Complex_t* registers = (Complex_t*)compiled->scratch;
+
+    for (size_t i = 0; i < compiled->size; i++)
+    {
+        CompiledInstruction* instruction = &compiled->instructions[i];
+        Complex_t* out = registers + i * EVAL_BLOCK_SIZE;
+
+        switch (instruction->type)
+        {
+            case NUMBER_TYPE:
+                for (size_t point = 0; point < count; point++)
+                    out[point] = instruction->number;
+                break;
+            case VARIABLE_TYPE:
+                for (size_t point = 0; point < count; point++)
+                    out[point] = zs[point];
+                break;
+            case OPERATION_TYPE:
+            {
+                const Complex_t* left  = registers + instruction->left  * EVAL_BLOCK_SIZE;
+                const Complex_t* right = registers + instruction->right * EVAL_BLOCK_SIZE;
+
+                for (size_t point = 0; point < count; point++)
+                {
+                    if (instruction->operation == DIV_OPERATION && IsEqual(abs(right[point]), 0))
+                        out[point] = NAN;
+                    else
+                        out[point] = _evalComplexOperation(instruction->operation, left[point], right[point]);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    const Complex_t* out = registers + compiled->output * EVAL_BLOCK_SIZE;
+    for (size_t point = 0; point < count; point++)
+        results[point] = out[point];
+}
+
+// std::pow goes through exp(v * ln(u)), which smears the rounding error of |u ^ v|
+// over the tiny imaginary part that complex-step differentiation relies on
+static Complex_t _complexPow(Complex_t base, Complex_t power)
+{
+    if (power.imag() != 0)
+        return std::pow(base, power);
+
+    double realPower = power.real();
+
+    if (realPower != floor(realPower) || fabs(realPower) > MAX_INTEGER_POWER)
+        return std::pow(base, realPower);
+
+    unsigned long exponent = (unsigned long)fabs(realPower);
+    Complex_t result = 1;
+
+    while (exponent)
+    {
+        if (exponent & 1)
+            result *= base;
+        base *= base;
+        exponent >>= 1;
+    }
+
+    return realPower < 0 ? 1.0 / result : result;
+}
+
+static inline Complex_t _evalComplexOperation(Operation operation, Complex_t left, Complex_t right)
+{
+    switch (operation)
+    {
+        case ADD_OPERATION:
+            return left + right;
+        case SUB_OPERATION:
+            return left - right;
+        case MUL_OPERATION:
+            return left * right;
+        case DIV_OPERATION:
+            return left / right;
+        case POWER_OPERATION:
+            return _complexPow(left, right);
+        case SIN_OPERATION:
+            return sin(left);
+        case COS_OPERATION:
+            return cos(left);
+        case TAN_OPERATION:
+            return tan(left);
+        case ARC_SIN_OPERATION:
+            return asin(left);
+        case ARC_COS_OPERATION:
+            return acos(left);
+        case ARC_TAN_OPERATION:
+            return atan(left);
+        case EXP_OPERATION:
+            return exp(left);
+        case LN_OPERATION:
+            return log(left);
+        default:
+            return NAN;
+    }
+}
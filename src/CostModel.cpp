@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include "CostModel.hpp"
+#include "DiffTreeDSL.hpp"
+
+// \frac{}{}, \cdot and the brackets of a function, what LatexWrite adds to the operands
+static const double LATEX_FRACTION_LENGTH = 9;
+static const double LATEX_DOT_LENGTH      = 5;
+static const double LATEX_BRACKETS_LENGTH = 2;
+
+static double _nodeCount      (void* data, const TreeElement* node, const TreeElement* left, const TreeElement* right);
+static double _evaluationCycles(void* data, const TreeElement* node, const TreeElement* left, const TreeElement* right);
+static double _latexLength    (void* data, const TreeElement* node, const TreeElement* left, const TreeElement* right);
+
+static double _estimatedCycles(Operation operation);
+static double _latexOperand(const TreeElement* operand, int priority);
+
+CostModel NodeCountCost()
+{
+    CostModel model = {};
+
+    model.nodeCost = _nodeCount;
+
+    return model;
+}
+
+CostModel EvaluationCyclesCost(const EvalProfile* profile)
+{
+    CostModel model = {};
+
+    model.data     = (void*)profile;
+    model.nodeCost = _evaluationCycles;
+
+    return model;
+}
+
+CostModel LatexLengthCost()
+{
+    CostModel model = {};
+
+    model.nodeCost = _latexLength;
+
+    return model;
+}
+
+static double _nodeCount(void*, const TreeElement*, const TreeElement*, const TreeElement*)
+{
+    return 1;
+}
+
+// a number or a variable is only copied into its register
+static double _evaluationCycles(void* data, const TreeElement* node, const TreeElement*, const TreeElement*)
+{
+    if (node->type != OPERATION_TYPE)
+        return 1;
+
+    const EvalProfile* profile = (const EvalProfile*)data;
+    Operation operation = node->value.operation;
+
+    if (profile && profile->operationCalls[operation] && profile->operationCycles[operation])
+        return (double)profile->operationCycles[operation] / (double)profile->operationCalls[operation];
+
+    return _estimatedCycles(operation);
+}
+
+// follows LatexWrite
+static double _latexLength(void*, const TreeElement* node, const TreeElement* left, const TreeElement* right)
+{
+    switch (node->type)
+    {
+        case NUMBER_TYPE:
+            return LATEX_BRACKETS_LENGTH + snprintf(nullptr, 0, "%lg", node->value.number);
+        case VARIABLE_TYPE:
+            return LATEX_BRACKETS_LENGTH + 1;
+        case OPERATION_TYPE:
+            break;
+        default:
+            return 1;
+    }
+
+    switch (node->value.operation)
+    {
+        case ADD_OPERATION:
+        case SUB_OPERATION:
+            return 1;
+        case MUL_OPERATION:
+            return LATEX_DOT_LENGTH + _latexOperand(left, MUL_OPERATION_PRIORITY) +
+                                      _latexOperand(right, MUL_OPERATION_PRIORITY);
+        case DIV_OPERATION:
+            return LATEX_FRACTION_LENGTH;
+        case POWER_OPERATION:
+            return 1 + _latexOperand(left, POWER_OPERATION_PRIORITY) + _latexOperand(right, POWER_OPERATION_PRIORITY);
+        default:
+            break;
+    }
+
+    switch (node->value.operation)
+    {
+        #define DEF_FUNC(name, priority, hasOneArg, string, length, ...)       \
+        case name:                                                              \
+            return 1 + length + LATEX_BRACKETS_LENGTH;
+
+        #include "DiffFunctions.hpp"
+
+        #undef DEF_FUNC
+
+        default:
+            return 1;
+    }
+}
+
+// rough cycles of one call of the libm function, only their ratios matter
+static double _estimatedCycles(Operation operation)
+{
+    switch (operation)
+    {
+        case ADD_OPERATION:
+        case SUB_OPERATION:
+        case MUL_OPERATION:
+            return 4;
+        case DIV_OPERATION:
+            return 14;
+        case EXP_OPERATION:
+        case LN_OPERATION:
+            return 30;
+        case SIN_OPERATION:
+        case COS_OPERATION:
+            return 40;
+        case ARC_SIN_OPERATION:
+        case ARC_COS_OPERATION:
+        case ARC_TAN_OPERATION:
+            return 50;
+        case TAN_OPERATION:
+            return 60;
+        case POWER_OPERATION:
+            return 80;
+        default:
+            return 4;
+    }
+}
+
+// brackets go around an operation binding weaker than its parent
+static double _latexOperand(const TreeElement* operand, int priority)
+{
+    if (operand && operand->type == OPERATION_TYPE && operand->priority < priority)
+        return LATEX_BRACKETS_LENGTH;
+
+    return 0;
+}
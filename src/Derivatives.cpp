@@ -0,0 +1,1107 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "Derivatives.hpp"
+#include "Optimiser.hpp"
+
+/** @struct _DerivativeMemo
+ * @brief Derivative of every instruction found so far, shared by all orders
+ *
+ * @var _DerivativeMemo::derivatives - index of the derivative instruction, SIZET_POISON if not found yet
+ * @var _DerivativeMemo::dependencies - bit i is set if the instruction depends on variable slot i
+ * @var _DerivativeMemo::known - number of instructions whose dependencies are found
+ * @var _DerivativeMemo::capacity - allocated elements
+ * @var _DerivativeMemo::variable - slot of the variable, SIZET_POISON if the tree does not have it
+ */
+struct _DerivativeMemo
+{
+    size_t* derivatives;
+    uint64_t* dependencies;
+    size_t known;
+    size_t capacity;
+    size_t variable;
+};
+
+#define PUSH_NUMBER(name, val)                                          \
+size_t name = SIZET_POISON;                                             \
+do                                                                      \
+{                                                                       \
+    CompiledIndexResult _tempIndex = _pushNumber(compiled, val);        \
+    RETURN_ERROR_RESULT(_tempIndex, SIZET_POISON);                      \
+    name = _tempIndex.value;                                            \
+} while (0)
+
+#define PUSH_OPERATION(name, op, left, right)                           \
+size_t name = SIZET_POISON;                                             \
+do                                                                      \
+{                                                                       \
+    CompiledIndexResult _tempIndex = _pushOperation(compiled, op, left, right); \
+    RETURN_ERROR_RESULT(_tempIndex, SIZET_POISON);                      \
+    name = _tempIndex.value;                                            \
+} while (0)
+
+#define PUSH_DERIVATIVE(name, index)                                    \
+size_t name = SIZET_POISON;                                             \
+do                                                                      \
+{                                                                       \
+    CompiledIndexResult _tempIndex = _recDerivative(compiled, memo, index); \
+    RETURN_ERROR_RESULT(_tempIndex, SIZET_POISON);                      \
+    name = _tempIndex.value;                                            \
+} while (0)
+
+static CompiledIndexResult _pushNumber(CompiledTree* compiled, double number);
+
+static CompiledIndexResult _pushOperation(CompiledTree* compiled, Operation operation, size_t left, size_t right);
+
+static bool _isNumber(const CompiledTree* compiled, size_t index, double number);
+
+static bool _hasOneArg(Operation operation);
+
+static CompiledIndexResult _recDerivative(CompiledTree* compiled, _DerivativeMemo* memo, size_t index);
+
+static CompiledIndexResult _derivativeOperation(CompiledTree* compiled, _DerivativeMemo* memo, size_t index);
+
+static CompiledIndexResult _pushTaylorPolynomial(CompiledTree* compiled, size_t* substituted, size_t slot,
+                                                 double x0, size_t order);
+
+static CompiledIndexResult _substitute(CompiledTree* compiled, size_t* substituted, size_t index,
+                                       size_t slot, double value);
+
+static CompiledIndexResult _pushFolded(CompiledTree* compiled, Operation operation, size_t left, size_t right);
+
+static double _foldNumbers(Operation operation, double left, double right);
+
+static ErrorCode _addDerivativeOutput(CompiledTree* compiled, _DerivativeMemo* memo, size_t index);
+
+static size_t _hessianOutput(size_t count, size_t slot1, size_t slot2);
+
+static ErrorCode _growMemo(_DerivativeMemo* memo, const CompiledTree* compiled);
+
+static void _resetMemo(_DerivativeMemo* memo, size_t variable);
+
+static void _destroyMemo(_DerivativeMemo* memo);
+
+static size_t _getVariableSlot(const CompiledTree* compiled, char var);
+
+static ErrorCode _countTreeSizes(const CompiledTree* compiled, size_t* sizes);
+
+static TreeResult _buildTree(const CompiledTree* compiled, size_t output, size_t size);
+
+DerivativesResult DifferentiateN(Tree* tree, char var, size_t order)
+{
+    MyAssertSoftResult(tree, {}, ERROR_NULLPTR);
+    MyAssertSoftResult(order, {}, ERROR_BAD_VALUE);
+
+    Derivatives derivatives = {};
+
+    ErrorCode error = derivatives.compiled.Init(tree);
+    if (error)
+        return { {}, error };
+
+    derivatives.sizes = (size_t*)calloc(order + 1, sizeof(*derivatives.sizes));
+    MyAssertSoftResult(derivatives.sizes, {}, ERROR_NO_MEMORY, derivatives.Destructor());
+
+    derivatives.instructions = (size_t*)calloc(order + 1, sizeof(*derivatives.instructions));
+    MyAssertSoftResult(derivatives.instructions, {}, ERROR_NO_MEMORY, derivatives.Destructor());
+
+    derivatives.instructions[0] = derivatives.compiled.size;
+
+    _DerivativeMemo memo = {};
+    _resetMemo(&memo, _getVariableSlot(&derivatives.compiled, var));
+
+    for (size_t k = 1; k <= order; k++)
+    {
+        CompiledIndexResult derivativeRes = _recDerivative(&derivatives.compiled, &memo,
+                                                           derivatives.compiled.outputs[k - 1]);
+        RETURN_ERROR_RESULT(derivativeRes, {}, _destroyMemo(&memo); derivatives.Destructor());
+
+        error = derivatives.compiled.AddOutput(derivativeRes.value);
+        if (error)
+        {
+            _destroyMemo(&memo);
+            derivatives.Destructor();
+            return { {}, error };
+        }
+
+        derivatives.instructions[k] = derivatives.compiled.size;
+        derivatives.order = k;
+    }
+
+    _destroyMemo(&memo);
+
+    error = _countTreeSizes(&derivatives.compiled, derivatives.sizes);
+    if (error)
+    {
+        derivatives.Destructor();
+        return { {}, error };
+    }
+
+    return { derivatives, EVERYTHING_FINE };
+}
+
+TreeResult DerivativeTree(Derivatives* derivatives, size_t order)
+{
+    MyAssertSoftResult(derivatives, {}, ERROR_NULLPTR);
+    MyAssertSoftResult(order <= derivatives->order, {}, ERROR_INDEX_OUT_OF_BOUNDS);
+
+    return _buildTree(&derivatives->compiled, order, derivatives->sizes[order]);
+}
+
+ErrorCode Derivatives::Destructor()
+{
+    free(this->sizes);
+    free(this->instructions);
+
+    this->sizes        = nullptr;
+    this->instructions = nullptr;
+    this->order        = 0;
+
+    return this->compiled.Destructor();
+}
+
+TreeResult TaylorExpand(Tree* tree, char var, double x0, size_t order)
+{
+    MyAssertSoftResult(tree, {}, ERROR_NULLPTR);
+
+    // order 0 still needs the function compiled, the one extra derivative is cheap
+    DerivativesResult derivativesRes = DifferentiateN(tree, var, order ? order : 1);
+    RETURN_ERROR_RESULT(derivativesRes, {});
+    Derivatives derivatives = derivativesRes.value;
+
+    CompiledTree* compiled = &derivatives.compiled;
+
+    // the instructions with x0 put in go after these, they are never substituted again
+    size_t* substituted = (size_t*)calloc(compiled->size, sizeof(*substituted));
+    MyAssertSoftResult(substituted, {}, ERROR_NO_MEMORY, derivatives.Destructor());
+
+    for (size_t i = 0; i < compiled->size; i++)
+        substituted[i] = SIZET_POISON;
+
+    CompiledIndexResult polynomialRes = _pushTaylorPolynomial(compiled, substituted,
+                                                              _getVariableSlot(compiled, var), x0, order);
+
+    free(substituted);
+
+    RETURN_ERROR_RESULT(polynomialRes, {}, derivatives.Destructor());
+
+    ErrorCode error = compiled->AddOutput(polynomialRes.value);
+    if (error)
+    {
+        derivatives.Destructor();
+        return { {}, error };
+    }
+
+    size_t* sizes = (size_t*)calloc(compiled->outputCount, sizeof(*sizes));
+    MyAssertSoftResult(sizes, {}, ERROR_NO_MEMORY, derivatives.Destructor());
+
+    error = _countTreeSizes(compiled, sizes);
+
+    TreeResult polynomialTree = { {}, error };
+    if (!error)
+        polynomialTree = _buildTree(compiled, compiled->outputCount - 1, sizes[compiled->outputCount - 1]);
+
+    free(sizes);
+    derivatives.Destructor();
+
+    RETURN_ERROR_RESULT(polynomialTree, {});
+
+    // in powers of x - x0, multiplied out it would lose precision away from 0
+    error = OptimiseByRules(&polynomialTree.value, nullptr);
+    if (error)
+    {
+        polynomialTree.value.Destructor();
+        return { {}, error };
+    }
+
+    return polynomialTree;
+}
+
+GradientResult FindGradient(Tree* tree)
+{
+    MyAssertSoftResult(tree, {}, ERROR_NULLPTR);
+
+    Gradient gradient = {};
+
+    ErrorCode error = gradient.compiled.Init(tree);
+    if (error)
+        return { {}, error };
+
+    size_t count = gradient.compiled.variableCount;
+
+    gradient.sizes = (size_t*)calloc(count + 1, sizeof(*gradient.sizes));
+    MyAssertSoftResult(gradient.sizes, {}, ERROR_NO_MEMORY, gradient.Destructor());
+
+    _DerivativeMemo memo = {};
+
+    // the instructions and their dependencies are shared, only the derivatives are found anew
+    for (size_t slot = 0; slot < count; slot++)
+    {
+        _resetMemo(&memo, slot);
+
+        error = _addDerivativeOutput(&gradient.compiled, &memo, gradient.compiled.outputs[0]);
+        if (error)
+        {
+            _destroyMemo(&memo);
+            gradient.Destructor();
+            return { {}, error };
+        }
+
+        gradient.count = slot + 1;
+    }
+
+    _destroyMemo(&memo);
+
+    error = _countTreeSizes(&gradient.compiled, gradient.sizes);
+    if (error)
+    {
+        gradient.Destructor();
+        return { {}, error };
+    }
+
+    return { gradient, EVERYTHING_FINE };
+}
+
+TreeResult GradientTree(Gradient* gradient, char var)
+{
+    MyAssertSoftResult(gradient, {}, ERROR_NULLPTR);
+
+    size_t slot = _getVariableSlot(&gradient->compiled, var);
+    if (slot == SIZET_POISON)
+        return { {}, ERROR_NOT_FOUND };
+
+    return _buildTree(&gradient->compiled, slot + 1, gradient->sizes[slot + 1]);
+}
+
+ErrorCode Gradient::Destructor()
+{
+    free(this->sizes);
+
+    this->sizes = nullptr;
+    this->count = 0;
+
+    return this->compiled.Destructor();
+}
+
+JacobianResult FindJacobian(Tree* const* trees, size_t count)
+{
+    MyAssertSoftResult(trees, {}, ERROR_NULLPTR);
+
+    Jacobian jacobian = {};
+
+    ErrorCode error = jacobian.compiled.Init(trees, count);
+    if (error)
+        return { {}, error };
+
+    jacobian.rows    = count;
+    jacobian.columns = jacobian.compiled.variableCount;
+
+    jacobian.entries = (size_t*)calloc(jacobian.rows * jacobian.columns + 1, sizeof(*jacobian.entries));
+    MyAssertSoftResult(jacobian.entries, {}, ERROR_NO_MEMORY, jacobian.Destructor());
+
+    _DerivativeMemo memo = {};
+
+    // a column shares the derivatives of the shared subexpressions
+    for (size_t slot = 0; slot < jacobian.columns && !error; slot++)
+    {
+        _resetMemo(&memo, slot);
+
+        error = _growMemo(&memo, &jacobian.compiled);
+
+        for (size_t row = 0; row < jacobian.rows && !error; row++)
+        {
+            size_t* entry = &jacobian.entries[row * jacobian.columns + slot];
+
+            if (!(memo.dependencies[jacobian.compiled.outputs[row]] >> slot & 1))
+            {
+                *entry = SIZET_POISON;
+                continue;
+            }
+
+            error = _addDerivativeOutput(&jacobian.compiled, &memo, jacobian.compiled.outputs[row]);
+
+            *entry = jacobian.compiled.outputCount - 1;
+            jacobian.nonZero++;
+        }
+    }
+
+    _destroyMemo(&memo);
+
+    if (!error)
+    {
+        jacobian.sizes = (size_t*)calloc(jacobian.compiled.outputCount, sizeof(*jacobian.sizes));
+        error = jacobian.sizes ? _countTreeSizes(&jacobian.compiled, jacobian.sizes) : ERROR_NO_MEMORY;
+    }
+
+    if (error)
+    {
+        jacobian.Destructor();
+        return { {}, error };
+    }
+
+    return { jacobian, EVERYTHING_FINE };
+}
+
+TreeResult JacobianTree(Jacobian* jacobian, size_t row, char var)
+{
+    MyAssertSoftResult(jacobian, {}, ERROR_NULLPTR);
+    MyAssertSoftResult(row < jacobian->rows, {}, ERROR_INDEX_OUT_OF_BOUNDS);
+
+    size_t slot = _getVariableSlot(&jacobian->compiled, var);
+    if (slot == SIZET_POISON)
+        return { {}, ERROR_NOT_FOUND };
+
+    size_t output = jacobian->entries[row * jacobian->columns + slot];
+    if (output != SIZET_POISON)
+        return _buildTree(&jacobian->compiled, output, jacobian->sizes[output]);
+
+    TreeElement_t zero = {};
+    zero.type = NUMBER_TYPE;
+    zero.value.number = 0;
+
+    TreeNodeResult zeroRes = TreeNode::New(zero, nullptr, nullptr);
+    RETURN_ERROR_RESULT(zeroRes, {});
+
+    Tree tree = {};
+    ErrorCode error = tree.Init(zeroRes.value);
+    if (error)
+    {
+        zeroRes.value->Delete();
+        return { {}, error };
+    }
+
+    return { tree, EVERYTHING_FINE };
+}
+
+ErrorCode Jacobian::Destructor()
+{
+    free(this->entries);
+    free(this->sizes);
+
+    this->entries = nullptr;
+    this->sizes   = nullptr;
+    this->rows    = 0;
+    this->columns = 0;
+    this->nonZero = 0;
+
+    return this->compiled.Destructor();
+}
+
+HessianResult FindHessian(Tree* tree)
+{
+    MyAssertSoftResult(tree, {}, ERROR_NULLPTR);
+
+    Hessian hessian = {};
+
+    ErrorCode error = hessian.compiled.Init(tree);
+    if (error)
+        return { {}, error };
+
+    size_t count = hessian.compiled.variableCount;
+
+    hessian.sizes = (size_t*)calloc(1 + count + count * (count + 1) / 2, sizeof(*hessian.sizes));
+    MyAssertSoftResult(hessian.sizes, {}, ERROR_NO_MEMORY, hessian.Destructor());
+
+    hessian.count = count;
+
+    _DerivativeMemo memo = {};
+
+    for (size_t slot = 0; slot < count && !error; slot++)
+    {
+        _resetMemo(&memo, slot);
+        error = _addDerivativeOutput(&hessian.compiled, &memo, hessian.compiled.outputs[0]);
+    }
+
+    // the column of the variable is the derivative of the gradient by it, the entries below
+    // the diagonal are the same as in the columns before
+    for (size_t column = 0; column < count && !error; column++)
+    {
+        _resetMemo(&memo, column);
+
+        for (size_t row = 0; row <= column && !error; row++)
+            error = _addDerivativeOutput(&hessian.compiled, &memo, hessian.compiled.outputs[row + 1]);
+    }
+
+    _destroyMemo(&memo);
+
+    if (!error)
+        error = _countTreeSizes(&hessian.compiled, hessian.sizes);
+
+    if (error)
+    {
+        hessian.Destructor();
+        return { {}, error };
+    }
+
+    return { hessian, EVERYTHING_FINE };
+}
+
+TreeResult HessianTree(Hessian* hessian, char var1, char var2)
+{
+    MyAssertSoftResult(hessian, {}, ERROR_NULLPTR);
+
+    size_t slot1 = _getVariableSlot(&hessian->compiled, var1);
+    size_t slot2 = _getVariableSlot(&hessian->compiled, var2);
+    if (slot1 == SIZET_POISON || slot2 == SIZET_POISON)
+        return { {}, ERROR_NOT_FOUND };
+
+    size_t output = _hessianOutput(hessian->count, slot1, slot2);
+
+    TreeResult treeRes = _buildTree(&hessian->compiled, output, hessian->sizes[output]);
+    RETURN_ERROR_RESULT(treeRes, {});
+
+    ErrorCode error = Optimise(&treeRes.value, nullptr);
+    if (error)
+    {
+        treeRes.value.Destructor();
+        return { {}, error };
+    }
+
+    return treeRes;
+}
+
+ErrorCode Hessian::Destructor()
+{
+    free(this->sizes);
+
+    this->sizes = nullptr;
+    this->count = 0;
+
+    return this->compiled.Destructor();
+}
+
+// outputs[k] of the compiled tree must be the derivative of order k
+static CompiledIndexResult _pushTaylorPolynomial(CompiledTree* compiled, size_t* substituted, size_t slot,
+                                                 double x0, size_t order)
+{
+    MyAssertSoftResult(compiled, SIZET_POISON, ERROR_NULLPTR);
+
+    CompiledIndexResult functionRes = _substitute(compiled, substituted, compiled->outputs[0], slot, x0);
+
+    // without the variable every derivative is 0
+    if (functionRes.error || slot == SIZET_POISON)
+        return functionRes;
+
+    CompiledInstruction variable = {};
+    variable.type     = VARIABLE_TYPE;
+    variable.variable = slot;
+
+    CompiledIndexResult xRes = compiled->Push(variable);
+    RETURN_ERROR_RESULT(xRes, SIZET_POISON);
+
+    // x - x0, or x + |x0| for a negative x0
+    PUSH_NUMBER(absX0, fabs(x0));
+    PUSH_OPERATION(shift, x0 < 0 ? ADD_OPERATION : SUB_OPERATION, xRes.value, absX0);
+
+    size_t polynomial = functionRes.value;
+    double factorial  = 1;
+
+    for (size_t k = 1; k <= order; k++)
+    {
+        factorial *= (double)k;
+
+        CompiledIndexResult derivativeRes = _substitute(compiled, substituted, compiled->outputs[k], slot, x0);
+        RETURN_ERROR_RESULT(derivativeRes, SIZET_POISON);
+
+        // f^(k)(x0) / k! * (x - x0) ^ k, a negative number is subtracted instead
+        Operation sign = ADD_OPERATION;
+        CompiledInstruction derivative = compiled->instructions[derivativeRes.value];
+
+        if (derivative.type == NUMBER_TYPE && derivative.number < 0)
+        {
+            sign = SUB_OPERATION;
+            derivativeRes = _pushNumber(compiled, -derivative.number);
+            RETURN_ERROR_RESULT(derivativeRes, SIZET_POISON);
+        }
+
+        PUSH_NUMBER(kFactorial, factorial);
+        PUSH_OPERATION(coefficient, DIV_OPERATION, derivativeRes.value, kFactorial);
+
+        PUSH_NUMBER(power, (double)k);
+        PUSH_OPERATION(shiftPower, POWER_OPERATION, shift, power);
+
+        PUSH_OPERATION(term, MUL_OPERATION, coefficient, shiftPower);
+        PUSH_OPERATION(sum, sign, polynomial, term);
+
+        polynomial = sum;
+    }
+
+    return { polynomial, EVERYTHING_FINE };
+}
+
+// the instruction with the variable in the slot replaced by the value, functions of numbers are folded
+static CompiledIndexResult _substitute(CompiledTree* compiled, size_t* substituted, size_t index,
+                                       size_t slot, double value)
+{
+    MyAssertSoftResult(compiled, SIZET_POISON, ERROR_NULLPTR);
+    MyAssertSoftResult(substituted, SIZET_POISON, ERROR_NULLPTR);
+
+    if (substituted[index] != SIZET_POISON)
+        return { substituted[index], EVERYTHING_FINE };
+
+    // pushing may move the instructions
+    CompiledInstruction instruction = compiled->instructions[index];
+
+    CompiledIndexResult resultRes = { index, EVERYTHING_FINE };
+
+    switch (instruction.type)
+    {
+        case NUMBER_TYPE:
+            break;
+        case VARIABLE_TYPE:
+            if (instruction.variable == slot)
+                resultRes = _pushNumber(compiled, value);
+            break;
+        case OPERATION_TYPE:
+        {
+            CompiledIndexResult leftRes = _substitute(compiled, substituted, instruction.left, slot, value);
+            RETURN_ERROR_RESULT(leftRes, SIZET_POISON);
+
+            CompiledIndexResult rightRes = { 0, EVERYTHING_FINE };
+            if (!_hasOneArg(instruction.operation))
+            {
+                rightRes = _substitute(compiled, substituted, instruction.right, slot, value);
+                RETURN_ERROR_RESULT(rightRes, SIZET_POISON);
+            }
+
+            resultRes = _pushFolded(compiled, instruction.operation, leftRes.value, rightRes.value);
+            break;
+        }
+        default:
+            return { SIZET_POISON, ERROR_BAD_VALUE };
+    }
+
+    RETURN_ERROR_RESULT(resultRes, SIZET_POISON);
+
+    substituted[index] = resultRes.value;
+
+    return resultRes;
+}
+
+// unlike _pushOperation folds functions too and fails where the operation is not defined
+static CompiledIndexResult _pushFolded(CompiledTree* compiled, Operation operation, size_t left, size_t right)
+{
+    bool binary = !_hasOneArg(operation);
+
+    if (compiled->instructions[left].type != NUMBER_TYPE ||
+        (binary && compiled->instructions[right].type != NUMBER_TYPE))
+        return _pushOperation(compiled, operation, left, right);
+
+    double leftNumber  = compiled->instructions[left].number;
+    double rightNumber = binary ? compiled->instructions[right].number : 0;
+
+    if (operation == DIV_OPERATION && rightNumber == 0)
+        return { SIZET_POISON, ERROR_ZERO_DIVISION };
+
+    double number = _foldNumbers(operation, leftNumber, rightNumber);
+    if (!isfinite(number))
+        return { SIZET_POISON, ERROR_BAD_VALUE };
+
+    return _pushNumber(compiled, number);
+}
+
+static double _foldNumbers(Operation operation, double left, double right)
+{
+    switch (operation)
+    {
+        case ADD_OPERATION:
+            return left + right;
+        case SUB_OPERATION:
+            return left - right;
+        case MUL_OPERATION:
+            return left * right;
+        case DIV_OPERATION:
+            return left / right;
+        case POWER_OPERATION:
+            return pow(left, right);
+        case SIN_OPERATION:
+            return sin(left);
+        case COS_OPERATION:
+            return cos(left);
+        case TAN_OPERATION:
+            return tan(left);
+        case ARC_SIN_OPERATION:
+            return asin(left);
+        case ARC_COS_OPERATION:
+            return acos(left);
+        case ARC_TAN_OPERATION:
+            return atan(left);
+        case EXP_OPERATION:
+            return exp(left);
+        case LN_OPERATION:
+            return log(left);
+        default:
+            return NAN;
+    }
+}
+
+static ErrorCode _addDerivativeOutput(CompiledTree* compiled, _DerivativeMemo* memo, size_t index)
+{
+    CompiledIndexResult derivativeRes = _recDerivative(compiled, memo, index);
+    RETURN_ERROR(derivativeRes.error);
+
+    return compiled->AddOutput(derivativeRes.value);
+}
+
+static size_t _hessianOutput(size_t count, size_t slot1, size_t slot2)
+{
+    size_t row    = slot1 < slot2 ? slot1 : slot2;
+    size_t column = slot1 < slot2 ? slot2 : slot1;
+
+    return 1 + count + column * (column + 1) / 2 + row;
+}
+
+static TreeResult _buildTree(const CompiledTree* compiled, size_t output, size_t size)
+{
+    MyAssertSoftResult(compiled, {}, ERROR_NULLPTR);
+
+    if (size > MAX_TREE_SIZE)
+        return { {}, ERROR_BAD_SIZE };
+
+    TreeNodeResult rootRes = compiled->BuildNode(compiled->outputs[output]);
+    RETURN_ERROR_RESULT(rootRes, {});
+
+    Tree tree = {};
+    ErrorCode error = tree.Init(rootRes.value);
+    if (error)
+    {
+        rootRes.value->Delete();
+        return { {}, error };
+    }
+
+    return { tree, EVERYTHING_FINE };
+}
+
+static CompiledIndexResult _pushNumber(CompiledTree* compiled, double number)
+{
+    CompiledInstruction instruction = {};
+    instruction.type   = NUMBER_TYPE;
+    instruction.number = number;
+
+    return compiled->Push(instruction);
+}
+
+static bool _isNumber(const CompiledTree* compiled, size_t index, double number)
+{
+    return compiled->instructions[index].type == NUMBER_TYPE &&
+           IsEqual(compiled->instructions[index].number, number);
+}
+
+static bool _hasOneArg(Operation operation)
+{
+    switch (operation)
+    {
+        #define DEF_FUNC(name, priority, hasOneArg, ...)                        \
+        case name:                                                              \
+            return hasOneArg;
+
+        #include "DiffFunctions.hpp"
+
+        #undef DEF_FUNC
+
+        default:
+            return false;
+    }
+}
+
+// folds constants and drops neutral elements like Optimise does
+static CompiledIndexResult _pushOperation(CompiledTree* compiled, Operation operation, size_t left, size_t right)
+{
+    MyAssertSoftResult(compiled, SIZET_POISON, ERROR_NULLPTR);
+
+    bool binary = !_hasOneArg(operation);
+
+    if (binary && compiled->instructions[left].type  == NUMBER_TYPE
+               && compiled->instructions[right].type == NUMBER_TYPE)
+    {
+        double leftNumber  = compiled->instructions[left].number;
+        double rightNumber = compiled->instructions[right].number;
+
+        switch (operation)
+        {
+            case ADD_OPERATION:
+                return _pushNumber(compiled, leftNumber + rightNumber);
+            case SUB_OPERATION:
+                return _pushNumber(compiled, leftNumber - rightNumber);
+            case MUL_OPERATION:
+                return _pushNumber(compiled, leftNumber * rightNumber);
+            case DIV_OPERATION:
+                if (rightNumber == 0)
+                    return { SIZET_POISON, ERROR_ZERO_DIVISION };
+                return _pushNumber(compiled, leftNumber / rightNumber);
+            case POWER_OPERATION:
+                return _pushNumber(compiled, pow(leftNumber, rightNumber));
+            default:
+                break;
+        }
+    }
+
+    switch (operation)
+    {
+        case ADD_OPERATION:
+            if (_isNumber(compiled, left, 0))
+                return { right, EVERYTHING_FINE };
+            if (_isNumber(compiled, right, 0))
+                return { left, EVERYTHING_FINE };
+            break;
+        case SUB_OPERATION:
+            if (_isNumber(compiled, right, 0))
+                return { left, EVERYTHING_FINE };
+            break;
+        case MUL_OPERATION:
+            if (_isNumber(compiled, left, 0) || _isNumber(compiled, right, 0))
+                return _pushNumber(compiled, 0);
+            if (_isNumber(compiled, left, 1))
+                return { right, EVERYTHING_FINE };
+            if (_isNumber(compiled, right, 1))
+                return { left, EVERYTHING_FINE };
+            break;
+        case DIV_OPERATION:
+            if (_isNumber(compiled, left, 0))
+                return _pushNumber(compiled, 0);
+            if (_isNumber(compiled, right, 1))
+                return { left, EVERYTHING_FINE };
+            break;
+        case POWER_OPERATION:
+            if (_isNumber(compiled, left, 0))
+                return _pushNumber(compiled, 0);
+            if (_isNumber(compiled, left, 1) || _isNumber(compiled, right, 0))
+                return _pushNumber(compiled, 1);
+            if (_isNumber(compiled, right, 1))
+                return { left, EVERYTHING_FINE };
+            break;
+        default:
+            break;
+    }
+
+    CompiledInstruction instruction = {};
+    instruction.type      = OPERATION_TYPE;
+    instruction.operation = operation;
+    instruction.left      = left;
+    instruction.right     = binary ? right : 0;
+
+    return compiled->Push(instruction);
+}
+
+static CompiledIndexResult _recDerivative(CompiledTree* compiled, _DerivativeMemo* memo, size_t index)
+{
+    MyAssertSoftResult(compiled, SIZET_POISON, ERROR_NULLPTR);
+    MyAssertSoftResult(memo, SIZET_POISON, ERROR_NULLPTR);
+    MyAssertSoftResult(index < compiled->size, SIZET_POISON, ERROR_INDEX_OUT_OF_BOUNDS);
+
+    ErrorCode error = _growMemo(memo, compiled);
+    if (error)
+        return { SIZET_POISON, error };
+
+    if (memo->derivatives[index] != SIZET_POISON)
+        return { memo->derivatives[index], EVERYTHING_FINE };
+
+    CompiledIndexResult derivativeRes = {};
+
+    bool dependsOnVariable = memo->variable != SIZET_POISON &&
+                             (memo->dependencies[index] >> memo->variable & 1);
+
+    switch (compiled->instructions[index].type)
+    {
+        case NUMBER_TYPE:
+            derivativeRes = _pushNumber(compiled, 0);
+            break;
+        case VARIABLE_TYPE:
+            derivativeRes = _pushNumber(compiled, dependsOnVariable);
+            break;
+        case OPERATION_TYPE:
+            if (dependsOnVariable)
+                derivativeRes = _derivativeOperation(compiled, memo, index);
+            else
+                derivativeRes = _pushNumber(compiled, 0);
+            break;
+        default:
+            return { SIZET_POISON, ERROR_BAD_VALUE };
+    }
+
+    RETURN_ERROR_RESULT(derivativeRes, SIZET_POISON);
+
+    // the instructions pushed meanwhile may have outgrown the memo
+    error = _growMemo(memo, compiled);
+    if (error)
+        return { SIZET_POISON, error };
+
+    memo->derivatives[index] = derivativeRes.value;
+
+    return derivativeRes;
+}
+
+// the same rules as in Differentiator.cpp
+static CompiledIndexResult _derivativeOperation(CompiledTree* compiled, _DerivativeMemo* memo, size_t index)
+{
+    MyAssertSoftResult(compiled, SIZET_POISON, ERROR_NULLPTR);
+
+    CompiledInstruction instruction = compiled->instructions[index];
+
+    size_t u = instruction.left;
+    size_t v = instruction.right;
+
+    switch (instruction.operation)
+    {
+        // (u +- v)' = u' +- v'
+        case ADD_OPERATION:
+        case SUB_OPERATION:
+        {
+            PUSH_DERIVATIVE(du, u);
+            PUSH_DERIVATIVE(dv, v);
+
+            return _pushOperation(compiled, instruction.operation, du, dv);
+        }
+        // (uv)' = u'v + uv'
+        case MUL_OPERATION:
+        {
+            PUSH_DERIVATIVE(du, u);
+            PUSH_DERIVATIVE(dv, v);
+
+            PUSH_OPERATION(duv, MUL_OPERATION, du, v);
+            PUSH_OPERATION(udv, MUL_OPERATION, u, dv);
+
+            return _pushOperation(compiled, ADD_OPERATION, duv, udv);
+        }
+        // (u / v)' = (u'v - uv') / (v ^ 2)
+        case DIV_OPERATION:
+        {
+            PUSH_DERIVATIVE(du, u);
+            PUSH_DERIVATIVE(dv, v);
+
+            PUSH_OPERATION(duv, MUL_OPERATION, du, v);
+            PUSH_OPERATION(udv, MUL_OPERATION, u, dv);
+            PUSH_OPERATION(leftSub, SUB_OPERATION, duv, udv);
+
+            PUSH_NUMBER(two, 2);
+            PUSH_OPERATION(vSquared, POWER_OPERATION, v, two);
+
+            return _pushOperation(compiled, DIV_OPERATION, leftSub, vSquared);
+        }
+        case POWER_OPERATION:
+        {
+            // (u ^ a)' = u' * (a * u ^ (a - 1))
+            if (compiled->instructions[v].type == NUMBER_TYPE)
+            {
+                PUSH_DERIVATIVE(du, u);
+
+                PUSH_NUMBER(aMinusOne, compiled->instructions[v].number - 1);
+                PUSH_OPERATION(uPowAMinusOne, POWER_OPERATION, u, aMinusOne);
+                PUSH_OPERATION(aMulUPowAMinusOne, MUL_OPERATION, v, uPowAMinusOne);
+
+                return _pushOperation(compiled, MUL_OPERATION, du, aMulUPowAMinusOne);
+            }
+
+            // (u ^ c)' = u' * (c * u ^ (c - 1)), c does not have the variable
+            if (!(memo->dependencies[v] >> memo->variable & 1))
+            {
+                PUSH_DERIVATIVE(du, u);
+
+                PUSH_NUMBER(one, 1);
+                PUSH_OPERATION(cMinusOne, SUB_OPERATION, v, one);
+                PUSH_OPERATION(uPowCMinusOne, POWER_OPERATION, u, cMinusOne);
+                PUSH_OPERATION(cMulUPowCMinusOne, MUL_OPERATION, v, uPowCMinusOne);
+
+                return _pushOperation(compiled, MUL_OPERATION, du, cMulUPowCMinusOne);
+            }
+
+            // (u ^ v)' = u ^ v * (v * lnu)'
+            PUSH_OPERATION(lnu, LN_OPERATION, u, 0);
+            PUSH_OPERATION(vlnu, MUL_OPERATION, v, lnu);
+            PUSH_DERIVATIVE(dvlnu, vlnu);
+
+            return _pushOperation(compiled, MUL_OPERATION, index, dvlnu);
+        }
+        // (sinu)' = u' * cosu
+        case SIN_OPERATION:
+        {
+            PUSH_DERIVATIVE(du, u);
+            PUSH_OPERATION(cosu, COS_OPERATION, u, 0);
+
+            return _pushOperation(compiled, MUL_OPERATION, du, cosu);
+        }
+        // (cosu)' = u' * (-1 * sinu)
+        case COS_OPERATION:
+        {
+            PUSH_DERIVATIVE(du, u);
+            PUSH_OPERATION(sinu, SIN_OPERATION, u, 0);
+            PUSH_NUMBER(neg1, -1);
+            PUSH_OPERATION(minusSinu, MUL_OPERATION, neg1, sinu);
+
+            return _pushOperation(compiled, MUL_OPERATION, du, minusSinu);
+        }
+        // (tanu)' = u' / (cosu)^2
+        case TAN_OPERATION:
+        {
+            PUSH_DERIVATIVE(du, u);
+            PUSH_OPERATION(cosu, COS_OPERATION, u, 0);
+            PUSH_NUMBER(two, 2);
+            PUSH_OPERATION(cosuSqr, POWER_OPERATION, cosu, two);
+
+            return _pushOperation(compiled, DIV_OPERATION, du, cosuSqr);
+        }
+        // (arcsinu)' = u' / ((1 - u ^ 2) ^ 0.5), (arccosu)' = -1 * (arcsinu)'
+        case ARC_SIN_OPERATION:
+        case ARC_COS_OPERATION:
+        {
+            PUSH_DERIVATIVE(du, u);
+            PUSH_NUMBER(two, 2);
+            PUSH_NUMBER(zeroFive, 0.5);
+            PUSH_NUMBER(one, 1);
+
+            PUSH_OPERATION(uSqr, POWER_OPERATION, u, two);
+            PUSH_OPERATION(oneSubUSqr, SUB_OPERATION, one, uSqr);
+            PUSH_OPERATION(oneSubUSqrSqrt, POWER_OPERATION, oneSubUSqr, zeroFive);
+
+            if (instruction.operation == ARC_SIN_OPERATION)
+                return _pushOperation(compiled, DIV_OPERATION, du, oneSubUSqrSqrt);
+
+            PUSH_OPERATION(arcsin, DIV_OPERATION, du, oneSubUSqrSqrt);
+            PUSH_NUMBER(neg1, -1);
+
+            return _pushOperation(compiled, MUL_OPERATION, neg1, arcsin);
+        }
+        // (arctanu)' = u' / (1 + u ^ 2)
+        case ARC_TAN_OPERATION:
+        {
+            PUSH_DERIVATIVE(du, u);
+            PUSH_NUMBER(one, 1);
+            PUSH_NUMBER(two, 2);
+
+            PUSH_OPERATION(uSqr, POWER_OPERATION, u, two);
+            PUSH_OPERATION(onePlusUSqr, ADD_OPERATION, one, uSqr);
+
+            return _pushOperation(compiled, DIV_OPERATION, du, onePlusUSqr);
+        }
+        // (e ^ u)' = e ^ u * u'
+        case EXP_OPERATION:
+        {
+            PUSH_DERIVATIVE(du, u);
+
+            return _pushOperation(compiled, MUL_OPERATION, index, du);
+        }
+        // (lnu)' = u' / u
+        case LN_OPERATION:
+        {
+            PUSH_DERIVATIVE(du, u);
+
+            return _pushOperation(compiled, DIV_OPERATION, du, u);
+        }
+        default:
+            return { SIZET_POISON, ERROR_BAD_VALUE };
+    }
+}
+
+static ErrorCode _growMemo(_DerivativeMemo* memo, const CompiledTree* compiled)
+{
+    MyAssertSoft(memo, ERROR_NULLPTR);
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+
+    if (compiled->size > memo->capacity)
+    {
+        size_t capacity = memo->capacity ? memo->capacity : compiled->size;
+        while (capacity < compiled->size)
+            capacity *= 2;
+
+        size_t* newDerivatives = (size_t*)realloc(memo->derivatives, capacity * sizeof(*newDerivatives));
+        MyAssertSoft(newDerivatives, ERROR_NO_MEMORY);
+        memo->derivatives = newDerivatives;
+
+        uint64_t* newDependencies = (uint64_t*)realloc(memo->dependencies, capacity * sizeof(*newDependencies));
+        MyAssertSoft(newDependencies, ERROR_NO_MEMORY);
+        memo->dependencies = newDependencies;
+
+        for (size_t i = memo->capacity; i < capacity; i++)
+            newDerivatives[i] = SIZET_POISON;
+
+        memo->capacity = capacity;
+    }
+
+    // operands go first, so their dependencies are already known
+    for (; memo->known < compiled->size; memo->known++)
+    {
+        const CompiledInstruction* instruction = &compiled->instructions[memo->known];
+
+        uint64_t dependencies = 0;
+
+        switch (instruction->type)
+        {
+            case VARIABLE_TYPE:
+                dependencies = (uint64_t)1 << instruction->variable;
+                break;
+            case OPERATION_TYPE:
+                dependencies = memo->dependencies[instruction->left];
+                if (!_hasOneArg(instruction->operation))
+                    dependencies |= memo->dependencies[instruction->right];
+                break;
+            case NUMBER_TYPE:
+            default:
+                break;
+        }
+
+        memo->dependencies[memo->known] = dependencies;
+    }
+
+    return EVERYTHING_FINE;
+}
+
+static void _resetMemo(_DerivativeMemo* memo, size_t variable)
+{
+    for (size_t i = 0; i < memo->capacity; i++)
+        memo->derivatives[i] = SIZET_POISON;
+
+    memo->variable = variable;
+}
+
+static void _destroyMemo(_DerivativeMemo* memo)
+{
+    free(memo->derivatives);
+    free(memo->dependencies);
+
+    *memo = {};
+}
+
+static size_t _getVariableSlot(const CompiledTree* compiled, char var)
+{
+    for (size_t slot = 0; slot < compiled->variableCount; slot++)
+        if (compiled->variables[slot] == var)
+            return slot;
+
+    return SIZET_POISON;
+}
+
+// instructions go operands first, so one pass counts every subtree
+static ErrorCode _countTreeSizes(const CompiledTree* compiled, size_t* sizes)
+{
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+    MyAssertSoft(sizes, ERROR_NULLPTR);
+
+    size_t* treeSizes = (size_t*)calloc(compiled->size, sizeof(*treeSizes));
+    MyAssertSoft(treeSizes, ERROR_NO_MEMORY);
+
+    for (size_t i = 0; i < compiled->size; i++)
+    {
+        const CompiledInstruction* instruction = &compiled->instructions[i];
+
+        size_t size = 1;
+
+        if (instruction->type == OPERATION_TYPE)
+        {
+            size_t operands = treeSizes[instruction->left];
+
+            if (!_hasOneArg(instruction->operation))
+                operands = operands > SIZE_MAX - treeSizes[instruction->right] ?
+                           SIZE_MAX : operands + treeSizes[instruction->right];
+
+            size = operands == SIZE_MAX ? SIZE_MAX : operands + 1;
+        }
+
+        treeSizes[i] = size;
+    }
+
+    for (size_t i = 0; i < compiled->outputCount; i++)
+        sizes[i] = treeSizes[compiled->outputs[i]];
+
+    free(treeSizes);
+
+    return EVERYTHING_FINE;
+}
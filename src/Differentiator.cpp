@@ -1,29 +1,245 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "Differentiator.hpp"
+#include "Evaluator.hpp"
+#include "Optimiser.hpp"
+#include "Normaliser.hpp"
+#include "Sort.hpp"
 #include "DiffTreeDSL.hpp"
-#include "LatexWriter.hpp"
+
+/** @struct _DiffMemoEntry
+ * @brief A differentiated subtree of the original tree and its derivative
+ *
+ * @var _DiffMemoEntry::original - the subtree
+ * @var _DiffMemoEntry::derivative - its derivative inside the new tree, only copied from
+ * @var _DiffMemoEntry::hash - structural hash of the subtree
+ * @var _DiffMemoEntry::next - next entry with the same bucket, SIZET_POISON at the end
+ */
+struct _DiffMemoEntry
+{
+    TreeNode* original;
+    TreeNode* derivative;
+    size_t hash;
+    size_t next;
+};
+
+/** @struct _DiffMemo
+ * @brief Derivatives found so far, so a repeated subtree is differentiated once.
+ * Entries are only added at the end and every bucket starts with its newest entry.
+ */
+struct _DiffMemo
+{
+    _DiffMemoEntry* entries;
+    size_t size;
+    size_t capacity;
+
+    size_t* buckets;
+    size_t bucketCount;
+
+    DiffMemoStats stats;
+};
+
+/** @struct _DiffHashes
+ * @brief Structural hashes of all the subtrees of the differentiated tree, found once from the leaves up.
+ * Nodes are found with linear probing, the table is at most half full.
+ * It is only read while differentiating, so every task shares it.
+ */
+struct _DiffHashes
+{
+    TreeNode** nodes;
+    size_t* hashes;
+    size_t capacity;
+};
+
+enum _DiffStepType
+{
+    LEAF_STEP,
+    NEED_STEP,
+    FOUND_STEP,
+    REPEATED_STEP,
+};
+
+/** @struct _DiffStep
+ * @brief A step of a parallel task, told to the real observer after the task is joined
+ */
+struct _DiffStep
+{
+    _DiffStepType type;
+    TreeNode* node;
+    TreeNode* derivative;
+};
+
+/** @struct _DiffLog
+ * @brief Steps of a parallel task in the order the sequential differentiator makes them
+ *
+ * @var _DiffLog::retired - trees left out of the derivative that the memo or the steps may point to,
+ * deleted when the whole differentiation ends
+ */
+struct _DiffLog
+{
+    _DiffStep* steps;
+    size_t size;
+    size_t capacity;
+
+    TreeNode** retired;
+    size_t retiredSize;
+    size_t retiredCapacity;
+};
+
+/** @struct _DiffContext
+ * @brief Everything the rules need besides the nodes, one per task so tasks share nothing mutable
+ *
+ * @var _DiffContext::var - the variable
+ * @var _DiffContext::observer - what is told about the steps, may be nullptr
+ * @var _DiffContext::memo - derivatives of the subtrees found so far
+ * @var _DiffContext::hashes - hashes of the subtrees, nullptr when the context is lazy
+ * @var _DiffContext::pool - where big operands are differentiated in parallel, may be nullptr
+ * @var _DiffContext::log - retired trees, and the steps if the task records them
+ * @var _DiffContext::lazy - operations are not differentiated, they become lazy nodes
+ * @var _DiffContext::cache - derivatives from the earlier calls, may be nullptr
+ * @var _DiffContext::budget - a derivative of more nodes stops the differentiation with ERROR_BAD_SIZE,
+ * 0 for no limit
+ */
+struct _DiffContext
+{
+    char var;
+    StepObserver* observer;
+    _DiffMemo memo;
+    const _DiffHashes* hashes;
+
+    WorkPool* pool;
+    _DiffLog* log;
+
+    bool lazy;
+    DiffCache* cache;
+
+    size_t budget;
+};
+
+/** @struct _DiffTask
+ * @brief Differentiation of a subtree with its own context
+ */
+struct _DiffTask
+{
+    WorkTask task;
+
+    TreeNode* node;
+    TreeNode* derivative;
+
+    _DiffContext context;
+    _DiffLog log;
+    StepObserver recorder;
+};
+
+// operands smaller than that together are not worth a task
+static const size_t PARALLEL_DIFF_MIN_NODES = 64;
+
+// every edit of another part of the expression keeps one more block alive, that many are dropped together
+static const size_t MAX_DIFF_CACHE_BLOCKS = 16;
+
+// tells that the derivative of the node is needed and finds it
+#define DIFF_NODE(name, node)                                           \
+TreeNode* name = nullptr;                                               \
+do                                                                      \
+{                                                                       \
+    OBSERVE(context->observer, needDerivative, node);                   \
+    RETURN_ERROR(_recDiff(node, &name, context));                       \
+} while (0)
+
+// makes a node of the derivative simplified at once, what it leaves out is retired
+#define MAKE_OPERATION(name, op, left, right)                           \
+    CREATE_SIMPLIFIED(name, op, left, right, _retire, context)
+
+// finds the derivatives of both operands, in parallel when they are big enough
+#define DIFF_NODES(leftName, left, rightName, right)                    \
+TreeNode* leftName  = nullptr;                                          \
+TreeNode* rightName = nullptr;                                          \
+RETURN_ERROR(_diffPair(left, &leftName, right, &rightName, context))
 
 EvalResult _recEval(TreeNode* node, double var);
 
-ErrorCode _recDiff(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffAddSub(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffMultiply(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffDivide(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffPower(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffPowerNumber(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffPowerVar(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffSin(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffCos(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffTan(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffArcsin(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffArccos(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffArctan(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffExp(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-ErrorCode _diffLn(TreeNode* node, TreeNode* oldNode, FILE* texFile);
-
-ErrorCode _writeNeedToFindDerivative(TreeNode* node, FILE* texFile);
-ErrorCode _writeFoundDerivative(TreeNode* node, TreeNode* oldNode, FILE* texFile);
+ErrorCode _recDiff(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffAddSub(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffMultiply(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffDivide(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffPower(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffPowerNumber(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffPowerConst(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffPowerBase(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffPowerVar(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffSin(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffCos(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffTan(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffArcsin(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffArccos(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffArctan(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffExp(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffLn(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffConstant(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffOperation(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffRepeated(TreeNode* node, TreeNode* found, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffLazy(TreeNode* node, TreeNode** derivative, _DiffContext* context);
+ErrorCode _diffCached(TreeNode* node, DiffCacheEntry* cached, size_t hash, TreeNode** derivative,
+                      _DiffContext* context);
+ErrorCode _diffPair(TreeNode* left, TreeNode** leftDerivative, TreeNode* right, TreeNode** rightDerivative,
+                    _DiffContext* context);
+
+static TreeResult _differentiate(Tree* tree, char var, WorkPool* pool, DiffCache* cache, size_t budget,
+                                 StepObserver* observer, DiffMemoStats* stats);
+
+static ErrorCode _initTask(_DiffTask* task, TreeNode* node, _DiffContext* parent);
+static ErrorCode _runTask(void* arg);
+static ErrorCode _joinTask(_DiffTask* task, _DiffContext* parent);
+static void _destroyTask(_DiffTask* task);
+
+static ErrorCode _retire(_DiffContext* context, TreeNode* node);
+
+static ErrorCode _expandOnce(TreeNode* node);
+static ErrorCode _recExpand(TreeNode* node, SimplifyWorklist* worklist);
+
+static StepObserver _recordingObserver(_DiffLog* log);
+static ErrorCode _recordStep(_DiffLog* log, _DiffStepType type, TreeNode* node, TreeNode* derivative);
+static ErrorCode _recordLeaf(void* data, TreeNode* leaf, TreeNode* derivative);
+static ErrorCode _recordNeed(void* data, TreeNode* node);
+static ErrorCode _recordFound(void* data, TreeNode* node, TreeNode* derivative);
+static ErrorCode _recordRepeated(void* data, TreeNode* node, TreeNode* derivative);
+static ErrorCode _replayLog(_DiffLog* log, StepObserver* observer);
+static void _destroyLog(_DiffLog* log);
+
+static bool _hasVariable(TreeNode* node, char var);
+
+static size_t _hashNode(TreeNode* node, size_t leftHash, size_t rightHash);
+
+static ErrorCode _initHashes(_DiffHashes* hashes, TreeNode* root, size_t treeSize);
+static size_t _fillHashes(_DiffHashes* hashes, TreeNode* node);
+static size_t _findHash(const _DiffHashes* hashes, TreeNode* node);
+static void _destroyHashes(_DiffHashes* hashes);
+static bool _sameSubtree(TreeNode* first, TreeNode* second);
+
+static ErrorCode _initMemo(_DiffMemo* memo, size_t treeSize);
+static void _destroyMemo(_DiffMemo* memo);
+static TreeNode* _findInMemo(_DiffMemo* memo, TreeNode* original, size_t hash);
+static ErrorCode _addToMemo(_DiffMemo* memo, TreeNode* original, TreeNode* derivative, size_t hash);
+
+static DiffCacheEntry* _findInCache(DiffCache* cache, TreeNode* original, size_t hash);
+static ErrorCode _addToCache(DiffCache* cache, TreeNode* original, TreeNode* derivative, size_t hash);
+static size_t _keepInCache(DiffCache* cache, TreeNode* node);
+static ErrorCode _rehashCache(DiffCache* cache, size_t bucketCount);
+static ErrorCode _pruneCache(DiffCache* cache, bool all);
+static ErrorCode _newBlock(DiffCache* cache, Tree* tree, Tree* function);
+static size_t _liveBlocks(DiffCache* cache);
+static ErrorCode _adoptDerivatives(DiffCache* cache, TreeNode* derivative);
+static ErrorCode _addCopy(DiffCache* cache, TreeNode* copy);
+static ErrorCode _simplifyMade(DiffCache* cache, TreeNode* derivative, StepObserver* observer);
+static ErrorCode _simplifyTree(TreeNode* root, DiffCache* cache, StepObserver* observer);
+static ErrorCode _pushMade(TreeNode* node, DiffCache* cache, SimplifyWorklist* worklist);
+static bool _isCopy(void* data, TreeNode* node);
+static void _keepSimplified(TreeNode* node, DiffCacheEntry** made, size_t madeCount, size_t generation);
+static int _compareCopies(const void* first, const void* second);
+static int _compareDerivatives(const void* first, const void* second);
+
 
 EvalResult Evaluate(Tree* tree, double var)
 {
@@ -42,6 +258,13 @@ EvalResult _recEval(TreeNode* node, double var)
             return { NODE_NUMBER(node), EVERYTHING_FINE };
         case VARIABLE_TYPE:
             return { var, EVERYTHING_FINE };
+        case DERIVATIVE_TYPE:
+        {
+            ErrorCode error = ExpandDerivative(node);
+            if (error)
+                return { NAN, error };
+            return _recEval(node, var);
+        }
         case OPERATION_TYPE:
         default:
             break;
@@ -97,187 +320,434 @@ EvalResult _recEval(TreeNode* node, double var)
     }
 }
 
-TreeResult Differentiate(Tree* tree, FILE* texFile)
+TreeResult Differentiate(Tree* tree, char var, StepObserver* observer, DiffMemoStats* stats)
+{
+    return _differentiate(tree, var, nullptr, nullptr, 0, observer, stats);
+}
+
+TreeResult DifferentiateParallel(Tree* tree, char var, WorkPool* pool, StepObserver* observer, DiffMemoStats* stats)
+{
+    MyAssertSoftResult(pool, {}, ERROR_NULLPTR);
+
+    return _differentiate(tree, var, pool, nullptr, 0, observer, stats);
+}
+
+BudgetedDerivativeResult DifferentiateWithBudget(Tree* tree, char var, size_t budget, WorkPool* pool,
+                                                 StepObserver* observer, DiffMemoStats* stats)
+{
+    MyAssertSoftResult(tree, {}, ERROR_NULLPTR);
+
+    // a bigger derivative would not pass Verify anyway
+    if (!budget || budget > MAX_TREE_SIZE)
+        budget = MAX_TREE_SIZE;
+
+    BudgetedDerivative derivative = {};
+    derivative.var = var;
+
+    TreeResult treeRes = _differentiate(tree, var, pool, nullptr, budget, observer, stats);
+    if (treeRes.error != ERROR_BAD_SIZE)
+    {
+        RETURN_ERROR_RESULT(treeRes, {});
+
+        derivative.path = SYMBOLIC_DIFF_PATH;
+        derivative.tree = treeRes.value;
+
+        return { derivative, EVERYTHING_FINE };
+    }
+
+    derivative.path = NUMERIC_DIFF_PATH;
+
+    ErrorCode error = derivative.function.Init(tree);
+    if (error)
+        return { {}, error };
+
+    return { derivative, EVERYTHING_FINE };
+}
+
+EvalResult Evaluate(BudgetedDerivative* derivative, double var)
+{
+    MyAssertSoftResult(derivative, NAN, ERROR_NULLPTR);
+
+    if (derivative->path == NUMERIC_DIFF_PATH)
+        return EvaluateDerivative(&derivative->function, derivative->var, var);
+
+    return Evaluate(&derivative->tree, var);
+}
+
+ErrorCode BudgetedDerivative::Destructor()
+{
+    ErrorCode error = this->path == NUMERIC_DIFF_PATH ? this->function.Destructor() : this->tree.Destructor();
+
+    *this = {};
+
+    return error;
+}
+
+TreeNodeResult DifferentiateIncremental(Tree* tree, char var, DiffCache* cache, StepObserver* observer,
+                                        DiffMemoStats* stats)
+{
+    MyAssertSoftResult(tree, nullptr, ERROR_NULLPTR);
+    MyAssertSoftResult(cache, nullptr, ERROR_NULLPTR);
+    MyAssertSoftResult(cache->buckets, nullptr, ERROR_NO_MEMORY);
+    ERR_DUMP_RET_RESULT(tree, nullptr);
+
+    ErrorCode error = EVERYTHING_FINE;
+
+    if (cache->var != var || _liveBlocks(cache) >= MAX_DIFF_CACHE_BLOCKS)
+    {
+        error = _pruneCache(cache, true);
+        if (error)
+        {
+            tree->Destructor();
+            return { nullptr, error };
+        }
+
+        cache->var = var;
+    }
+
+    cache->generation++;
+    cache->copyCount = 0;
+
+    Tree function = {};
+    error = _newBlock(cache, tree, &function);
+    if (error)
+        return { nullptr, error };
+
+    TreeResult result = _differentiate(&function, var, nullptr, cache, 0, observer, stats);
+    if (result.error)
+    {
+        // the entries of the call may point into the deleted derivative
+        _pruneCache(cache, true);
+        return { nullptr, result.error };
+    }
+
+    TreeNode* derivative = result.value.root;
+    cache->blocks[cache->block].derivative = derivative;
+
+    error = _simplifyMade(cache, derivative, observer);
+
+    // what was not met this time is not in the tree any more
+    if (!error)
+        error = _pruneCache(cache, false);
+
+    if (error)
+    {
+        _pruneCache(cache, true);
+        return { nullptr, error };
+    }
+
+    return { derivative, EVERYTHING_FINE };
+}
+
+ErrorCode DiffCache::Init()
+{
+    *this = {};
+
+    return _rehashCache(this, 16);
+}
+
+ErrorCode DiffCache::Destructor()
+{
+    ErrorCode error = _pruneCache(this, true);
+
+    free(this->entries);
+    free(this->buckets);
+    free(this->blocks);
+    free(this->copies);
+
+    *this = {};
+
+    return error;
+}
+
+TreeResult DifferentiateLazy(Tree* tree, char var)
 {
     MyAssertSoftResult(tree, {}, ERROR_NULLPTR);
     ERR_DUMP_RET_RESULT(tree, {});
 
-    TreeNodeResult newTreeRootRes = tree->root->Copy();
-    RETURN_ERROR_RESULT(newTreeRootRes, {});
+    _DiffContext context = {};
+    context.var  = var;
+    context.lazy = true;
+
+    TreeNode* derivative = nullptr;
+    ErrorCode error = _recDiff(tree->root, &derivative, &context);
+    if (error)
+        return { {}, error };
 
     Tree newTree = {};
-    ErrorCode error = newTree.Init(newTreeRootRes.value);
+    error = newTree.Init(derivative);
+
+    if (error)
+    {
+        derivative->Delete();
+        return { {}, error };
+    }
+
+    return { newTree, EVERYTHING_FINE };
+}
+
+ErrorCode ExpandDerivative(TreeNode* node)
+{
+    MyAssertSoft(node, ERROR_NULLPTR);
+
+    // u' + v' is just u' when v is a constant, so an expansion may be lazy again
+    while (NODE_TYPE(node) == DERIVATIVE_TYPE)
+        RETURN_ERROR(_expandOnce(node));
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode ExpandDerivatives(Tree* tree)
+{
+    MyAssertSoft(tree, ERROR_NULLPTR);
+
+    SimplifyWorklist worklist = {};
+    RETURN_ERROR(worklist.Init());
+
+    ErrorCode error = _recExpand(tree->root, &worklist);
+
+    // an expansion may be a number that its parents can fold
+    if (!error)
+        error = worklist.Run(nullptr);
+
+    worklist.Destructor();
+
+    return error;
+}
+
+static TreeResult _differentiate(Tree* tree, char var, WorkPool* pool, DiffCache* cache, size_t budget,
+                                 StepObserver* observer, DiffMemoStats* stats)
+{
+    MyAssertSoftResult(tree, {}, ERROR_NULLPTR);
+    ERR_DUMP_RET_RESULT(tree, {});
+
+    if (observer && observer->derivativeStart)
+    {
+        ErrorCode error = observer->derivativeStart(observer->data, tree->root);
+        if (error)
+            return { {}, error };
+    }
+
+    // the root task tells the real observer everything at once
+    _DiffTask root = {};
+    root.task    = { _runTask, &root, EVERYTHING_FINE, false };
+    root.node    = tree->root;
+    _DiffHashes hashes = {};
+    root.context = { var, observer, {}, &hashes, pool, &root.log, false, cache, budget };
+
+    ErrorCode error = _initHashes(&hashes, tree->root, *tree->size);
+    if (error)
+        return { {}, error };
 
+    error = _initMemo(&root.context.memo, *tree->size);
     if (error)
+    {
+        _destroyHashes(&hashes);
         return { {}, error };
+    }
 
-    tree->Dump();
-    newTree.Dump();
+    error = pool ? pool->Run(&root.task) : _runTask(&root);
 
-    error = _recDiff(newTree.root, tree->root, texFile);
+    if (!error && cache)
+        error = _adoptDerivatives(cache, root.derivative);
+
+    _destroyMemo(&root.context.memo);
+    _destroyHashes(&hashes);
+    _destroyLog(&root.log);
 
     if (error)
+    {
+        if (root.derivative)
+            root.derivative->Delete();
         return { {}, error };
+    }
+
+    Tree newTree = {};
+    error = newTree.Init(root.derivative);
 
-    #ifdef TEX_WRITE
-    fprintf(texFile, "Найдем производную\n\\newline\n\\[");
-    error = LatexWrite(tree->root, texFile);
     if (error)
+    {
+        root.derivative->Delete();
         return { {}, error };
-    fprintf(texFile, "\\]\n");
-    #endif
+    }
+
+    if (stats)
+        *stats = root.context.memo.stats;
 
     return { newTree, EVERYTHING_FINE };
 }
 
-ErrorCode _recDiff(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _recDiff(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
+    MyAssertSoft(derivative, ERROR_NULLPTR);
 
     switch (NODE_TYPE(node))
     {
         case NUMBER_TYPE:
-            #ifdef TEX_WRITE
-            fprintf(texFile, "Видно, что $%lg' = 0$\n\\newline\n", NODE_NUMBER(node));
-            #endif
-            NODE_NUMBER(node) = 0;
+        {
+            CREATE_NUMBER(zero, 0);
+            *derivative = zero;
+            OBSERVE(context->observer, leafDerivative, node, zero);
             return EVERYTHING_FINE;
+        }
         case VARIABLE_TYPE:
-            #ifdef TEX_WRITE
-            fprintf(texFile, "Видно, что $%c' = 1$\n\\newline\n", NODE_VAR(node));
-            #endif
-            NODE_TYPE(node) = NUMBER_TYPE;
-            NODE_NUMBER(node) = 1;
+        {
+            CREATE_NUMBER(dx, NODE_VAR(node) == context->var);
+            *derivative = dx;
+            OBSERVE(context->observer, leafDerivative, node, dx);
             return EVERYTHING_FINE;
+        }
         case OPERATION_TYPE:
         {
-            switch (NODE_OPERATION(node))
+            if (!_hasVariable(node, context->var))
+                return _diffConstant(node, derivative, context);
+
+            if (context->lazy)
+                return _diffLazy(node, derivative, context);
+
+            size_t hash = _findHash(context->hashes, node);
+            MyAssertSoft(hash != SIZET_POISON, ERROR_BAD_TREE);
+
+            TreeNode* found = _findInMemo(&context->memo, node, hash);
+            if (found)
             {
+                context->memo.stats.hits++;
+                return _diffRepeated(node, found, derivative, context);
+            }
 
-                #define DEF_FUNC(name, priority, hasOneArg, string, length, code, ...)  \
-                case name:                                                              \
-                code;
+            DiffCacheEntry* cached = context->cache ? _findInCache(context->cache, node, hash) : nullptr;
+            if (cached)
+                return _diffCached(node, cached, hash, derivative, context);
 
-                #include "DiffFunctions.hpp"
+            context->memo.stats.misses++;
 
-                #undef DEF_FUNC
+            RETURN_ERROR(_diffOperation(node, derivative, context));
 
-                default:
-                    return ERROR_BAD_TREE;
+            #ifdef SIZE_VERIFICATION
+            if (context->budget && (*derivative)->nodeCount > context->budget)
+            {
+                RETURN_ERROR(_retire(context, *derivative));
+                *derivative = nullptr;
+                return ERROR_BAD_SIZE;
             }
+            #endif
+
+            if (context->cache)
+                RETURN_ERROR(_addToCache(context->cache, node, *derivative, hash));
+
+            return _addToMemo(&context->memo, node, *derivative, hash);
         }
         default:
             return ERROR_BAD_VALUE;
     }
 }
-// (u +- v)' = u' +- v''
-ErrorCode _diffAddSub(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+
+ErrorCode _diffOperation(TreeNode* node, TreeNode** derivative, _DiffContext* context)
+{
+    switch (NODE_OPERATION(node))
+    {
+
+        #define DEF_FUNC(name, priority, hasOneArg, string, length, code, ...)  \
+        case name:                                                              \
+        code;
+
+        #include "DiffFunctions.hpp"
+
+        #undef DEF_FUNC
+
+        default:
+            return ERROR_BAD_TREE;
+    }
+}
+
+// (u +- v)' = u' +- v'
+ErrorCode _diffAddSub(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
     if (!node->left || !node->right)
         return ERROR_BAD_TREE;
 
-    RETURN_ERROR(_writeNeedToFindDerivative(node->left, texFile));
-    RETURN_ERROR(_recDiff(node->left, oldNode->left, texFile));
+    DIFF_NODES(du, node->left, dv, node->right);
 
-    RETURN_ERROR(_writeNeedToFindDerivative(node->right, texFile));
-    RETURN_ERROR(_recDiff(node->right, oldNode->right, texFile));
+    MAKE_OPERATION(result, NODE_OPERATION(node), du, dv);
 
-    RETURN_ERROR(node->SetLeft(node->left));
-    RETURN_ERROR(node->SetRight(node->right));
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
-
 // (uv)' = u'v + uv'
-ErrorCode _diffMultiply(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _diffMultiply(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
     if (!node->left || !node->right)
         return ERROR_BAD_TREE;
 
+    DIFF_NODES(du, node->left, dv, node->right);
+
     COPY_NODE(u, node->left);
     COPY_NODE(v, node->right);
 
-    RETURN_ERROR(_writeNeedToFindDerivative(node->left, texFile));
-    RETURN_ERROR(_recDiff(node->left, oldNode->left, texFile));
-
-    RETURN_ERROR(_writeNeedToFindDerivative(node->right, texFile));
-    RETURN_ERROR(_recDiff(node->right, oldNode->right, texFile));
-
     // u'v
-    CREATE_OPERATION(duv, MUL_OPERATION, node->left, v);
+    MAKE_OPERATION(duv, MUL_OPERATION, du, v);
 
     // uv'
-    CREATE_OPERATION(udv, MUL_OPERATION, u, node->right);
+    MAKE_OPERATION(udv, MUL_OPERATION, u, dv);
 
-    RETURN_ERROR(node->SetLeft(duv));
-    RETURN_ERROR(node->SetRight(udv));
+    MAKE_OPERATION(result, ADD_OPERATION, duv, udv);
 
-    NODE_OPERATION(node) = ADD_OPERATION;
-    UPDATE_PRIORITY(node);
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
 // (u / v)' = (u'v - uv') / (v ^ 2)
-ErrorCode _diffDivide(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _diffDivide(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
     if (!node->left || !node->right)
         return ERROR_BAD_TREE;
 
+    DIFF_NODES(du, node->left, dv, node->right);
+
     COPY_NODE(u, node->left);
     COPY_NODE(v, node->right);
 
-    RETURN_ERROR(_writeNeedToFindDerivative(node->left, texFile));
-    RETURN_ERROR(_recDiff(node->left, oldNode->left, texFile));
-
-    RETURN_ERROR(_writeNeedToFindDerivative(node->right, texFile));
-    RETURN_ERROR(_recDiff(node->right, oldNode->right, texFile));
-
     // u'v
-    CREATE_OPERATION(duv, MUL_OPERATION, node->left, v);
+    MAKE_OPERATION(duv, MUL_OPERATION, du, v);
 
     // uv'
-    CREATE_OPERATION(udv, MUL_OPERATION, u, node->right);
+    MAKE_OPERATION(udv, MUL_OPERATION, u, dv);
 
     // u'v - uv'
-    CREATE_OPERATION(leftSub, SUB_OPERATION, duv, udv);
+    MAKE_OPERATION(leftSub, SUB_OPERATION, duv, udv);
 
     // v ^ 2
-    COPY_NODE(v2, v);
+    COPY_NODE(v2, node->right);
     CREATE_NUMBER(two, 2);
 
-    CREATE_OPERATION(vSquared, POWER_OPERATION, v2, two);
+    MAKE_OPERATION(vSquared, POWER_OPERATION, v2, two);
 
-    RETURN_ERROR(node->SetLeft(leftSub));
-    RETURN_ERROR(node->SetRight(vSquared));
+    MAKE_OPERATION(result, DIV_OPERATION, leftSub, vSquared);
 
-    NODE_OPERATION(node) = DIV_OPERATION;
-    UPDATE_PRIORITY(node);
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
-ErrorCode _diffPower(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _diffPower(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
     if (!node->left || !node->right)
         return ERROR_BAD_TREE;
@@ -285,10 +755,14 @@ ErrorCode _diffPower(TreeNode* node, TreeNode* oldNode, FILE* texFile)
     switch (NODE_TYPE(node->right))
     {
         case NUMBER_TYPE:
-            return _diffPowerNumber(node, oldNode, texFile);
+            return _diffPowerNumber(node, derivative, context);
         case VARIABLE_TYPE:
         case OPERATION_TYPE:
-            return _diffPowerVar(node, oldNode, texFile);
+            if (!_hasVariable(node->right, context->var))
+                return _diffPowerConst(node, derivative, context);
+            if (!_hasVariable(node->left, context->var))
+                return _diffPowerBase(node, derivative, context);
+            return _diffPowerVar(node, derivative, context);
         default:
             return ERROR_SYNTAX;
     }
@@ -296,318 +770,1253 @@ ErrorCode _diffPower(TreeNode* node, TreeNode* oldNode, FILE* texFile)
     return EVERYTHING_FINE;
 }
 
-// (u ^ a)' = a * u ^ (a - 1) * u'
-ErrorCode _diffPowerNumber(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+// (u ^ a)' = u' * (a * u ^ (a - 1))
+ErrorCode _diffPowerNumber(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
     if (!node->left || !node->right)
         return ERROR_BAD_TREE;
 
+    DIFF_NODE(du, node->left);
+
     COPY_NODE(u, node->left);
 
-    RETURN_ERROR(_writeNeedToFindDerivative(node->left, texFile));
-    RETURN_ERROR(_recDiff(node->left, oldNode->left, texFile));
+    // a
+    CREATE_NUMBER(a, NODE_NUMBER(node->right));
 
     // (a - 1)
-    CREATE_NUMBER(aMinusOne, node->right->value.value.number - 1);
+    CREATE_NUMBER(aMinusOne, NODE_NUMBER(node->right) - 1);
 
     // u ^ (a - 1)
-    CREATE_OPERATION(uPowAminusOne, POWER_OPERATION, u, aMinusOne);
+    MAKE_OPERATION(uPowAminusOne, POWER_OPERATION, u, aMinusOne);
 
     // a * u ^ (a - 1)
-    CREATE_OPERATION(aMulUPowMinusOne, MUL_OPERATION, node->right, uPowAminusOne);
+    MAKE_OPERATION(aMulUPowMinusOne, MUL_OPERATION, a, uPowAminusOne);
 
-    RETURN_ERROR(node->SetRight(aMulUPowMinusOne));
+    MAKE_OPERATION(result, MUL_OPERATION, du, aMulUPowMinusOne);
 
-    NODE_OPERATION(node) = MUL_OPERATION;
-    UPDATE_PRIORITY(node);
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
-// (u ^ v)' = (e ^ (v * lnu))' = u ^ v * (v * lnu)'
-ErrorCode _diffPowerVar(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+// (u ^ c)' = u' * (c * u ^ (c - 1)), c does not have the variable
+ErrorCode _diffPowerConst(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
-    CREATE_NODE(uPowV, node->value, node->left, node->right);
+    if (!node->left || !node->right)
+        return ERROR_BAD_TREE;
+
+    DIFF_NODE(du, node->left);
 
     COPY_NODE(u, node->left);
-    COPY_NODE(v, node->right);
+    COPY_NODE(c, node->right);
+    COPY_NODE(c2, node->right);
 
-    CREATE_OPERATION(lnu, LN_OPERATION, u, nullptr);
+    // c - 1
+    CREATE_NUMBER(one, 1);
+    MAKE_OPERATION(cMinusOne, SUB_OPERATION, c2, one);
+
+    // u ^ (c - 1)
+    MAKE_OPERATION(uPowCMinusOne, POWER_OPERATION, u, cMinusOne);
+
+    // c * u ^ (c - 1)
+    MAKE_OPERATION(cMulUPowCMinusOne, MUL_OPERATION, c, uPowCMinusOne);
+
+    MAKE_OPERATION(result, MUL_OPERATION, du, cMulUPowCMinusOne);
+
+    *derivative = result;
+
+    OBSERVE(context->observer, foundDerivative, node, result);
+
+    return EVERYTHING_FINE;
+}
+
+// (a ^ v)' = a ^ v * lna * v'
+ErrorCode _diffPowerBase(TreeNode* node, TreeNode** derivative, _DiffContext* context)
+{
+    MyAssertSoft(node, ERROR_NULLPTR);
+
+    if (!node->left || !node->right)
+        return ERROR_BAD_TREE;
 
-    CREATE_OPERATION(vlnu, MUL_OPERATION, v, lnu);
+    DIFF_NODE(dv, node->right);
 
-    COPY_NODE(vlnuOld, vlnu);
+    COPY_NODE(aPowV, node);
+    COPY_NODE(a, node->left);
 
-    RETURN_ERROR(_writeNeedToFindDerivative(vlnu, texFile));
-    RETURN_ERROR(_recDiff(vlnu, vlnuOld, texFile));
+    CREATE_OPERATION(lna, LN_OPERATION, a, nullptr);
 
-    RETURN_ERROR(vlnuOld->Delete());
+    MAKE_OPERATION(aPowVlna, MUL_OPERATION, aPowV, lna);
 
-    RETURN_ERROR(node->SetLeft(uPowV));
-    RETURN_ERROR(node->SetRight(vlnu));
+    MAKE_OPERATION(result, MUL_OPERATION, aPowVlna, dv);
 
-    NODE_OPERATION(node) = MUL_OPERATION;
-    UPDATE_PRIORITY(node);
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
+
+    return EVERYTHING_FINE;
+}
+
+// (u ^ v)' = (e ^ (v * lnu))' = u ^ v * (v' * lnu + v * u' / u)
+ErrorCode _diffPowerVar(TreeNode* node, TreeNode** derivative, _DiffContext* context)
+{
+    MyAssertSoft(node, ERROR_NULLPTR);
+
+    if (!node->left || !node->right)
+        return ERROR_BAD_TREE;
+
+    DIFF_NODES(du, node->left, dv, node->right);
+
+    COPY_NODE(uPowV, node);
+    COPY_NODE(u, node->left);
+    COPY_NODE(v, node->right);
+    COPY_NODE(u2, node->left);
+
+    // v' * lnu
+    CREATE_OPERATION(lnu, LN_OPERATION, u, nullptr);
+    MAKE_OPERATION(dvlnu, MUL_OPERATION, dv, lnu);
+
+    // v * u' / u
+    MAKE_OPERATION(vdu, MUL_OPERATION, v, du);
+    MAKE_OPERATION(vduDivU, DIV_OPERATION, vdu, u2);
+
+    MAKE_OPERATION(sum, ADD_OPERATION, dvlnu, vduDivU);
+
+    MAKE_OPERATION(result, MUL_OPERATION, uPowV, sum);
+
+    *derivative = result;
+
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
 // (sinu)' = u' * cosu
-ErrorCode _diffSin(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _diffSin(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
     if (!node->left || node->right)
         return ERROR_BAD_TREE;
 
-    COPY_NODE(u, node->left);
+    DIFF_NODE(du, node->left);
 
-    _writeNeedToFindDerivative(node->left, texFile);
-    RETURN_ERROR(_recDiff(node->left, oldNode->left, texFile));
+    COPY_NODE(u, node->left);
 
-    CREATE_OPERATION(cosu, COS_OPERATION, u, nullptr);
+    MAKE_OPERATION(cosu, COS_OPERATION, u, nullptr);
 
-    NODE_OPERATION(node) = MUL_OPERATION;
-    UPDATE_PRIORITY(node);
+    MAKE_OPERATION(result, MUL_OPERATION, du, cosu);
 
-    RETURN_ERROR(node->SetRight(cosu));
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
 // (cosu)' = u' * (-1 * sinu)
-ErrorCode _diffCos(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _diffCos(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
     if (!node->left || node->right)
         return ERROR_BAD_TREE;
 
-    COPY_NODE(u, node->left);
+    DIFF_NODE(du, node->left);
 
-    _writeNeedToFindDerivative(node->left, texFile);
-    RETURN_ERROR(_recDiff(node->left, oldNode->left, texFile));
+    COPY_NODE(u, node->left);
 
-    CREATE_OPERATION(sinu, SIN_OPERATION, u, nullptr);
+    MAKE_OPERATION(sinu, SIN_OPERATION, u, nullptr);
 
     CREATE_NUMBER(neg1, -1);
 
-    CREATE_OPERATION(minusSinu, MUL_OPERATION, neg1, sinu);
+    MAKE_OPERATION(minusSinu, MUL_OPERATION, neg1, sinu);
 
-    NODE_OPERATION(node) = MUL_OPERATION;
-    UPDATE_PRIORITY(node);
+    MAKE_OPERATION(result, MUL_OPERATION, du, minusSinu);
 
-    RETURN_ERROR(node->SetRight(minusSinu));
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
 // (tanu)' = u' / (cosu)^2
-ErrorCode _diffTan(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _diffTan(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
     if (!node->left || node->right)
         return ERROR_BAD_TREE;
 
-    COPY_NODE(u, node->left);
+    DIFF_NODE(du, node->left);
 
-    _writeNeedToFindDerivative(node->left, texFile);
-    RETURN_ERROR(_recDiff(node->left, oldNode->left, texFile));
+    COPY_NODE(u, node->left);
 
-    CREATE_OPERATION(cosu, COS_OPERATION, u, nullptr);
+    MAKE_OPERATION(cosu, COS_OPERATION, u, nullptr);
 
     CREATE_NUMBER(two, 2);
 
-    CREATE_OPERATION(cosuSqr, POWER_OPERATION, cosu, two);
+    MAKE_OPERATION(cosuSqr, POWER_OPERATION, cosu, two);
 
-    NODE_OPERATION(node) = DIV_OPERATION;
-    UPDATE_PRIORITY(node);
+    MAKE_OPERATION(result, DIV_OPERATION, du, cosuSqr);
 
-    RETURN_ERROR(node->SetRight(cosuSqr));
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
 // (arcsinu)' = u' / ((1 - u ^ 2) ^ 0.5)
-ErrorCode _diffArcsin(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _diffArcsin(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
-    COPY_NODE(u, node->left);
+    if (!node->left || node->right)
+        return ERROR_BAD_TREE;
+
+    DIFF_NODE(du, node->left);
 
-    _writeNeedToFindDerivative(node->left, texFile);
-    RETURN_ERROR(_recDiff(node->left, oldNode->left, texFile));
+    COPY_NODE(u, node->left);
 
     CREATE_NUMBER(two, 2);
     CREATE_NUMBER(zeroFive, 0.5);
     CREATE_NUMBER(one, 1);
 
-    CREATE_OPERATION(uSqr, POWER_OPERATION, u, two);
-    CREATE_OPERATION(oneSubUSqr, SUB_OPERATION, one, uSqr);
-    CREATE_OPERATION(oneSubUSqrSqrt, POWER_OPERATION, oneSubUSqr, zeroFive);
+    MAKE_OPERATION(uSqr, POWER_OPERATION, u, two);
+    MAKE_OPERATION(oneSubUSqr, SUB_OPERATION, one, uSqr);
+    MAKE_OPERATION(oneSubUSqrSqrt, POWER_OPERATION, oneSubUSqr, zeroFive);
 
-    NODE_OPERATION(node) = DIV_OPERATION;
-    UPDATE_PRIORITY(node);
+    MAKE_OPERATION(result, DIV_OPERATION, du, oneSubUSqrSqrt);
 
-    RETURN_ERROR(node->SetRight(oneSubUSqrSqrt));
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
 // (arccosu)' = -(arcsinu)'
-ErrorCode _diffArccos(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _diffArccos(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
-    RETURN_ERROR(_diffArcsin(node, oldNode, texFile));
+    TreeNode* arcsin = nullptr;
+    RETURN_ERROR(_diffArcsin(node, &arcsin, context));
 
-    CREATE_NODE(arcsin, node->value, node->left, node->right);
     CREATE_NUMBER(neg1, -1);
 
-    RETURN_ERROR(node->SetLeft(neg1));
-    RETURN_ERROR(node->SetRight(arcsin));
+    MAKE_OPERATION(result, MUL_OPERATION, neg1, arcsin);
 
-    NODE_OPERATION(node) = MUL_OPERATION;
-    UPDATE_PRIORITY(node);
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
 // (arctanu)' = u' / (1 + u ^ 2)
-ErrorCode _diffArctan(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _diffArctan(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
-    COPY_NODE(u, node->left);
+    if (!node->left || node->right)
+        return ERROR_BAD_TREE;
 
-    _writeNeedToFindDerivative(node->left, texFile);
-    RETURN_ERROR(_recDiff(node->left, oldNode->left, texFile));
+    DIFF_NODE(du, node->left);
+
+    COPY_NODE(u, node->left);
 
     CREATE_NUMBER(one, 1);
     CREATE_NUMBER(two, 2);
 
-    CREATE_OPERATION(uSqr, POWER_OPERATION, u, two);
-    CREATE_OPERATION(onePlusuSqr, ADD_OPERATION, one, uSqr);
+    MAKE_OPERATION(uSqr, POWER_OPERATION, u, two);
+    MAKE_OPERATION(onePlusuSqr, ADD_OPERATION, one, uSqr);
 
-    NODE_OPERATION(node) = DIV_OPERATION;
-    UPDATE_PRIORITY(node);
+    MAKE_OPERATION(result, DIV_OPERATION, du, onePlusuSqr);
 
-    RETURN_ERROR(node->SetRight(onePlusuSqr));
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
 // (e ^ u)' = e ^ u * u'
-ErrorCode _diffExp(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _diffExp(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
-    CREATE_NODE(expu, node->value, node->left, node->right);
+    if (!node->left || node->right)
+        return ERROR_BAD_TREE;
 
-    COPY_NODE(u, node->left);
+    DIFF_NODE(du, node->left);
 
-    _writeNeedToFindDerivative(node->left, texFile);
-    RETURN_ERROR(_recDiff(u, oldNode, texFile));
+    COPY_NODE(expu, node);
 
-    RETURN_ERROR(node->SetLeft(expu));
-    RETURN_ERROR(node->SetRight(u));
+    MAKE_OPERATION(result, MUL_OPERATION, expu, du);
 
-    NODE_OPERATION(node) = MUL_OPERATION;
-    UPDATE_PRIORITY(node);
+    *derivative = result;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, result);
 
     return EVERYTHING_FINE;
 }
 
 // (lnu)' = u' / u
-ErrorCode _diffLn(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+ErrorCode _diffLn(TreeNode* node, TreeNode** derivative, _DiffContext* context)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
 
     if (!node->left || node->right)
         return ERROR_BAD_TREE;
 
+    DIFF_NODE(du, node->left);
+
     COPY_NODE(u, node->left);
 
-    _writeNeedToFindDerivative(node->left, texFile);
-    RETURN_ERROR(_recDiff(node->left, oldNode->left, texFile));
+    MAKE_OPERATION(result, DIV_OPERATION, du, u);
+
+    *derivative = result;
+
+    OBSERVE(context->observer, foundDerivative, node, result);
+
+    return EVERYTHING_FINE;
+}
+
+// (c)' = 0 for a whole subtree without the variable
+ErrorCode _diffConstant(TreeNode* node, TreeNode** derivative, _DiffContext* context)
+{
+    MyAssertSoft(node, ERROR_NULLPTR);
 
-    NODE_OPERATION(node) = DIV_OPERATION;
-    UPDATE_PRIORITY(node);
+    CREATE_NUMBER(zero, 0);
 
-    RETURN_ERROR(node->SetRight(u));
+    *derivative = zero;
 
-    RETURN_ERROR(_writeFoundDerivative(node, oldNode, texFile));
+    OBSERVE(context->observer, foundDerivative, node, zero);
 
     return EVERYTHING_FINE;
 }
 
-ErrorCode _writeNeedToFindDerivative(TreeNode* node, FILE* texFile)
+// the same subtree was already differentiated, its derivative is copied
+ErrorCode _diffRepeated(TreeNode* node, TreeNode* found, TreeNode** derivative, _DiffContext* context)
 {
-    #ifdef TEX_WRITE
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(texFile, ERROR_BAD_FILE);
+    MyAssertSoft(found, ERROR_NULLPTR);
 
-    fprintf(texFile, "Необходимо найти $");
-    if (NODE_TYPE(node) == OPERATION_TYPE)
-        fprintf(texFile, "(");
+    COPY_NODE(copy, found);
 
-    RETURN_ERROR(LatexWrite(node, texFile));
+    *derivative = copy;
 
-    if (NODE_TYPE(node) == OPERATION_TYPE)
-        fprintf(texFile, ")");
-    fprintf(texFile, "'$\n\\newline\n");
-    #endif
+    OBSERVE(context->observer, repeatedDerivative, node, copy);
 
     return EVERYTHING_FINE;
 }
 
-ErrorCode _writeFoundDerivative(TreeNode* node, TreeNode* oldNode, FILE* texFile)
+// the subtree was in the tree of an earlier call, its derivative is copied from the cache
+ErrorCode _diffCached(TreeNode* node, DiffCacheEntry* cached, size_t hash, TreeNode** derivative,
+                      _DiffContext* context)
 {
-    #ifdef TEX_WRITE
     MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(oldNode, ERROR_NULLPTR);
-    MyAssertSoft(texFile, ERROR_BAD_FILE);
+    MyAssertSoft(cached, ERROR_NULLPTR);
 
-    fprintf(texFile, "%s\n\\newline\n", GetRandomMathComment());
-    fprintf(texFile, "\\[(");
-    RETURN_ERROR(LatexWrite(oldNode, texFile));
-    fprintf(texFile, ")' = ");
-    RETURN_ERROR(LatexWrite(node, texFile));
-    fprintf(texFile, "\\]\n");
-    #endif
+    COPY_NODE(copy, cached->derivative);
+    RETURN_ERROR(_addCopy(context->cache, copy), copy->Delete());
+
+    // the next edit may be inside the subtree, so its parts stay in the cache too
+    _keepInCache(context->cache, node);
+
+    *derivative = copy;
+
+    context->memo.stats.reused++;
+    context->memo.stats.reusedNodes += copy->nodeCount;
+
+    OBSERVE(context->observer, repeatedDerivative, node, copy);
+
+    return _addToMemo(&context->memo, node, copy, hash);
+}
+
+// (u)' is left for later, see DifferentiateLazy
+ErrorCode _diffLazy(TreeNode* node, TreeNode** derivative, _DiffContext* context)
+{
+    MyAssertSoft(node, ERROR_NULLPTR);
+
+    COPY_NODE(u, node);
+
+    TreeElement_t value = {};
+    value.type = DERIVATIVE_TYPE;
+    value.value.var = context->var;
+
+    CREATE_NODE(du, value, u, nullptr);
+
+    *derivative = du;
 
     return EVERYTHING_FINE;
 }
+
+ErrorCode _diffPair(TreeNode* left, TreeNode** leftDerivative, TreeNode* right, TreeNode** rightDerivative,
+                    _DiffContext* context)
+{
+    MyAssertSoft(left, ERROR_NULLPTR);
+    MyAssertSoft(right, ERROR_NULLPTR);
+
+    if (!context->pool || left->nodeCount + right->nodeCount < PARALLEL_DIFF_MIN_NODES)
+    {
+        OBSERVE(context->observer, needDerivative, left);
+        RETURN_ERROR(_recDiff(left, leftDerivative, context));
+
+        OBSERVE(context->observer, needDerivative, right);
+        ErrorCode error = _recDiff(right, rightDerivative, context);
+
+        // the budget may run out in the right operand, the left one is not leaked then
+        if (error)
+        {
+            _retire(context, *leftDerivative);
+            *leftDerivative = nullptr;
+        }
+
+        return error;
+    }
+
+    _DiffTask tasks[2] = {};
+
+    RETURN_ERROR(_initTask(&tasks[0], left, context));
+    RETURN_ERROR(_initTask(&tasks[1], right, context), _destroyTask(&tasks[0]));
+
+    // the right operand goes to the pool, the left one is done here
+    ErrorCode error = context->pool->Spawn(&tasks[1].task);
+    if (error)
+    {
+        _destroyTask(&tasks[0]);
+        _destroyTask(&tasks[1]);
+        return error;
+    }
+
+    tasks[0].task.error = _runTask(&tasks[0]);
+
+    ErrorCode rightError = context->pool->Wait(&tasks[1].task);
+
+    error = tasks[0].task.error;
+    if (!error)
+        error = rightError;
+
+    // the steps are told in the order of the sequential differentiator
+    if (!error)
+        error = _joinTask(&tasks[0], context);
+    if (!error)
+        error = _joinTask(&tasks[1], context);
+
+    if (error)
+    {
+        _destroyTask(&tasks[0]);
+        _destroyTask(&tasks[1]);
+        return error;
+    }
+
+    *leftDerivative  = tasks[0].derivative;
+    *rightDerivative = tasks[1].derivative;
+
+    tasks[0].derivative = nullptr;
+    tasks[1].derivative = nullptr;
+
+    _destroyTask(&tasks[0]);
+    _destroyTask(&tasks[1]);
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _initTask(_DiffTask* task, TreeNode* node, _DiffContext* parent)
+{
+    *task = {};
+
+    task->task = { _runTask, task, EVERYTHING_FINE, false };
+    task->node = node;
+
+    task->context.var  = parent->var;
+    task->context.hashes = parent->hashes;
+    task->context.pool = parent->pool;
+    task->context.budget = parent->budget;
+    task->context.log  = &task->log;
+
+    // nobody to tell, nothing to record
+    if (parent->observer)
+    {
+        task->recorder         = _recordingObserver(&task->log);
+        task->context.observer = &task->recorder;
+    }
+
+    return _initMemo(&task->context.memo, node->nodeCount);
+}
+
+static ErrorCode _runTask(void* arg)
+{
+    _DiffTask* task = (_DiffTask*)arg;
+
+    return _recDiff(task->node, &task->derivative, &task->context);
+}
+
+// tells the parent's observer the steps of the task and gives it what the task found
+static ErrorCode _joinTask(_DiffTask* task, _DiffContext* parent)
+{
+    OBSERVE(parent->observer, needDerivative, task->node);
+
+    RETURN_ERROR(_replayLog(&task->log, parent->observer));
+
+    for (size_t i = 0; i < task->log.retiredSize; i++)
+    {
+        RETURN_ERROR(_retire(parent, task->log.retired[i]));
+        task->log.retired[i] = nullptr;
+    }
+    task->log.retiredSize = 0;
+
+    for (size_t i = 0; i < task->context.memo.size; i++)
+    {
+        _DiffMemoEntry* entry = &task->context.memo.entries[i];
+        RETURN_ERROR(_addToMemo(&parent->memo, entry->original, entry->derivative, entry->hash));
+    }
+
+    parent->memo.stats.hits   += task->context.memo.stats.hits;
+    parent->memo.stats.misses += task->context.memo.stats.misses;
+
+    return EVERYTHING_FINE;
+}
+
+static void _destroyTask(_DiffTask* task)
+{
+    if (task->derivative)
+        task->derivative->Delete();
+
+    _destroyMemo(&task->context.memo);
+    _destroyLog(&task->log);
+
+    *task = {};
+}
+
+// a tree left out of the derivative may still be pointed to by the memo or the recorded steps,
+// so it lives until the differentiation ends
+static ErrorCode _retire(_DiffContext* context, TreeNode* node)
+{
+    MyAssertSoft(context, ERROR_NULLPTR);
+    MyAssertSoft(node, ERROR_NULLPTR);
+
+    _DiffLog* log = context->log;
+    MyAssertSoft(log, ERROR_NULLPTR, node->Delete());
+
+    if (log->retiredSize == log->retiredCapacity)
+    {
+        size_t newCapacity = log->retiredCapacity ? log->retiredCapacity * 2 : 4;
+
+        TreeNode** newRetired = (TreeNode**)realloc(log->retired, newCapacity * sizeof(*newRetired));
+        MyAssertSoft(newRetired, ERROR_NO_MEMORY, node->Delete());
+
+        log->retired         = newRetired;
+        log->retiredCapacity = newCapacity;
+    }
+
+    log->retired[log->retiredSize++] = node;
+
+    return EVERYTHING_FINE;
+}
+
+// the lazy node takes the value and the operands of one rule applied to its function
+static ErrorCode _expandOnce(TreeNode* node)
+{
+    TreeNode* function = node->left;
+    MyAssertSoft(function && !node->right, ERROR_BAD_TREE);
+
+    _DiffLog log = {};
+
+    _DiffContext context = {};
+    context.var  = NODE_VAR(node);
+    context.log  = &log;
+    context.lazy = true;
+
+    TreeNode* expansion = nullptr;
+    ErrorCode error = EVERYTHING_FINE;
+
+    if (NODE_TYPE(function) == OPERATION_TYPE && _hasVariable(function, context.var))
+        error = _diffOperation(function, &expansion, &context);
+    else
+        error = _recDiff(function, &expansion, &context);
+
+    _destroyLog(&log);
+    RETURN_ERROR(error);
+
+    RETURN_ERROR(function->Delete(), expansion->Delete());
+
+    TreeNode* left  = expansion->left;
+    TreeNode* right = expansion->right;
+
+    node->value = expansion->value;
+
+    expansion->left  = nullptr;
+    expansion->right = nullptr;
+    RETURN_ERROR(expansion->Delete());
+
+    RETURN_ERROR(node->SetLeft(left));
+
+    return node->SetRight(right);
+}
+
+static ErrorCode _recExpand(TreeNode* node, SimplifyWorklist* worklist)
+{
+    MyAssertSoft(node, ERROR_NULLPTR);
+
+    if (NODE_TYPE(node) == DERIVATIVE_TYPE)
+    {
+        RETURN_ERROR(ExpandDerivative(node));
+        RETURN_ERROR(worklist->Push(node));
+    }
+
+    if (node->left)
+        RETURN_ERROR(_recExpand(node->left, worklist));
+    if (node->right)
+        RETURN_ERROR(_recExpand(node->right, worklist));
+
+    return EVERYTHING_FINE;
+}
+
+static StepObserver _recordingObserver(_DiffLog* log)
+{
+    StepObserver observer = {};
+
+    observer.data               = log;
+    observer.leafDerivative     = _recordLeaf;
+    observer.needDerivative     = _recordNeed;
+    observer.foundDerivative    = _recordFound;
+    observer.repeatedDerivative = _recordRepeated;
+
+    return observer;
+}
+
+static ErrorCode _recordStep(_DiffLog* log, _DiffStepType type, TreeNode* node, TreeNode* derivative)
+{
+    MyAssertSoft(log, ERROR_NULLPTR);
+
+    if (log->size == log->capacity)
+    {
+        size_t newCapacity = log->capacity ? log->capacity * 2 : 64;
+
+        _DiffStep* newSteps = (_DiffStep*)realloc(log->steps, newCapacity * sizeof(*newSteps));
+        MyAssertSoft(newSteps, ERROR_NO_MEMORY);
+
+        log->steps    = newSteps;
+        log->capacity = newCapacity;
+    }
+
+    log->steps[log->size++] = { type, node, derivative };
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _recordLeaf(void* data, TreeNode* leaf, TreeNode* derivative)
+{
+    return _recordStep((_DiffLog*)data, LEAF_STEP, leaf, derivative);
+}
+
+static ErrorCode _recordNeed(void* data, TreeNode* node)
+{
+    return _recordStep((_DiffLog*)data, NEED_STEP, node, nullptr);
+}
+
+static ErrorCode _recordFound(void* data, TreeNode* node, TreeNode* derivative)
+{
+    return _recordStep((_DiffLog*)data, FOUND_STEP, node, derivative);
+}
+
+static ErrorCode _recordRepeated(void* data, TreeNode* node, TreeNode* derivative)
+{
+    return _recordStep((_DiffLog*)data, REPEATED_STEP, node, derivative);
+}
+
+static ErrorCode _replayLog(_DiffLog* log, StepObserver* observer)
+{
+    for (size_t i = 0; i < log->size; i++)
+    {
+        _DiffStep* step = &log->steps[i];
+
+        switch (step->type)
+        {
+            case LEAF_STEP:
+                OBSERVE(observer, leafDerivative, step->node, step->derivative);
+                break;
+            case NEED_STEP:
+                OBSERVE(observer, needDerivative, step->node);
+                break;
+            case FOUND_STEP:
+                OBSERVE(observer, foundDerivative, step->node, step->derivative);
+                break;
+            case REPEATED_STEP:
+                OBSERVE(observer, repeatedDerivative, step->node, step->derivative);
+                break;
+            default:
+                return ERROR_BAD_VALUE;
+        }
+    }
+
+    return EVERYTHING_FINE;
+}
+
+static void _destroyLog(_DiffLog* log)
+{
+    for (size_t i = 0; i < log->retiredSize; i++)
+        if (log->retired[i])
+            log->retired[i]->Delete();
+
+    free(log->steps);
+    free(log->retired);
+
+    *log = {};
+}
+
+static bool _hasVariable(TreeNode* node, char var)
+{
+    return node && (node->variables & VariableBit(var));
+}
+
+static size_t _hashNode(TreeNode* node, size_t leftHash, size_t rightHash)
+{
+    size_t key[4] = { (size_t)NODE_TYPE(node), 0, leftHash, rightHash };
+
+    switch (NODE_TYPE(node))
+    {
+        case NUMBER_TYPE:
+            memcpy(&key[1], &NODE_NUMBER(node), sizeof(NODE_NUMBER(node)));
+            break;
+        case VARIABLE_TYPE:
+            key[1] = (size_t)NODE_VAR(node);
+            break;
+        case OPERATION_TYPE:
+            key[1] = (size_t)NODE_OPERATION(node);
+            break;
+        default:
+            break;
+    }
+
+    return CalculateHash(key, sizeof(key), 0);
+}
+
+static ErrorCode _initHashes(_DiffHashes* hashes, TreeNode* root, size_t treeSize)
+{
+    *hashes = {};
+
+    hashes->capacity = 16;
+    while (hashes->capacity < 2 * treeSize)
+        hashes->capacity *= 2;
+
+    hashes->nodes  = (TreeNode**)calloc(hashes->capacity, sizeof(*hashes->nodes));
+    hashes->hashes = (size_t*)calloc(hashes->capacity, sizeof(*hashes->hashes));
+    MyAssertSoft(hashes->nodes && hashes->hashes, ERROR_NO_MEMORY, _destroyHashes(hashes));
+
+    _fillHashes(hashes, root);
+
+    return EVERYTHING_FINE;
+}
+
+// adds the hashes of every subtree, returns the hash of the node
+static size_t _fillHashes(_DiffHashes* hashes, TreeNode* node)
+{
+    if (!node)
+        return 0;
+
+    size_t hash = _hashNode(node, _fillHashes(hashes, node->left), _fillHashes(hashes, node->right));
+
+    size_t slot = CalculateHash(&node, sizeof(node), 0) & (hashes->capacity - 1);
+    while (hashes->nodes[slot])
+        slot = (slot + 1) & (hashes->capacity - 1);
+
+    hashes->nodes[slot]  = node;
+    hashes->hashes[slot] = hash;
+
+    return hash;
+}
+
+static size_t _findHash(const _DiffHashes* hashes, TreeNode* node)
+{
+    size_t slot = CalculateHash(&node, sizeof(node), 0) & (hashes->capacity - 1);
+    while (hashes->nodes[slot])
+    {
+        if (hashes->nodes[slot] == node)
+            return hashes->hashes[slot];
+
+        slot = (slot + 1) & (hashes->capacity - 1);
+    }
+
+    return SIZET_POISON;
+}
+
+static void _destroyHashes(_DiffHashes* hashes)
+{
+    free(hashes->nodes);
+    free(hashes->hashes);
+
+    *hashes = {};
+}
+
+static bool _sameSubtree(TreeNode* first, TreeNode* second)
+{
+    if (!first || !second)
+        return first == second;
+
+    if (NODE_TYPE(first) != NODE_TYPE(second))
+        return false;
+
+    switch (NODE_TYPE(first))
+    {
+        case NUMBER_TYPE:
+            if (NODE_NUMBER(first) != NODE_NUMBER(second))
+                return false;
+            break;
+        case VARIABLE_TYPE:
+            if (NODE_VAR(first) != NODE_VAR(second))
+                return false;
+            break;
+        case OPERATION_TYPE:
+            if (NODE_OPERATION(first) != NODE_OPERATION(second))
+                return false;
+            break;
+        default:
+            return false;
+    }
+
+    return _sameSubtree(first->left, second->left) && _sameSubtree(first->right, second->right);
+}
+
+static ErrorCode _initMemo(_DiffMemo* memo, size_t treeSize)
+{
+    *memo = {};
+
+    // about one entry per bucket, no rehashing needed
+    memo->bucketCount = 16;
+    while (memo->bucketCount < treeSize)
+        memo->bucketCount *= 2;
+
+    memo->buckets = (size_t*)calloc(memo->bucketCount, sizeof(*memo->buckets));
+    MyAssertSoft(memo->buckets, ERROR_NO_MEMORY);
+
+    for (size_t i = 0; i < memo->bucketCount; i++)
+        memo->buckets[i] = SIZET_POISON;
+
+    return EVERYTHING_FINE;
+}
+
+static void _destroyMemo(_DiffMemo* memo)
+{
+    free(memo->entries);
+    free(memo->buckets);
+
+    DiffMemoStats stats = memo->stats;
+
+    *memo = {};
+
+    memo->stats = stats;
+}
+
+static TreeNode* _findInMemo(_DiffMemo* memo, TreeNode* original, size_t hash)
+{
+    for (size_t i = memo->buckets[hash & (memo->bucketCount - 1)]; i != SIZET_POISON; i = memo->entries[i].next)
+        if (memo->entries[i].hash == hash && _sameSubtree(memo->entries[i].original, original))
+            return memo->entries[i].derivative;
+
+    return nullptr;
+}
+
+static ErrorCode _addToMemo(_DiffMemo* memo, TreeNode* original, TreeNode* derivative, size_t hash)
+{
+    if (memo->size == memo->capacity)
+    {
+        size_t newCapacity = memo->capacity ? memo->capacity * 2 : 16;
+
+        _DiffMemoEntry* newEntries = (_DiffMemoEntry*)realloc(memo->entries, newCapacity * sizeof(*newEntries));
+        MyAssertSoft(newEntries, ERROR_NO_MEMORY);
+
+        memo->entries  = newEntries;
+        memo->capacity = newCapacity;
+    }
+
+    size_t* bucket = &memo->buckets[hash & (memo->bucketCount - 1)];
+
+    memo->entries[memo->size] = { original, derivative, hash, *bucket };
+    *bucket = memo->size++;
+
+    return EVERYTHING_FINE;
+}
+
+static DiffCacheEntry* _findInCache(DiffCache* cache, TreeNode* original, size_t hash)
+{
+    for (size_t i = cache->buckets[hash & (cache->bucketCount - 1)]; i != SIZET_POISON; i = cache->entries[i].next)
+        if (cache->entries[i].hash == hash && _sameSubtree(cache->entries[i].original, original))
+            return &cache->entries[i];
+
+    return nullptr;
+}
+
+static ErrorCode _addToCache(DiffCache* cache, TreeNode* original, TreeNode* derivative, size_t hash)
+{
+    if (cache->size == cache->capacity)
+    {
+        size_t newCapacity = cache->capacity ? cache->capacity * 2 : 16;
+
+        DiffCacheEntry* newEntries = (DiffCacheEntry*)realloc(cache->entries, newCapacity * sizeof(*newEntries));
+        MyAssertSoft(newEntries, ERROR_NO_MEMORY);
+
+        cache->entries  = newEntries;
+        cache->capacity = newCapacity;
+    }
+
+    if (cache->size == cache->bucketCount)
+        RETURN_ERROR(_rehashCache(cache, cache->bucketCount * 2));
+
+    size_t* bucket = &cache->buckets[hash & (cache->bucketCount - 1)];
+
+    cache->entries[cache->size] = { original, derivative, derivative->id, hash, *bucket, cache->generation,
+                                    cache->block, false };
+    *bucket = cache->size++;
+
+    cache->blocks[cache->block].users++;
+
+    return EVERYTHING_FINE;
+}
+
+// marks the entries of every subtree as met in this call, returns the hash of the node
+static size_t _keepInCache(DiffCache* cache, TreeNode* node)
+{
+    if (!node)
+        return 0;
+
+    size_t hash = _hashNode(node, _keepInCache(cache, node->left), _keepInCache(cache, node->right));
+
+    if (NODE_TYPE(node) == OPERATION_TYPE && _hasVariable(node, cache->var))
+    {
+        DiffCacheEntry* entry = _findInCache(cache, node, hash);
+        if (entry)
+            entry->generation = cache->generation;
+    }
+
+    return hash;
+}
+
+static ErrorCode _rehashCache(DiffCache* cache, size_t bucketCount)
+{
+    size_t* newBuckets = (size_t*)realloc(cache->buckets, bucketCount * sizeof(*newBuckets));
+    MyAssertSoft(newBuckets, ERROR_NO_MEMORY);
+
+    cache->buckets     = newBuckets;
+    cache->bucketCount = bucketCount;
+
+    for (size_t i = 0; i < bucketCount; i++)
+        cache->buckets[i] = SIZET_POISON;
+
+    for (size_t i = 0; i < cache->size; i++)
+    {
+        size_t* bucket = &cache->buckets[cache->entries[i].hash & (bucketCount - 1)];
+
+        cache->entries[i].next = *bucket;
+        *bucket = i;
+    }
+
+    return EVERYTHING_FINE;
+}
+
+// deletes the entries not met in the current call, or all of them, and the blocks nobody points into
+static ErrorCode _pruneCache(DiffCache* cache, bool all)
+{
+    ErrorCode error = EVERYTHING_FINE;
+    size_t kept = 0;
+
+    for (size_t i = 0; i < cache->size; i++)
+    {
+        DiffCacheEntry* entry = &cache->entries[i];
+
+        if (!all && entry->generation == cache->generation)
+        {
+            cache->entries[kept++] = *entry;
+            continue;
+        }
+
+        if (entry->ownsDerivative)
+        {
+            ErrorCode derivativeError = entry->derivative->Delete();
+            if (!error)
+                error = derivativeError;
+        }
+
+        cache->blocks[entry->block].users--;
+    }
+
+    cache->size = kept;
+
+    for (size_t i = 0; i < cache->blockCount; i++)
+    {
+        DiffCacheBlock* block = &cache->blocks[i];
+
+        // the caller reads the derivative of the current call until the next one
+        if (!block->function || block->users || (!all && i == cache->block))
+            continue;
+
+        ErrorCode functionError = block->function->Delete();
+        if (!error)
+            error = functionError;
+
+        if (block->derivative)
+        {
+            ErrorCode derivativeError = block->derivative->Delete();
+            if (!error)
+                error = derivativeError;
+        }
+
+        *block = {};
+    }
+
+    if (!cache->buckets)
+        return error;
+
+    RETURN_ERROR(error);
+
+    return _rehashCache(cache, cache->bucketCount);
+}
+
+// the block of the call takes the tree over, the entries of the call will point into it
+static ErrorCode _newBlock(DiffCache* cache, Tree* tree, Tree* function)
+{
+    size_t block = 0;
+    while (block < cache->blockCount && cache->blocks[block].function)
+        block++;
+
+    if (block == cache->blockCapacity)
+    {
+        size_t newCapacity = cache->blockCapacity ? cache->blockCapacity * 2 : 4;
+
+        DiffCacheBlock* newBlocks = (DiffCacheBlock*)realloc(cache->blocks, newCapacity * sizeof(*newBlocks));
+        MyAssertSoft(newBlocks, ERROR_NO_MEMORY, tree->Destructor());
+
+        cache->blocks        = newBlocks;
+        cache->blockCapacity = newCapacity;
+    }
+
+    if (block == cache->blockCount)
+        cache->blockCount++;
+
+    cache->blocks[block] = { tree->root, nullptr, 0 };
+    cache->block = block;
+
+    *function = *tree;
+    *tree     = {};
+
+    return EVERYTHING_FINE;
+}
+
+static size_t _liveBlocks(DiffCache* cache)
+{
+    size_t live = 0;
+
+    for (size_t i = 0; i < cache->blockCount; i++)
+        if (cache->blocks[i].function)
+            live++;
+
+    return live;
+}
+
+// a derivative of the call left out of the result is in a retired tree,
+// its entry gets a copy before the retired trees are deleted
+static ErrorCode _adoptDerivatives(DiffCache* cache, TreeNode* derivative)
+{
+    for (size_t i = 0; i < cache->size; i++)
+    {
+        DiffCacheEntry* entry = &cache->entries[i];
+        if (entry->block != cache->block)
+            continue;
+
+        TreeNode* top = entry->derivative;
+        while (top->parent)
+            top = top->parent;
+
+        if (top == derivative)
+            continue;
+
+        TreeNodeResult copy = entry->derivative->Copy();
+        RETURN_ERROR(copy.error);
+
+        entry->derivative     = copy.value;
+        entry->derivativeId   = copy.value->id;
+        entry->ownsDerivative = true;
+    }
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _addCopy(DiffCache* cache, TreeNode* copy)
+{
+    if (cache->copyCount == cache->copyCapacity)
+    {
+        size_t newCapacity = cache->copyCapacity ? cache->copyCapacity * 2 : 16;
+
+        DiffCacheCopy* newCopies = (DiffCacheCopy*)realloc(cache->copies, newCapacity * sizeof(*newCopies));
+        MyAssertSoft(newCopies, ERROR_NO_MEMORY);
+
+        cache->copies       = newCopies;
+        cache->copyCapacity = newCapacity;
+    }
+
+    cache->copies[cache->copyCount++] = { copy, copy->id };
+
+    return EVERYTHING_FINE;
+}
+
+// the nodes the call made are simplified as Optimise does it, the copied derivatives are simplified already.
+// A rewrite may delete a derivative an entry of the call points to, such entries are dropped,
+// the others now point to the simplified derivatives of their subtrees
+static ErrorCode _simplifyMade(DiffCache* cache, TreeNode* derivative, StepObserver* observer)
+{
+    if (cache->copyCount)
+        Sort(cache->copies, cache->copyCount, sizeof(*cache->copies), _compareCopies);
+
+    DiffCacheEntry** made = (DiffCacheEntry**)calloc(cache->size + 1, sizeof(*made));
+    MyAssertSoft(made, ERROR_NO_MEMORY);
+
+    size_t madeCount = 0;
+    for (size_t i = 0; i < cache->size; i++)
+        if (cache->entries[i].block == cache->block)
+            made[madeCount++] = &cache->entries[i];
+
+    ErrorCode error = _simplifyTree(derivative, cache, observer);
+
+    for (size_t i = 0; i < madeCount && !error; i++)
+        if (made[i]->ownsDerivative)
+            error = _simplifyTree(made[i]->derivative, cache, observer);
+
+    if (!error)
+    {
+        for (size_t i = 0; i < madeCount; i++)
+            if (!made[i]->ownsDerivative)
+                made[i]->generation--;
+
+        if (madeCount)
+            Sort(made, madeCount, sizeof(*made), _compareDerivatives);
+
+        _keepSimplified(derivative, made, madeCount, cache->generation);
+    }
+
+    free(made);
+
+    return error;
+}
+
+// Optimise for the made part of the tree: the rules go from the made nodes up,
+// then the changed polynomial parts are normalised, while that makes the tree smaller
+static ErrorCode _simplifyTree(TreeNode* root, DiffCache* cache, StepObserver* observer)
+{
+    OBSERVE(observer, optimiseStart, root);
+
+    Tree tree = {};
+    RETURN_ERROR(tree.Init(root));
+
+    size_t normalisedSize = SIZET_POISON;
+
+    while (true)
+    {
+        SimplifyWorklist worklist = {};
+        RETURN_ERROR(worklist.Init());
+
+        ErrorCode error = _pushMade(root, cache, &worklist);
+
+        if (!error)
+            error = worklist.Run(observer);
+
+        worklist.Destructor();
+        RETURN_ERROR(error);
+
+        size_t size = root->nodeCount;
+
+        RETURN_ERROR(NormaliseChanged(&tree, _isCopy, cache, observer));
+
+        if (root->nodeCount >= size || root->nodeCount >= normalisedSize)
+            return EVERYTHING_FINE;
+
+        normalisedSize = root->nodeCount;
+    }
+}
+
+static ErrorCode _pushMade(TreeNode* node, DiffCache* cache, SimplifyWorklist* worklist)
+{
+    if (NODE_TYPE(node) != OPERATION_TYPE || _isCopy(cache, node))
+        return EVERYTHING_FINE;
+
+    RETURN_ERROR(worklist->Push(node));
+
+    RETURN_ERROR(_pushMade(node->left, cache, worklist));
+    if (node->right)
+        RETURN_ERROR(_pushMade(node->right, cache, worklist));
+
+    return EVERYTHING_FINE;
+}
+
+// the copies are sorted, a node made at the address of a deleted copy has another id
+static bool _isCopy(void* data, TreeNode* node)
+{
+    DiffCache* cache = (DiffCache*)data;
+
+    size_t left  = 0;
+    size_t right = cache->copyCount;
+
+    while (left < right)
+    {
+        size_t middle = left + (right - left) / 2;
+
+        if ((uintptr_t)cache->copies[middle].node < (uintptr_t)node)
+            left = middle + 1;
+        else
+            right = middle;
+    }
+
+    return left < cache->copyCount && cache->copies[left].node == node && cache->copies[left].id == node->id;
+}
+
+// an entry is kept if its derivative is still in the tree, a node made at a freed address has another id
+static void _keepSimplified(TreeNode* node, DiffCacheEntry** made, size_t madeCount, size_t generation)
+{
+    size_t left  = 0;
+    size_t right = madeCount;
+
+    while (left < right)
+    {
+        size_t middle = left + (right - left) / 2;
+
+        if ((uintptr_t)made[middle]->derivative < (uintptr_t)node)
+            left = middle + 1;
+        else
+            right = middle;
+    }
+
+    // an operand kept by a simplifying constructor is the derivative of its parent too
+    for (; left < madeCount && made[left]->derivative == node; left++)
+        if (made[left]->derivativeId == node->id)
+            made[left]->generation = generation;
+
+    if (node->left)
+        _keepSimplified(node->left, made, madeCount, generation);
+    if (node->right)
+        _keepSimplified(node->right, made, madeCount, generation);
+}
+
+static int _compareCopies(const void* first, const void* second)
+{
+    uintptr_t firstNode  = (uintptr_t)((const DiffCacheCopy*)first)->node;
+    uintptr_t secondNode = (uintptr_t)((const DiffCacheCopy*)second)->node;
+
+    return (firstNode > secondNode) - (firstNode < secondNode);
+}
+
+static int _compareDerivatives(const void* first, const void* second)
+{
+    uintptr_t firstNode  = (uintptr_t)(*(DiffCacheEntry* const*)first)->derivative;
+    uintptr_t secondNode = (uintptr_t)(*(DiffCacheEntry* const*)second)->derivative;
+
+    return (firstNode > secondNode) - (firstNode < secondNode);
+}
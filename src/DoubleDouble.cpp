@@ -0,0 +1,242 @@
+#include <math.h>
+#include "DoubleDouble.hpp"
+
+static const DoubleDouble DD_PI_2 = { 1.5707963267948966, 6.123233995736766e-17 };
+static const DoubleDouble DD_LN2  = { 0.6931471805599453, 2.3190468138462996e-17 };
+
+// the next 53 bits of pi / 2, k * pi / 2 is taken off in three exact steps
+static const double PI_2_TAIL = -1.4973849048591698e-33;
+
+static const int    EXP_HALVINGS       = 9;
+static const int    MAX_SERIES_TERMS   = 64;
+static const double MAX_EXP_ARGUMENT   = 709.78;
+static const double MIN_EXP_ARGUMENT   = -745.2;
+static const double MAX_INTEGER_POWER  = 2147483648.0;
+static const double MAX_TRIG_ARGUMENT  = 1e15;
+static const int    MAX_NEWTON_STEPS   = 8;
+
+static DoubleDouble _ddLdexp(DoubleDouble x, int exponent);
+
+static void _ddSinCos(DoubleDouble x, DoubleDouble* sinx, DoubleDouble* cosx);
+
+static DoubleDouble _ddIntegerPow(DoubleDouble base, long power);
+
+static DoubleDouble _ddLdexp(DoubleDouble x, int exponent)
+{
+    return { ldexp(x.hi, exponent), ldexp(x.lo, exponent) };
+}
+
+// e ^ x = 2 ^ k * e ^ r, e ^ r = (e ^ (r / 2 ^ m)) ^ (2 ^ m)
+DoubleDouble DDExp(DoubleDouble x)
+{
+    if (isnan(x.hi))
+        return x;
+    if (x.hi > MAX_EXP_ARGUMENT)
+        return DDFromDouble(INFINITY);
+    if (x.hi < MIN_EXP_ARGUMENT)
+        return DDFromDouble(0);
+
+    double k = nearbyint(x.hi / DD_LN2.hi);
+
+    DoubleDouble r = _ddLdexp(DDSub(x, DDMulDouble(DD_LN2, k)), -EXP_HALVINGS);
+
+    // e ^ r - 1, keeping the small part separate from 1 keeps the squarings exact
+    DoubleDouble term = r;
+    DoubleDouble sum  = r;
+
+    for (int n = 2; n < MAX_SERIES_TERMS; n++)
+    {
+        term = DDDiv(DDMul(term, r), DDFromDouble(n));
+        sum = DDAdd(sum, term);
+
+        if (fabs(term.hi) <= DOUBLE_DOUBLE_EPSILON * fabs(sum.hi))
+            break;
+    }
+
+    // (1 + s) ^ 2 - 1 = 2s + s ^ 2
+    for (int i = 0; i < EXP_HALVINGS; i++)
+        sum = DDAdd(DDMulDouble(sum, 2), DDMul(sum, sum));
+
+    return _ddLdexp(DDAdd(sum, DDFromDouble(1)), (int)k);
+}
+
+// one Newton step for e ^ y = x doubles the digits of libm's log
+DoubleDouble DDLn(DoubleDouble x)
+{
+    if (isnan(x.hi) || x.hi < 0)
+        return DDFromDouble(NAN);
+    if (x.hi == 0)
+        return DDFromDouble(-INFINITY);
+    if (isinf(x.hi))
+        return x;
+
+    DoubleDouble y = DDFromDouble(log(x.hi));
+
+    DoubleDouble correction = DDSub(DDMul(x, DDExp(DDNeg(y))), DDFromDouble(1));
+
+    return DDAdd(y, correction);
+}
+
+// x = k * pi / 2 + r, |r| <= pi / 4. Every word of pi / 2 times k is exact, so r keeps its digits
+// while k * 2 ^ -160 is small, bigger arguments are NaN as in BigFloat
+static void _ddSinCos(DoubleDouble x, DoubleDouble* sinx, DoubleDouble* cosx)
+{
+    if (!isfinite(x.hi) || fabs(x.hi) > MAX_TRIG_ARGUMENT)
+    {
+        *sinx = DDFromDouble(NAN);
+        *cosx = DDFromDouble(NAN);
+        return;
+    }
+
+    double k = nearbyint(x.hi / DD_PI_2.hi);
+
+    DoubleDouble r = DDSub(x, _ddTwoProd(DD_PI_2.hi, k));
+    r = DDSub(r, _ddTwoProd(DD_PI_2.lo, k));
+    r = DDSub(r, _ddTwoProd(PI_2_TAIL, k));
+    DoubleDouble r2 = DDMul(r, r);
+
+    DoubleDouble sinTerm = r;
+    DoubleDouble sinSum  = r;
+    DoubleDouble cosTerm = DDFromDouble(1);
+    DoubleDouble cosSum  = DDFromDouble(1);
+
+    for (int n = 1; n < MAX_SERIES_TERMS / 2; n++)
+    {
+        cosTerm = DDNeg(DDDiv(DDMul(cosTerm, r2), DDFromDouble((2 * n - 1) * (2 * n))));
+        sinTerm = DDNeg(DDDiv(DDMul(sinTerm, r2), DDFromDouble((2 * n) * (2 * n + 1))));
+
+        cosSum = DDAdd(cosSum, cosTerm);
+        sinSum = DDAdd(sinSum, sinTerm);
+
+        if (fabs(cosTerm.hi) <= DOUBLE_DOUBLE_EPSILON * fabs(cosSum.hi) &&
+            fabs(sinTerm.hi) <= DOUBLE_DOUBLE_EPSILON * fabs(sinSum.hi))
+            break;
+    }
+
+    switch ((long)fmod(k, 4) & 3)
+    {
+        case 0:
+            *sinx = sinSum;
+            *cosx = cosSum;
+            break;
+        case 1:
+            *sinx = cosSum;
+            *cosx = DDNeg(sinSum);
+            break;
+        case 2:
+            *sinx = DDNeg(sinSum);
+            *cosx = DDNeg(cosSum);
+            break;
+        case 3:
+        default:
+            *sinx = DDNeg(cosSum);
+            *cosx = sinSum;
+            break;
+    }
+}
+
+DoubleDouble DDSin(DoubleDouble x)
+{
+    DoubleDouble sinx = {}, cosx = {};
+    _ddSinCos(x, &sinx, &cosx);
+
+    return sinx;
+}
+
+DoubleDouble DDCos(DoubleDouble x)
+{
+    DoubleDouble sinx = {}, cosx = {};
+    _ddSinCos(x, &sinx, &cosx);
+
+    return cosx;
+}
+
+DoubleDouble DDTan(DoubleDouble x)
+{
+    DoubleDouble sinx = {}, cosx = {};
+    _ddSinCos(x, &sinx, &cosx);
+
+    return DDDiv(sinx, cosx);
+}
+
+// arctan(x) = +-pi / 2 - arctan(1 / x) for |x| > 1, then Newton for tan(y) = x
+// from libm's atan: y -= (sin(y) - x * cos(y)) * cos(y) until the step is below the precision
+DoubleDouble DDArctan(DoubleDouble x)
+{
+    if (isnan(x.hi))
+        return x;
+    if (isinf(x.hi))
+        return x.hi > 0 ? DD_PI_2 : DDNeg(DD_PI_2);
+
+    if (fabs(x.hi) > 1)
+    {
+        DoubleDouble absX = x.hi > 0 ? x : DDNeg(x);
+        DoubleDouble y = DDSub(DD_PI_2, DDArctan(DDDiv(DDFromDouble(1), absX)));
+
+        return x.hi > 0 ? y : DDNeg(y);
+    }
+
+    DoubleDouble y = DDFromDouble(atan(x.hi));
+
+    for (int i = 0; i < MAX_NEWTON_STEPS; i++)
+    {
+        DoubleDouble siny = {}, cosy = {};
+        _ddSinCos(y, &siny, &cosy);
+
+        DoubleDouble step = DDMul(DDSub(siny, DDMul(x, cosy)), cosy);
+        y = DDSub(y, step);
+
+        if (fabs(step.hi) <= DOUBLE_DOUBLE_EPSILON * fabs(y.hi))
+            break;
+    }
+
+    return y;
+}
+
+// arcsin(x) = arctan(x / sqrt(1 - x ^ 2))
+DoubleDouble DDArcsin(DoubleDouble x)
+{
+    double absX = fabs(x.hi);
+
+    if (isnan(x.hi) || absX > 1)
+        return DDFromDouble(NAN);
+    if (absX == 1 && x.lo == 0)
+        return x.hi > 0 ? DD_PI_2 : DDNeg(DD_PI_2);
+
+    DoubleDouble oneMinusX2 = DDSub(DDFromDouble(1), DDMul(x, x));
+
+    return DDArctan(DDDiv(x, DDSqrt(oneMinusX2)));
+}
+
+DoubleDouble DDArccos(DoubleDouble x)
+{
+    return DDSub(DD_PI_2, DDArcsin(x));
+}
+
+static DoubleDouble _ddIntegerPow(DoubleDouble base, long power)
+{
+    unsigned long exponent = (unsigned long)labs(power);
+    DoubleDouble result = DDFromDouble(1);
+
+    while (exponent)
+    {
+        if (exponent & 1)
+            result = DDMul(result, base);
+        exponent >>= 1;
+        if (exponent)
+            base = DDMul(base, base);
+    }
+
+    return power < 0 ? DDDiv(DDFromDouble(1), result) : result;
+}
+
+DoubleDouble DDPow(DoubleDouble base, DoubleDouble power)
+{
+    if (power.lo == 0 && power.hi == floor(power.hi) && fabs(power.hi) < MAX_INTEGER_POWER)
+        return _ddIntegerPow(base, (long)power.hi);
+
+    if (base.hi == 0)
+        return DDFromDouble(power.hi > 0 ? 0 : INFINITY);
+
+    return DDExp(DDMul(power, DDLn(base)));
+}
@@ -0,0 +1,1331 @@
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "EGraph.hpp"
+#include "RewriteRules.hpp"
+#include "RecursiveDescent.hpp"
+#include "Differentiator.hpp"
+#include "DiffTreeDSL.hpp"
+#include "MinMax.hpp"
+
+static const size_t ENODES_START_CAPACITY   = 64;
+static const size_t MATCHES_START_CAPACITY  = 64;
+static const unsigned int ENODE_HASH_SEED   = 0xE6A9;
+
+// numbers folded in a different order may differ in the last bits. The tolerance is relative,
+// a small power like 2 ^ -40 is not 0, so a sum cancelling to less than that is folded to 0 instead
+static const double NUMBER_TOLERANCE = 1e-9;
+
+static const size_t MAX_RULE_LENGTH  = 64;
+static const size_t MAX_PATTERN_SIZE = 16;
+
+// a rule matching more often in a round is left out for some rounds,
+// both numbers double every time it is left out
+static const size_t RULE_MATCH_LIMIT = 1000;
+static const size_t BAN_ITERATIONS   = 5;
+static const size_t MAX_BAN_SHIFT    = 16;
+
+#define BOUND(var)     (bound[#var[0] - 'a'])
+#define NUMBER(var)    (graph->nodes[BOUND(var)].number)
+#define IS_NUMBER(var) (graph->nodes[BOUND(var)].isNumber)
+
+#define DEF_RULE(name, pattern, replacement, guard)                     \
+static bool _guard ## name(EGraph* graph, const size_t* bound)          \
+{                                                                       \
+    (void)graph;                                                        \
+    (void)bound;                                                        \
+    return guard;                                                       \
+}
+
+#include "SimplifyRules.hpp"
+#include "EqualityRules.hpp"
+
+#undef DEF_RULE
+
+/** @struct _EqualityRule
+ * @brief A rule of SimplifyRules.hpp or EqualityRules.hpp
+ *
+ * @var _EqualityRule::patternString, _EqualityRule::replacementString - as written in the table
+ * @var _EqualityRule::guard - whether the rule applies to the classes its variables stand for
+ * @var _EqualityRule::pattern, _EqualityRule::replacement - parsed strings, variables are VARIABLE_TYPE nodes
+ */
+struct _EqualityRule
+{
+    const char* patternString;
+    const char* replacementString;
+    bool (*guard)(EGraph* graph, const size_t* bound);
+
+    TreeNode* pattern;
+    TreeNode* replacement;
+};
+
+static _EqualityRule RULES[] =
+{
+#define DEF_RULE(name, pattern, replacement, guard) { pattern, replacement, _guard ## name, nullptr, nullptr },
+
+#include "SimplifyRules.hpp"
+#include "EqualityRules.hpp"
+
+#undef DEF_RULE
+};
+
+static const size_t RULE_COUNT = sizeof(RULES) / sizeof(*RULES);
+
+static pthread_once_t COMPILE_ONCE  = PTHREAD_ONCE_INIT;
+static ErrorCode      COMPILE_ERROR = EVERYTHING_FINE;
+
+/** @struct _Match
+ * @brief A place where a rule applies, found before any rule of the round is applied
+ *
+ * @var _Match::rule - the rule
+ * @var _Match::eclass - the class matching the pattern
+ * @var _Match::bound - classes the variables stand for
+ */
+struct _Match
+{
+    size_t rule;
+    size_t eclass;
+    size_t bound[RULE_VARIABLE_COUNT];
+};
+
+struct _Matches
+{
+    _Match* matches;
+    size_t size;
+    size_t capacity;
+};
+
+/** @struct _Matcher
+ * @brief State of matching one rule
+ *
+ * @var _Matcher::rule - the rule
+ * @var _Matcher::eclass - the class the whole pattern is matched against
+ * @var _Matcher::bound - classes of the variables bound so far, SIZET_POISON for the rest
+ * @var _Matcher::limit - matches of the rule after which it is given up
+ * @var _Matcher::found - matches of the rule so far
+ */
+struct _Matcher
+{
+    size_t rule;
+    size_t eclass;
+    size_t bound[RULE_VARIABLE_COUNT];
+
+    size_t limit;
+    size_t found;
+};
+
+/** @struct _RuleSchedule
+ * @brief How a rule is left out by @ref EGraph::Saturate
+ *
+ * @var _RuleSchedule::bannedUntil - the first round the rule is matched again
+ * @var _RuleSchedule::bans - how many times it was left out
+ */
+struct _RuleSchedule
+{
+    size_t bannedUntil;
+    size_t bans;
+};
+
+static void _compileRules();
+static ErrorCode _parseRule(const char* string, TreeNode** root);
+static ErrorCode _checkVariables(TreeNode* node, bool* bound, bool binds);
+
+static ErrorCode _addTree(EGraph* graph, TreeNode* node, size_t* eclass);
+static ErrorCode _addNode(EGraph* graph, TreeElement_t value, size_t left, size_t right, size_t* eclass, bool* added);
+static ErrorCode _addNumber(EGraph* graph, double number, size_t* eclass, bool* added);
+static ErrorCode _addPattern(EGraph* graph, TreeNode* pattern, const size_t* bound, size_t* eclass, bool* added);
+static ErrorCode _merge(EGraph* graph, size_t first, size_t second, bool* merged);
+static bool _sameNumber(double first, double second);
+static size_t _findOperand(EGraph* graph, size_t eclass);
+static TreeElement_t _operationElement(Operation operation);
+
+static size_t _hashNode(TreeElement_t* value, size_t left, size_t right);
+static bool _sameNode(EGraph* graph, size_t node, TreeElement_t* value, size_t left, size_t right);
+static size_t* _findSlot(EGraph* graph, TreeElement_t* value, size_t left, size_t right);
+static ErrorCode _rebuildTable(EGraph* graph, size_t capacity);
+static ErrorCode _mergeEqualNodes(EGraph* graph, bool* merged);
+static ErrorCode _foldNumbers(EGraph* graph, bool* merged);
+static ErrorCode _compute(Operation operation, double left, double right, double* number, bool* computed);
+static ErrorCode _makeLists(EGraph* graph);
+static ErrorCode _sortByKey(const size_t* keys, const size_t* values, size_t count, size_t keyCount,
+                            size_t* start, size_t* sorted);
+
+static ErrorCode _matchRules(EGraph* graph, size_t iteration, _RuleSchedule* schedule, _Matches* matches,
+                             double deadline, bool* banned);
+static ErrorCode _matchRule(EGraph* graph, _Matcher* matcher, _Matches* matches);
+static ErrorCode _matchPending(EGraph* graph, _Matcher* matcher, TreeNode** patterns, size_t* classes,
+                               size_t pendingCount, _Matches* matches);
+static ErrorCode _pushMatch(_Matches* matches, _Matcher* matcher);
+static ErrorCode _applyMatches(EGraph* graph, _Matches* matches, size_t nodeLimit, size_t* rewrites, bool* changed);
+
+static ErrorCode _reserveCosts(EGraphExtractor* extractor, size_t capacity);
+static ErrorCode _relax(EGraphExtractor* extractor, EGraph* graph, size_t node,
+                       size_t* worklist, size_t* worklistSize, bool* queued);
+static TreeNodeResult _buildTree(EGraphExtractor* extractor, EGraph* graph, size_t eclass, size_t* budget);
+
+static double _seconds();
+
+ErrorCode EGraph::Init()
+{
+    *this = {};
+
+    this->nodes = (ENode*)calloc(ENODES_START_CAPACITY, sizeof(*this->nodes));
+    MyAssertSoft(this->nodes, ERROR_NO_MEMORY);
+
+    this->capacity = ENODES_START_CAPACITY;
+    this->clean    = true;
+
+    return _rebuildTable(this, 2 * ENODES_START_CAPACITY);
+}
+
+EClassResult EGraph::Add(TreeNode* root)
+{
+    MyAssertSoftResult(root, SIZET_POISON, ERROR_NULLPTR);
+
+    size_t eclass = SIZET_POISON;
+    ErrorCode error = _addTree(this, root, &eclass);
+
+    return { eclass, error };
+}
+
+size_t EGraph::Find(size_t eclass)
+{
+    // halves the way every time it is walked
+    while (this->nodes[eclass].parent != eclass)
+    {
+        this->nodes[eclass].parent = this->nodes[this->nodes[eclass].parent].parent;
+        eclass = this->nodes[eclass].parent;
+    }
+
+    return eclass;
+}
+
+// a merge may make two more nodes equal, so it goes on until nothing merges
+ErrorCode EGraph::Rebuild()
+{
+    if (this->clean)
+        return EVERYTHING_FINE;
+
+    bool merged = true;
+
+    while (merged)
+    {
+        merged = false;
+
+        RETURN_ERROR(_mergeEqualNodes(this, &merged));
+        RETURN_ERROR(_foldNumbers(this, &merged));
+    }
+
+    RETURN_ERROR(_makeLists(this));
+
+    this->clean = true;
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode EGraph::Saturate(const EGraphLimits* limits, SaturationReport* report)
+{
+    pthread_once(&COMPILE_ONCE, _compileRules);
+    RETURN_ERROR(COMPILE_ERROR);
+
+    EGraphLimits defaultLimits = { DEFAULT_EGRAPH_NODES, DEFAULT_EGRAPH_ITERATIONS, DEFAULT_EGRAPH_SECONDS };
+    if (!limits)
+        limits = &defaultLimits;
+
+    double deadline = limits->seconds > 0 ? _seconds() + limits->seconds : INFINITY;
+
+    SaturationReport done = {};
+    _RuleSchedule schedule[RULE_COUNT] = {};
+    _Matches matches = {};
+
+    ErrorCode error = this->Rebuild();
+
+    while (!error)
+    {
+        if (done.iterations >= limits->iterations)
+        {
+            done.stop = ITERATION_LIMIT_STOP;
+            break;
+        }
+        if (this->size >= limits->nodes)
+        {
+            done.stop = NODE_LIMIT_STOP;
+            break;
+        }
+        if (_seconds() > deadline)
+        {
+            done.stop = TIME_LIMIT_STOP;
+            break;
+        }
+
+        bool banned  = false;
+        bool changed = false;
+
+        matches.size = 0;
+
+        error = _matchRules(this, done.iterations, schedule, &matches, deadline, &banned);
+        if (error)
+            break;
+
+        error = _applyMatches(this, &matches, limits->nodes, &done.rewrites, &changed);
+        if (error)
+            break;
+
+        error = this->Rebuild();
+        done.iterations++;
+
+        if (changed)
+            continue;
+
+        if (!banned)
+        {
+            done.stop = SATURATED_STOP;
+            break;
+        }
+
+        // only the left out rules may still find something
+        for (size_t rule = 0; rule < RULE_COUNT; rule++)
+            schedule[rule].bannedUntil = 0;
+    }
+
+    free(matches.matches);
+
+    done.nodes   = this->size;
+    done.classes = this->classCount;
+
+    if (report)
+        *report = done;
+
+    return error;
+}
+
+ErrorCode EGraph::Destructor()
+{
+    free(this->nodes);
+    free(this->table);
+    free(this->classNodes);
+    free(this->classStart);
+    free(this->parentNodes);
+    free(this->parentStart);
+    free(this->operationNodes);
+
+    *this = {};
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode EGraphExtractor::Init(CostModel model)
+{
+    MyAssertSoft(model.nodeCost, ERROR_NULLPTR);
+
+    *this = {};
+    this->model = model;
+
+    return EVERYTHING_FINE;
+}
+
+// a class only gets cheaper: it may get a new node or merge with another class,
+// so the costs go down from the changed classes to the ones using them
+ErrorCode EGraphExtractor::Update(EGraph* graph)
+{
+    MyAssertSoft(graph, ERROR_NULLPTR);
+
+    RETURN_ERROR(graph->Rebuild());
+    RETURN_ERROR(_reserveCosts(this, graph->size));
+
+    size_t* worklist = (size_t*)calloc(graph->size, sizeof(*worklist));
+    bool*   queued   = (bool*)  calloc(graph->size, sizeof(*queued));
+    if (!worklist || !queued)
+    {
+        free(worklist);
+        free(queued);
+        return ERROR_NO_MEMORY;
+    }
+
+    size_t worklistSize = 0;
+    ErrorCode error = EVERYTHING_FINE;
+
+    // merged classes take the cheaper tree of the two
+    for (size_t i = 0; i < this->known; i++)
+    {
+        size_t eclass = graph->Find(i);
+        if (eclass == i || this->costs[i] >= this->costs[eclass])
+            continue;
+
+        this->costs[eclass] = this->costs[i];
+        this->best[eclass]  = this->best[i];
+
+        if (!queued[eclass])
+        {
+            queued[eclass] = true;
+            worklist[worklistSize++] = eclass;
+        }
+    }
+
+    for (size_t node = this->known; node < graph->size && !error; node++)
+        if (graph->nodes[node].live)
+            error = _relax(this, graph, node, worklist, &worklistSize, queued);
+
+    while (worklistSize && !error)
+    {
+        size_t eclass = worklist[--worklistSize];
+        queued[eclass] = false;
+
+        for (size_t i = graph->parentStart[eclass]; i < graph->parentStart[eclass + 1] && !error; i++)
+            error = _relax(this, graph, graph->parentNodes[i], worklist, &worklistSize, queued);
+    }
+
+    free(worklist);
+    free(queued);
+
+    if (!error)
+        this->known = graph->size;
+
+    return error;
+}
+
+TreeResult EGraphExtractor::Extract(EGraph* graph, size_t eclass)
+{
+    MyAssertSoftResult(graph, {}, ERROR_NULLPTR);
+    MyAssertSoftResult(eclass < graph->size, {}, ERROR_INDEX_OUT_OF_BOUNDS);
+
+    ErrorCode error = this->Update(graph);
+    if (error)
+        return { {}, error };
+
+    size_t budget = MAX_TREE_SIZE;
+
+    TreeNodeResult rootRes = _buildTree(this, graph, eclass, &budget);
+    if (rootRes.error)
+        return { {}, rootRes.error };
+
+    Tree tree = {};
+    error = tree.Init(rootRes.value);
+    if (error)
+    {
+        rootRes.value->Delete();
+        return { {}, error };
+    }
+
+    return { tree, EVERYTHING_FINE };
+}
+
+ErrorCode EGraphExtractor::Destructor()
+{
+    free(this->costs);
+    free(this->best);
+
+    *this = {};
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode OptimiseByEGraph(Tree* tree, CostModel model, const EGraphLimits* limits, SaturationReport* report)
+{
+    MyAssertSoft(tree, ERROR_NULLPTR);
+
+    EGraph graph = {};
+    RETURN_ERROR(graph.Init());
+
+    EClassResult classRes = graph.Add(tree->root);
+    RETURN_ERROR(classRes.error, graph.Destructor());
+
+    RETURN_ERROR(graph.Saturate(limits, report), graph.Destructor());
+
+    EGraphExtractor extractor = {};
+    RETURN_ERROR(extractor.Init(model), graph.Destructor());
+
+    TreeResult cheapestRes = extractor.Extract(&graph, classRes.value);
+
+    extractor.Destructor();
+    graph.Destructor();
+
+    // the tree itself is one of the candidates, a model preferring a bigger tree than fits leaves it alone
+    if (cheapestRes.error == ERROR_BAD_SIZE)
+        return EVERYTHING_FINE;
+    RETURN_ERROR(cheapestRes.error);
+
+    RETURN_ERROR(tree->Destructor(), cheapestRes.value.Destructor());
+
+    *tree = cheapestRes.value;
+
+    return EVERYTHING_FINE;
+}
+
+static void _compileRules()
+{
+    for (size_t i = 0; i < RULE_COUNT && !COMPILE_ERROR; i++)
+    {
+        _EqualityRule* rule = &RULES[i];
+
+        COMPILE_ERROR = _parseRule(rule->patternString, &rule->pattern);
+        if (!COMPILE_ERROR)
+            COMPILE_ERROR = _parseRule(rule->replacementString, &rule->replacement);
+        if (COMPILE_ERROR)
+            return;
+
+        if (NODE_TYPE(rule->pattern) != OPERATION_TYPE || rule->pattern->nodeCount > MAX_PATTERN_SIZE)
+        {
+            COMPILE_ERROR = ERROR_BAD_VALUE;
+            return;
+        }
+
+        bool bound[RULE_VARIABLE_COUNT] = {};
+
+        COMPILE_ERROR = _checkVariables(rule->pattern, bound, true);
+        if (!COMPILE_ERROR)
+            COMPILE_ERROR = _checkVariables(rule->replacement, bound, false);
+    }
+}
+
+// the parser wants a string it can write to
+static ErrorCode _parseRule(const char* string, TreeNode** root)
+{
+    MyAssertSoft(strlen(string) < MAX_RULE_LENGTH, ERROR_BAD_SIZE);
+
+    char buffer[MAX_RULE_LENGTH] = "";
+    strcpy(buffer, string);
+
+    Tree tree = {};
+    RETURN_ERROR(ParseExpression(&tree, buffer));
+
+    *root = tree.root;
+
+    return EVERYTHING_FINE;
+}
+
+// the pattern binds the variables, the replacement may only use them
+static ErrorCode _checkVariables(TreeNode* node, bool* bound, bool binds)
+{
+    if (!node)
+        return EVERYTHING_FINE;
+
+    if (NODE_TYPE(node) == VARIABLE_TYPE)
+    {
+        MyAssertSoft('a' <= NODE_VAR(node) && NODE_VAR(node) <= 'z', ERROR_BAD_VALUE);
+        MyAssertSoft(binds || bound[NODE_VAR(node) - 'a'], ERROR_BAD_VALUE);
+
+        bound[NODE_VAR(node) - 'a'] = true;
+
+        return EVERYTHING_FINE;
+    }
+
+    RETURN_ERROR(_checkVariables(node->left, bound, binds));
+    return _checkVariables(node->right, bound, binds);
+}
+
+static ErrorCode _addTree(EGraph* graph, TreeNode* node, size_t* eclass)
+{
+    RETURN_ERROR(ExpandDerivative(node));
+
+    bool added = false;
+
+    switch (NODE_TYPE(node))
+    {
+        case NUMBER_TYPE:
+            return _addNumber(graph, NODE_NUMBER(node), eclass, &added);
+        case VARIABLE_TYPE:
+            return _addNode(graph, node->value, SIZET_POISON, SIZET_POISON, eclass, &added);
+        case OPERATION_TYPE:
+            break;
+        default:
+            return ERROR_BAD_VALUE;
+    }
+
+    MyAssertSoft(node->left, ERROR_BAD_TREE);
+
+    size_t left  = SIZET_POISON;
+    size_t right = SIZET_POISON;
+
+    RETURN_ERROR(_addTree(graph, node->left, &left));
+    if (node->right)
+        RETURN_ERROR(_addTree(graph, node->right, &right));
+
+    return _addNode(graph, _operationElement(NODE_OPERATION(node)), left, right, eclass, &added);
+}
+
+// the node may already be there, then its class is given
+static ErrorCode _addNode(EGraph* graph, TreeElement_t value, size_t left, size_t right, size_t* eclass, bool* added)
+{
+    left  = _findOperand(graph, left);
+    right = _findOperand(graph, right);
+
+    size_t* slot = _findSlot(graph, &value, left, right);
+    if (*slot != SIZET_POISON)
+    {
+        *eclass = graph->Find(*slot);
+        *added  = false;
+        return EVERYTHING_FINE;
+    }
+
+    if (graph->size == graph->capacity)
+    {
+        size_t newCapacity = graph->capacity * 2;
+
+        ENode* newNodes = (ENode*)realloc(graph->nodes, newCapacity * sizeof(*newNodes));
+        MyAssertSoft(newNodes, ERROR_NO_MEMORY);
+
+        graph->nodes    = newNodes;
+        graph->capacity = newCapacity;
+    }
+
+    size_t index = graph->size++;
+
+    ENode* node = &graph->nodes[index];
+
+    node->value    = value;
+    node->left     = left;
+    node->right    = right;
+    node->parent   = index;
+    node->live     = true;
+    node->isNumber = value.type == NUMBER_TYPE;
+    node->number   = node->isNumber ? value.value.number : NAN;
+
+    *slot = index;
+
+    *eclass = index;
+    *added  = true;
+
+    graph->clean = false;
+
+    // keeps the table at most half full
+    if (2 * graph->size > graph->tableCapacity)
+        return _rebuildTable(graph, graph->tableCapacity * 2);
+
+    return EVERYTHING_FINE;
+}
+
+// -0 and 0 are one number
+static ErrorCode _addNumber(EGraph* graph, double number, size_t* eclass, bool* added)
+{
+    TreeElement_t value = {};
+
+    value.type         = NUMBER_TYPE;
+    value.value.number = number + 0.0;
+
+    return _addNode(graph, value, SIZET_POISON, SIZET_POISON, eclass, added);
+}
+
+static ErrorCode _addPattern(EGraph* graph, TreeNode* pattern, const size_t* bound, size_t* eclass, bool* added)
+{
+    switch (NODE_TYPE(pattern))
+    {
+        case VARIABLE_TYPE:
+            *eclass = graph->Find(bound[NODE_VAR(pattern) - 'a']);
+            return EVERYTHING_FINE;
+        case NUMBER_TYPE:
+            return _addNumber(graph, NODE_NUMBER(pattern), eclass, added);
+        case OPERATION_TYPE:
+            break;
+        default:
+            return ERROR_BAD_VALUE;
+    }
+
+    size_t left  = SIZET_POISON;
+    size_t right = SIZET_POISON;
+
+    RETURN_ERROR(_addPattern(graph, pattern->left, bound, &left, added));
+    if (pattern->right)
+        RETURN_ERROR(_addPattern(graph, pattern->right, bound, &right, added));
+
+    bool addedHere = false;
+    RETURN_ERROR(_addNode(graph, _operationElement(NODE_OPERATION(pattern)), left, right, eclass, &addedHere));
+
+    *added = *added || addedHere;
+
+    return EVERYTHING_FINE;
+}
+
+// the smaller index names the merged class, so the names do not depend on the order of merges.
+// Classes equal to different numbers are never merged, such a merge can only come from a wrong rule
+static ErrorCode _merge(EGraph* graph, size_t first, size_t second, bool* merged)
+{
+    first  = graph->Find(first);
+    second = graph->Find(second);
+
+    if (first == second)
+        return EVERYTHING_FINE;
+
+    size_t root  = min(first, second);
+    size_t other = max(first, second);
+
+    MyAssertSoft(!graph->nodes[root].isNumber || !graph->nodes[other].isNumber ||
+                 _sameNumber(graph->nodes[root].number, graph->nodes[other].number), ERROR_BAD_VALUE);
+
+    graph->nodes[other].parent = root;
+
+    if (!graph->nodes[root].isNumber && graph->nodes[other].isNumber)
+    {
+        graph->nodes[root].isNumber = true;
+        graph->nodes[root].number   = graph->nodes[other].number;
+    }
+
+    graph->clean = false;
+    *merged      = true;
+
+    return EVERYTHING_FINE;
+}
+
+static bool _sameNumber(double first, double second)
+{
+    return first == second || fabs(first - second) <= NUMBER_TOLERANCE * fmax(fabs(first), fabs(second));
+}
+
+static size_t _findOperand(EGraph* graph, size_t eclass)
+{
+    return eclass == SIZET_POISON ? SIZET_POISON : graph->Find(eclass);
+}
+
+static TreeElement_t _operationElement(Operation operation)
+{
+    ENode node = {};
+
+    NODE_TYPE(&node)      = OPERATION_TYPE;
+    NODE_OPERATION(&node) = operation;
+    UPDATE_PRIORITY(&node);
+
+    return node.value;
+}
+
+// packed without padding so that equal nodes hash equally
+static size_t _hashNode(TreeElement_t* value, size_t left, size_t right)
+{
+    uint64_t key[4] = {};
+
+    key[0] = (uint64_t)value->type;
+
+    switch (value->type)
+    {
+        case NUMBER_TYPE:
+            memcpy(&key[1], &value->value.number, sizeof(value->value.number));
+            break;
+        case VARIABLE_TYPE:
+            key[1] = (uint64_t)value->value.var;
+            break;
+        case OPERATION_TYPE:
+            key[1] = (uint64_t)value->value.operation;
+            break;
+        default:
+            break;
+    }
+
+    key[2] = left;
+    key[3] = right;
+
+    return CalculateHash(key, sizeof(key), ENODE_HASH_SEED);
+}
+
+static bool _sameNode(EGraph* graph, size_t node, TreeElement_t* value, size_t left, size_t right)
+{
+    TreeElement_t* other = &graph->nodes[node].value;
+
+    if (other->type != value->type)
+        return false;
+
+    switch (value->type)
+    {
+        case NUMBER_TYPE:
+            if (memcmp(&other->value.number, &value->value.number, sizeof(value->value.number)) != 0)
+                return false;
+            break;
+        case VARIABLE_TYPE:
+            if (other->value.var != value->value.var)
+                return false;
+            break;
+        case OPERATION_TYPE:
+            if (other->value.operation != value->value.operation)
+                return false;
+            break;
+        default:
+            return false;
+    }
+
+    return _findOperand(graph, graph->nodes[node].left)  == left &&
+           _findOperand(graph, graph->nodes[node].right) == right;
+}
+
+// the slot of the equal node, or the empty slot where it would go
+static size_t* _findSlot(EGraph* graph, TreeElement_t* value, size_t left, size_t right)
+{
+    size_t mask = graph->tableCapacity - 1;
+    size_t slot = _hashNode(value, left, right) & mask;
+
+    while (graph->table[slot] != SIZET_POISON && !_sameNode(graph, graph->table[slot], value, left, right))
+        slot = (slot + 1) & mask;
+
+    return &graph->table[slot];
+}
+
+static ErrorCode _rebuildTable(EGraph* graph, size_t capacity)
+{
+    size_t* slots = (size_t*)calloc(capacity, sizeof(*slots));
+    MyAssertSoft(slots, ERROR_NO_MEMORY);
+
+    for (size_t i = 0; i < capacity; i++)
+        slots[i] = SIZET_POISON;
+
+    for (size_t index = 0; index < graph->size; index++)
+    {
+        ENode* node = &graph->nodes[index];
+        if (!node->live)
+            continue;
+
+        size_t slot = _hashNode(&node->value, _findOperand(graph, node->left),
+                                              _findOperand(graph, node->right)) & (capacity - 1);
+        while (slots[slot] != SIZET_POISON)
+            slot = (slot + 1) & (capacity - 1);
+
+        slots[slot] = index;
+    }
+
+    free(graph->table);
+    graph->table = slots;
+    graph->tableCapacity = capacity;
+
+    return EVERYTHING_FINE;
+}
+
+// the operands are renamed to their classes now, a node equal to one met before
+// is left out of the lists and the classes of the two are merged
+static ErrorCode _mergeEqualNodes(EGraph* graph, bool* merged)
+{
+    for (size_t i = 0; i < graph->tableCapacity; i++)
+        graph->table[i] = SIZET_POISON;
+
+    for (size_t index = 0; index < graph->size; index++)
+    {
+        ENode* node = &graph->nodes[index];
+        if (!node->live)
+            continue;
+
+        node->left  = _findOperand(graph, node->left);
+        node->right = _findOperand(graph, node->right);
+
+        size_t* slot = _findSlot(graph, &node->value, node->left, node->right);
+
+        if (*slot == SIZET_POISON)
+        {
+            *slot = index;
+            continue;
+        }
+
+        node->live = false;
+
+        RETURN_ERROR(_merge(graph, *slot, index, merged));
+    }
+
+    return EVERYTHING_FINE;
+}
+
+// the same operations on numbers as the rules compute
+static ErrorCode _foldNumbers(EGraph* graph, bool* merged)
+{
+    size_t size = graph->size;
+
+    for (size_t index = 0; index < size; index++)
+    {
+        ENode node = graph->nodes[index];
+        if (!node.live || node.value.type != OPERATION_TYPE || node.right == SIZET_POISON)
+            continue;
+
+        if (graph->nodes[graph->Find(index)].isNumber)
+            continue;
+
+        ENode* left  = &graph->nodes[graph->Find(node.left)];
+        ENode* right = &graph->nodes[graph->Find(node.right)];
+
+        if (!left->isNumber || !right->isNumber)
+            continue;
+
+        double number = 0;
+        bool computed = false;
+
+        if (_compute(node.value.value.operation, left->number, right->number, &number, &computed) || !computed ||
+            isnan(number))
+            continue;
+
+        Operation operation = node.value.value.operation;
+        if ((operation == ADD_OPERATION || operation == SUB_OPERATION) &&
+            fabs(number) <= NUMBER_TOLERANCE * fmax(fabs(left->number), fabs(right->number)))
+            number = 0;
+
+        size_t eclass = SIZET_POISON;
+        bool added = false;
+
+        RETURN_ERROR(_addNumber(graph, number, &eclass, &added));
+        RETURN_ERROR(_merge(graph, index, eclass, merged));
+    }
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _compute(Operation operation, double left, double right, double* number, bool* computed)
+{
+    *computed = true;
+
+    switch (operation)
+    {
+        case ADD_OPERATION:
+            *number = left + right;
+            break;
+        case SUB_OPERATION:
+            *number = left - right;
+            break;
+        case MUL_OPERATION:
+            *number = left * right;
+            break;
+        case DIV_OPERATION:
+            if (right == 0)
+                return ERROR_ZERO_DIVISION;
+            *number = left / right;
+            break;
+        case POWER_OPERATION:
+            *number = pow(left, right);
+            break;
+        default:
+            *computed = false;
+            break;
+    }
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _makeLists(EGraph* graph)
+{
+    size_t size = graph->size;
+
+    size_t* keys   = (size_t*)calloc(2 * size + 1, sizeof(*keys));
+    size_t* values = (size_t*)calloc(2 * size + 1, sizeof(*values));
+
+    size_t* classNodes     = (size_t*)realloc(graph->classNodes,     (size + 1)     * sizeof(*classNodes));
+    if (classNodes)
+        graph->classNodes = classNodes;
+    size_t* classStart     = (size_t*)realloc(graph->classStart,     (size + 1)     * sizeof(*classStart));
+    if (classStart)
+        graph->classStart = classStart;
+    size_t* parentNodes    = (size_t*)realloc(graph->parentNodes,    (2 * size + 1) * sizeof(*parentNodes));
+    if (parentNodes)
+        graph->parentNodes = parentNodes;
+    size_t* parentStart    = (size_t*)realloc(graph->parentStart,    (size + 1)     * sizeof(*parentStart));
+    if (parentStart)
+        graph->parentStart = parentStart;
+    size_t* operationNodes = (size_t*)realloc(graph->operationNodes, (size + 1)     * sizeof(*operationNodes));
+    if (operationNodes)
+        graph->operationNodes = operationNodes;
+
+    if (!keys || !values || !classNodes || !classStart || !parentNodes || !parentStart || !operationNodes)
+    {
+        free(keys);
+        free(values);
+        return ERROR_NO_MEMORY;
+    }
+
+    size_t count = 0;
+
+    for (size_t index = 0; index < size; index++)
+    {
+        if (!graph->nodes[index].live)
+            continue;
+
+        keys  [count] = graph->Find(index);
+        values[count] = index;
+        count++;
+    }
+
+    _sortByKey(keys, values, count, size, graph->classStart, graph->classNodes);
+
+    graph->classCount = 0;
+    for (size_t eclass = 0; eclass < size; eclass++)
+        if (graph->classStart[eclass + 1] > graph->classStart[eclass])
+            graph->classCount++;
+
+    count = 0;
+
+    for (size_t index = 0; index < size; index++)
+    {
+        ENode* node = &graph->nodes[index];
+        if (!node->live || node->value.type != OPERATION_TYPE)
+            continue;
+
+        keys  [count] = node->left;
+        values[count] = index;
+        count++;
+
+        if (node->right != SIZET_POISON && node->right != node->left)
+        {
+            keys  [count] = node->right;
+            values[count] = index;
+            count++;
+        }
+    }
+
+    _sortByKey(keys, values, count, size, graph->parentStart, graph->parentNodes);
+
+    count = 0;
+
+    for (size_t index = 0; index < size; index++)
+    {
+        ENode* node = &graph->nodes[index];
+        if (!node->live || node->value.type != OPERATION_TYPE)
+            continue;
+
+        keys  [count] = node->value.value.operation;
+        values[count] = index;
+        count++;
+    }
+
+    _sortByKey(keys, values, count, OPERATION_COUNT, graph->operationStart, graph->operationNodes);
+
+    free(keys);
+    free(values);
+
+    return EVERYTHING_FINE;
+}
+
+// counting sort, the values of key k end up in sorted[start[k]..start[k + 1]) in their order
+static ErrorCode _sortByKey(const size_t* keys, const size_t* values, size_t count, size_t keyCount,
+                            size_t* start, size_t* sorted)
+{
+    memset(start, 0, (keyCount + 1) * sizeof(*start));
+
+    for (size_t i = 0; i < count; i++)
+        start[keys[i] + 1]++;
+
+    for (size_t key = 0; key < keyCount; key++)
+        start[key + 1] += start[key];
+
+    // start[k] is moved to the end of k while filling, then everything is shifted back
+    for (size_t i = 0; i < count; i++)
+        sorted[start[keys[i]]++] = values[i];
+
+    for (size_t key = keyCount; key > 0; key--)
+        start[key] = start[key - 1];
+    start[0] = 0;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _matchRules(EGraph* graph, size_t iteration, _RuleSchedule* schedule, _Matches* matches,
+                             double deadline, bool* banned)
+{
+    for (size_t rule = 0; rule < RULE_COUNT; rule++)
+    {
+        if (schedule[rule].bannedUntil > iteration)
+        {
+            *banned = true;
+            continue;
+        }
+
+        size_t shift = min(schedule[rule].bans, MAX_BAN_SHIFT);
+
+        _Matcher matcher = {};
+        matcher.rule  = rule;
+        matcher.limit = RULE_MATCH_LIMIT << shift;
+
+        size_t before = matches->size;
+
+        RETURN_ERROR(_matchRule(graph, &matcher, matches));
+
+        if (matcher.found > matcher.limit)
+        {
+            matches->size = before;
+
+            schedule[rule].bannedUntil = iteration + (BAN_ITERATIONS << shift);
+            schedule[rule].bans++;
+
+            *banned = true;
+        }
+
+        // what is matched by then is still applied
+        if (_seconds() > deadline)
+            return EVERYTHING_FINE;
+    }
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _matchRule(EGraph* graph, _Matcher* matcher, _Matches* matches)
+{
+    TreeNode* pattern = RULES[matcher->rule].pattern;
+    Operation operation = NODE_OPERATION(pattern);
+
+    TreeNode* patterns[MAX_PATTERN_SIZE + 1] = {};
+    size_t    classes [MAX_PATTERN_SIZE + 1] = {};
+
+    for (size_t i = graph->operationStart[operation];
+         i < graph->operationStart[operation + 1] && matcher->found <= matcher->limit; i++)
+    {
+        ENode* node = &graph->nodes[graph->operationNodes[i]];
+
+        matcher->eclass = graph->Find(graph->operationNodes[i]);
+        for (size_t var = 0; var < RULE_VARIABLE_COUNT; var++)
+            matcher->bound[var] = SIZET_POISON;
+
+        size_t count = 0;
+
+        if (pattern->right)
+        {
+            patterns[count] = pattern->right;
+            classes [count] = node->right;
+            count++;
+        }
+
+        patterns[count] = pattern->left;
+        classes [count] = node->left;
+        count++;
+
+        RETURN_ERROR(_matchPending(graph, matcher, patterns, classes, count, matches));
+    }
+
+    return EVERYTHING_FINE;
+}
+
+// the patterns still to match and their classes, the next pair on top. A frame takes its pair
+// from the top and puts it back before returning, so the stack is shared by all of them.
+static ErrorCode _matchPending(EGraph* graph, _Matcher* matcher, TreeNode** patterns, size_t* classes,
+                               size_t pendingCount, _Matches* matches)
+{
+    if (matcher->found > matcher->limit)
+        return EVERYTHING_FINE;
+
+    if (!pendingCount)
+    {
+        if (!RULES[matcher->rule].guard(graph, matcher->bound))
+            return EVERYTHING_FINE;
+
+        matcher->found++;
+
+        return _pushMatch(matches, matcher);
+    }
+
+    pendingCount--;
+
+    TreeNode* pattern = patterns[pendingCount];
+    size_t    eclass  = classes [pendingCount];
+
+    ErrorCode error = EVERYTHING_FINE;
+
+    switch (NODE_TYPE(pattern))
+    {
+        case VARIABLE_TYPE:
+        {
+            size_t* variable = &matcher->bound[NODE_VAR(pattern) - 'a'];
+
+            // a, b and c stand for numbers
+            if (NODE_VAR(pattern) <= 'c' && !graph->nodes[eclass].isNumber)
+                break;
+
+            if (*variable != SIZET_POISON)
+            {
+                if (*variable == eclass)
+                    error = _matchPending(graph, matcher, patterns, classes, pendingCount, matches);
+                break;
+            }
+
+            *variable = eclass;
+            error = _matchPending(graph, matcher, patterns, classes, pendingCount, matches);
+            *variable = SIZET_POISON;
+            break;
+        }
+        case NUMBER_TYPE:
+            if (graph->nodes[eclass].isNumber && _sameNumber(graph->nodes[eclass].number, NODE_NUMBER(pattern)))
+                error = _matchPending(graph, matcher, patterns, classes, pendingCount, matches);
+            break;
+        case OPERATION_TYPE:
+            for (size_t i = graph->classStart[eclass]; i < graph->classStart[eclass + 1] && !error; i++)
+            {
+                ENode* node = &graph->nodes[graph->classNodes[i]];
+
+                if (node->value.type != OPERATION_TYPE || node->value.value.operation != NODE_OPERATION(pattern))
+                    continue;
+
+                size_t count = pendingCount;
+
+                if (pattern->right)
+                {
+                    patterns[count] = pattern->right;
+                    classes [count] = node->right;
+                    count++;
+                }
+
+                patterns[count] = pattern->left;
+                classes [count] = node->left;
+                count++;
+
+                error = _matchPending(graph, matcher, patterns, classes, count, matches);
+            }
+            break;
+        default:
+            break;
+    }
+
+    patterns[pendingCount] = pattern;
+    classes [pendingCount] = eclass;
+
+    return error;
+}
+
+static ErrorCode _pushMatch(_Matches* matches, _Matcher* matcher)
+{
+    if (matches->size == matches->capacity)
+    {
+        size_t newCapacity = matches->capacity ? matches->capacity * 2 : MATCHES_START_CAPACITY;
+
+        _Match* newMatches = (_Match*)realloc(matches->matches, newCapacity * sizeof(*newMatches));
+        MyAssertSoft(newMatches, ERROR_NO_MEMORY);
+
+        matches->matches  = newMatches;
+        matches->capacity = newCapacity;
+    }
+
+    _Match* match = &matches->matches[matches->size++];
+
+    match->rule   = matcher->rule;
+    match->eclass = matcher->eclass;
+    memcpy(match->bound, matcher->bound, sizeof(match->bound));
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _applyMatches(EGraph* graph, _Matches* matches, size_t nodeLimit, size_t* rewrites, bool* changed)
+{
+    for (size_t i = 0; i < matches->size && graph->size < nodeLimit; i++)
+    {
+        _Match* match = &matches->matches[i];
+
+        size_t eclass = SIZET_POISON;
+        bool added = false;
+
+        RETURN_ERROR(_addPattern(graph, RULES[match->rule].replacement, match->bound, &eclass, &added));
+        RETURN_ERROR(_merge(graph, match->eclass, eclass, changed));
+
+        if (added)
+            *changed = true;
+
+        (*rewrites)++;
+    }
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _reserveCosts(EGraphExtractor* extractor, size_t capacity)
+{
+    if (capacity <= extractor->capacity)
+        return EVERYTHING_FINE;
+
+    size_t newCapacity = max(capacity, 2 * extractor->capacity);
+
+    double* newCosts = (double*)realloc(extractor->costs, newCapacity * sizeof(*newCosts));
+    MyAssertSoft(newCosts, ERROR_NO_MEMORY);
+    extractor->costs = newCosts;
+
+    size_t* newBest = (size_t*)realloc(extractor->best, newCapacity * sizeof(*newBest));
+    MyAssertSoft(newBest, ERROR_NO_MEMORY);
+    extractor->best = newBest;
+
+    for (size_t i = extractor->capacity; i < newCapacity; i++)
+    {
+        extractor->costs[i] = INFINITY;
+        extractor->best [i] = SIZET_POISON;
+    }
+
+    extractor->capacity = newCapacity;
+
+    return EVERYTHING_FINE;
+}
+
+// a node costing more than 0 is more expensive than its operands,
+// so the best nodes never lead back to their own class
+static ErrorCode _relax(EGraphExtractor* extractor, EGraph* graph, size_t node,
+                       size_t* worklist, size_t* worklistSize, bool* queued)
+{
+    ENode* current = &graph->nodes[node];
+
+    const TreeElement* operands[2] = {};
+    size_t classes[2] = { current->left, current->right };
+    double cost = 0;
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        if (classes[i] == SIZET_POISON)
+            continue;
+
+        size_t operand = graph->Find(classes[i]);
+        if (extractor->best[operand] == SIZET_POISON)
+            return EVERYTHING_FINE;
+
+        operands[i] = &graph->nodes[extractor->best[operand]].value;
+        cost += extractor->costs[operand];
+    }
+
+    double nodeCost = extractor->model.nodeCost(extractor->model.data, &current->value, operands[0], operands[1]);
+    MyAssertSoft(nodeCost > 0, ERROR_BAD_VALUE);
+
+    cost += nodeCost;
+
+    size_t eclass = graph->Find(node);
+    if (cost >= extractor->costs[eclass])
+        return EVERYTHING_FINE;
+
+    extractor->costs[eclass] = cost;
+    extractor->best [eclass] = node;
+
+    if (!queued[eclass])
+    {
+        queued[eclass] = true;
+        worklist[(*worklistSize)++] = eclass;
+    }
+
+    return EVERYTHING_FINE;
+}
+
+// the budget keeps a cheap but huge tree from being built
+static TreeNodeResult _buildTree(EGraphExtractor* extractor, EGraph* graph, size_t eclass, size_t* budget)
+{
+    size_t node = extractor->best[graph->Find(eclass)];
+    if (node == SIZET_POISON)
+        return { nullptr, ERROR_NOT_FOUND };
+
+    if (!*budget)
+        return { nullptr, ERROR_BAD_SIZE };
+    (*budget)--;
+
+    ENode current = graph->nodes[node];
+
+    TreeNode* left  = nullptr;
+    TreeNode* right = nullptr;
+
+    if (current.left != SIZET_POISON)
+    {
+        TreeNodeResult leftRes = _buildTree(extractor, graph, current.left, budget);
+        RETURN_ERROR_RESULT(leftRes, nullptr);
+        left = leftRes.value;
+    }
+
+    if (current.right != SIZET_POISON)
+    {
+        TreeNodeResult rightRes = _buildTree(extractor, graph, current.right, budget);
+        RETURN_ERROR_RESULT(rightRes, nullptr, left->Delete());
+        right = rightRes.value;
+    }
+
+    TreeNodeResult nodeRes = TreeNode::New(current.value, left, right);
+    if (nodeRes.error)
+    {
+        if (left)
+            left->Delete();
+        if (right)
+            right->Delete();
+    }
+
+    return nodeRes;
+}
+
+static double _seconds()
+{
+    timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
@@ -0,0 +1,326 @@
+#include <stdlib.h>
+#include <string.h>
+#include "EvalProfiler.hpp"
+#include "LatexWriter.hpp"
+#include "DiffTreeDSL.hpp"
+#include "Sort.hpp"
+
+/** @struct _SubtreeCost
+ * @brief An instruction and the cycles of its subtree, what gets sorted
+ */
+struct _SubtreeCost
+{
+    size_t index;
+    uint64_t cycles;
+};
+
+struct _SubtreeCostsResult
+{
+    _SubtreeCost* value;
+    size_t count;
+    ErrorCode error;
+};
+
+static bool _hasOneArg(Operation operation);
+
+static const char* _operationName(Operation operation);
+
+static int _instructionPriority(const CompiledTree* compiled, size_t index);
+
+static void _accumulateSubtrees(EvalProfile* profile, const CompiledTree* compiled);
+
+static int _compareSubtreeCosts(const void* a, const void* b);
+
+static _SubtreeCostsResult _getHottest(EvalProfile* profile, const CompiledTree* compiled);
+
+static ErrorCode _recWriteInfix(const CompiledTree* compiled, size_t index, FILE* file);
+
+static ErrorCode _writeInfixOperand(const CompiledTree* compiled, size_t index, int priority, bool parenthesizeEqual,
+                                    FILE* file);
+
+ErrorCode EvalProfile::Init(const CompiledTree* compiled)
+{
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+
+    *this = {};
+
+    this->instructionCount = compiled->size;
+
+    this->instructionCycles = (uint64_t*)calloc(compiled->size, sizeof(*this->instructionCycles));
+    MyAssertSoft(this->instructionCycles, ERROR_NO_MEMORY);
+
+    this->subtreeCycles = (uint64_t*)calloc(compiled->size, sizeof(*this->subtreeCycles));
+    MyAssertSoft(this->subtreeCycles, ERROR_NO_MEMORY, this->Destructor());
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode EvalProfile::Reset()
+{
+    MyAssertSoft(this->instructionCycles, ERROR_NULLPTR);
+    MyAssertSoft(this->subtreeCycles, ERROR_NULLPTR);
+
+    this->points = 0;
+
+    memset(this->operationCalls,  0, sizeof(this->operationCalls));
+    memset(this->operationCycles, 0, sizeof(this->operationCycles));
+
+    memset(this->instructionCycles, 0, this->instructionCount * sizeof(*this->instructionCycles));
+    memset(this->subtreeCycles,     0, this->instructionCount * sizeof(*this->subtreeCycles));
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode EvalProfile::Destructor()
+{
+    free(this->instructionCycles);
+    free(this->subtreeCycles);
+
+    *this = {};
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode EvalProfileWrite(EvalProfile* profile, const CompiledTree* compiled, FILE* file, size_t hottestCount)
+{
+    MyAssertSoft(profile, ERROR_NULLPTR);
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+    MyAssertSoft(file, ERROR_BAD_FILE);
+    MyAssertSoft(profile->instructionCount == compiled->size, ERROR_BAD_SIZE);
+
+    uint64_t totalCycles = 0;
+    for (size_t operation = 0; operation < OPERATION_COUNT; operation++)
+        totalCycles += profile->operationCycles[operation];
+
+    double total = totalCycles ? (double)totalCycles : 1;
+
+    fprintf(file, "%zu points, %llu cycles, %.1f cycles per point\n", profile->points,
+            (unsigned long long)totalCycles, (double)totalCycles / (double)(profile->points ? profile->points : 1));
+
+    fprintf(file, "%-8s %12s %14s %12s %8s\n", "op", "calls", "cycles", "cycles/call", "share");
+
+    for (size_t operation = 0; operation < OPERATION_COUNT; operation++)
+    {
+        size_t calls = profile->operationCalls[operation];
+        if (!calls)
+            continue;
+
+        uint64_t cycles = profile->operationCycles[operation];
+
+        fprintf(file, "%-8s %12zu %14llu %12.2f %7.1f%%\n", _operationName((Operation)operation), calls,
+                (unsigned long long)cycles, (double)cycles / (double)calls, 100.0 * (double)cycles / total);
+    }
+
+    _SubtreeCostsResult hottestRes = _getHottest(profile, compiled);
+    RETURN_ERROR(hottestRes.error);
+
+    fprintf(file, "hottest subtrees:\n");
+
+    for (size_t i = 0; i < hottestRes.count && i < hottestCount; i++)
+    {
+        fprintf(file, "%7.1f%%  ", 100.0 * (double)hottestRes.value[i].cycles / total);
+        RETURN_ERROR(_recWriteInfix(compiled, hottestRes.value[i].index, file), free(hottestRes.value));
+        fprintf(file, "\n");
+    }
+
+    free(hottestRes.value);
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode EvalProfileWriteTex(EvalProfile* profile, const CompiledTree* compiled, FILE* texFile,
+                              size_t hottestCount)
+{
+    MyAssertSoft(profile, ERROR_NULLPTR);
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+    MyAssertSoft(texFile, ERROR_BAD_FILE);
+    MyAssertSoft(profile->instructionCount == compiled->size, ERROR_BAD_SIZE);
+
+    uint64_t totalCycles = 0;
+    for (size_t operation = 0; operation < OPERATION_COUNT; operation++)
+        totalCycles += profile->operationCycles[operation];
+
+    double total = totalCycles ? (double)totalCycles : 1;
+
+    _SubtreeCostsResult hottestRes = _getHottest(profile, compiled);
+    RETURN_ERROR(hottestRes.error);
+
+    fprintf(texFile, "Дольше всего вычисляются\n\\newline\n");
+
+    for (size_t i = 0; i < hottestRes.count && i < hottestCount; i++)
+    {
+        TreeNodeResult nodeRes = compiled->BuildNode(hottestRes.value[i].index);
+        RETURN_ERROR(nodeRes.error, free(hottestRes.value));
+
+        fprintf(texFile, "\\[");
+        ErrorCode error = LatexWrite(nodeRes.value, texFile);
+        fprintf(texFile, "\\quad %.1f\\%%\\]\n", 100.0 * (double)hottestRes.value[i].cycles / total);
+
+        nodeRes.value->Delete();
+        RETURN_ERROR(error, free(hottestRes.value));
+    }
+
+    free(hottestRes.value);
+
+    return EVERYTHING_FINE;
+}
+
+static bool _hasOneArg(Operation operation)
+{
+    switch (operation)
+    {
+        #define DEF_FUNC(name, priority, hasOneArg, ...)                        \
+        case name:                                                              \
+            return hasOneArg;
+
+        #include "DiffFunctions.hpp"
+
+        #undef DEF_FUNC
+
+        default:
+            return false;
+    }
+}
+
+static const char* _operationName(Operation operation)
+{
+    switch (operation)
+    {
+        #define DEF_FUNC(name, priority, hasOneArg, string, ...)                \
+        case name:                                                              \
+            return string;
+
+        #include "DiffFunctions.hpp"
+
+        #undef DEF_FUNC
+
+        default:
+            return "?";
+    }
+}
+
+static int _instructionPriority(const CompiledTree* compiled, size_t index)
+{
+    const CompiledInstruction* instruction = &compiled->instructions[index];
+
+    if (instruction->type != OPERATION_TYPE)
+        return INT32_MAX;
+
+    switch (instruction->operation)
+    {
+        #define DEF_FUNC(name, priority, ...)                                   \
+        case name:                                                              \
+            return priority;
+
+        #include "DiffFunctions.hpp"
+
+        #undef DEF_FUNC
+
+        default:
+            return INT32_MAX;
+    }
+}
+
+// operands come before the instruction, so one pass in order is enough
+static void _accumulateSubtrees(EvalProfile* profile, const CompiledTree* compiled)
+{
+    for (size_t i = 0; i < compiled->size; i++)
+    {
+        const CompiledInstruction* instruction = &compiled->instructions[i];
+
+        profile->subtreeCycles[i] = profile->instructionCycles[i];
+
+        if (instruction->type != OPERATION_TYPE)
+            continue;
+
+        profile->subtreeCycles[i] += profile->subtreeCycles[instruction->left];
+        if (!_hasOneArg(instruction->operation))
+            profile->subtreeCycles[i] += profile->subtreeCycles[instruction->right];
+    }
+}
+
+static int _compareSubtreeCosts(const void* a, const void* b)
+{
+    uint64_t first  = ((const _SubtreeCost*)a)->cycles;
+    uint64_t second = ((const _SubtreeCost*)b)->cycles;
+
+    return (first < second) - (first > second);
+}
+
+// operation instructions by subtree cycles, most expensive first
+static _SubtreeCostsResult _getHottest(EvalProfile* profile, const CompiledTree* compiled)
+{
+    _accumulateSubtrees(profile, compiled);
+
+    _SubtreeCost* costs = (_SubtreeCost*)calloc(compiled->size, sizeof(*costs));
+    if (!costs)
+        return { nullptr, 0, ERROR_NO_MEMORY };
+
+    size_t count = 0;
+    for (size_t i = 0; i < compiled->size; i++)
+        if (compiled->instructions[i].type == OPERATION_TYPE)
+            costs[count++] = { i, profile->subtreeCycles[i] };
+
+    Sort(costs, count, sizeof(*costs), _compareSubtreeCosts);
+
+    return { costs, count, EVERYTHING_FINE };
+}
+
+static ErrorCode _recWriteInfix(const CompiledTree* compiled, size_t index, FILE* file)
+{
+    const CompiledInstruction* instruction = &compiled->instructions[index];
+
+    switch (instruction->type)
+    {
+        case NUMBER_TYPE:
+            fprintf(file, "%lg", instruction->number);
+            return EVERYTHING_FINE;
+        case VARIABLE_TYPE:
+            fprintf(file, "%c", compiled->variables[instruction->variable]);
+            return EVERYTHING_FINE;
+        case OPERATION_TYPE:
+            break;
+        default:
+            return ERROR_BAD_VALUE;
+    }
+
+    const char* name = _operationName(instruction->operation);
+
+    if (_hasOneArg(instruction->operation))
+    {
+        fprintf(file, "%s(", name);
+        RETURN_ERROR(_recWriteInfix(compiled, instruction->left, file));
+        fprintf(file, ")");
+
+        return EVERYTHING_FINE;
+    }
+
+    int priority = _instructionPriority(compiled, index);
+
+    // a - (b - c), a / (b * c) and (a ^ b) ^ c need the brackets
+    bool leftAssociative = instruction->operation == SUB_OPERATION || instruction->operation == DIV_OPERATION;
+
+    RETURN_ERROR(_writeInfixOperand(compiled, instruction->left, priority,
+                                    instruction->operation == POWER_OPERATION, file));
+    fprintf(file, " %s ", name);
+    RETURN_ERROR(_writeInfixOperand(compiled, instruction->right, priority, leftAssociative, file));
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _writeInfixOperand(const CompiledTree* compiled, size_t index, int priority, bool parenthesizeEqual,
+                                    FILE* file)
+{
+    int operandPriority = _instructionPriority(compiled, index);
+
+    if (operandPriority < priority || (parenthesizeEqual && operandPriority == priority))
+    {
+        fprintf(file, "(");
+        RETURN_ERROR(_recWriteInfix(compiled, index, file));
+        fprintf(file, ")");
+    }
+    else
+        RETURN_ERROR(_recWriteInfix(compiled, index, file));
+
+    return EVERYTHING_FINE;
+}
@@ -0,0 +1,612 @@
+#include <math.h>
+#include <string.h>
+#include "Evaluator.hpp"
+#include "MinMax.hpp"
+#include "VectorMath.hpp"
+
+/** @struct _Dual
+ * @brief A value and its derivative along the variable of the current hessian column
+ */
+struct _Dual
+{
+    double value;
+    double tangent;
+};
+
+static inline double _evalOperation(Operation operation, double left, double right);
+
+static ErrorCode _evalPoint(CompiledTree* compiled, const double* point, double* values);
+
+static double _localPartials(const CompiledInstruction* instruction, const double* values, const double* tangents,
+                             double result, _Dual* byLeft, _Dual* byRight);
+
+static bool _hasOneArg(Operation operation);
+
+static ErrorCode _evalRegisters(CompiledTree* compiled, double var);
+
+static void _evalBlock(CompiledTree* compiled, const double* vars, size_t count, EvalProfile* profile);
+
+static void _evalOperationBlock(Operation operation, const double* left, const double* right,
+                                double* out, size_t count);
+
+EvalResult Evaluate(CompiledTree* compiled, double var)
+{
+    MyAssertSoftResult(compiled, NAN, ERROR_NULLPTR);
+    MyAssertSoftResult(compiled->instructions, NAN, ERROR_NULLPTR);
+
+    ErrorCode error = _evalRegisters(compiled, var);
+    if (error)
+        return { NAN, error };
+
+    return { ((double*)compiled->scratch)[compiled->output], EVERYTHING_FINE };
+}
+
+ErrorCode EvaluateMany(CompiledTree* compiled, double var, double* results)
+{
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+    MyAssertSoft(compiled->instructions, ERROR_NULLPTR);
+    MyAssertSoft(results, ERROR_NULLPTR);
+
+    ErrorCode error = _evalRegisters(compiled, var);
+
+    const double* registers = (const double*)compiled->scratch;
+    for (size_t i = 0; i < compiled->outputCount; i++)
+        results[i] = error ? NAN : registers[compiled->outputs[i]];
+
+    return error;
+}
+
+static ErrorCode _evalRegisters(CompiledTree* compiled, double var)
+{
+    double* registers = (double*)compiled->scratch;
+
+    for (size_t i = 0; i < compiled->size; i++)
+    {
+        CompiledInstruction* instruction = &compiled->instructions[i];
+
+        switch (instruction->type)
+        {
+            case NUMBER_TYPE:
+                registers[i] = instruction->number;
+                break;
+            case VARIABLE_TYPE:
+                registers[i] = var;
+                break;
+            case OPERATION_TYPE:
+                if (instruction->operation == DIV_OPERATION && IsEqual(registers[instruction->right], 0))
+                    return ERROR_ZERO_DIVISION;
+
+                registers[i] = _evalOperation(instruction->operation,
+                                              registers[instruction->left], registers[instruction->right]);
+                break;
+            default:
+                return ERROR_BAD_VALUE;
+        }
+    }
+
+    return EVERYTHING_FINE;
+}
+
+EvalResult EvaluateDerivative(CompiledTree* compiled, char variable, double var)
+{
+    MyAssertSoftResult(compiled, NAN, ERROR_NULLPTR);
+    MyAssertSoftResult(compiled->instructions, NAN, ERROR_NULLPTR);
+
+    ErrorCode error = _evalRegisters(compiled, var);
+    if (error)
+        return { NAN, error };
+
+    double* values   = (double*)compiled->scratch;
+    double* tangents = values + compiled->size;
+
+    for (size_t i = 0; i < compiled->size; i++)
+    {
+        const CompiledInstruction* instruction = &compiled->instructions[i];
+
+        _Dual byLeft = {}, byRight = {};
+
+        switch (instruction->type)
+        {
+            case VARIABLE_TYPE:
+                tangents[i] = compiled->variables[instruction->variable] == variable;
+                break;
+            case OPERATION_TYPE:
+                tangents[i] = _localPartials(instruction, values, tangents, values[i], &byLeft, &byRight);
+                break;
+            case NUMBER_TYPE:
+            default:
+                tangents[i] = 0;
+                break;
+        }
+    }
+
+    return { tangents[compiled->output], EVERYTHING_FINE };
+}
+
+ErrorCode EvaluateHessian(CompiledTree* compiled, const double* point, double* gradient, double* hessian)
+{
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+    MyAssertSoft(compiled->instructions, ERROR_NULLPTR);
+    MyAssertSoft(point, ERROR_NULLPTR);
+    MyAssertSoft(hessian, ERROR_NULLPTR);
+
+    size_t size  = compiled->size;
+    size_t count = compiled->variableCount;
+
+    double* registers = (double*)calloc(4 * size, sizeof(*registers));
+    MyAssertSoft(registers, ERROR_NO_MEMORY);
+
+    double* values          = registers;
+    double* tangents        = registers + size;
+    double* adjoints        = registers + 2 * size;
+    double* adjointTangents = registers + 3 * size;
+
+    for (size_t i = 0; i < count * count; i++)
+        hessian[i] = 0;
+    for (size_t i = 0; gradient && i < count; i++)
+        gradient[i] = 0;
+
+    ErrorCode error = _evalPoint(compiled, point, values);
+
+    for (size_t column = 0; column < count && !error; column++)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            const CompiledInstruction* instruction = &compiled->instructions[i];
+
+            _Dual byLeft = {}, byRight = {};
+
+            switch (instruction->type)
+            {
+                case VARIABLE_TYPE:
+                    tangents[i] = instruction->variable == column;
+                    break;
+                case OPERATION_TYPE:
+                    tangents[i] = _localPartials(instruction, values, tangents, values[i], &byLeft, &byRight);
+                    break;
+                case NUMBER_TYPE:
+                default:
+                    tangents[i] = 0;
+                    break;
+            }
+        }
+
+        memset(adjoints, 0, 2 * size * sizeof(*adjoints));
+        adjoints[compiled->output] = 1;
+
+        // operands go before their operations, so going back visits every operation after all its users
+        for (size_t i = size; i-- > 0;)
+        {
+            const CompiledInstruction* instruction = &compiled->instructions[i];
+
+            if (instruction->type != OPERATION_TYPE || (adjoints[i] == 0 && adjointTangents[i] == 0))
+                continue;
+
+            _Dual byLeft = {}, byRight = {};
+            _localPartials(instruction, values, tangents, values[i], &byLeft, &byRight);
+
+            adjoints[instruction->left]        += adjoints[i] * byLeft.value;
+            adjointTangents[instruction->left] += adjointTangents[i] * byLeft.value + adjoints[i] * byLeft.tangent;
+
+            if (!_hasOneArg(instruction->operation))
+            {
+                adjoints[instruction->right]        += adjoints[i] * byRight.value;
+                adjointTangents[instruction->right] += adjointTangents[i] * byRight.value +
+                                                       adjoints[i] * byRight.tangent;
+            }
+        }
+
+        for (size_t i = 0; i < size; i++)
+        {
+            const CompiledInstruction* instruction = &compiled->instructions[i];
+            if (instruction->type != VARIABLE_TYPE)
+                continue;
+
+            hessian[instruction->variable * count + column] += adjointTangents[i];
+
+            if (gradient && column == 0)
+                gradient[instruction->variable] += adjoints[i];
+        }
+    }
+
+    free(registers);
+
+    if (error)
+    {
+        for (size_t i = 0; i < count * count; i++)
+            hessian[i] = NAN;
+        for (size_t i = 0; gradient && i < count; i++)
+            gradient[i] = NAN;
+    }
+
+    return error;
+}
+
+ErrorCode EvaluateJacobian(Jacobian* jacobian, const double* point, double* values, double* matrix)
+{
+    MyAssertSoft(jacobian, ERROR_NULLPTR);
+    MyAssertSoft(jacobian->compiled.instructions, ERROR_NULLPTR);
+    MyAssertSoft(point, ERROR_NULLPTR);
+    MyAssertSoft(matrix, ERROR_NULLPTR);
+
+    CompiledTree* compiled = &jacobian->compiled;
+    double* registers = (double*)compiled->scratch;
+
+    ErrorCode error = _evalPoint(compiled, point, registers);
+
+    for (size_t row = 0; row < jacobian->rows; row++)
+    {
+        if (values)
+            values[row] = error ? NAN : registers[compiled->outputs[row]];
+
+        for (size_t column = 0; column < jacobian->columns; column++)
+        {
+            size_t output = jacobian->entries[row * jacobian->columns + column];
+
+            double entry = output == SIZET_POISON ? 0 : registers[compiled->outputs[output]];
+
+            matrix[row * jacobian->columns + column] = error ? NAN : entry;
+        }
+    }
+
+    return error;
+}
+
+static ErrorCode _evalPoint(CompiledTree* compiled, const double* point, double* values)
+{
+    for (size_t i = 0; i < compiled->size; i++)
+    {
+        CompiledInstruction* instruction = &compiled->instructions[i];
+
+        switch (instruction->type)
+        {
+            case NUMBER_TYPE:
+                values[i] = instruction->number;
+                break;
+            case VARIABLE_TYPE:
+                values[i] = point[instruction->variable];
+                break;
+            case OPERATION_TYPE:
+                if (instruction->operation == DIV_OPERATION && IsEqual(values[instruction->right], 0))
+                    return ERROR_ZERO_DIVISION;
+
+                values[i] = _evalOperation(instruction->operation,
+                                           values[instruction->left], values[instruction->right]);
+                break;
+            default:
+                return ERROR_BAD_VALUE;
+        }
+    }
+
+    return EVERYTHING_FINE;
+}
+
+// partial derivatives of the operation by its operands with their derivatives along the column,
+// returns the derivative of the result along the column
+static double _localPartials(const CompiledInstruction* instruction, const double* values, const double* tangents,
+                             double result, _Dual* byLeft, _Dual* byRight)
+{
+    double x  = values[instruction->left];
+    double dx = tangents[instruction->left];
+    double y  = 0;
+    double dy = 0;
+
+    if (!_hasOneArg(instruction->operation))
+    {
+        y  = values[instruction->right];
+        dy = tangents[instruction->right];
+    }
+
+    *byLeft  = {};
+    *byRight = {};
+
+    switch (instruction->operation)
+    {
+        case ADD_OPERATION:
+            *byLeft  = { 1, 0 };
+            *byRight = { 1, 0 };
+            break;
+        case SUB_OPERATION:
+            *byLeft  = { 1, 0 };
+            *byRight = { -1, 0 };
+            break;
+        case MUL_OPERATION:
+            *byLeft  = { y, dy };
+            *byRight = { x, dx };
+            break;
+        case DIV_OPERATION:
+            *byLeft  = { 1 / y, -dy / (y * y) };
+            *byRight = { -x / (y * y), -dx / (y * y) + 2 * x * dy / (y * y * y) };
+            break;
+        case POWER_OPERATION:
+        {
+            double xPowYMinusOne = pow(x, y - 1);
+            double lnx = log(x);
+
+            byLeft->value   = y * xPowYMinusOne;
+            byLeft->tangent = IsEqual(y, 1) ? 0 : y * (y - 1) * pow(x, y - 2) * dx;
+
+            // ln of a negative base only goes to the exponent, it is not let into
+            // the tangents when the exponent is constant along the column
+            if (dy != 0)
+                byLeft->tangent += dy * xPowYMinusOne * (1 + y * lnx);
+
+            double tangent = byLeft->value * dx + (dy == 0 ? 0 : result * lnx * dy);
+
+            *byRight = { result * lnx, tangent * lnx + result * dx / x };
+
+            return tangent;
+        }
+        case SIN_OPERATION:
+            *byLeft = { cos(x), -sin(x) * dx };
+            break;
+        case COS_OPERATION:
+            *byLeft = { -sin(x), -cos(x) * dx };
+            break;
+        case TAN_OPERATION:
+        {
+            double cosx = cos(x);
+            *byLeft = { 1 / (cosx * cosx), 2 * sin(x) / (cosx * cosx * cosx) * dx };
+            break;
+        }
+        case ARC_SIN_OPERATION:
+        case ARC_COS_OPERATION:
+        {
+            double oneSubXSqr = 1 - x * x;
+            double sign = instruction->operation == ARC_SIN_OPERATION ? 1 : -1;
+
+            *byLeft = { sign / sqrt(oneSubXSqr), sign * x / (oneSubXSqr * sqrt(oneSubXSqr)) * dx };
+            break;
+        }
+        case ARC_TAN_OPERATION:
+        {
+            double onePlusXSqr = 1 + x * x;
+            *byLeft = { 1 / onePlusXSqr, -2 * x / (onePlusXSqr * onePlusXSqr) * dx };
+            break;
+        }
+        case EXP_OPERATION:
+            *byLeft = { result, result * dx };
+            break;
+        case LN_OPERATION:
+            *byLeft = { 1 / x, -dx / (x * x) };
+            break;
+        default:
+            *byLeft = { NAN, NAN };
+            return NAN;
+    }
+
+    return byLeft->value * dx + (dy == 0 ? 0 : byRight->value * dy);
+}
+
+static bool _hasOneArg(Operation operation)
+{
+    switch (operation)
+    {
+        #define DEF_FUNC(name, priority, hasOneArg, ...)                        \
+        case name:                                                              \
+            return hasOneArg;
+
+        #include "DiffFunctions.hpp"
+
+        #undef DEF_FUNC
+
+        default:
+            return false;
+    }
+}
+
+ErrorCode EvaluateBatch(CompiledTree* compiled, const double* vars, double* results, size_t count)
+{
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+    MyAssertSoft(compiled->instructions, ERROR_NULLPTR);
+    MyAssertSoft(vars, ERROR_NULLPTR);
+    MyAssertSoft(results, ERROR_NULLPTR);
+
+    const double* out = (const double*)compiled->scratch + compiled->output * EVAL_BLOCK_SIZE;
+
+    for (size_t start = 0; start < count; start += EVAL_BLOCK_SIZE)
+    {
+        size_t blockSize = min(EVAL_BLOCK_SIZE, count - start);
+
+        _evalBlock(compiled, vars + start, blockSize, nullptr);
+
+        for (size_t point = 0; point < blockSize; point++)
+            results[start + point] = out[point];
+    }
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode EvaluateManyBatch(CompiledTree* compiled, const double* vars, double* results, size_t count)
+{
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+    MyAssertSoft(compiled->instructions, ERROR_NULLPTR);
+    MyAssertSoft(vars, ERROR_NULLPTR);
+    MyAssertSoft(results, ERROR_NULLPTR);
+
+    const double* registers = (const double*)compiled->scratch;
+
+    for (size_t start = 0; start < count; start += EVAL_BLOCK_SIZE)
+    {
+        size_t blockSize = min(EVAL_BLOCK_SIZE, count - start);
+
+        _evalBlock(compiled, vars + start, blockSize, nullptr);
+
+        for (size_t i = 0; i < compiled->outputCount; i++)
+        {
+            const double* out = registers + compiled->outputs[i] * EVAL_BLOCK_SIZE;
+
+            for (size_t point = 0; point < blockSize; point++)
+                results[i * count + start + point] = out[point];
+        }
+    }
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode EvaluateBatchProfiled(CompiledTree* compiled, const double* vars, double* results, size_t count,
+                                EvalProfile* profile)
+{
+    MyAssertSoft(compiled, ERROR_NULLPTR);
+    MyAssertSoft(compiled->instructions, ERROR_NULLPTR);
+    MyAssertSoft(vars, ERROR_NULLPTR);
+    MyAssertSoft(results, ERROR_NULLPTR);
+    MyAssertSoft(profile, ERROR_NULLPTR);
+    MyAssertSoft(profile->instructionCount == compiled->size, ERROR_BAD_SIZE);
+
+    const double* out = (const double*)compiled->scratch + compiled->output * EVAL_BLOCK_SIZE;
+
+    for (size_t start = 0; start < count; start += EVAL_BLOCK_SIZE)
+    {
+        size_t blockSize = min(EVAL_BLOCK_SIZE, count - start);
+
+        _evalBlock(compiled, vars + start, blockSize, profile);
+
+        for (size_t point = 0; point < blockSize; point++)
+            results[start + point] = out[point];
+    }
+
+    profile->points += count;
+
+    return EVERYTHING_FINE;
+}
+
+// the profile is optional, the check costs nothing next to a block of 64 points
+static void _evalBlock(CompiledTree* compiled, const double* vars, size_t count, EvalProfile* profile)
+{
+    double* registers = (double*)compiled->scratch;
+
+    for (size_t i = 0; i < compiled->size; i++)
+    {
+        CompiledInstruction* instruction = &compiled->instructions[i];
+        double* out = registers + i * EVAL_BLOCK_SIZE;
+
+        switch (instruction->type)
+        {
+            case NUMBER_TYPE:
+                for (size_t point = 0; point < count; point++)
+                    out[point] = instruction->number;
+                break;
+            case VARIABLE_TYPE:
+                for (size_t point = 0; point < count; point++)
+                    out[point] = vars[point];
+                break;
+            case OPERATION_TYPE:
+            {
+                const double* left  = registers + instruction->left  * EVAL_BLOCK_SIZE;
+                const double* right = registers + instruction->right * EVAL_BLOCK_SIZE;
+
+                if (!profile)
+                {
+                    _evalOperationBlock(instruction->operation, left, right, out, count);
+                    break;
+                }
+
+                uint64_t start = ProfilerTicks();
+                _evalOperationBlock(instruction->operation, left, right, out, count);
+                uint64_t cycles = ProfilerTicks() - start;
+
+                profile->instructionCycles[i] += cycles;
+                profile->operationCycles[instruction->operation] += cycles;
+                profile->operationCalls [instruction->operation] += count;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+#define EVAL_LOOP(expression)                                           \
+do                                                                      \
+{                                                                       \
+    for (size_t point = 0; point < count; point++)                      \
+        out[point] = expression;                                        \
+} while (0)
+
+static void _evalOperationBlock(Operation operation, const double* left, const double* right,
+                                double* out, size_t count)
+{
+    switch (operation)
+    {
+        case ADD_OPERATION:
+            EVAL_LOOP(left[point] + right[point]);
+            break;
+        case SUB_OPERATION:
+            EVAL_LOOP(left[point] - right[point]);
+            break;
+        case MUL_OPERATION:
+            EVAL_LOOP(left[point] * right[point]);
+            break;
+        case DIV_OPERATION:
+            EVAL_LOOP(IsEqual(right[point], 0) ? NAN : left[point] / right[point]);
+            break;
+        case POWER_OPERATION:
+            EVAL_LOOP(pow(left[point], right[point]));
+            break;
+        case SIN_OPERATION:
+            VecSin(left, out, count);
+            break;
+        case COS_OPERATION:
+            VecCos(left, out, count);
+            break;
+        case TAN_OPERATION:
+            VecTan(left, out, count);
+            break;
+        case ARC_SIN_OPERATION:
+            VecArcsin(left, out, count);
+            break;
+        case ARC_COS_OPERATION:
+            VecArccos(left, out, count);
+            break;
+        case ARC_TAN_OPERATION:
+            VecArctan(left, out, count);
+            break;
+        case EXP_OPERATION:
+            VecExp(left, out, count);
+            break;
+        case LN_OPERATION:
+            VecLn(left, out, count);
+            break;
+        default:
+            EVAL_LOOP(NAN);
+            break;
+    }
+}
+
+#undef EVAL_LOOP
+
+static inline double _evalOperation(Operation operation, double left, double right)
+{
+    switch (operation)
+    {
+        case ADD_OPERATION:
+            return left + right;
+        case SUB_OPERATION:
+            return left - right;
+        case MUL_OPERATION:
+            return left * right;
+        case DIV_OPERATION:
+            return left / right;
+        case POWER_OPERATION:
+            return pow(left, right);
+        case SIN_OPERATION:
+            return sin(left);
+        case COS_OPERATION:
+            return cos(left);
+        case TAN_OPERATION:
+            return tan(left);
+        case ARC_SIN_OPERATION:
+            return asin(left);
+        case ARC_COS_OPERATION:
+            return acos(left);
+        case ARC_TAN_OPERATION:
+            return atan(left);
+        case EXP_OPERATION:
+            return exp(left);
+        case LN_OPERATION:
+            return log(left);
+        default:
+            return NAN;
+    }
+}
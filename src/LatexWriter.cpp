@@ -3,6 +3,7 @@
 #include "DiffTreeDSL.hpp"
 #include "FunnyMathComments.hpp"
 #include "LatexWriter.hpp"
+#include "Differentiator.hpp"
 
 static const size_t MAX_FILE_LENGTH = 256;
 static const size_t MAX_COMMAND_LENGTH = 512;
@@ -93,6 +94,9 @@ ErrorCode _recTexWrite(TreeNode* node, FILE* texFile)
             break;
         case OPERATION_TYPE:
             return _recTexWriteOperation(node, texFile);
+        case DERIVATIVE_TYPE:
+            RETURN_ERROR(ExpandDerivative(node));
+            return _recTexWrite(node, texFile);
         default:
             return ERROR_BAD_VALUE;
     }
@@ -185,6 +189,9 @@ ErrorCode _printSubExpression(TreeNode* node, int priority, FILE* texFile)
     MyAssertHard(node, ERROR_NULLPTR);
     MyAssertSoft(texFile, ERROR_BAD_FILE);
 
+    // the priority is known only after the expansion
+    RETURN_ERROR(ExpandDerivative(node));
+
     if (NODE_TYPE(node) == OPERATION_TYPE && node->value.priority < priority)
     {
         fprintf(texFile, "(");
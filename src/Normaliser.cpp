@@ -0,0 +1,1380 @@
+#include <math.h>
+#include <string.h>
+#include "Normaliser.hpp"
+#include "DiffTreeDSL.hpp"
+#include "Sort.hpp"
+#include "MinMax.hpp"
+
+static const size_t MAX_TERM_FACTORS     = 8;
+static const size_t MAX_POLYNOMIAL_TERMS = 64;
+static const size_t MAX_PRODUCT_TERMS    = 1024;
+static const double MAX_EXPONENT         = 64;
+static const long   MAX_EXPANDED_POWER   = 16;
+
+static const size_t POLYNOMIAL_START_CAPACITY = 4;
+static const size_t ATOMS_START_CAPACITY      = 16;
+static const size_t REPLACED_START_CAPACITY   = 8;
+
+/** @struct _Factor
+ * @brief An atom in an integer power, the power is never 0
+ *
+ * @var _Factor::key - the key of the atom, factors and terms are ordered by the keys
+ * @var _Factor::atom - index of the atom
+ * @var _Factor::exponent - the power
+ */
+struct _Factor
+{
+    size_t key;
+    size_t atom;
+    long exponent;
+};
+
+/** @struct _Term
+ * @brief A number times the factors, the factors go by @ref _factorBefore
+ */
+struct _Term
+{
+    double coefficient;
+    size_t factorCount;
+    _Factor factors[MAX_TERM_FACTORS];
+};
+
+/** @struct _Polynomial
+ * @brief Sum of terms in the order of @ref _compareTerms, like terms collected and no zero terms,
+ * so 0 has no terms at all
+ */
+struct _Polynomial
+{
+    _Term* terms;
+    size_t size;
+    size_t capacity;
+};
+
+/** @struct _Atom
+ * @brief A subtree the normal form does not look into
+ *
+ * @var _Atom::node - the subtree
+ * @var _Atom::key - the same for equal subtrees wherever they are, so the order of the atoms
+ * and the normal form do not depend on which atom is met first
+ * @var _Atom::owned - node is not a part of the tree but a sum built for a denominator
+ * @var _Atom::sum - the polynomial of the sum, to cancel it against numerators
+ */
+struct _Atom
+{
+    TreeNode* node;
+    size_t key;
+    bool owned;
+    _Polynomial sum;
+};
+
+/** @struct _Atoms
+ * @brief Atoms of one part of the tree, equal subtrees are one atom
+ */
+struct _Atoms
+{
+    _Atom* atoms;
+    size_t size;
+    size_t capacity;
+};
+
+/** @struct _Groups
+ * @brief Terms of a polynomial over the same denominator
+ *
+ * @var _Groups::leader - leader[i] is the first term over the same denominator as the term i
+ * @var _Groups::size - size[i] is how many terms the group of the first term i has
+ */
+struct _Groups
+{
+    size_t leader[MAX_POLYNOMIAL_TERMS];
+    size_t size[MAX_POLYNOMIAL_TERMS];
+};
+
+/** @struct _Unchanged
+ * @brief Tells which subtrees are in the normal form already, see @ref NormaliseChanged
+ *
+ * @var _Unchanged::isNormal - the check, nullptr if no subtree is known to be normal
+ * @var _Unchanged::data - passed to the check
+ */
+struct _Unchanged
+{
+    IsNormal_t* isNormal;
+    void* data;
+};
+
+/** @struct _Part
+ * @brief A part of the tree made of polynomial operations
+ *
+ * @var _Part::atoms - atoms of the part
+ * @var _Part::replaced - old subtrees of the rewritten nodes, deleted with the part
+ * @var _Part::observer - what is told about the rewritten nodes
+ * @var _Part::unchanged - the subtrees that are only converted
+ */
+struct _Part
+{
+    _Atoms atoms;
+    TreeNode** replaced;
+    size_t replacedCount;
+    size_t replacedCapacity;
+    StepObserver* observer;
+    _Unchanged unchanged;
+};
+
+static ErrorCode _normaliseNode(TreeNode* node, _Unchanged unchanged, StepObserver* observer);
+static bool _isUnchanged(_Unchanged unchanged, TreeNode* node);
+static ErrorCode _normalisePart(TreeNode* node, _Part* part, _Polynomial* result);
+static bool _isPolynomialOperation(TreeNode* node);
+static ErrorCode _replaceNode(_Part* part, TreeNode* node, TreeNode* replacement);
+static void _destroyPart(_Part* part);
+
+static ErrorCode _toPolynomial(TreeNode* node, _Atoms* atoms, _Polynomial* result);
+static ErrorCode _combinePolynomials(TreeNode* node, _Polynomial* left, _Polynomial* right,
+                                     _Atoms* atoms, _Polynomial* result);
+static ErrorCode _powerPolynomial(_Polynomial* base, long exponent, _Polynomial* result);
+static ErrorCode _toTerm(TreeNode* node, _Atoms* atoms, _Term* result);
+static ErrorCode _polynomialTerm(TreeNode* node, _Polynomial* polynomial, _Atoms* atoms, _Term* result);
+static ErrorCode _divideByTerm(_Polynomial* numerator, _Term* denominator, _Atoms* atoms, _Polynomial* result);
+
+static ErrorCode _initPolynomial(_Polynomial* polynomial);
+static void _destroyPolynomial(_Polynomial* polynomial);
+static ErrorCode _pushTerm(_Polynomial* polynomial, _Term* term);
+static ErrorCode _collectTerms(_Polynomial* polynomial);
+static ErrorCode _constantPolynomial(double number, _Polynomial* result);
+static ErrorCode _termPolynomial(_Term* term, _Polynomial* result);
+static ErrorCode _addPolynomials(_Polynomial* first, _Polynomial* second, double sign, _Polynomial* result);
+static ErrorCode _mulPolynomials(_Polynomial* first, _Polynomial* second, _Polynomial* result);
+static bool _divideExactly(_Polynomial* dividend, _Polynomial* divisor, _Term* quotient);
+static bool _samePolynomial(_Polynomial* first, _Polynomial* second);
+
+static ErrorCode _mulTerms(_Term* first, _Term* second, long secondSign, _Term* result);
+static ErrorCode _powerTerm(_Term* term, long exponent, _Term* result);
+static int _compareTerms(const void* first, const void* second);
+static long _degree(_Term* term);
+static bool _sameDenominator(_Term* first, _Term* second);
+static bool _factorBefore(_Factor* first, _Factor* second);
+
+static ErrorCode _atomTerm(TreeNode* node, _Atoms* atoms, _Term* result);
+static ErrorCode _sumAtomTerm(_Polynomial* sum, _Atoms* atoms, _Term* result);
+static ErrorCode _commonFactors(_Term* first, _Term* second, _Term* result);
+static ErrorCode _pushAtom(_Atoms* atoms, _Atom atom, size_t* index);
+static void _destroyAtoms(_Atoms* atoms);
+static bool _sameSubtree(TreeNode* first, TreeNode* second);
+static size_t _subtreeKey(TreeNode* node);
+
+static size_t _normalSize(_Polynomial* polynomial, _Atoms* atoms, bool* overCommon);
+static bool _commonDenominator(_Polynomial* polynomial, _Term* denominator, _Polynomial* numerator);
+static void _groupTerms(_Polynomial* polynomial, _Groups* groups);
+static double _termSign(_Polynomial* polynomial, _Groups* groups, size_t index);
+static size_t _groupsSize(_Polynomial* polynomial, _Atoms* atoms);
+static size_t _termSize(_Term* term, double sign, _Atoms* atoms);
+static size_t _factorsSize(_Term* term, long sign, _Atoms* atoms);
+
+static TreeNodeResult _buildPolynomial(_Polynomial* polynomial, _Atoms* atoms);
+static TreeNodeResult _buildGroups(_Polynomial* polynomial, _Atoms* atoms);
+static TreeNodeResult _buildGroup(_Polynomial* polynomial, _Groups* groups, size_t leader, _Atoms* atoms);
+static TreeNodeResult _buildTerm(_Term* term, double sign, _Atoms* atoms);
+static TreeNodeResult _buildFactors(_Term* term, long sign, _Atoms* atoms);
+static TreeNodeResult _newOperation(Operation operation, TreeNode* left, TreeNode* right);
+static TreeNodeResult _newNumber(double number);
+
+ErrorCode Normalise(Tree* tree, StepObserver* observer)
+{
+    MyAssertSoft(tree, ERROR_NULLPTR);
+
+    return _normaliseNode(tree->root, {}, observer);
+}
+
+ErrorCode NormaliseChanged(Tree* tree, IsNormal_t* isNormal, void* data, StepObserver* observer)
+{
+    MyAssertSoft(tree, ERROR_NULLPTR);
+    MyAssertSoft(isNormal, ERROR_NULLPTR);
+
+    return _normaliseNode(tree->root, { isNormal, data }, observer);
+}
+
+static ErrorCode _normaliseNode(TreeNode* node, _Unchanged unchanged, StepObserver* observer)
+{
+    if (_isUnchanged(unchanged, node))
+        return EVERYTHING_FINE;
+
+    if (_isPolynomialOperation(node))
+    {
+        _Part part = { {}, nullptr, 0, 0, observer, unchanged };
+        _Polynomial polynomial = {};
+
+        ErrorCode error = _normalisePart(node, &part, &polynomial);
+
+        _destroyPolynomial(&polynomial);
+        _destroyPart(&part);
+
+        return error;
+    }
+
+    if (node->left)
+        RETURN_ERROR(_normaliseNode(node->left, unchanged, observer), node->UpdateCounts());
+    if (node->right)
+        RETURN_ERROR(_normaliseNode(node->right, unchanged, observer), node->UpdateCounts());
+
+    node->UpdateCounts();
+
+    return EVERYTHING_FINE;
+}
+
+static bool _isUnchanged(_Unchanged unchanged, TreeNode* node)
+{
+    return unchanged.isNormal && unchanged.isNormal(unchanged.data, node);
+}
+
+// the operands are normalised first, so every node is converted once and a node is rewritten
+// if its normal form is smaller than what its operands have come to
+static ErrorCode _normalisePart(TreeNode* node, _Part* part, _Polynomial* result)
+{
+    if (NODE_TYPE(node) == NUMBER_TYPE)
+        return _constantPolynomial(NODE_NUMBER(node), result);
+
+    // its normal form would not be smaller, the normal form of the part needs only its polynomial
+    if (_isUnchanged(part->unchanged, node))
+        return _toPolynomial(node, &part->atoms, result);
+
+    if (!_isPolynomialOperation(node))
+    {
+        RETURN_ERROR(_normaliseNode(node, part->unchanged, part->observer));
+
+        _Term term = {};
+        RETURN_ERROR(_atomTerm(node, &part->atoms, &term));
+
+        return _termPolynomial(&term, result);
+    }
+
+    _Polynomial left  = {};
+    _Polynomial right = {};
+
+    ErrorCode error = _normalisePart(node->left, part, &left);
+    if (!error)
+        error = _normalisePart(node->right, part, &right);
+
+    node->UpdateCounts();
+
+    if (!error)
+        error = _combinePolynomials(node, &left, &right, &part->atoms, result);
+
+    _destroyPolynomial(&left);
+    _destroyPolynomial(&right);
+
+    // too big to expand or divided by 0, the node stays as it is
+    if (error == ERROR_BAD_SIZE || error == ERROR_ZERO_DIVISION)
+    {
+        _destroyPolynomial(result);
+
+        _Term term = {};
+        RETURN_ERROR(_atomTerm(node, &part->atoms, &term));
+
+        return _termPolynomial(&term, result);
+    }
+
+    RETURN_ERROR(error);
+
+    // the normal form is counted before it is made, most nodes keep their own
+    bool overCommon = false;
+    if (_normalSize(result, &part->atoms, &overCommon) >= node->nodeCount)
+        return EVERYTHING_FINE;
+
+    TreeNodeResult normalRes = _buildPolynomial(result, &part->atoms);
+    RETURN_ERROR(normalRes.error);
+
+    OBSERVE(part->observer, simplifyStart, node);
+
+    RETURN_ERROR(_replaceNode(part, node, normalRes.value));
+
+    OBSERVE(part->observer, simplified, node);
+
+    return EVERYTHING_FINE;
+}
+
+static bool _isPolynomialOperation(TreeNode* node)
+{
+    if (NODE_TYPE(node) != OPERATION_TYPE)
+        return false;
+
+    switch (NODE_OPERATION(node))
+    {
+        case ADD_OPERATION:
+        case SUB_OPERATION:
+        case MUL_OPERATION:
+        case DIV_OPERATION:
+            return true;
+        case POWER_OPERATION:
+            return NODE_TYPE(node->right) == NUMBER_TYPE &&
+                   NODE_NUMBER(node->right) == floor(NODE_NUMBER(node->right)) &&
+                   fabs(NODE_NUMBER(node->right)) <= MAX_EXPONENT;
+        default:
+            return false;
+    }
+}
+
+// the node stays where it is and takes the contents of the replacement, its old operands
+// are kept in the part, because the atoms may be in them
+static ErrorCode _replaceNode(_Part* part, TreeNode* node, TreeNode* replacement)
+{
+    if (part->replacedCount == part->replacedCapacity)
+    {
+        size_t newCapacity = part->replacedCapacity ? part->replacedCapacity * 2 : REPLACED_START_CAPACITY;
+
+        TreeNode** newReplaced = (TreeNode**)realloc(part->replaced, newCapacity * sizeof(*newReplaced));
+        MyAssertSoft(newReplaced, ERROR_NO_MEMORY, replacement->Delete());
+
+        part->replaced         = newReplaced;
+        part->replacedCapacity = newCapacity;
+    }
+
+    TreeElement_t value = node->value;
+    TreeNode* left      = node->left;
+    TreeNode* right     = node->right;
+
+    node->value = replacement->value;
+    node->left  = replacement->left;
+    node->right = replacement->right;
+
+    if (node->left)
+        node->left->parent = node;
+    if (node->right)
+        node->right->parent = node;
+
+    replacement->value = value;
+    replacement->left  = left;
+    replacement->right = right;
+
+    left->parent  = replacement;
+    right->parent = replacement;
+
+    node->UpdateCounts();
+    replacement->UpdateCounts();
+
+    part->replaced[part->replacedCount++] = replacement;
+
+    return EVERYTHING_FINE;
+}
+
+static void _destroyPart(_Part* part)
+{
+    for (size_t i = 0; i < part->replacedCount; i++)
+        part->replaced[i]->Delete();
+
+    free(part->replaced);
+
+    _destroyAtoms(&part->atoms);
+
+    *part = {};
+}
+
+// a part of the tree that is not being normalised, only converted
+static ErrorCode _toPolynomial(TreeNode* node, _Atoms* atoms, _Polynomial* result)
+{
+    if (NODE_TYPE(node) == NUMBER_TYPE)
+        return _constantPolynomial(NODE_NUMBER(node), result);
+
+    if (_isPolynomialOperation(node))
+    {
+        _Polynomial left  = {};
+        _Polynomial right = {};
+
+        ErrorCode error = _toPolynomial(node->left, atoms, &left);
+        if (!error)
+            error = _toPolynomial(node->right, atoms, &right);
+        if (!error)
+            error = _combinePolynomials(node, &left, &right, atoms, result);
+
+        _destroyPolynomial(&left);
+        _destroyPolynomial(&right);
+
+        if (error != ERROR_BAD_SIZE && error != ERROR_ZERO_DIVISION)
+            return error;
+
+        _destroyPolynomial(result);
+    }
+
+    _Term term = {};
+    RETURN_ERROR(_atomTerm(node, atoms, &term));
+
+    return _termPolynomial(&term, result);
+}
+
+static ErrorCode _combinePolynomials(TreeNode* node, _Polynomial* left, _Polynomial* right,
+                                     _Atoms* atoms, _Polynomial* result)
+{
+    _Term term = {};
+
+    switch (NODE_OPERATION(node))
+    {
+        case ADD_OPERATION:
+            return _addPolynomials(left, right, 1, result);
+        case SUB_OPERATION:
+            return _addPolynomials(left, right, -1, result);
+        case MUL_OPERATION:
+            return _mulPolynomials(left, right, result);
+        case DIV_OPERATION:
+            RETURN_ERROR(_polynomialTerm(node->right, right, atoms, &term));
+
+            return _divideByTerm(left, &term, atoms, result);
+        case POWER_OPERATION:
+        {
+            long exponent = (long)NODE_NUMBER(node->right);
+
+            if (exponent >= 0)
+                return _powerPolynomial(left, exponent, result);
+
+            RETURN_ERROR(_polynomialTerm(node->left, left, atoms, &term));
+            RETURN_ERROR(_powerTerm(&term, exponent, &term));
+
+            return _termPolynomial(&term, result);
+        }
+        default:
+            return ERROR_BAD_VALUE;
+    }
+}
+
+static ErrorCode _powerPolynomial(_Polynomial* base, long exponent, _Polynomial* result)
+{
+    if (base->size > 1 && exponent > MAX_EXPANDED_POWER)
+        return ERROR_BAD_SIZE;
+
+    RETURN_ERROR(_constantPolynomial(1, result));
+
+    for (long i = 0; i < exponent; i++)
+    {
+        _Polynomial product = {};
+
+        ErrorCode error = _mulPolynomials(result, base, &product);
+
+        _destroyPolynomial(result);
+        *result = product;
+
+        RETURN_ERROR(error);
+    }
+
+    return EVERYTHING_FINE;
+}
+
+// a denominator is one term, a sum in it becomes an atom
+static ErrorCode _toTerm(TreeNode* node, _Atoms* atoms, _Term* result)
+{
+    _Polynomial polynomial = {};
+    RETURN_ERROR(_toPolynomial(node, atoms, &polynomial));
+
+    ErrorCode error = _polynomialTerm(node, &polynomial, atoms, result);
+
+    _destroyPolynomial(&polynomial);
+
+    return error;
+}
+
+// the polynomial of the node as one term, products and powers of sums are taken apart
+static ErrorCode _polynomialTerm(TreeNode* node, _Polynomial* polynomial, _Atoms* atoms, _Term* result)
+{
+    switch (polynomial->size)
+    {
+        case 0:
+            return ERROR_ZERO_DIVISION;
+        case 1:
+            *result = polynomial->terms[0];
+            return EVERYTHING_FINE;
+        default:
+            break;
+    }
+
+    if (NODE_TYPE(node) == OPERATION_TYPE && NODE_OPERATION(node) == MUL_OPERATION)
+    {
+        _Term left  = {};
+        _Term right = {};
+
+        RETURN_ERROR(_toTerm(node->left, atoms, &left));
+        RETURN_ERROR(_toTerm(node->right, atoms, &right));
+
+        return _mulTerms(&left, &right, 1, result);
+    }
+
+    if (_isPolynomialOperation(node) && NODE_OPERATION(node) == POWER_OPERATION)
+    {
+        _Term base = {};
+        RETURN_ERROR(_toTerm(node->left, atoms, &base));
+
+        return _powerTerm(&base, (long)NODE_NUMBER(node->right), result);
+    }
+
+    return _sumAtomTerm(polynomial, atoms, result);
+}
+
+static ErrorCode _divideByTerm(_Polynomial* numerator, _Term* denominator, _Atoms* atoms, _Polynomial* result)
+{
+    _Term inverse = {};
+    RETURN_ERROR(_powerTerm(denominator, -1, &inverse));
+
+    _Polynomial* dividend = numerator;
+    _Polynomial cancelled = {};
+
+    // a sum of the denominator goes away if the numerator is a multiple of it
+    for (size_t i = 0; i < inverse.factorCount; i++)
+    {
+        _Atom* atom = &atoms->atoms[inverse.factors[i].atom];
+        _Term quotient = {};
+
+        if (!atom->owned || inverse.factors[i].exponent > 0 || !_divideExactly(numerator, &atom->sum, &quotient))
+            continue;
+
+        _Term sum = { 1, 1, { inverse.factors[i] } };
+        sum.factors[0].exponent = 1;
+
+        RETURN_ERROR(_mulTerms(&inverse, &sum, 1, &inverse));
+        RETURN_ERROR(_termPolynomial(&quotient, &cancelled));
+
+        dividend = &cancelled;
+
+        break;
+    }
+
+    _Polynomial inversePolynomial = {};
+    ErrorCode error = _termPolynomial(&inverse, &inversePolynomial);
+
+    if (!error)
+        error = _mulPolynomials(dividend, &inversePolynomial, result);
+
+    _destroyPolynomial(&cancelled);
+    _destroyPolynomial(&inversePolynomial);
+
+    return error;
+}
+
+static ErrorCode _initPolynomial(_Polynomial* polynomial)
+{
+    *polynomial = {};
+
+    polynomial->terms = (_Term*)calloc(POLYNOMIAL_START_CAPACITY, sizeof(*polynomial->terms));
+    MyAssertSoft(polynomial->terms, ERROR_NO_MEMORY);
+
+    polynomial->capacity = POLYNOMIAL_START_CAPACITY;
+
+    return EVERYTHING_FINE;
+}
+
+static void _destroyPolynomial(_Polynomial* polynomial)
+{
+    free(polynomial->terms);
+
+    *polynomial = {};
+}
+
+static ErrorCode _pushTerm(_Polynomial* polynomial, _Term* term)
+{
+    if (polynomial->size == polynomial->capacity)
+    {
+        size_t newCapacity = polynomial->capacity ? polynomial->capacity * 2 : POLYNOMIAL_START_CAPACITY;
+
+        _Term* newTerms = (_Term*)realloc(polynomial->terms, newCapacity * sizeof(*newTerms));
+        MyAssertSoft(newTerms, ERROR_NO_MEMORY);
+
+        polynomial->terms    = newTerms;
+        polynomial->capacity = newCapacity;
+    }
+
+    polynomial->terms[polynomial->size++] = *term;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _collectTerms(_Polynomial* polynomial)
+{
+    Sort(polynomial->terms, polynomial->size, sizeof(*polynomial->terms), _compareTerms);
+
+    size_t size = 0;
+
+    for (size_t i = 0; i < polynomial->size; i++)
+    {
+        if (size && _compareTerms(&polynomial->terms[size - 1], &polynomial->terms[i]) == 0)
+            polynomial->terms[size - 1].coefficient += polynomial->terms[i].coefficient;
+        else
+            polynomial->terms[size++] = polynomial->terms[i];
+
+        if (IsEqual(polynomial->terms[size - 1].coefficient, 0) &&
+            (i + 1 == polynomial->size || _compareTerms(&polynomial->terms[size - 1], &polynomial->terms[i + 1])))
+            size--;
+    }
+
+    polynomial->size = size;
+
+    if (size > MAX_POLYNOMIAL_TERMS)
+        return ERROR_BAD_SIZE;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _constantPolynomial(double number, _Polynomial* result)
+{
+    RETURN_ERROR(_initPolynomial(result));
+
+    if (IsEqual(number, 0))
+        return EVERYTHING_FINE;
+
+    _Term term = { number, 0, {} };
+
+    return _pushTerm(result, &term);
+}
+
+static ErrorCode _termPolynomial(_Term* term, _Polynomial* result)
+{
+    RETURN_ERROR(_initPolynomial(result));
+
+    return _pushTerm(result, term);
+}
+
+static ErrorCode _addPolynomials(_Polynomial* first, _Polynomial* second, double sign, _Polynomial* result)
+{
+    RETURN_ERROR(_initPolynomial(result));
+
+    for (size_t i = 0; i < first->size; i++)
+        RETURN_ERROR(_pushTerm(result, &first->terms[i]));
+
+    for (size_t i = 0; i < second->size; i++)
+    {
+        _Term term = second->terms[i];
+        term.coefficient *= sign;
+
+        RETURN_ERROR(_pushTerm(result, &term));
+    }
+
+    return _collectTerms(result);
+}
+
+static ErrorCode _mulPolynomials(_Polynomial* first, _Polynomial* second, _Polynomial* result)
+{
+    // too big is not an error, the part stays as it was
+    if (first->size * second->size > MAX_PRODUCT_TERMS)
+        return ERROR_BAD_SIZE;
+
+    RETURN_ERROR(_initPolynomial(result));
+
+    for (size_t i = 0; i < first->size; i++)
+    {
+        for (size_t j = 0; j < second->size; j++)
+        {
+            _Term product = {};
+
+            RETURN_ERROR(_mulTerms(&first->terms[i], &second->terms[j], 1, &product));
+            RETURN_ERROR(_pushTerm(result, &product));
+        }
+    }
+
+    return _collectTerms(result);
+}
+
+// whether the dividend is the divisor times one term, the terms go in the same order
+// after multiplying by a term, so that term is the ratio of the first ones
+static bool _divideExactly(_Polynomial* dividend, _Polynomial* divisor, _Term* quotient)
+{
+    if (!dividend->size || dividend->size != divisor->size)
+        return false;
+
+    if (_mulTerms(&dividend->terms[0], &divisor->terms[0], -1, quotient))
+        return false;
+
+    quotient->coefficient = dividend->terms[0].coefficient / divisor->terms[0].coefficient;
+
+    _Polynomial quotientPolynomial = {};
+    _Polynomial product = {};
+
+    bool divides = !_termPolynomial(quotient, &quotientPolynomial) &&
+                   !_mulPolynomials(divisor, &quotientPolynomial, &product) &&
+                   _samePolynomial(dividend, &product);
+
+    _destroyPolynomial(&quotientPolynomial);
+    _destroyPolynomial(&product);
+
+    return divides;
+}
+
+static bool _samePolynomial(_Polynomial* first, _Polynomial* second)
+{
+    if (first->size != second->size)
+        return false;
+
+    for (size_t i = 0; i < first->size; i++)
+        if (_compareTerms(&first->terms[i], &second->terms[i]) ||
+            !IsEqual(first->terms[i].coefficient, second->terms[i].coefficient))
+            return false;
+
+    return true;
+}
+
+// the exponents of the second term are taken with secondSign, -1 divides the monomials
+static ErrorCode _mulTerms(_Term* first, _Term* second, long secondSign, _Term* result)
+{
+    _Term product = { first->coefficient * second->coefficient, 0, {} };
+
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < first->factorCount || j < second->factorCount)
+    {
+        _Factor factor = {};
+
+        if (j == second->factorCount ||
+            (i < first->factorCount && _factorBefore(&first->factors[i], &second->factors[j])))
+            factor = first->factors[i++];
+        else if (i == first->factorCount || _factorBefore(&second->factors[j], &first->factors[i]))
+        {
+            factor = second->factors[j++];
+            factor.exponent *= secondSign;
+        }
+        else
+        {
+            factor = first->factors[i++];
+            factor.exponent += secondSign * second->factors[j++].exponent;
+        }
+
+        if (!factor.exponent)
+            continue;
+
+        if (product.factorCount == MAX_TERM_FACTORS)
+            return ERROR_BAD_SIZE;
+
+        product.factors[product.factorCount++] = factor;
+    }
+
+    *result = product;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _powerTerm(_Term* term, long exponent, _Term* result)
+{
+    if (exponent < 0 && IsEqual(term->coefficient, 0))
+        return ERROR_ZERO_DIVISION;
+
+    _Term power = { pow(term->coefficient, (double)exponent), 0, {} };
+
+    if (exponent)
+    {
+        power.factorCount = term->factorCount;
+
+        for (size_t i = 0; i < term->factorCount; i++)
+        {
+            power.factors[i] = term->factors[i];
+            power.factors[i].exponent *= exponent;
+        }
+    }
+
+    *result = power;
+
+    return EVERYTHING_FINE;
+}
+
+// higher degree first, then the first atoms in higher powers first, the coefficients are not looked at
+static int _compareTerms(const void* first, const void* second)
+{
+    _Term* a = (_Term*)first;
+    _Term* b = (_Term*)second;
+
+    long aDegree = _degree(a);
+    long bDegree = _degree(b);
+
+    if (aDegree != bDegree)
+        return aDegree > bDegree ? -1 : 1;
+
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < a->factorCount || j < b->factorCount)
+    {
+        if (j == b->factorCount || (i < a->factorCount && _factorBefore(&a->factors[i], &b->factors[j])))
+            return a->factors[i].exponent > 0 ? -1 : 1;
+        if (i == a->factorCount || _factorBefore(&b->factors[j], &a->factors[i]))
+            return b->factors[j].exponent > 0 ? 1 : -1;
+
+        if (a->factors[i].exponent != b->factors[j].exponent)
+            return a->factors[i].exponent > b->factors[j].exponent ? -1 : 1;
+
+        i++;
+        j++;
+    }
+
+    return 0;
+}
+
+static long _degree(_Term* term)
+{
+    long degree = 0;
+
+    for (size_t i = 0; i < term->factorCount; i++)
+        degree += term->factors[i].exponent;
+
+    return degree;
+}
+
+static bool _sameDenominator(_Term* first, _Term* second)
+{
+    size_t i = 0;
+    size_t j = 0;
+
+    while (true)
+    {
+        while (i < first->factorCount && first->factors[i].exponent > 0)
+            i++;
+        while (j < second->factorCount && second->factors[j].exponent > 0)
+            j++;
+
+        if (i == first->factorCount || j == second->factorCount)
+            return i == first->factorCount && j == second->factorCount;
+
+        if (first->factors[i].atom != second->factors[j].atom ||
+            first->factors[i].exponent != second->factors[j].exponent)
+            return false;
+
+        i++;
+        j++;
+    }
+}
+
+// keys of different atoms are equal very rarely, then the first met atom goes first
+static bool _factorBefore(_Factor* first, _Factor* second)
+{
+    if (first->key != second->key)
+        return first->key < second->key;
+
+    return first->atom < second->atom;
+}
+
+static ErrorCode _atomTerm(TreeNode* node, _Atoms* atoms, _Term* result)
+{
+    size_t index = 0;
+    RETURN_ERROR(_pushAtom(atoms, { node, _subtreeKey(node), false, {} }, &index));
+
+    *result = { 1, 1, { { atoms->atoms[index].key, index, 1 } } };
+
+    return EVERYTHING_FINE;
+}
+
+// the sum is taken without its denominators, common factors and minus in front, they stay in the term,
+// so that equal sums come to the same atom
+static ErrorCode _sumAtomTerm(_Polynomial* sum, _Atoms* atoms, _Term* result)
+{
+    _Term content = sum->terms[0];
+    content.coefficient = content.coefficient < 0 ? -1 : 1;
+
+    for (size_t i = 1; i < sum->size; i++)
+        RETURN_ERROR(_commonFactors(&content, &sum->terms[i], &content));
+
+    _Atom atom = { nullptr, 0, true, {} };
+    RETURN_ERROR(_initPolynomial(&atom.sum));
+
+    for (size_t i = 0; i < sum->size; i++)
+    {
+        _Term term = {};
+
+        RETURN_ERROR(_mulTerms(&sum->terms[i], &content, -1, &term), _destroyPolynomial(&atom.sum));
+        RETURN_ERROR(_pushTerm(&atom.sum, &term), _destroyPolynomial(&atom.sum));
+    }
+
+    TreeNodeResult nodeRes = _buildPolynomial(&atom.sum, atoms);
+    RETURN_ERROR(nodeRes.error, _destroyPolynomial(&atom.sum));
+
+    atom.node = nodeRes.value;
+    atom.key  = _subtreeKey(atom.node);
+
+    size_t index = 0;
+    RETURN_ERROR(_pushAtom(atoms, atom, &index), nodeRes.value->Delete(); _destroyPolynomial(&atom.sum));
+
+    _Term atomTerm = { 1, 1, { { atom.key, index, 1 } } };
+
+    return _mulTerms(&content, &atomTerm, 1, result);
+}
+
+// the factors both terms have in them, an atom missing from a term is there in power 0
+static ErrorCode _commonFactors(_Term* first, _Term* second, _Term* result)
+{
+    _Term common = { first->coefficient, 0, {} };
+
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < first->factorCount || j < second->factorCount)
+    {
+        _Factor factor = {};
+
+        if (j == second->factorCount ||
+            (i < first->factorCount && _factorBefore(&first->factors[i], &second->factors[j])))
+        {
+            factor = first->factors[i];
+            factor.exponent = min(factor.exponent, 0L);
+            i++;
+        }
+        else if (i == first->factorCount || _factorBefore(&second->factors[j], &first->factors[i]))
+        {
+            factor = second->factors[j];
+            factor.exponent = min(factor.exponent, 0L);
+            j++;
+        }
+        else
+        {
+            factor = first->factors[i];
+            factor.exponent = min(factor.exponent, second->factors[j].exponent);
+            i++;
+            j++;
+        }
+
+        if (!factor.exponent)
+            continue;
+
+        if (common.factorCount == MAX_TERM_FACTORS)
+            return ERROR_BAD_SIZE;
+
+        common.factors[common.factorCount++] = factor;
+    }
+
+    *result = common;
+
+    return EVERYTHING_FINE;
+}
+
+// an atom equal to one already there is dropped
+static ErrorCode _pushAtom(_Atoms* atoms, _Atom atom, size_t* index)
+{
+    for (size_t i = 0; i < atoms->size; i++)
+    {
+        if (atoms->atoms[i].key != atom.key || !_sameSubtree(atoms->atoms[i].node, atom.node))
+            continue;
+
+        if (atom.owned)
+        {
+            atom.node->Delete();
+            _destroyPolynomial(&atom.sum);
+        }
+
+        *index = i;
+
+        return EVERYTHING_FINE;
+    }
+
+    if (atoms->size == atoms->capacity)
+    {
+        size_t newCapacity = atoms->capacity ? atoms->capacity * 2 : ATOMS_START_CAPACITY;
+
+        _Atom* newAtoms = (_Atom*)realloc(atoms->atoms, newCapacity * sizeof(*newAtoms));
+        MyAssertSoft(newAtoms, ERROR_NO_MEMORY);
+
+        atoms->atoms    = newAtoms;
+        atoms->capacity = newCapacity;
+    }
+
+    *index = atoms->size;
+    atoms->atoms[atoms->size++] = atom;
+
+    return EVERYTHING_FINE;
+}
+
+static void _destroyAtoms(_Atoms* atoms)
+{
+    for (size_t i = 0; i < atoms->size; i++)
+    {
+        if (!atoms->atoms[i].owned)
+            continue;
+
+        atoms->atoms[i].node->Delete();
+        _destroyPolynomial(&atoms->atoms[i].sum);
+    }
+
+    free(atoms->atoms);
+
+    *atoms = {};
+}
+
+static bool _sameSubtree(TreeNode* first, TreeNode* second)
+{
+    if (!first || !second)
+        return first == second;
+
+    if (NODE_TYPE(first) != NODE_TYPE(second) || first->variables != second->variables)
+        return false;
+
+    switch (NODE_TYPE(first))
+    {
+        case NUMBER_TYPE:
+            if (NODE_NUMBER(first) != NODE_NUMBER(second))
+                return false;
+            break;
+        case VARIABLE_TYPE:
+            if (NODE_VAR(first) != NODE_VAR(second))
+                return false;
+            break;
+        case OPERATION_TYPE:
+            if (NODE_OPERATION(first) != NODE_OPERATION(second))
+                return false;
+            break;
+        default:
+            return false;
+    }
+
+    return _sameSubtree(first->left, second->left) && _sameSubtree(first->right, second->right);
+}
+
+// variables go first by their letters, the other subtrees by a hash of them
+static size_t _subtreeKey(TreeNode* node)
+{
+    static const size_t HASH_MULTIPLIER = 0x100000001b3;
+    static const size_t HASH_FLAG       = (size_t)1 << 63;
+
+    if (NODE_TYPE(node) == VARIABLE_TYPE)
+        return (size_t)(unsigned char)NODE_VAR(node);
+
+    size_t key = (size_t)NODE_TYPE(node) * HASH_MULTIPLIER;
+
+    switch (NODE_TYPE(node))
+    {
+        case NUMBER_TYPE:
+        {
+            double number = NODE_NUMBER(node);
+            size_t bits = 0;
+            memcpy(&bits, &number, sizeof(bits));
+
+            key ^= bits;
+            break;
+        }
+        case OPERATION_TYPE:
+            key ^= (size_t)NODE_OPERATION(node);
+            break;
+        default:
+            break;
+    }
+
+    if (node->left)
+        key = (key ^ _subtreeKey(node->left)) * HASH_MULTIPLIER;
+    if (node->right)
+        key = (key * HASH_MULTIPLIER ^ _subtreeKey(node->right)) * HASH_MULTIPLIER;
+
+    return key | HASH_FLAG;
+}
+
+// nodes in the tree @ref _buildPolynomial makes, overCommon tells which of the two forms it takes
+static size_t _normalSize(_Polynomial* polynomial, _Atoms* atoms, bool* overCommon)
+{
+    *overCommon = false;
+
+    if (!polynomial->size)
+        return 1;
+
+    size_t size = _groupsSize(polynomial, atoms);
+
+    _Term denominator = {};
+    _Term numeratorTerms[MAX_POLYNOMIAL_TERMS];
+    _Polynomial numerator = { numeratorTerms, 0, MAX_POLYNOMIAL_TERMS };
+
+    if (!_commonDenominator(polynomial, &denominator, &numerator))
+        return size;
+
+    size_t commonSize = _groupsSize(&numerator, atoms) + _factorsSize(&denominator, -1, atoms) + 1;
+
+    if (commonSize >= size)
+        return size;
+
+    *overCommon = true;
+
+    return commonSize;
+}
+
+// the terms multiplied by the common denominator, false if there is none or a term gets too many factors
+static bool _commonDenominator(_Polynomial* polynomial, _Term* denominator, _Polynomial* numerator)
+{
+    if (polynomial->size < 2 || polynomial->size > numerator->capacity)
+        return false;
+
+    *denominator = { 1, 0, {} };
+
+    for (size_t i = 0; i < polynomial->size; i++)
+        if (_commonFactors(denominator, &polynomial->terms[i], denominator))
+            return false;
+
+    if (!denominator->factorCount)
+        return false;
+
+    numerator->size = polynomial->size;
+
+    for (size_t i = 0; i < polynomial->size; i++)
+        if (_mulTerms(&polynomial->terms[i], denominator, -1, &numerator->terms[i]))
+            return false;
+
+    return true;
+}
+
+static void _groupTerms(_Polynomial* polynomial, _Groups* groups)
+{
+    for (size_t i = 0; i < polynomial->size; i++)
+    {
+        groups->leader[i] = i;
+        groups->size[i]   = 0;
+
+        for (size_t j = 0; j < i; j++)
+        {
+            if (groups->leader[j] == j && _sameDenominator(&polynomial->terms[j], &polynomial->terms[i]))
+            {
+                groups->leader[i] = j;
+                break;
+            }
+        }
+
+        groups->size[groups->leader[i]]++;
+    }
+}
+
+// a negative term is subtracted unless it starts a group of several terms or the whole sum
+static double _termSign(_Polynomial* polynomial, _Groups* groups, size_t index)
+{
+    if (polynomial->terms[index].coefficient >= 0)
+        return 1;
+
+    if (groups->leader[index] != index)
+        return -1;
+
+    return index && groups->size[index] == 1 ? -1 : 1;
+}
+
+static size_t _groupsSize(_Polynomial* polynomial, _Atoms* atoms)
+{
+    _Groups groups;
+    _groupTerms(polynomial, &groups);
+
+    // the additions and subtractions between the terms
+    size_t size = polynomial->size - 1;
+
+    for (size_t i = 0; i < polynomial->size; i++)
+    {
+        size += _termSize(&polynomial->terms[i], _termSign(polynomial, &groups, i), atoms);
+
+        if (groups.leader[i] != i)
+            continue;
+
+        size_t denominatorSize = _factorsSize(&polynomial->terms[i], -1, atoms);
+
+        if (denominatorSize)
+            size += denominatorSize + 1;
+    }
+
+    return size;
+}
+
+static size_t _termSize(_Term* term, double sign, _Atoms* atoms)
+{
+    size_t size = _factorsSize(term, 1, atoms);
+
+    if (!size)
+        return 1;
+
+    return term->coefficient * sign == 1 ? size : size + 2;
+}
+
+static size_t _factorsSize(_Term* term, long sign, _Atoms* atoms)
+{
+    size_t size  = 0;
+    size_t count = 0;
+
+    for (size_t i = 0; i < term->factorCount; i++)
+    {
+        long exponent = term->factors[i].exponent * sign;
+        if (exponent <= 0)
+            continue;
+
+        size += atoms->atoms[term->factors[i].atom].node->nodeCount + (exponent > 1 ? 2 : 0);
+        count++;
+    }
+
+    return count ? size + count - 1 : 0;
+}
+
+// the smaller of the sum of fractions and one fraction over the common denominator
+static TreeNodeResult _buildPolynomial(_Polynomial* polynomial, _Atoms* atoms)
+{
+    if (!polynomial->size)
+        return _newNumber(0);
+
+    MyAssertSoftResult(polynomial->size <= MAX_POLYNOMIAL_TERMS, nullptr, ERROR_BAD_SIZE);
+
+    bool overCommon = false;
+    _normalSize(polynomial, atoms, &overCommon);
+
+    if (!overCommon)
+        return _buildGroups(polynomial, atoms);
+
+    _Term denominator = {};
+    _Term numeratorTerms[MAX_POLYNOMIAL_TERMS];
+    _Polynomial numerator = { numeratorTerms, 0, MAX_POLYNOMIAL_TERMS };
+
+    _commonDenominator(polynomial, &denominator, &numerator);
+
+    TreeNodeResult numeratorRes = _buildGroups(&numerator, atoms);
+    RETURN_ERROR_RESULT(numeratorRes, nullptr);
+
+    TreeNodeResult denominatorRes = _buildFactors(&denominator, -1, atoms);
+    RETURN_ERROR_RESULT(denominatorRes, nullptr, numeratorRes.value->Delete());
+
+    return _newOperation(DIV_OPERATION, numeratorRes.value, denominatorRes.value);
+}
+
+// terms over the same denominator are summed first and divided once
+static TreeNodeResult _buildGroups(_Polynomial* polynomial, _Atoms* atoms)
+{
+    _Groups groups;
+    _groupTerms(polynomial, &groups);
+
+    TreeNode* sum = nullptr;
+
+    for (size_t i = 0; i < polynomial->size; i++)
+    {
+        if (groups.leader[i] != i)
+            continue;
+
+        TreeNodeResult groupRes = _buildGroup(polynomial, &groups, i, atoms);
+        RETURN_ERROR_RESULT(groupRes, nullptr, if (sum) sum->Delete());
+
+        if (!sum)
+        {
+            sum = groupRes.value;
+            continue;
+        }
+
+        Operation operation = _termSign(polynomial, &groups, i) < 0 ? SUB_OPERATION : ADD_OPERATION;
+
+        TreeNodeResult sumRes = _newOperation(operation, sum, groupRes.value);
+        RETURN_ERROR_RESULT(sumRes, nullptr);
+
+        sum = sumRes.value;
+    }
+
+    return { sum, EVERYTHING_FINE };
+}
+
+static TreeNodeResult _buildGroup(_Polynomial* polynomial, _Groups* groups, size_t leader, _Atoms* atoms)
+{
+    TreeNode* numerator = nullptr;
+
+    for (size_t i = leader; i < polynomial->size; i++)
+    {
+        if (groups->leader[i] != leader)
+            continue;
+
+        double sign = _termSign(polynomial, groups, i);
+
+        TreeNodeResult termRes = _buildTerm(&polynomial->terms[i], sign, atoms);
+        RETURN_ERROR_RESULT(termRes, nullptr, if (numerator) numerator->Delete());
+
+        if (!numerator)
+        {
+            numerator = termRes.value;
+            continue;
+        }
+
+        TreeNodeResult numeratorRes = _newOperation(sign < 0 ? SUB_OPERATION : ADD_OPERATION,
+                                                    numerator, termRes.value);
+        RETURN_ERROR_RESULT(numeratorRes, nullptr);
+
+        numerator = numeratorRes.value;
+    }
+
+    TreeNodeResult denominatorRes = _buildFactors(&polynomial->terms[leader], -1, atoms);
+    RETURN_ERROR_RESULT(denominatorRes, nullptr, numerator->Delete());
+
+    if (!denominatorRes.value)
+        return { numerator, EVERYTHING_FINE };
+
+    return _newOperation(DIV_OPERATION, numerator, denominatorRes.value);
+}
+
+// only the factors in positive powers, the others go to the denominator of the group
+static TreeNodeResult _buildTerm(_Term* term, double sign, _Atoms* atoms)
+{
+    double coefficient = term->coefficient * sign;
+
+    TreeNodeResult productRes = _buildFactors(term, 1, atoms);
+    RETURN_ERROR_RESULT(productRes, nullptr);
+
+    TreeNode* product = productRes.value;
+
+    if (!product)
+        return _newNumber(coefficient);
+
+    if (coefficient == 1)
+        return { product, EVERYTHING_FINE };
+
+    // x / 3 rather than 0.333333 * x
+    if (coefficient > 0 && coefficient < 1 && 1 / coefficient == round(1 / coefficient))
+    {
+        TreeNodeResult divisorRes = _newNumber(1 / coefficient);
+        RETURN_ERROR_RESULT(divisorRes, nullptr, product->Delete());
+
+        return _newOperation(DIV_OPERATION, product, divisorRes.value);
+    }
+
+    TreeNodeResult numberRes = _newNumber(coefficient);
+    RETURN_ERROR_RESULT(numberRes, nullptr, product->Delete());
+
+    return _newOperation(MUL_OPERATION, numberRes.value, product);
+}
+
+// product of the factors whose powers have the sign, taken in absolute value, nullptr for none
+static TreeNodeResult _buildFactors(_Term* term, long sign, _Atoms* atoms)
+{
+    TreeNode* product = nullptr;
+
+    for (size_t i = 0; i < term->factorCount; i++)
+    {
+        long exponent = term->factors[i].exponent * sign;
+        if (exponent <= 0)
+            continue;
+
+        TreeNodeResult factorRes = atoms->atoms[term->factors[i].atom].node->Copy();
+        RETURN_ERROR_RESULT(factorRes, nullptr, if (product) product->Delete());
+
+        if (exponent > 1)
+        {
+            TreeNodeResult exponentRes = _newNumber((double)exponent);
+            RETURN_ERROR_RESULT(exponentRes, nullptr, factorRes.value->Delete(); if (product) product->Delete());
+
+            factorRes = _newOperation(POWER_OPERATION, factorRes.value, exponentRes.value);
+            RETURN_ERROR_RESULT(factorRes, nullptr, if (product) product->Delete());
+        }
+
+        if (!product)
+        {
+            product = factorRes.value;
+            continue;
+        }
+
+        TreeNodeResult productRes = _newOperation(MUL_OPERATION, product, factorRes.value);
+        RETURN_ERROR_RESULT(productRes, nullptr);
+
+        product = productRes.value;
+    }
+
+    return { product, EVERYTHING_FINE };
+}
+
+// the operands are deleted if the node can not be made
+static TreeNodeResult _newOperation(Operation operation, TreeNode* left, TreeNode* right)
+{
+    TreeNodeResult nodeRes = TreeNode::New({}, left, right);
+    RETURN_ERROR_RESULT(nodeRes, nullptr, left->Delete(); if (right) right->Delete());
+
+    TreeNode* node = nodeRes.value;
+
+    NODE_TYPE(node)      = OPERATION_TYPE;
+    NODE_OPERATION(node) = operation;
+    UPDATE_PRIORITY(node);
+
+    return nodeRes;
+}
+
+static TreeNodeResult _newNumber(double number)
+{
+    TreeNodeResult nodeRes = TreeNode::New({}, nullptr, nullptr);
+    RETURN_ERROR_RESULT(nodeRes, nullptr);
+
+    NODE_TYPE(nodeRes.value)   = NUMBER_TYPE;
+    NODE_NUMBER(nodeRes.value) = number;
+
+    return nodeRes;
+}
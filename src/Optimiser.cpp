@@ -1,325 +1,356 @@
 #include "Optimiser.hpp"
-#include "LatexWriter.hpp"
+#include "Normaliser.hpp"
+#include "RewriteRules.hpp"
 #include "DiffTreeDSL.hpp"
 
-enum Direction
+static const size_t WORKLIST_START_CAPACITY = 16;
+
+static ErrorCode _recOptimise(TreeNode* node, StepObserver* observer);
+static ErrorCode _simplifyNode(TreeNode* node, StepObserver* observer, bool* simplified);
+
+static bool _isDeeper(SimplifyEntry first, SimplifyEntry second);
+static ErrorCode _pushEntry(SimplifyWorklist* worklist, SimplifyEntry entry);
+static SimplifyEntry _popEntry(SimplifyWorklist* worklist);
+static ErrorCode _runEntry(SimplifyWorklist* worklist, SimplifyEntry entry, StepObserver* observer);
+static void _recountUp(TreeNode* node);
+
+static bool _isNumber(TreeNode* node, double number);
+static TreeNodeResult _newNumber(double number, TreeNode* left, TreeNode* right, TreeNode* dropped[2]);
+static TreeNodeResult _keepOperand(TreeNode* kept, TreeNode* other, TreeNode* dropped[2]);
+
+ErrorCode Optimise(Tree* tree, StepObserver* observer)
 {
-    LEFT,
-    RIGHT,
-};
+    MyAssertSoft(tree, ERROR_NULLPTR);
 
-ErrorCode _recOptimise(TreeNode* node, FILE* texFile, bool* keepOptimizingPtr);
-ErrorCode _recOptimizeConsts(TreeNode* node, FILE* texFile, bool* keepOptimizingPtr);
-ErrorCode _recOptimizeNeutrals(TreeNode* node, FILE* texFile, bool* keepOptimizingPtr);
-ErrorCode _deleteUnnededAndReplace(TreeNode* toReplace, Direction deleteDirection);
+    OBSERVE(observer, optimiseStart, tree->root);
 
-ErrorCode _writeOptimiseStart(TreeNode* node, FILE*texFile);
+    size_t normalisedSize = SIZET_POISON;
 
-ErrorCode Optimise(Tree* tree, FILE* texFile)
+    // a part brought to the normal form may give the rules something new,
+    // that goes on while the normal form keeps making the tree smaller
+    while (true)
+    {
+        RETURN_ERROR(_recOptimise(tree->root, observer));
+
+        size_t size = *tree->size;
+
+        RETURN_ERROR(Normalise(tree, observer));
+
+        if (*tree->size >= size || *tree->size >= normalisedSize)
+            return EVERYTHING_FINE;
+
+        normalisedSize = *tree->size;
+    }
+}
+
+ErrorCode OptimiseByRules(Tree* tree, StepObserver* observer)
 {
     MyAssertSoft(tree, ERROR_NULLPTR);
 
-    #ifdef TEX_WRITE
-    fprintf(texFile, "Упростим\n\\newline\n\\[");
-    RETURN_ERROR(LatexWrite(tree->root, texFile));
-    fprintf(texFile, "\\]\n");
-    #endif
+    OBSERVE(observer, optimiseStart, tree->root);
 
-    bool keepOptimising = true;
+    return _recOptimise(tree->root, observer);
+}
 
-    while (keepOptimising)
-        RETURN_ERROR(_recOptimise(tree->root, texFile, &keepOptimising));
+// the children are simplified first and a rule gives back its new inner nodes simplified,
+// so a rewrite of the node never gives its subtree anything new to simplify
+static ErrorCode _recOptimise(TreeNode* node, StepObserver* observer)
+{
+    MyAssertSoft(node, ERROR_NULLPTR);
+
+    if (NODE_TYPE(node) != OPERATION_TYPE)
+        return EVERYTHING_FINE;
+
+    // the rewrites do not go up the tree, so every node is recounted after its children,
+    // also on errors to leave the tree consistent
+    RETURN_ERROR(_recOptimise(node->left, observer), node->UpdateCounts());
+    if (node->right)
+        RETURN_ERROR(_recOptimise(node->right, observer), node->UpdateCounts());
+
+    bool simplified = true;
+
+    while (simplified && NODE_TYPE(node) == OPERATION_TYPE)
+        RETURN_ERROR(_simplifyNode(node, observer, &simplified), node->UpdateCounts());
+
+    node->UpdateCounts();
 
     return EVERYTHING_FINE;
 }
 
-ErrorCode _recOptimise(TreeNode* node, FILE* texFile, bool* keepOptimizingPtr)
+static ErrorCode _simplifyNode(TreeNode* node, StepObserver* observer, bool* simplified)
 {
     MyAssertSoft(node, ERROR_NULLPTR);
+    MyAssertSoft(simplified, ERROR_NULLPTR);
+
+    RuleMatch match = {};
+
+    RETURN_ERROR(FindRule(node, &match, simplified));
+
+    if (!*simplified)
+        return EVERYTHING_FINE;
+
+    OBSERVE(observer, simplifyStart, node);
 
-    MyAssertSoft(keepOptimizingPtr, ERROR_NULLPTR);
+    RETURN_ERROR(ApplyRule(node, &match));
 
-    *keepOptimizingPtr = false;
+    OBSERVE(observer, simplified, node);
 
-    switch (NODE_TYPE(node))
+    return EVERYTHING_FINE;
+}
+
+ErrorCode SimplifyWorklist::Init()
+{
+    *this = {};
+
+    this->entries = (SimplifyEntry*)calloc(WORKLIST_START_CAPACITY, sizeof(*this->entries));
+    MyAssertSoft(this->entries, ERROR_NO_MEMORY);
+
+    this->capacity = WORKLIST_START_CAPACITY;
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode SimplifyWorklist::Push(TreeNode* node)
+{
+    MyAssertSoft(node, ERROR_NULLPTR);
+
+    size_t depth = 0;
+    for (TreeNode* ancestor = node->parent; ancestor; ancestor = ancestor->parent)
+        depth++;
+
+    return _pushEntry(this, { node, depth });
+}
+
+ErrorCode SimplifyWorklist::Run(StepObserver* observer)
+{
+    while (this->size)
     {
-        case NUMBER_TYPE:
-        case VARIABLE_TYPE:
-            return EVERYTHING_FINE;
-        default:
-            break;
+        SimplifyEntry entry = _popEntry(this);
+
+        while (this->size && this->entries[0].node == entry.node)
+            _popEntry(this);
+
+        ErrorCode error = _runEntry(this, entry, observer);
+
+        if (error)
+        {
+            // the ancestors of what is left were not recounted yet
+            while (this->size)
+                _recountUp(_popEntry(this).node);
+
+            return error;
+        }
+    }
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode SimplifyWorklist::Destructor()
+{
+    free(this->entries);
+
+    *this = {};
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _pushEntry(SimplifyWorklist* worklist, SimplifyEntry entry)
+{
+    if (worklist->size == worklist->capacity)
+    {
+        size_t newCapacity = worklist->capacity ? worklist->capacity * 2 : WORKLIST_START_CAPACITY;
+
+        SimplifyEntry* newEntries = (SimplifyEntry*)realloc(worklist->entries, newCapacity * sizeof(*newEntries));
+        MyAssertSoft(newEntries, ERROR_NO_MEMORY);
+
+        worklist->entries  = newEntries;
+        worklist->capacity = newCapacity;
     }
 
-    RETURN_ERROR(_recOptimizeConsts(node, texFile, keepOptimizingPtr));
+    SimplifyEntry* entries = worklist->entries;
+    size_t index = worklist->size++;
 
-    switch (NODE_TYPE(node))
+    while (index && _isDeeper(entry, entries[(index - 1) / 2]))
     {
-        case NUMBER_TYPE:
-        case VARIABLE_TYPE:
-            return EVERYTHING_FINE;
-        default:
-            break;
+        entries[index] = entries[(index - 1) / 2];
+        index = (index - 1) / 2;
     }
 
-    RETURN_ERROR(_recOptimizeNeutrals(node, texFile, keepOptimizingPtr));
+    entries[index] = entry;
 
     return EVERYTHING_FINE;
 }
 
-ErrorCode _recOptimizeConsts(TreeNode* node, FILE* texFile, bool* keepOptimizingPtr)
+static SimplifyEntry _popEntry(SimplifyWorklist* worklist)
 {
-    MyAssertSoft(node, ERROR_NULLPTR);
+    SimplifyEntry* entries = worklist->entries;
 
-    MyAssertSoft(keepOptimizingPtr, ERROR_NULLPTR);
+    SimplifyEntry top  = entries[0];
+    SimplifyEntry last = entries[--worklist->size];
 
-    if (!node->right)
-        return _recOptimise(node->left, texFile, keepOptimizingPtr);
+    size_t index = 0;
 
-    RETURN_ERROR(_recOptimise(node->left, texFile, keepOptimizingPtr));
-    RETURN_ERROR(_recOptimise(node->right, texFile, keepOptimizingPtr));
-
-    if (NODE_TYPE(node->left) == NUMBER_TYPE && NODE_TYPE(node->right) == NUMBER_TYPE)
+    while (2 * index + 1 < worklist->size)
     {
-        *keepOptimizingPtr = true;
+        size_t child = 2 * index + 1;
+        if (child + 1 < worklist->size && _isDeeper(entries[child + 1], entries[child]))
+            child++;
+
+        if (!_isDeeper(entries[child], last))
+            break;
 
-        RETURN_ERROR(_writeOptimiseStart(node, texFile));
+        entries[index] = entries[child];
+        index = child;
+    }
 
-        NODE_TYPE(node) = NUMBER_TYPE;
+    entries[index] = last;
 
-        switch (NODE_OPERATION(node))
-        {
-            case ADD_OPERATION:
-                NODE_NUMBER(node) = NODE_NUMBER(node->left) + NODE_NUMBER(node->right);
-                break;
-            case SUB_OPERATION:
-                NODE_NUMBER(node) = NODE_NUMBER(node->left) - NODE_NUMBER(node->right);
-                break;
-            case MUL_OPERATION:
-                NODE_NUMBER(node) = NODE_NUMBER(node->left) * NODE_NUMBER(node->right);
-                break;
-            case DIV_OPERATION:
-                if (NODE_NUMBER(node->right) == 0)
-                    return ERROR_ZERO_DIVISION;
-                NODE_NUMBER(node) = NODE_NUMBER(node->left) / NODE_NUMBER(node->right);
-                break;
-            case POWER_OPERATION:
-                NODE_NUMBER(node) = pow(NODE_NUMBER(node->left), NODE_NUMBER(node->right));
-                break;
-            default:
-                return EVERYTHING_FINE;
-        }
+    return top;
+}
+
+// everything deeper is already done, so the operands are simplified and recounted
+static ErrorCode _runEntry(SimplifyWorklist* worklist, SimplifyEntry entry, StepObserver* observer)
+{
+    TreeNode* node = entry.node;
+
+    bool simplified = true;
 
-        RETURN_ERROR(node->left->Delete());
-        RETURN_ERROR(node->right->Delete());
+    while (simplified && NODE_TYPE(node) == OPERATION_TYPE)
+        RETURN_ERROR(_simplifyNode(node, observer, &simplified), _recountUp(node));
 
-        RETURN_ERROR(LatexWrite(node, texFile));
-        fprintf(texFile, "\\]\n");
+    node->UpdateCounts();
 
+    if (!node->parent)
         return EVERYTHING_FINE;
-    }
+
+    RETURN_ERROR(_pushEntry(worklist, { node->parent, entry.depth - 1 }), _recountUp(node->parent));
 
     return EVERYTHING_FINE;
 }
 
-ErrorCode _recOptimizeNeutrals(TreeNode* node, FILE* texFile, bool* keepOptimizingPtr)
+// the same node has the same depth, ordering by address puts its entries next to each other
+static bool _isDeeper(SimplifyEntry first, SimplifyEntry second)
 {
-    MyAssertSoft(node, ERROR_NULLPTR);
+    if (first.depth != second.depth)
+        return first.depth > second.depth;
 
-    MyAssertSoft(keepOptimizingPtr, ERROR_NULLPTR);
+    return first.node > second.node;
+}
 
-    if (!node->right)
-        return _recOptimise(node->left, texFile, keepOptimizingPtr);
+static void _recountUp(TreeNode* node)
+{
+    for (; node; node = node->parent)
+        node->UpdateCounts();
+}
 
-    RETURN_ERROR(_recOptimise(node->left, texFile, keepOptimizingPtr));
-    RETURN_ERROR(_recOptimise(node->right, texFile, keepOptimizingPtr));
+TreeNodeResult NewSimplifiedOperation(Operation operation, TreeNode* left, TreeNode* right, TreeNode* dropped[2])
+{
+    MyAssertSoftResult(left, nullptr, ERROR_NULLPTR);
+    MyAssertSoftResult(dropped, nullptr, ERROR_NULLPTR);
 
-    bool optimised = false;
+    dropped[0] = nullptr;
+    dropped[1] = nullptr;
 
-    switch (NODE_OPERATION(node))
+    if (right && NODE_TYPE(left) == NUMBER_TYPE && NODE_TYPE(right) == NUMBER_TYPE)
     {
-        case ADD_OPERATION:
-            if (NODE_TYPE(node->left) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->left), 0))
-            {
-                optimised = true;
-                RETURN_ERROR(_writeOptimiseStart(node, texFile));
-                *keepOptimizingPtr = true;
-                RETURN_ERROR(_deleteUnnededAndReplace(node, LEFT));
-                break;
-            }
-            else if (NODE_TYPE(node->right) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->right), 0))
-            {
-                optimised = true;
-                RETURN_ERROR(_writeOptimiseStart(node, texFile));
-                *keepOptimizingPtr = true;
-                RETURN_ERROR(_deleteUnnededAndReplace(node, RIGHT));
-                break;
-            }
-            break;
-        case SUB_OPERATION:
-            if (NODE_TYPE(node->right) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->right), 0))
-            {
-                optimised = true;
-                RETURN_ERROR(_writeOptimiseStart(node, texFile));
-                *keepOptimizingPtr = true;
-                RETURN_ERROR(_deleteUnnededAndReplace(node, RIGHT));
-                break;
-            }
-            break;
-        case MUL_OPERATION:
-            if ((NODE_TYPE(node->left)  == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->left), 0)) ||
-                (NODE_TYPE(node->right) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->right), 0)))
-            {
-                optimised = true;
-                RETURN_ERROR(_writeOptimiseStart(node, texFile));
-                *keepOptimizingPtr = true;
-                if (node->left)
-                    RETURN_ERROR(node->left->Delete());
-                if (node->right)
-                    RETURN_ERROR(node->right->Delete());
-
-                NODE_TYPE(node) = NUMBER_TYPE;
-                NODE_NUMBER(node) = 0;
-                break;
-            }
-            else if (NODE_TYPE(node->left) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->left), 1))
-            {
-                optimised = true;
-                RETURN_ERROR(_writeOptimiseStart(node, texFile));
-                *keepOptimizingPtr = true;
-                RETURN_ERROR(_deleteUnnededAndReplace(node, LEFT));
+        double leftNumber  = NODE_NUMBER(left);
+        double rightNumber = NODE_NUMBER(right);
+
+        switch (operation)
+        {
+            case ADD_OPERATION:
+                return _newNumber(leftNumber + rightNumber, left, right, dropped);
+            case SUB_OPERATION:
+                return _newNumber(leftNumber - rightNumber, left, right, dropped);
+            case MUL_OPERATION:
+                return _newNumber(leftNumber * rightNumber, left, right, dropped);
+            case DIV_OPERATION:
+                // left for Optimise to report
+                if (rightNumber == 0)
+                    break;
+                return _newNumber(leftNumber / rightNumber, left, right, dropped);
+            case POWER_OPERATION:
+                return _newNumber(pow(leftNumber, rightNumber), left, right, dropped);
+            default:
                 break;
-            }
-            else if (NODE_TYPE(node->right) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->right), 1))
-            {
-                optimised = true;
-                RETURN_ERROR(_writeOptimiseStart(node, texFile));
-                *keepOptimizingPtr = true;
-                RETURN_ERROR(_deleteUnnededAndReplace(node, RIGHT));
+        }
+    }
+
+    if (right)
+    {
+        switch (operation)
+        {
+            case ADD_OPERATION:
+                if (_isNumber(left, 0))
+                    return _keepOperand(right, left, dropped);
+                if (_isNumber(right, 0))
+                    return _keepOperand(left, right, dropped);
                 break;
-            }
-            break;
-        case DIV_OPERATION:
-            if (NODE_TYPE(node->left) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->left), 0))
-            {
-                optimised = true;
-                RETURN_ERROR(_writeOptimiseStart(node, texFile));
-                *keepOptimizingPtr = true;
-                if (node->left)
-                    RETURN_ERROR(node->left->Delete());
-                if (node->right)
-                    RETURN_ERROR(node->right->Delete());
-
-                NODE_TYPE(node) = NUMBER_TYPE;
-                NODE_NUMBER(node) = 0;
+            case SUB_OPERATION:
+                if (_isNumber(right, 0))
+                    return _keepOperand(left, right, dropped);
                 break;
-            }
-            else if (NODE_TYPE(node->right) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->right), 1))
-            {
-                optimised = true;
-                RETURN_ERROR(_writeOptimiseStart(node, texFile));
-                *keepOptimizingPtr = true;
-                RETURN_ERROR(_deleteUnnededAndReplace(node, RIGHT));
+            case MUL_OPERATION:
+                if (_isNumber(left, 0) || _isNumber(right, 0))
+                    return _newNumber(0, left, right, dropped);
+                if (_isNumber(left, 1))
+                    return _keepOperand(right, left, dropped);
+                if (_isNumber(right, 1))
+                    return _keepOperand(left, right, dropped);
                 break;
-            }
-            break;
-        case POWER_OPERATION:
-            if (NODE_TYPE(node->left) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->left), 0))
-            {
-                optimised = true;
-                RETURN_ERROR(_writeOptimiseStart(node, texFile));
-                *keepOptimizingPtr = true;
-                if (node->left)
-                    RETURN_ERROR(node->left->Delete());
-                if (node->right)
-                    RETURN_ERROR(node->right->Delete());
-
-                NODE_TYPE(node) = NUMBER_TYPE;
-                NODE_NUMBER(node) = 0;
+            case DIV_OPERATION:
+                if (_isNumber(left, 0) && !_isNumber(right, 0))
+                    return _newNumber(0, left, right, dropped);
+                if (_isNumber(right, 1))
+                    return _keepOperand(left, right, dropped);
                 break;
-            }
-            else if ((NODE_TYPE(node->left)  == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->left), 1)) ||
-                     (NODE_TYPE(node->right) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->right), 0)))
-            {
-                optimised = true;
-                RETURN_ERROR(_writeOptimiseStart(node, texFile));
-                *keepOptimizingPtr = true;
-                if (node->left)
-                    RETURN_ERROR(node->left->Delete());
-                if (node->right)
-                    RETURN_ERROR(node->right->Delete());
-
-                NODE_TYPE(node) = NUMBER_TYPE;
-                NODE_NUMBER(node) = 1;
+            case POWER_OPERATION:
+                if (_isNumber(left, 0))
+                    return _newNumber(0, left, right, dropped);
+                if (_isNumber(left, 1) || _isNumber(right, 0))
+                    return _newNumber(1, left, right, dropped);
+                if (_isNumber(right, 1))
+                    return _keepOperand(left, right, dropped);
                 break;
-            }
-            if (NODE_TYPE(node->right) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node->right), 1))
-            {
-                optimised = true;
-                RETURN_ERROR(_writeOptimiseStart(node, texFile));
-                *keepOptimizingPtr = true;
-                RETURN_ERROR(_deleteUnnededAndReplace(node, RIGHT));
+            default:
                 break;
-            }
-            break;
-        default:
-            return EVERYTHING_FINE;
+        }
     }
 
-    if (optimised)
-    {
-        RETURN_ERROR(LatexWrite(node, texFile));
-        fprintf(texFile, "\\]\n");
-    }
+    TreeNodeResult nodeRes = TreeNode::New({}, left, right);
+    RETURN_ERROR_RESULT(nodeRes, nullptr);
 
-    return EVERYTHING_FINE;
-}
+    TreeNode* node = nodeRes.value;
 
-ErrorCode _deleteUnnededAndReplace(TreeNode* toReplace, Direction deleteDirection)
-{
-    MyAssertSoft(toReplace, ERROR_NULLPTR);
+    NODE_TYPE(node)      = OPERATION_TYPE;
+    NODE_OPERATION(node) = operation;
+    UPDATE_PRIORITY(node);
 
-    TreeNode* newNode = nullptr;
+    return { node, EVERYTHING_FINE };
+}
 
-    switch (deleteDirection)
-    {
-        case LEFT:
-            RETURN_ERROR(toReplace->left->Delete());
-            newNode = toReplace->right;
-            break;
-        case RIGHT:
-            RETURN_ERROR(toReplace->right->Delete());
-            newNode = toReplace->left;
-            break;
-        default:
-            return ERROR_BAD_VALUE;
-    }
+static bool _isNumber(TreeNode* node, double number)
+{
+    return NODE_TYPE(node) == NUMBER_TYPE && IsEqual(NODE_NUMBER(node), number);
+}
 
-    toReplace->value = newNode->value;
-    toReplace->SetLeft(newNode->left);
-    toReplace->SetRight(newNode->right);
+static TreeNodeResult _newNumber(double number, TreeNode* left, TreeNode* right, TreeNode* dropped[2])
+{
+    TreeNodeResult nodeRes = TreeNode::New({}, nullptr, nullptr);
+    RETURN_ERROR_RESULT(nodeRes, nullptr);
 
-    newNode->value     = {};
-    newNode->left      = nullptr;
-    newNode->right     = nullptr;
-    newNode->parent    = nullptr;
-    newNode->nodeCount = SIZET_POISON;
-    newNode->id        = BAD_ID;
+    NODE_TYPE(nodeRes.value)   = NUMBER_TYPE;
+    NODE_NUMBER(nodeRes.value) = number;
 
-    free(newNode);
+    dropped[0] = left;
+    dropped[1] = right;
 
-    return EVERYTHING_FINE;
+    return nodeRes;
 }
 
-ErrorCode _writeOptimiseStart(TreeNode* node, FILE* texFile)
+static TreeNodeResult _keepOperand(TreeNode* kept, TreeNode* other, TreeNode* dropped[2])
 {
-    #ifdef TEX_WRITE
-    MyAssertSoft(node, ERROR_NULLPTR);
-    MyAssertSoft(texFile, ERROR_BAD_FILE);
+    dropped[0] = other;
 
-    fprintf(texFile, "%s\n\\[", GetRandomMathComment());
-    RETURN_ERROR(LatexWrite(node, texFile));
-    fprintf(texFile, "=");
-    #endif
-
-    return EVERYTHING_FINE;
+    return { kept, EVERYTHING_FINE };
 }
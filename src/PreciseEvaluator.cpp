@@ -0,0 +1,369 @@
+#include <math.h>
+#include <float.h>
+#include "PreciseEvaluator.hpp"
+#include "MinMax.hpp"
+
+static const double DOUBLE_UNIT_ROUNDOFF = DBL_EPSILON / 2;
+// double-double transcendentals are a few units off in the last place
+static const double DOUBLE_DOUBLE_SAFETY = 16;
+static const size_t MULTI_PRECISION_GUARD_BITS = 32;
+static const size_t DOUBLE_DOUBLE_BITS = 104;
+
+/** @struct _BoundedValue
+ * @brief A double with a first order bound of its rounding error in units of roundoff
+ */
+struct _BoundedValue
+{
+    double value;
+    double error;
+};
+
+struct _BoundedEvalResult
+{
+    _BoundedValue value;
+    ErrorCode error;
+};
+
+static _BoundedEvalResult _evalBounded(CompiledTree* compiled, double var);
+
+static _BoundedValue _evalBoundedOperation(Operation operation, _BoundedValue left, _BoundedValue right);
+
+static inline double _scaleError(double factor, double error);
+
+static double _relativeError(double bound, double roundoffLog2, double value);
+
+static DoubleDouble _evalDoubleDoubleOperation(Operation operation, DoubleDouble left, DoubleDouble right);
+
+static BigFloat _evalBigFloatOperation(Operation operation, const BigFloat* left, const BigFloat* right);
+
+DoubleDoubleEvalResult EvaluateDoubleDouble(CompiledTree* compiled, DoubleDouble var)
+{
+    MyAssertSoftResult(compiled, {}, ERROR_NULLPTR);
+    MyAssertSoftResult(compiled->instructions, {}, ERROR_NULLPTR);
+
+    DoubleDouble* registers = (DoubleDouble*)compiled->scratch;
+
+    for (size_t i = 0; i < compiled->size; i++)
+    {
+        CompiledInstruction* instruction = &compiled->instructions[i];
+
+        switch (instruction->type)
+        {
+            case NUMBER_TYPE:
+                registers[i] = DDFromDouble(instruction->number);
+                break;
+            case VARIABLE_TYPE:
+                registers[i] = var;
+                break;
+            case OPERATION_TYPE:
+                if (instruction->operation == DIV_OPERATION && IsEqual(DDToDouble(registers[instruction->right]), 0))
+                    return { DDFromDouble(NAN), ERROR_ZERO_DIVISION };
+
+                registers[i] = _evalDoubleDoubleOperation(instruction->operation,
+                                                          registers[instruction->left],
+                                                          registers[instruction->right]);
+                break;
+            default:
+                return { DDFromDouble(NAN), ERROR_BAD_VALUE };
+        }
+    }
+
+    return { registers[compiled->output], EVERYTHING_FINE };
+}
+
+BigFloatEvalResult EvaluateBigFloat(CompiledTree* compiled, const BigFloat* var)
+{
+    MyAssertSoftResult(compiled, {}, ERROR_NULLPTR);
+    MyAssertSoftResult(compiled->instructions, {}, ERROR_NULLPTR);
+    MyAssertSoftResult(var, {}, ERROR_NULLPTR);
+
+    BigFloat* registers = (BigFloat*)calloc(compiled->size, sizeof(*registers));
+    MyAssertSoftResult(registers, {}, ERROR_NO_MEMORY);
+
+    ErrorCode error = EVERYTHING_FINE;
+
+    for (size_t i = 0; i < compiled->size && !error; i++)
+    {
+        CompiledInstruction* instruction = &compiled->instructions[i];
+
+        switch (instruction->type)
+        {
+            case NUMBER_TYPE:
+                registers[i] = BigFloatFromDouble(instruction->number, var->limbs);
+                break;
+            case VARIABLE_TYPE:
+                registers[i] = *var;
+                break;
+            case OPERATION_TYPE:
+                if (instruction->operation == DIV_OPERATION &&
+                    IsEqual(BigFloatToDouble(&registers[instruction->right]), 0))
+                {
+                    error = ERROR_ZERO_DIVISION;
+                    break;
+                }
+
+                registers[i] = _evalBigFloatOperation(instruction->operation,
+                                                      &registers[instruction->left],
+                                                      &registers[instruction->right]);
+                break;
+            default:
+                error = ERROR_BAD_VALUE;
+                break;
+        }
+    }
+
+    BigFloat result = error ? BigFloatFromDouble(NAN, var->limbs) : registers[compiled->output];
+
+    free(registers);
+
+    return { result, error };
+}
+
+AutoEvalResult EvaluateAuto(CompiledTree* compiled, double var, double relativeTolerance)
+{
+    MyAssertSoftResult(compiled, {}, ERROR_NULLPTR);
+    MyAssertSoftResult(relativeTolerance > 0, {}, ERROR_BAD_NUMBER);
+
+    _BoundedEvalResult boundedRes = _evalBounded(compiled, var);
+    RETURN_ERROR_RESULT(boundedRes, {});
+
+    // the bound is linear in the unit roundoff, so the double pass predicts every precision.
+    // After cancellation the double value itself is noise, so each retry divides by the better value
+    double absoluteBound = boundedRes.value.error;
+
+    AutoEvalValue result = {};
+    result.value = boundedRes.value.value;
+    result.relativeError = _relativeError(absoluteBound, log2(DOUBLE_UNIT_ROUNDOFF), result.value);
+    result.precision = DOUBLE_PRECISION;
+
+    if (isnan(result.value) || result.relativeError <= relativeTolerance)
+        return { result, EVERYTHING_FINE };
+
+    DoubleDoubleEvalResult ddRes = EvaluateDoubleDouble(compiled, DDFromDouble(var));
+    RETURN_ERROR_RESULT(ddRes, {});
+
+    result.value = DDToDouble(ddRes.value);
+    result.relativeError = _relativeError(absoluteBound, log2(DOUBLE_DOUBLE_EPSILON * DOUBLE_DOUBLE_SAFETY),
+                                          result.value);
+    result.precision = DOUBLE_DOUBLE_PRECISION;
+
+    if (isnan(result.value) || result.relativeError <= relativeTolerance)
+        return { result, EVERYTHING_FINE };
+
+    size_t limbs = 0;
+
+    while (result.relativeError > relativeTolerance && limbs < BIG_FLOAT_MAX_LIMBS)
+    {
+        double bits = log2(result.relativeError / relativeTolerance) + MULTI_PRECISION_GUARD_BITS +
+                      (double)(limbs ? limbs * BIG_FLOAT_LIMB_BITS : DOUBLE_DOUBLE_BITS);
+        if (!isfinite(bits))
+            bits = (double)(BIG_FLOAT_MAX_LIMBS * BIG_FLOAT_LIMB_BITS);
+
+        limbs = min(max((size_t)ceil(bits / BIG_FLOAT_LIMB_BITS) + 1, limbs + 1), BIG_FLOAT_MAX_LIMBS);
+
+        BigFloat varBig = BigFloatFromDouble(var, limbs);
+
+        BigFloatEvalResult bigRes = EvaluateBigFloat(compiled, &varBig);
+        RETURN_ERROR_RESULT(bigRes, {});
+
+        result.value = BigFloatToDouble(&bigRes.value);
+        result.relativeError = _relativeError(absoluteBound, 1 - (double)(limbs * BIG_FLOAT_LIMB_BITS),
+                                              result.value);
+        result.precision = MULTI_PRECISION;
+        result.limbs = limbs;
+
+        if (isnan(result.value))
+            break;
+    }
+
+    return { result, EVERYTHING_FINE };
+}
+
+// bound is in units of roundoff, logarithms keep tiny roundoffs from underflowing
+static double _relativeError(double bound, double roundoffLog2, double value)
+{
+    if (bound == 0)
+        return 0;
+
+    return exp2(log2(bound) + roundoffLog2 - log2(fabs(value)));
+}
+
+static _BoundedEvalResult _evalBounded(CompiledTree* compiled, double var)
+{
+    MyAssertSoftResult(compiled, {}, ERROR_NULLPTR);
+    MyAssertSoftResult(compiled->instructions, {}, ERROR_NULLPTR);
+
+    _BoundedValue* registers = (_BoundedValue*)compiled->scratch;
+
+    for (size_t i = 0; i < compiled->size; i++)
+    {
+        CompiledInstruction* instruction = &compiled->instructions[i];
+
+        switch (instruction->type)
+        {
+            case NUMBER_TYPE:
+                registers[i] = { instruction->number, 0 };
+                break;
+            case VARIABLE_TYPE:
+                registers[i] = { var, 0 };
+                break;
+            case OPERATION_TYPE:
+                if (instruction->operation == DIV_OPERATION && IsEqual(registers[instruction->right].value, 0))
+                    return { {}, ERROR_ZERO_DIVISION };
+
+                registers[i] = _evalBoundedOperation(instruction->operation,
+                                                     registers[instruction->left],
+                                                     registers[instruction->right]);
+                break;
+            default:
+                return { {}, ERROR_BAD_VALUE };
+        }
+    }
+
+    return { registers[compiled->output], EVERYTHING_FINE };
+}
+
+// exact operands stay exact even where the derivative blows up
+static inline double _scaleError(double factor, double error)
+{
+    return error == 0 ? 0 : fabs(factor) * error;
+}
+
+// propagated error of the operands plus one rounding of the result
+static _BoundedValue _evalBoundedOperation(Operation operation, _BoundedValue left, _BoundedValue right)
+{
+    double l = left.value;
+    double r = right.value;
+    double v = NAN;
+    double propagated = 0;
+
+    switch (operation)
+    {
+        case ADD_OPERATION:
+            v = l + r;
+            propagated = left.error + right.error;
+            break;
+        case SUB_OPERATION:
+            v = l - r;
+            propagated = left.error + right.error;
+            break;
+        case MUL_OPERATION:
+            v = l * r;
+            propagated = _scaleError(fabs(r), left.error) + _scaleError(fabs(l), right.error);
+            break;
+        case DIV_OPERATION:
+            v = l / r;
+            propagated = _scaleError(1 / fabs(r), left.error) + _scaleError(fabs(v / r), right.error);
+            break;
+        case POWER_OPERATION:
+            v = pow(l, r);
+            propagated = _scaleError(fabs(v * r / l), left.error) + _scaleError(fabs(v * log(fabs(l))), right.error);
+            break;
+        case SIN_OPERATION:
+            v = sin(l);
+            propagated = _scaleError(fabs(cos(l)), left.error);
+            break;
+        case COS_OPERATION:
+            v = cos(l);
+            propagated = _scaleError(fabs(sin(l)), left.error);
+            break;
+        case TAN_OPERATION:
+            v = tan(l);
+            propagated = _scaleError(1 + v * v, left.error);
+            break;
+        case ARC_SIN_OPERATION:
+            v = asin(l);
+            propagated = _scaleError(1 / sqrt(1 - l * l), left.error);
+            break;
+        case ARC_COS_OPERATION:
+            v = acos(l);
+            propagated = _scaleError(1 / sqrt(1 - l * l), left.error);
+            break;
+        case ARC_TAN_OPERATION:
+            v = atan(l);
+            propagated = _scaleError(1 / (1 + l * l), left.error);
+            break;
+        case EXP_OPERATION:
+            v = exp(l);
+            propagated = _scaleError(fabs(v), left.error);
+            break;
+        case LN_OPERATION:
+            v = log(l);
+            propagated = _scaleError(1 / fabs(l), left.error);
+            break;
+        default:
+            break;
+    }
+
+    return { v, propagated + fabs(v) };
+}
+
+static DoubleDouble _evalDoubleDoubleOperation(Operation operation, DoubleDouble left, DoubleDouble right)
+{
+    switch (operation)
+    {
+        case ADD_OPERATION:
+            return DDAdd(left, right);
+        case SUB_OPERATION:
+            return DDSub(left, right);
+        case MUL_OPERATION:
+            return DDMul(left, right);
+        case DIV_OPERATION:
+            return DDDiv(left, right);
+        case POWER_OPERATION:
+            return DDPow(left, right);
+        case SIN_OPERATION:
+            return DDSin(left);
+        case COS_OPERATION:
+            return DDCos(left);
+        case TAN_OPERATION:
+            return DDTan(left);
+        case ARC_SIN_OPERATION:
+            return DDArcsin(left);
+        case ARC_COS_OPERATION:
+            return DDArccos(left);
+        case ARC_TAN_OPERATION:
+            return DDArctan(left);
+        case EXP_OPERATION:
+            return DDExp(left);
+        case LN_OPERATION:
+            return DDLn(left);
+        default:
+            return DDFromDouble(NAN);
+    }
+}
+
+static BigFloat _evalBigFloatOperation(Operation operation, const BigFloat* left, const BigFloat* right)
+{
+    switch (operation)
+    {
+        case ADD_OPERATION:
+            return BigFloatAdd(left, right);
+        case SUB_OPERATION:
+            return BigFloatSub(left, right);
+        case MUL_OPERATION:
+            return BigFloatMul(left, right);
+        case DIV_OPERATION:
+            return BigFloatDiv(left, right);
+        case POWER_OPERATION:
+            return BigFloatPow(left, right);
+        case SIN_OPERATION:
+            return BigFloatSin(left);
+        case COS_OPERATION:
+            return BigFloatCos(left);
+        case TAN_OPERATION:
+            return BigFloatTan(left);
+        case ARC_SIN_OPERATION:
+            return BigFloatArcsin(left);
+        case ARC_COS_OPERATION:
+            return BigFloatArccos(left);
+        case ARC_TAN_OPERATION:
+            return BigFloatArctan(left);
+        case EXP_OPERATION:
+            return BigFloatExp(left);
+        case LN_OPERATION:
+            return BigFloatLn(left);
+        default:
+            return BigFloatFromDouble(NAN, left->limbs);
+    }
+}
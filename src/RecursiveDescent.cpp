@@ -50,6 +50,8 @@ TreeNodeResult _getId(const char** context);
 
 TreeNodeResult _getD(const char** context);
 
+static void _destroyTrees(Tree* trees, size_t count);
+
 ErrorCode ParseExpression(Tree* tree, char* string)
 {
     MyAssertSoft(tree, ERROR_NULLPTR);
@@ -71,6 +73,43 @@ ErrorCode ParseExpression(Tree* tree, char* string)
     return EVERYTHING_FINE;
 }
 
+// expressions separated by commas, each of them becomes a tree
+ErrorCode ParseSystem(Tree* trees, size_t capacity, size_t* count, char* string)
+{
+    MyAssertSoft(trees, ERROR_NULLPTR);
+    MyAssertSoft(count, ERROR_NULLPTR);
+    MyAssertSoft(string, ERROR_NULLPTR);
+
+    const char* filteredSpaces = StringFilter(string, " \t\n", '\0');
+    MyAssertSoft(filteredSpaces, ERROR_NULLPTR);
+
+    const char** context = (const char**)&string;
+
+    *count = 0;
+
+    do
+    {
+        MyAssertSoft(*count < capacity, ERROR_INDEX_OUT_OF_BOUNDS, _destroyTrees(trees, *count));
+
+        TreeNodeResult root = _getE(context);
+        RETURN_ERROR(root.error, _destroyTrees(trees, *count));
+
+        RETURN_ERROR(trees[*count].Init(root.value), root.value->Delete(); _destroyTrees(trees, *count));
+
+        (*count)++;
+    } while (*CUR_CHAR_PTR == ',' && CUR_CHAR_PTR++);
+
+    SyntaxAssert(*CUR_CHAR_PTR == '\0', _destroyTrees(trees, *count));
+
+    return EVERYTHING_FINE;
+}
+
+static void _destroyTrees(Tree* trees, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        trees[i].Destructor();
+}
+
 TreeNodeResult _getN(const char** context)
 {
     MyAssertSoftResult(context, nullptr, ERROR_NULLPTR);
@@ -269,12 +308,13 @@ if (hasOneArg && strncasecmp(CUR_CHAR_PTR, string, length) == 0)        \
 
     SyntaxAssertResult(isalpha(*CUR_CHAR_PTR), nullptr);
 
-    TreeNodeResult varRes = TreeNode::New({}, nullptr, nullptr);
-    RETURN_ERROR_RESULT(varRes, nullptr);
-    TreeNode* var = varRes.value;
+    // the value goes to New for the node to know its variable
+    TreeElement_t value = {};
+    value.type = VARIABLE_TYPE;
+    value.value.var = *CUR_CHAR_PTR;
 
-    var->value.type = VARIABLE_TYPE;
-    var->value.value.var = *CUR_CHAR_PTR;
+    TreeNodeResult varRes = TreeNode::New(value, nullptr, nullptr);
+    RETURN_ERROR_RESULT(varRes, nullptr);
 
     CUR_CHAR_PTR++;
 
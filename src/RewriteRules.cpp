@@ -0,0 +1,727 @@
+#include <math.h>
+#include <string.h>
+#include <pthread.h>
+#include "RewriteRules.hpp"
+#include "RecursiveDescent.hpp"
+#include "DiffTreeDSL.hpp"
+
+#define DEF_FUNC(name, ...) + 1
+static const size_t RULE_OPERATION_COUNT = 0
+#include "DiffFunctions.hpp"
+;
+#undef DEF_FUNC
+
+static const size_t MAX_RULE_LENGTH  = 64;
+static const size_t MAX_PATTERN_SIZE = 16;
+
+static const size_t AUTOMATON_START_CAPACITY = 64;
+
+#define BOUND(var)     (bound[#var[0] - 'a'])
+#define NUMBER(var)    NODE_NUMBER(BOUND(var))
+#define IS_NUMBER(var) (NODE_TYPE(BOUND(var)) == NUMBER_TYPE)
+
+#define DEF_RULE(name, pattern, replacement, guard)                     \
+static bool _guard ## name(TreeNode* const* bound)                      \
+{                                                                       \
+    (void)bound;                                                        \
+    return guard;                                                       \
+}
+
+#include "SimplifyRules.hpp"
+
+#undef DEF_RULE
+
+/** @struct _Rule
+ * @brief A rule of SimplifyRules.hpp
+ *
+ * @var _Rule::patternString, _Rule::replacementString - as written in the table
+ * @var _Rule::guard - whether the rule applies to what its variables stand for
+ * @var _Rule::pattern, _Rule::replacement - parsed strings, variables are VARIABLE_TYPE nodes
+ * @var _Rule::used - which variables the replacement uses
+ * @var _Rule::next - next rule accepted by the same state, SIZET_POISON at the end
+ */
+struct _Rule
+{
+    const char* patternString;
+    const char* replacementString;
+    bool (*guard)(TreeNode* const* bound);
+
+    TreeNode* pattern;
+    TreeNode* replacement;
+    bool used[RULE_VARIABLE_COUNT];
+
+    size_t next;
+};
+
+static _Rule RULES[] =
+{
+#define DEF_RULE(name, pattern, replacement, guard) { pattern, replacement, _guard ## name, nullptr, nullptr, {}, SIZET_POISON },
+
+#include "SimplifyRules.hpp"
+
+#undef DEF_RULE
+};
+
+static const size_t RULE_COUNT = sizeof(RULES) / sizeof(*RULES);
+
+/** @struct _RuleState
+ * @brief A state of the discrimination tree, a part of some patterns read in preorder.
+ * The next states are SIZET_POISON when no pattern goes on that way.
+ *
+ * @var _RuleState::operations - next state for every operation
+ * @var _RuleState::anything - next state for a variable standing for any subtree
+ * @var _RuleState::anyNumber - next state for a variable standing for a number
+ * @var _RuleState::numbers - first edge for a number written in a pattern
+ * @var _RuleState::accepted - first rule whose whole pattern is read here
+ * @var _RuleState::lastAccepted - the last one, rules are kept in the table's order
+ * @var _RuleState::firstRule - the first rule of the table met here or further
+ */
+struct _RuleState
+{
+    size_t operations[RULE_OPERATION_COUNT];
+    size_t anything;
+    size_t anyNumber;
+    size_t numbers;
+
+    size_t accepted;
+    size_t lastAccepted;
+    size_t firstRule;
+};
+
+/** @struct _NumberEdge
+ * @brief A number written in a pattern, leads to the state, next is the next edge of the same state
+ */
+struct _NumberEdge
+{
+    double number;
+    size_t state;
+    size_t next;
+};
+
+/** @struct _RuleAutomaton
+ * @brief All the patterns of the table merged into one tree of states, state 0 is the root
+ */
+struct _RuleAutomaton
+{
+    _RuleState* states;
+    size_t stateCount;
+    size_t stateCapacity;
+
+    _NumberEdge* edges;
+    size_t edgeCount;
+    size_t edgeCapacity;
+};
+
+static _RuleAutomaton  AUTOMATON     = {};
+static pthread_once_t  COMPILE_ONCE  = PTHREAD_ONCE_INIT;
+static ErrorCode       COMPILE_ERROR = EVERYTHING_FINE;
+
+static void _compileRules();
+static ErrorCode _compileRule(size_t rule);
+static ErrorCode _parseRule(const char* string, TreeNode** root);
+static ErrorCode _checkVariables(TreeNode* node, size_t* uses, size_t maxUses);
+static ErrorCode _insertPattern(TreeNode* pattern, size_t* state, size_t rule);
+static ErrorCode _follow(size_t state, TreeNode* pattern, size_t* next);
+static ErrorCode _newState(size_t* state);
+static ErrorCode _newEdge(size_t state, double number, size_t* next);
+
+static void _matchState(size_t state, TreeNode** pending, size_t pendingCount,
+                        TreeNode* node, RuleMatch* match, bool* found);
+static void _acceptRules(_RuleState* state, TreeNode* node, RuleMatch* match, bool* found);
+static bool _bindPattern(TreeNode* pattern, TreeNode* subject, TreeNode** bound);
+static bool _sameSubtree(TreeNode* first, TreeNode* second);
+static size_t _variableIndex(TreeNode* variable);
+static bool _isNumberVariable(TreeNode* variable);
+
+static TreeNodeResult _instantiate(TreeNode* pattern, TreeNode** bound, bool* taken);
+static TreeNodeResult _instantiateOperand(TreeNode* pattern, TreeNode** bound, bool* taken);
+static ErrorCode _simplifyNew(TreeNode* node);
+static ErrorCode _compute(Operation operation, double left, double right, double* number, bool* computed);
+static TreeNodeResult _newNumber(double number);
+static void _detach(TreeNode* node);
+static void _deleteChild(TreeNode* child);
+static void _moveInto(TreeNode* node, TreeNode* replacement);
+
+ErrorCode FindRule(TreeNode* node, RuleMatch* match, bool* found)
+{
+    MyAssertSoft(node, ERROR_NULLPTR);
+    MyAssertSoft(match, ERROR_NULLPTR);
+    MyAssertSoft(found, ERROR_NULLPTR);
+
+    pthread_once(&COMPILE_ONCE, _compileRules);
+    RETURN_ERROR(COMPILE_ERROR);
+
+    *found = false;
+
+    if (NODE_TYPE(node) != OPERATION_TYPE)
+        return EVERYTHING_FINE;
+
+    if (NODE_OPERATION(node) == DIV_OPERATION &&
+        NODE_TYPE(node->left) == NUMBER_TYPE && NODE_TYPE(node->right) == NUMBER_TYPE &&
+        NODE_NUMBER(node->right) == 0)
+        return ERROR_ZERO_DIVISION;
+
+    TreeNode* pending[MAX_PATTERN_SIZE + 1] = { node };
+
+    _matchState(0, pending, 1, node, match, found);
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode ApplyRule(TreeNode* node, RuleMatch* match)
+{
+    MyAssertSoft(node, ERROR_NULLPTR);
+    MyAssertSoft(match, ERROR_NULLPTR);
+    MyAssertSoft(match->rule < RULE_COUNT, ERROR_INDEX_OUT_OF_BOUNDS);
+
+    _Rule* rule = &RULES[match->rule];
+
+    // the kept subtrees go out first, so deleting the old operands leaves them alone
+    for (size_t i = 0; i < RULE_VARIABLE_COUNT; i++)
+        if (rule->used[i])
+            _detach(match->bound[i]);
+
+    _deleteChild(node->left);
+    _deleteChild(node->right);
+
+    node->left  = nullptr;
+    node->right = nullptr;
+
+    bool taken[RULE_VARIABLE_COUNT] = {};
+
+    TreeNodeResult replacementRes = _instantiate(rule->replacement, match->bound, taken);
+
+    if (replacementRes.error)
+    {
+        // what was taken is deleted with the unfinished replacement
+        for (size_t i = 0; i < RULE_VARIABLE_COUNT; i++)
+            if (rule->used[i] && !taken[i])
+                _deleteChild(match->bound[i]);
+
+        NODE_TYPE(node)   = NUMBER_TYPE;
+        NODE_NUMBER(node) = NAN;
+
+        return replacementRes.error;
+    }
+
+    _moveInto(node, replacementRes.value);
+
+    return EVERYTHING_FINE;
+}
+
+static void _compileRules()
+{
+    size_t root = 0;
+
+    COMPILE_ERROR = _newState(&root);
+    if (COMPILE_ERROR)
+        return;
+
+    for (size_t i = 0; i < RULE_COUNT && !COMPILE_ERROR; i++)
+        COMPILE_ERROR = _compileRule(i);
+}
+
+static ErrorCode _compileRule(size_t rule)
+{
+    _Rule* current = &RULES[rule];
+
+    RETURN_ERROR(_parseRule(current->patternString, &current->pattern));
+    RETURN_ERROR(_parseRule(current->replacementString, &current->replacement));
+
+    MyAssertSoft(NODE_TYPE(current->pattern) == OPERATION_TYPE, ERROR_BAD_VALUE);
+    MyAssertSoft(current->pattern->nodeCount <= MAX_PATTERN_SIZE, ERROR_BAD_SIZE);
+
+    size_t patternUses[RULE_VARIABLE_COUNT]     = {};
+    size_t replacementUses[RULE_VARIABLE_COUNT] = {};
+
+    RETURN_ERROR(_checkVariables(current->pattern, patternUses, SIZET_POISON));
+    RETURN_ERROR(_checkVariables(current->replacement, replacementUses, 1));
+
+    for (size_t i = 0; i < RULE_VARIABLE_COUNT; i++)
+    {
+        MyAssertSoft(!replacementUses[i] || patternUses[i], ERROR_BAD_VALUE);
+        current->used[i] = replacementUses[i];
+    }
+
+    size_t state = 0;
+    RETURN_ERROR(_insertPattern(current->pattern, &state, rule));
+
+    _RuleState* accepting = &AUTOMATON.states[state];
+
+    if (accepting->accepted == SIZET_POISON)
+        accepting->accepted = rule;
+    else
+        RULES[accepting->lastAccepted].next = rule;
+
+    accepting->lastAccepted = rule;
+
+    return EVERYTHING_FINE;
+}
+
+// the parser wants a string it can write to
+static ErrorCode _parseRule(const char* string, TreeNode** root)
+{
+    MyAssertSoft(strlen(string) < MAX_RULE_LENGTH, ERROR_BAD_SIZE);
+
+    char buffer[MAX_RULE_LENGTH] = "";
+    strcpy(buffer, string);
+
+    Tree tree = {};
+    RETURN_ERROR(ParseExpression(&tree, buffer));
+
+    *root = tree.root;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _checkVariables(TreeNode* node, size_t* uses, size_t maxUses)
+{
+    if (!node)
+        return EVERYTHING_FINE;
+
+    if (NODE_TYPE(node) == VARIABLE_TYPE)
+    {
+        MyAssertSoft('a' <= NODE_VAR(node) && NODE_VAR(node) <= 'z', ERROR_BAD_VALUE);
+
+        size_t index = _variableIndex(node);
+        MyAssertSoft(uses[index] < maxUses, ERROR_BAD_VALUE);
+
+        uses[index]++;
+
+        return EVERYTHING_FINE;
+    }
+
+    RETURN_ERROR(_checkVariables(node->left, uses, maxUses));
+    return _checkVariables(node->right, uses, maxUses);
+}
+
+static ErrorCode _insertPattern(TreeNode* pattern, size_t* state, size_t rule)
+{
+    if (!pattern)
+        return EVERYTHING_FINE;
+
+    RETURN_ERROR(_follow(*state, pattern, state));
+
+    if (AUTOMATON.states[*state].firstRule > rule)
+        AUTOMATON.states[*state].firstRule = rule;
+
+    RETURN_ERROR(_insertPattern(pattern->left, state, rule));
+    return _insertPattern(pattern->right, state, rule);
+}
+
+// the states may move while a new one is made, so they are only kept by index
+static ErrorCode _follow(size_t state, TreeNode* pattern, size_t* next)
+{
+    size_t found = SIZET_POISON;
+
+    switch (NODE_TYPE(pattern))
+    {
+        case OPERATION_TYPE:
+            found = AUTOMATON.states[state].operations[NODE_OPERATION(pattern)];
+            break;
+        case VARIABLE_TYPE:
+            found = _isNumberVariable(pattern) ? AUTOMATON.states[state].anyNumber
+                                               : AUTOMATON.states[state].anything;
+            break;
+        case NUMBER_TYPE:
+            for (size_t edge = AUTOMATON.states[state].numbers; edge != SIZET_POISON; edge = AUTOMATON.edges[edge].next)
+                if (AUTOMATON.edges[edge].number == NODE_NUMBER(pattern))
+                    found = AUTOMATON.edges[edge].state;
+
+            if (found == SIZET_POISON)
+                return _newEdge(state, NODE_NUMBER(pattern), next);
+            break;
+        default:
+            return ERROR_BAD_VALUE;
+    }
+
+    if (found != SIZET_POISON)
+    {
+        *next = found;
+        return EVERYTHING_FINE;
+    }
+
+    RETURN_ERROR(_newState(next));
+
+    _RuleState* current = &AUTOMATON.states[state];
+
+    if (NODE_TYPE(pattern) == OPERATION_TYPE)
+        current->operations[NODE_OPERATION(pattern)] = *next;
+    else if (_isNumberVariable(pattern))
+        current->anyNumber = *next;
+    else
+        current->anything = *next;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _newState(size_t* state)
+{
+    if (AUTOMATON.stateCount == AUTOMATON.stateCapacity)
+    {
+        size_t newCapacity = AUTOMATON.stateCapacity ? AUTOMATON.stateCapacity * 2 : AUTOMATON_START_CAPACITY;
+
+        _RuleState* newStates = (_RuleState*)realloc(AUTOMATON.states, newCapacity * sizeof(*newStates));
+        MyAssertSoft(newStates, ERROR_NO_MEMORY);
+
+        AUTOMATON.states        = newStates;
+        AUTOMATON.stateCapacity = newCapacity;
+    }
+
+    _RuleState* newState = &AUTOMATON.states[AUTOMATON.stateCount];
+
+    for (size_t i = 0; i < RULE_OPERATION_COUNT; i++)
+        newState->operations[i] = SIZET_POISON;
+
+    newState->anything     = SIZET_POISON;
+    newState->anyNumber    = SIZET_POISON;
+    newState->numbers      = SIZET_POISON;
+    newState->accepted     = SIZET_POISON;
+    newState->lastAccepted = SIZET_POISON;
+    newState->firstRule    = SIZET_POISON;
+
+    *state = AUTOMATON.stateCount++;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _newEdge(size_t state, double number, size_t* next)
+{
+    if (AUTOMATON.edgeCount == AUTOMATON.edgeCapacity)
+    {
+        size_t newCapacity = AUTOMATON.edgeCapacity ? AUTOMATON.edgeCapacity * 2 : AUTOMATON_START_CAPACITY;
+
+        _NumberEdge* newEdges = (_NumberEdge*)realloc(AUTOMATON.edges, newCapacity * sizeof(*newEdges));
+        MyAssertSoft(newEdges, ERROR_NO_MEMORY);
+
+        AUTOMATON.edges        = newEdges;
+        AUTOMATON.edgeCapacity = newCapacity;
+    }
+
+    RETURN_ERROR(_newState(next));
+
+    AUTOMATON.edges[AUTOMATON.edgeCount] = { number, *next, AUTOMATON.states[state].numbers };
+    AUTOMATON.states[state].numbers = AUTOMATON.edgeCount++;
+
+    return EVERYTHING_FINE;
+}
+
+// pending are the subtrees still to read, the next one on top. A frame reads its subject
+// from the top and puts it back before returning, so the stack is shared by all of them.
+static void _matchState(size_t state, TreeNode** pending, size_t pendingCount,
+                        TreeNode* node, RuleMatch* match, bool* found)
+{
+    _RuleState* current = &AUTOMATON.states[state];
+
+    // nothing here can beat what is found
+    if (*found && current->firstRule >= match->rule)
+        return;
+
+    if (!pendingCount)
+    {
+        _acceptRules(current, node, match, found);
+        return;
+    }
+
+    TreeNode* subject = pending[--pendingCount];
+
+    if (current->anything != SIZET_POISON)
+        _matchState(current->anything, pending, pendingCount, node, match, found);
+
+    switch (NODE_TYPE(subject))
+    {
+        case NUMBER_TYPE:
+            if (current->anyNumber != SIZET_POISON)
+                _matchState(current->anyNumber, pending, pendingCount, node, match, found);
+
+            for (size_t edge = current->numbers; edge != SIZET_POISON; edge = AUTOMATON.edges[edge].next)
+                if (IsEqual(AUTOMATON.edges[edge].number, NODE_NUMBER(subject)))
+                    _matchState(AUTOMATON.edges[edge].state, pending, pendingCount, node, match, found);
+            break;
+        case OPERATION_TYPE:
+        {
+            size_t next = current->operations[NODE_OPERATION(subject)];
+            if (next == SIZET_POISON)
+                break;
+
+            size_t count = pendingCount;
+
+            if (subject->right)
+                pending[count++] = subject->right;
+            pending[count++] = subject->left;
+
+            _matchState(next, pending, count, node, match, found);
+            break;
+        }
+        default:
+            break;
+    }
+
+    pending[pendingCount] = subject;
+}
+
+static void _acceptRules(_RuleState* state, TreeNode* node, RuleMatch* match, bool* found)
+{
+    for (size_t rule = state->accepted; rule != SIZET_POISON; rule = RULES[rule].next)
+    {
+        if (*found && rule >= match->rule)
+            return;
+
+        TreeNode* bound[RULE_VARIABLE_COUNT] = {};
+
+        if (!_bindPattern(RULES[rule].pattern, node, bound) || !RULES[rule].guard(bound))
+            continue;
+
+        match->rule = rule;
+        memcpy(match->bound, bound, sizeof(bound));
+        *found = true;
+
+        return;
+    }
+}
+
+// the shape is already known to fit, what is left are the repeated variables
+static bool _bindPattern(TreeNode* pattern, TreeNode* subject, TreeNode** bound)
+{
+    if (!pattern)
+        return true;
+
+    if (NODE_TYPE(pattern) != VARIABLE_TYPE)
+        return _bindPattern(pattern->left, subject->left, bound) &&
+               _bindPattern(pattern->right, subject->right, bound);
+
+    TreeNode** variable = &bound[_variableIndex(pattern)];
+
+    if (*variable)
+        return _sameSubtree(*variable, subject);
+
+    *variable = subject;
+
+    return true;
+}
+
+static bool _sameSubtree(TreeNode* first, TreeNode* second)
+{
+    if (!first || !second)
+        return first == second;
+
+    if (NODE_TYPE(first) != NODE_TYPE(second) || first->variables != second->variables)
+        return false;
+
+    switch (NODE_TYPE(first))
+    {
+        case NUMBER_TYPE:
+            if (NODE_NUMBER(first) != NODE_NUMBER(second))
+                return false;
+            break;
+        case VARIABLE_TYPE:
+            if (NODE_VAR(first) != NODE_VAR(second))
+                return false;
+            break;
+        case OPERATION_TYPE:
+            if (NODE_OPERATION(first) != NODE_OPERATION(second))
+                return false;
+            break;
+        default:
+            return false;
+    }
+
+    return _sameSubtree(first->left, second->left) && _sameSubtree(first->right, second->right);
+}
+
+static size_t _variableIndex(TreeNode* variable)
+{
+    return (size_t)(NODE_VAR(variable) - 'a');
+}
+
+// a, b and c stand for numbers
+static bool _isNumberVariable(TreeNode* variable)
+{
+    return NODE_VAR(variable) <= 'c';
+}
+
+static TreeNodeResult _instantiate(TreeNode* pattern, TreeNode** bound, bool* taken)
+{
+    switch (NODE_TYPE(pattern))
+    {
+        case VARIABLE_TYPE:
+            taken[_variableIndex(pattern)] = true;
+            return { bound[_variableIndex(pattern)], EVERYTHING_FINE };
+        case NUMBER_TYPE:
+            return _newNumber(NODE_NUMBER(pattern));
+        case OPERATION_TYPE:
+            break;
+        default:
+            return { nullptr, ERROR_BAD_VALUE };
+    }
+
+    TreeNodeResult leftRes = _instantiateOperand(pattern->left, bound, taken);
+    RETURN_ERROR_RESULT(leftRes, nullptr);
+
+    TreeNode* left  = leftRes.value;
+    TreeNode* right = nullptr;
+
+    if (pattern->right)
+    {
+        TreeNodeResult rightRes = _instantiateOperand(pattern->right, bound, taken);
+        RETURN_ERROR_RESULT(rightRes, nullptr, left->Delete());
+
+        right = rightRes.value;
+    }
+
+    if (right && NODE_TYPE(left) == NUMBER_TYPE && NODE_TYPE(right) == NUMBER_TYPE)
+    {
+        double number = 0;
+        bool computed = false;
+
+        ErrorCode error = _compute(NODE_OPERATION(pattern), NODE_NUMBER(left), NODE_NUMBER(right),
+                                   &number, &computed);
+
+        if (error || computed)
+        {
+            left->Delete();
+            right->Delete();
+
+            if (error)
+                return { nullptr, error };
+
+            return _newNumber(number);
+        }
+    }
+
+    TreeNodeResult nodeRes = TreeNode::New({}, left, right);
+    RETURN_ERROR_RESULT(nodeRes, nullptr, left->Delete(); if (right) right->Delete());
+
+    TreeNode* node = nodeRes.value;
+
+    NODE_TYPE(node)      = OPERATION_TYPE;
+    NODE_OPERATION(node) = NODE_OPERATION(pattern);
+    UPDATE_PRIORITY(node);
+
+    return nodeRes;
+}
+
+// the top of the replacement is simplified by whoever applies the rule, the new nodes below it here
+static TreeNodeResult _instantiateOperand(TreeNode* pattern, TreeNode** bound, bool* taken)
+{
+    TreeNodeResult operandRes = _instantiate(pattern, bound, taken);
+    RETURN_ERROR_RESULT(operandRes, nullptr);
+
+    if (NODE_TYPE(pattern) != OPERATION_TYPE)
+        return operandRes;
+
+    ErrorCode error = _simplifyNew(operandRes.value);
+    if (error)
+    {
+        operandRes.value->Delete();
+        return { nullptr, error };
+    }
+
+    return operandRes;
+}
+
+static ErrorCode _simplifyNew(TreeNode* node)
+{
+    bool found = true;
+
+    while (found && NODE_TYPE(node) == OPERATION_TYPE)
+    {
+        RuleMatch match = {};
+
+        RETURN_ERROR(FindRule(node, &match, &found));
+
+        if (found)
+            RETURN_ERROR(ApplyRule(node, &match));
+    }
+
+    node->UpdateCounts();
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _compute(Operation operation, double left, double right, double* number, bool* computed)
+{
+    *computed = true;
+
+    switch (operation)
+    {
+        case ADD_OPERATION:
+            *number = left + right;
+            break;
+        case SUB_OPERATION:
+            *number = left - right;
+            break;
+        case MUL_OPERATION:
+            *number = left * right;
+            break;
+        case DIV_OPERATION:
+            if (right == 0)
+                return ERROR_ZERO_DIVISION;
+            *number = left / right;
+            break;
+        case POWER_OPERATION:
+            *number = pow(left, right);
+            break;
+        default:
+            *computed = false;
+            break;
+    }
+
+    return EVERYTHING_FINE;
+}
+
+static TreeNodeResult _newNumber(double number)
+{
+    TreeNodeResult nodeRes = TreeNode::New({}, nullptr, nullptr);
+    RETURN_ERROR_RESULT(nodeRes, nullptr);
+
+    NODE_TYPE(nodeRes.value)   = NUMBER_TYPE;
+    NODE_NUMBER(nodeRes.value) = number;
+
+    return nodeRes;
+}
+
+static void _detach(TreeNode* node)
+{
+    TreeNode* parent = node->parent;
+
+    if (parent->left == node)
+        parent->left = nullptr;
+    else
+        parent->right = nullptr;
+
+    node->parent = nullptr;
+}
+
+// detached first, so that Delete does not recount all the way up to the root
+static void _deleteChild(TreeNode* child)
+{
+    if (!child)
+        return;
+
+    child->parent = nullptr;
+    child->Delete();
+}
+
+static void _moveInto(TreeNode* node, TreeNode* replacement)
+{
+    node->value = replacement->value;
+    node->left  = replacement->left;
+    node->right = replacement->right;
+
+    if (node->left)
+        node->left->parent = node;
+    if (node->right)
+        node->right->parent = node;
+
+    replacement->value     = {};
+    replacement->left      = nullptr;
+    replacement->right     = nullptr;
+    replacement->parent    = nullptr;
+    #ifdef SIZE_VERIFICATION
+    replacement->nodeCount = SIZET_POISON;
+    #endif
+    replacement->id        = BAD_ID;
+
+    free(replacement);
+}
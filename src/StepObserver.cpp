@@ -0,0 +1,217 @@
+#include "StepObserver.hpp"
+#include "LatexWriter.hpp"
+#include "DiffTreeDSL.hpp"
+
+static ErrorCode _latexDerivativeStart   (void* data, TreeNode* function);
+static ErrorCode _latexLeafDerivative    (void* data, TreeNode* leaf, TreeNode* derivative);
+static ErrorCode _latexNeedDerivative    (void* data, TreeNode* node);
+static ErrorCode _latexFoundDerivative   (void* data, TreeNode* node, TreeNode* derivative);
+static ErrorCode _latexRepeatedDerivative(void* data, TreeNode* node, TreeNode* derivative);
+static ErrorCode _latexOptimiseStart     (void* data, TreeNode* root);
+static ErrorCode _latexSimplifyStart     (void* data, TreeNode* node);
+static ErrorCode _latexSimplified        (void* data, TreeNode* node);
+
+static ErrorCode _countDerivativeStart   (void* data, TreeNode* function);
+static ErrorCode _countLeafDerivative    (void* data, TreeNode* leaf, TreeNode* derivative);
+static ErrorCode _countFoundDerivative   (void* data, TreeNode* node, TreeNode* derivative);
+static ErrorCode _countRepeatedDerivative(void* data, TreeNode* node, TreeNode* derivative);
+static ErrorCode _countOptimiseStart     (void* data, TreeNode* root);
+static ErrorCode _countSimplified        (void* data, TreeNode* node);
+
+StepObserver LatexObserver(FILE* texFile)
+{
+    StepObserver observer = {};
+
+    observer.data               = texFile;
+    observer.derivativeStart    = _latexDerivativeStart;
+    observer.leafDerivative     = _latexLeafDerivative;
+    observer.needDerivative     = _latexNeedDerivative;
+    observer.foundDerivative    = _latexFoundDerivative;
+    observer.repeatedDerivative = _latexRepeatedDerivative;
+    observer.optimiseStart      = _latexOptimiseStart;
+    observer.simplifyStart      = _latexSimplifyStart;
+    observer.simplified         = _latexSimplified;
+
+    return observer;
+}
+
+StepObserver CountingObserver(StepCounts* counts)
+{
+    StepObserver observer = {};
+
+    observer.data               = counts;
+    observer.derivativeStart    = _countDerivativeStart;
+    observer.leafDerivative     = _countLeafDerivative;
+    observer.foundDerivative    = _countFoundDerivative;
+    observer.repeatedDerivative = _countRepeatedDerivative;
+    observer.optimiseStart      = _countOptimiseStart;
+    observer.simplified         = _countSimplified;
+
+    return observer;
+}
+
+static ErrorCode _latexDerivativeStart(void* data, TreeNode* function)
+{
+    FILE* texFile = (FILE*)data;
+    MyAssertSoft(texFile, ERROR_BAD_FILE);
+    MyAssertSoft(function, ERROR_NULLPTR);
+
+    fprintf(texFile, "Найдем производную\n\\newline\n\\[");
+    RETURN_ERROR(LatexWrite(function, texFile));
+    fprintf(texFile, "\\]\n");
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _latexLeafDerivative(void* data, TreeNode* leaf, TreeNode* derivative)
+{
+    FILE* texFile = (FILE*)data;
+    MyAssertSoft(texFile, ERROR_BAD_FILE);
+    MyAssertSoft(leaf, ERROR_NULLPTR);
+    MyAssertSoft(derivative, ERROR_NULLPTR);
+
+    if (NODE_TYPE(leaf) == VARIABLE_TYPE)
+        fprintf(texFile, "Видно, что $%c' = %lg$\n\\newline\n", NODE_VAR(leaf), NODE_NUMBER(derivative));
+    else
+        fprintf(texFile, "Видно, что $%lg' = %lg$\n\\newline\n", NODE_NUMBER(leaf), NODE_NUMBER(derivative));
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _latexNeedDerivative(void* data, TreeNode* node)
+{
+    FILE* texFile = (FILE*)data;
+    MyAssertSoft(texFile, ERROR_BAD_FILE);
+    MyAssertSoft(node, ERROR_NULLPTR);
+
+    fprintf(texFile, "Необходимо найти $");
+    if (NODE_TYPE(node) == OPERATION_TYPE)
+        fprintf(texFile, "(");
+
+    RETURN_ERROR(LatexWrite(node, texFile));
+
+    if (NODE_TYPE(node) == OPERATION_TYPE)
+        fprintf(texFile, ")");
+    fprintf(texFile, "'$\n\\newline\n");
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _latexFoundDerivative(void* data, TreeNode* node, TreeNode* derivative)
+{
+    FILE* texFile = (FILE*)data;
+    MyAssertSoft(texFile, ERROR_BAD_FILE);
+    MyAssertSoft(node, ERROR_NULLPTR);
+    MyAssertSoft(derivative, ERROR_NULLPTR);
+
+    fprintf(texFile, "%s\n\\newline\n", GetRandomMathComment());
+    fprintf(texFile, "\\[(");
+    RETURN_ERROR(LatexWrite(node, texFile));
+    fprintf(texFile, ")' = ");
+    RETURN_ERROR(LatexWrite(derivative, texFile));
+    fprintf(texFile, "\\]\n");
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _latexRepeatedDerivative(void* data, TreeNode* node, TreeNode* derivative)
+{
+    FILE* texFile = (FILE*)data;
+    MyAssertSoft(texFile, ERROR_BAD_FILE);
+
+    fprintf(texFile, "Эту производную мы уже находили\n\\newline\n");
+
+    return _latexFoundDerivative(data, node, derivative);
+}
+
+static ErrorCode _latexOptimiseStart(void* data, TreeNode* root)
+{
+    FILE* texFile = (FILE*)data;
+    MyAssertSoft(texFile, ERROR_BAD_FILE);
+    MyAssertSoft(root, ERROR_NULLPTR);
+
+    fprintf(texFile, "Упростим\n\\newline\n\\[");
+    RETURN_ERROR(LatexWrite(root, texFile));
+    fprintf(texFile, "\\]\n");
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _latexSimplifyStart(void* data, TreeNode* node)
+{
+    FILE* texFile = (FILE*)data;
+    MyAssertSoft(texFile, ERROR_BAD_FILE);
+    MyAssertSoft(node, ERROR_NULLPTR);
+
+    fprintf(texFile, "%s\n\\[", GetRandomMathComment());
+    RETURN_ERROR(LatexWrite(node, texFile));
+    fprintf(texFile, "=");
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _latexSimplified(void* data, TreeNode* node)
+{
+    FILE* texFile = (FILE*)data;
+    MyAssertSoft(texFile, ERROR_BAD_FILE);
+    MyAssertSoft(node, ERROR_NULLPTR);
+
+    RETURN_ERROR(LatexWrite(node, texFile));
+    fprintf(texFile, "\\]\n");
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _countDerivativeStart(void* data, TreeNode*)
+{
+    MyAssertSoft(data, ERROR_NULLPTR);
+
+    ((StepCounts*)data)->derivatives++;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _countLeafDerivative(void* data, TreeNode*, TreeNode*)
+{
+    MyAssertSoft(data, ERROR_NULLPTR);
+
+    ((StepCounts*)data)->leafDerivatives++;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _countFoundDerivative(void* data, TreeNode*, TreeNode*)
+{
+    MyAssertSoft(data, ERROR_NULLPTR);
+
+    ((StepCounts*)data)->foundDerivatives++;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _countRepeatedDerivative(void* data, TreeNode*, TreeNode*)
+{
+    MyAssertSoft(data, ERROR_NULLPTR);
+
+    ((StepCounts*)data)->repeatedDerivatives++;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _countOptimiseStart(void* data, TreeNode*)
+{
+    MyAssertSoft(data, ERROR_NULLPTR);
+
+    ((StepCounts*)data)->optimisations++;
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _countSimplified(void* data, TreeNode*)
+{
+    MyAssertSoft(data, ERROR_NULLPTR);
+
+    ((StepCounts*)data)->simplifications++;
+
+    return EVERYTHING_FINE;
+}
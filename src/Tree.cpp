@@ -20,9 +20,9 @@ static FILE* HTML_FILE = NULL;
 
 static TreeNodeResult _recCopy(TreeNode* node);
 
-#ifdef SIZE_VERIFICATION
-static ErrorCode _recUpdateParentNodeCount(TreeNode* node);
-#endif
+static void _updateNode(TreeNode* node);
+
+static ErrorCode _recUpdateParent(TreeNode* node);
 
 static TreeNodeCountResult _recCountNodes(TreeNode* node);
 
@@ -64,6 +64,9 @@ case name:                                                    \
     case VARIABLE_TYPE:
         fprintf(file, "var: %c", treeEl->value.var);
         break;
+    case DERIVATIVE_TYPE:
+        fprintf(file, "d/d%c", treeEl->value.var);
+        break;
     default:
         fprintf(stderr, "ERROR ELEMENT\n");
         break;
@@ -80,31 +83,20 @@ TreeNodeResult TreeNode::New(TreeElement_t value, TreeNode* left, TreeNode* righ
 
     node->value = value;
 
-    #ifdef SIZE_VERIFICATION
-    node->nodeCount = 1;
-    #endif
-
     if (left)
-    {
         left->parent = node;
-        #ifdef SIZE_VERIFICATION
-        node->nodeCount += left->nodeCount;
-        #endif
-    }
     node->left = left;
 
     if (right)
-    {
         right->parent = node;
-        #ifdef SIZE_VERIFICATION
-        node->nodeCount += right->nodeCount;
-        #endif
-    }
     node->right = right;
 
+    _updateNode(node);
+
     node->parent = nullptr;
 
-    node->id = CURRENT_ID++;
+    // nodes are made by several threads in DifferentiateParallel
+    node->id = __atomic_fetch_add(&CURRENT_ID, 1, __ATOMIC_RELAXED);
 
     if (NODE_TYPE(node) == OPERATION_TYPE)
     {
@@ -148,9 +140,7 @@ ErrorCode TreeNode::Delete()
         else
             return ERROR_TREE_LOOP;
 
-        #ifdef SIZE_VERIFICATION
-        _recUpdateParentNodeCount(this->parent);
-        #endif
+        _recUpdateParent(this->parent);
     }
 
     if (this->left)
@@ -194,23 +184,13 @@ ErrorCode TreeNode::SetLeft(TreeNode* left)
 {
     this->left = left;
 
-    #ifdef SIZE_VERIFICATION
-    this->nodeCount = 1;
-
-    if (left)
-        this->nodeCount += left->nodeCount;
-
-    if (this->right)
-        this->nodeCount += this->right->nodeCount;
-    #endif
-
     if (left)
         left->parent = this;
 
-    #ifdef SIZE_VERIFICATION
+    _updateNode(this);
+
     if (this->parent)
-        return _recUpdateParentNodeCount(this->parent);
-    #endif
+        return _recUpdateParent(this->parent);
 
     return EVERYTHING_FINE;
 }
@@ -219,27 +199,22 @@ ErrorCode TreeNode::SetRight(TreeNode* right)
 {
     this->right = right;
 
-    #ifdef SIZE_VERIFICATION
-    this->nodeCount = 1;
-
-    if (this->left)
-        this->nodeCount += this->left->nodeCount;
-
-    if (right)
-        this->nodeCount += right->nodeCount;
-    #endif
-
     if (right)
         right->parent = this;
 
-    #ifdef SIZE_VERIFICATION
+    _updateNode(this);
+
     if (this->parent)
-        return _recUpdateParentNodeCount(this->parent);
-    #endif
+        return _recUpdateParent(this->parent);
 
     return EVERYTHING_FINE;
 }
 
+void TreeNode::UpdateCounts()
+{
+    _updateNode(this);
+}
+
 static TreeNodeResult _recCopy(TreeNode* node)
 {
     MyAssertSoftResult(node, nullptr, ERROR_NULLPTR);
@@ -290,36 +265,54 @@ static TreeNodeResult _recCopy(TreeNode* node)
     return copy;
 }
 
-#ifdef SIZE_VERIFICATION
-static ErrorCode _recUpdateParentNodeCount(TreeNode* node)
+// what a node knows about its subtree, from its value and its children
+static void _updateNode(TreeNode* node)
 {
-    MyAssertSoft(node, ERROR_NULLPTR);
-    if (node->id == BAD_ID)
-        return ERROR_TREE_LOOP;
-
-    size_t oldId = node->id;
-    node->id = BAD_ID;
-
+    #ifdef SIZE_VERIFICATION
     node->nodeCount = 1;
+    #endif
+
+    node->variables = NODE_TYPE(node) == VARIABLE_TYPE ? VariableBit(NODE_VAR(node)) : 0;
 
     if (node->left)
+    {
+        #ifdef SIZE_VERIFICATION
         node->nodeCount += node->left->nodeCount;
+        #endif
+        node->variables |= node->left->variables;
+    }
 
     if (node->right)
+    {
+        #ifdef SIZE_VERIFICATION
         node->nodeCount += node->right->nodeCount;
+        #endif
+        node->variables |= node->right->variables;
+    }
+}
+
+static ErrorCode _recUpdateParent(TreeNode* node)
+{
+    MyAssertSoft(node, ERROR_NULLPTR);
+    if (node->id == BAD_ID)
+        return ERROR_TREE_LOOP;
+
+    size_t oldId = node->id;
+    node->id = BAD_ID;
+
+    _updateNode(node);
 
     if (node->parent)
     {
         if (node->parent->left != node && node->parent->right != node)
             return ERROR_TREE_LOOP;
-        RETURN_ERROR(_recUpdateParentNodeCount(node->parent));
+        RETURN_ERROR(_recUpdateParent(node->parent));
     }
 
     node->id = oldId;
 
     return EVERYTHING_FINE;
 }
-#endif
 
 ErrorCode Tree::Init(TreeNode* root)
 {
@@ -444,18 +437,12 @@ ErrorCode _recRecalcNodes(TreeNode* node)
     size_t oldId = node->id;
     node->id = BAD_ID;
 
-    node->nodeCount = 1;
-
     if (node->left)
-    {
         RETURN_ERROR(_recRecalcNodes(node->left));
-        node->nodeCount += node->left->nodeCount;
-    }
     if (node->right)
-    {
         RETURN_ERROR(_recRecalcNodes(node->right));
-        node->nodeCount += node->right->nodeCount;
-    }
+
+    _updateNode(node);
 
     node->id = oldId;
 
@@ -468,6 +455,7 @@ ErrorCode _recRecalcNodes(TreeNode* node)
 #define NODE_COLOR_OP "\"#f18f8f\""
 #define NODE_COLOR_NUM "\"#eee7a0\""
 #define NODE_COLOR_VAR "\"#a7e989\""
+#define NODE_COLOR_DERIVATIVE "\"#8fc4f1\""
 #define BACK_GROUND_COLOR "\"#de97d4\""
 #define TREE_COLOR "\"#ff7be9\""
 #define NODE_COLOR "\"#fae1f6\""
@@ -481,6 +469,10 @@ ErrorCode Tree::Dump()
 
     MyAssertSoft(this->root, ERROR_NO_ROOT);
 
+    // every node is drawn, so every lazy one is reached, a broken tree is drawn as it is
+    if (!this->Verify())
+        RETURN_ERROR(ExpandDerivatives(this));
+
     if (HTML_FILE)
         fprintf(HTML_FILE,
         "<h1>Iteration %zu</h1>\n"
@@ -530,6 +522,9 @@ ErrorCode Tree::Dump()
         case VARIABLE_TYPE:
             fprintf(outGraphFile, "fillcolor = " NODE_COLOR_VAR ", ");
             break;
+        case DERIVATIVE_TYPE:
+            fprintf(outGraphFile, "fillcolor = " NODE_COLOR_DERIVATIVE ", ");
+            break;
         default:
             return ERROR_BAD_VALUE;
     }
@@ -587,6 +582,9 @@ static ErrorCode _recBuildCellTemplatesGraph(TreeNode* node, FILE* outGraphFile,
         case VARIABLE_TYPE:
             fprintf(outGraphFile, "fillcolor = " NODE_COLOR_VAR ", ");
             break;
+        case DERIVATIVE_TYPE:
+            fprintf(outGraphFile, "fillcolor = " NODE_COLOR_DERIVATIVE ", ");
+            break;
         default:
             return ERROR_BAD_VALUE;
     }
@@ -0,0 +1,302 @@
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "VectorMath.hpp"
+#include "MinMax.hpp"
+
+const char* const VECTOR_MATH_ISA_NAMES[] =
+{
+    "libm", "scalar", "avx2", "avx512",
+};
+
+typedef void (*VecFunction_t)(const double* x, double* y, size_t count);
+
+struct VectorMathTable
+{
+    VecFunction_t sin;
+    VecFunction_t cos;
+    VecFunction_t tan;
+    VecFunction_t arcsin;
+    VecFunction_t arccos;
+    VecFunction_t arctan;
+    VecFunction_t exp;
+    VecFunction_t ln;
+};
+
+// 1.5 * 2 ^ 52, adding it rounds a double to an integer that lands in the low mantissa bits
+static const double VEC_ROUND_MAGIC = 6755399441055744.0;
+static const double VEC_ROUND_MAX   = 2251799813685248.0; // 2 ^ 51
+
+static const double  VEC_DOUBLE_MIN            = DBL_MIN;
+static const double  VEC_SUBNORMAL_SCALE       = 18014398509481984.0; // 2 ^ 54
+static const int64_t VEC_SUBNORMAL_SCALE_LOG2  = 54;
+static const int64_t VEC_MANTISSA_MASK         = 0x000fffffffffffff;
+static const int64_t VEC_ONE_BITS              = 0x3ff0000000000000;
+
+static const double VEC_LOG2E  = 1.44269504088896338700e+00;
+static const double VEC_LN2_HI = 6.93147180369123816490e-01;
+static const double VEC_LN2_LO = 1.90821492927058770002e-10;
+
+static const double VEC_EXP_MAX       =  709.782712893383973096;
+static const double VEC_EXP_MIN       = -745.133219101941108420;
+static const double VEC_EXP_CLAMP_MAX =  710;
+static const double VEC_EXP_CLAMP_MIN = -746;
+
+// 1 / n! from n = 13 down to 2
+static const double VEC_EXP_COEFFS[] =
+{
+    1.6059043836821614599e-10, 2.0876756987868098979e-09, 2.5052108385441718775e-08,
+    2.7557319223985890653e-07, 2.7557319223985890653e-06, 2.4801587301587301587e-05,
+    1.9841269841269841270e-04, 1.3888888888888888889e-03, 8.3333333333333333333e-03,
+    4.1666666666666666667e-02, 1.6666666666666666667e-01, 5.0000000000000000000e-01,
+};
+
+// fdlibm e_log.c Lg1 .. Lg7
+static const double VEC_LN_COEFFS[] =
+{
+    6.666666666666735130e-01, 3.999999999940941908e-01, 2.857142874366239149e-01,
+    2.222219843214978396e-01, 1.818357216161805012e-01, 1.531383769920937332e-01,
+    1.479819860511658591e-01,
+};
+
+// fdlibm k_sin.c S1 .. S6 and k_cos.c C1 .. C6
+static const double VEC_SIN_COEFFS[] =
+{
+    -1.66666666666666324348e-01,  8.33333333332248946124e-03, -1.98412698298579493134e-04,
+     2.75573137070700676789e-06, -2.50507602534068634195e-08,  1.58969099521155010221e-10,
+};
+
+static const double VEC_COS_COEFFS[] =
+{
+     4.16666666666666019037e-02, -1.38888888888741095749e-03,  2.48015872894767294178e-05,
+    -2.75573143513906633035e-07,  2.08757232129817482790e-09, -1.13596475577881948265e-11,
+};
+
+// pi / 2 in 33 bit parts, from fdlibm e_rem_pio2.c
+static const double VEC_PI2_1      = 1.57079632673412561417e+00;
+static const double VEC_PI2_2      = 6.07710050630396597660e-11;
+static const double VEC_PI2_3      = 2.02226624871116645580e-21;
+static const double VEC_PI2_3_TAIL = 8.47842766036889956997e-32;
+
+// above this k * VEC_PI2_1 stops being exact soon, libm does the big reductions
+static const double VEC_SIN_COS_MAX = 1e5;
+
+// fdlibm s_atan.c aT[0] .. aT[10]
+static const double VEC_ATAN_COEFFS[] =
+{
+     3.33333333333329318027e-01, -1.99999999998764832476e-01,  1.42857142725034663711e-01,
+    -1.11111104054623557880e-01,  9.09088713343650656196e-02, -7.69187620504482999495e-02,
+     6.66107313738753120669e-02, -5.83357013379057348645e-02,  4.97687799461593236017e-02,
+    -3.65315727442169155270e-02,  1.62858201153657823623e-02,
+};
+
+// fdlibm s_atan.c, arctan(0.5), arctan(1), arctan(1.5), arctan(inf) and where they are used
+static const double VEC_ATAN_BOUNDS[] = { 0.4375, 0.6875, 1.1875, 2.4375 };
+
+static const double VEC_ATAN_HI[] =
+{
+    4.63647609000806093515e-01, 7.85398163397448278999e-01,
+    9.82793723247329054082e-01, 1.57079632679489655800e+00,
+};
+
+static const double VEC_ATAN_LO[] =
+{
+    2.26987774529616870924e-17, 3.06161699786838301793e-17,
+    1.39033110312309984516e-17, 6.12323399573676603587e-17,
+};
+
+#define VEC_NAME(name) name ## Scalar
+#define VEC_WIDTH 1
+#define VEC_SQRT(x) sqrt(x)
+typedef double  VecDouble_t;
+typedef int64_t VecInt_t;
+#include "VectorMathKernels.hpp"
+#undef VEC_NAME
+#undef VEC_WIDTH
+#undef VEC_SQRT
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#define VEC_NAME(name) name ## Avx2
+#define VEC_WIDTH 4
+#define VecDouble_t VecDoubleAvx2_t
+#define VecInt_t    VecIntAvx2_t
+#define VEC_SQRT(x) ((VecDouble_t)_mm256_sqrt_pd((__m256d)(x)))
+typedef double  VecDoubleAvx2_t __attribute__((vector_size(VEC_WIDTH * sizeof(double))));
+typedef int64_t VecIntAvx2_t    __attribute__((vector_size(VEC_WIDTH * sizeof(int64_t))));
+#include "VectorMathKernels.hpp"
+#undef VEC_NAME
+#undef VEC_WIDTH
+#undef VEC_SQRT
+#undef VecDouble_t
+#undef VecInt_t
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq,fma")
+#define VEC_NAME(name) name ## Avx512
+#define VEC_WIDTH 8
+#define VecDouble_t VecDoubleAvx512_t
+#define VecInt_t    VecIntAvx512_t
+#define VEC_SQRT(x) ((VecDouble_t)_mm512_maskz_sqrt_pd(0xff, (__m512d)(x)))
+typedef double  VecDoubleAvx512_t __attribute__((vector_size(VEC_WIDTH * sizeof(double))));
+typedef int64_t VecIntAvx512_t    __attribute__((vector_size(VEC_WIDTH * sizeof(int64_t))));
+#include "VectorMathKernels.hpp"
+#undef VEC_NAME
+#undef VEC_WIDTH
+#undef VEC_SQRT
+#undef VecDouble_t
+#undef VecInt_t
+#pragma GCC pop_options
+
+#endif
+
+#define DEF_LIBM_ARRAY(name, function)                                  \
+static void name(const double* x, double* y, size_t count)              \
+{                                                                       \
+    for (size_t i = 0; i < count; i++)                                  \
+        y[i] = function(x[i]);                                          \
+}
+
+DEF_LIBM_ARRAY(_libmSin,    sin)
+DEF_LIBM_ARRAY(_libmCos,    cos)
+DEF_LIBM_ARRAY(_libmTan,    tan)
+DEF_LIBM_ARRAY(_libmArcsin, asin)
+DEF_LIBM_ARRAY(_libmArccos, acos)
+DEF_LIBM_ARRAY(_libmArctan, atan)
+DEF_LIBM_ARRAY(_libmExp,    exp)
+DEF_LIBM_ARRAY(_libmLn,     log)
+
+#undef DEF_LIBM_ARRAY
+
+static const VectorMathTable LIBM_TABLE =
+{
+    _libmSin,    _libmCos,    _libmTan,
+    _libmArcsin, _libmArccos, _libmArctan,
+    _libmExp,    _libmLn,
+};
+
+static VectorMathIsa          _currentIsa   = VECTOR_MATH_LIBM;
+static const VectorMathTable* _currentTable = nullptr;
+
+static bool _isaSupported(VectorMathIsa isa);
+
+static const VectorMathTable* _getTable();
+
+static bool _isaSupported(VectorMathIsa isa)
+{
+    switch (isa)
+    {
+        case VECTOR_MATH_LIBM:
+        case VECTOR_MATH_SCALAR:
+            return true;
+        #if defined(__x86_64__) || defined(__i386__)
+        case VECTOR_MATH_AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case VECTOR_MATH_AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+        #endif
+        default:
+            return false;
+    }
+}
+
+VectorMathIsa VectorMathBestIsa()
+{
+    if (_isaSupported(VECTOR_MATH_AVX512))
+        return VECTOR_MATH_AVX512;
+    if (_isaSupported(VECTOR_MATH_AVX2))
+        return VECTOR_MATH_AVX2;
+
+    return VECTOR_MATH_SCALAR;
+}
+
+VectorMathIsa VectorMathGetIsa()
+{
+    _getTable();
+
+    return _currentIsa;
+}
+
+ErrorCode VectorMathSetIsa(VectorMathIsa isa)
+{
+    if (!_isaSupported(isa))
+        return ERROR_BAD_VALUE;
+
+    switch (isa)
+    {
+        case VECTOR_MATH_LIBM:
+            _currentTable = &LIBM_TABLE;
+            break;
+        case VECTOR_MATH_SCALAR:
+            _currentTable = &TABLEScalar;
+            break;
+        #if defined(__x86_64__) || defined(__i386__)
+        case VECTOR_MATH_AVX2:
+            _currentTable = &TABLEAvx2;
+            break;
+        case VECTOR_MATH_AVX512:
+            _currentTable = &TABLEAvx512;
+            break;
+        #endif
+        default:
+            return ERROR_BAD_VALUE;
+    }
+
+    _currentIsa = isa;
+
+    return EVERYTHING_FINE;
+}
+
+static const VectorMathTable* _getTable()
+{
+    if (!_currentTable)
+        VectorMathSetIsa(VectorMathBestIsa());
+
+    return _currentTable;
+}
+
+void VecSin(const double* x, double* y, size_t count)
+{
+    _getTable()->sin(x, y, count);
+}
+
+void VecCos(const double* x, double* y, size_t count)
+{
+    _getTable()->cos(x, y, count);
+}
+
+void VecTan(const double* x, double* y, size_t count)
+{
+    _getTable()->tan(x, y, count);
+}
+
+void VecArcsin(const double* x, double* y, size_t count)
+{
+    _getTable()->arcsin(x, y, count);
+}
+
+void VecArccos(const double* x, double* y, size_t count)
+{
+    _getTable()->arccos(x, y, count);
+}
+
+void VecArctan(const double* x, double* y, size_t count)
+{
+    _getTable()->arctan(x, y, count);
+}
+
+void VecExp(const double* x, double* y, size_t count)
+{
+    _getTable()->exp(x, y, count);
+}
+
+void VecLn(const double* x, double* y, size_t count)
+{
+    _getTable()->ln(x, y, count);
+}
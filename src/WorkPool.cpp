@@ -0,0 +1,283 @@
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include "WorkPool.hpp"
+
+static const size_t DEQUE_START_CAPACITY = 16;
+
+// the pool and worker the current thread belongs to
+static thread_local WorkPool* CURRENT_POOL   = nullptr;
+static thread_local size_t    CURRENT_WORKER = 0;
+
+struct _WorkerStart
+{
+    WorkPool* pool;
+    size_t index;
+};
+
+static void* _workerMain(void* arg);
+
+static ErrorCode _pushTask(WorkDeque* deque, WorkTask* task);
+
+static WorkTask* _popTask(WorkDeque* deque);
+
+static WorkTask* _stealTask(WorkDeque* deque);
+
+static WorkTask* _findTask(WorkPool* pool, size_t worker);
+
+static void _runTask(WorkTask* task);
+
+ErrorCode WorkPool::Init(size_t workerCount)
+{
+    *this = {};
+
+    if (!workerCount)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workerCount = cpus > 0 ? (size_t)cpus : 1;
+    }
+
+    pthread_mutex_init(&this->runMutex, nullptr);
+    pthread_mutex_init(&this->sleepMutex, nullptr);
+    pthread_cond_init(&this->sleepCondition, nullptr);
+
+    this->deques = (WorkDeque*)calloc(workerCount, sizeof(*this->deques));
+    MyAssertSoft(this->deques, ERROR_NO_MEMORY, this->Destructor());
+
+    this->threads = (pthread_t*)calloc(workerCount, sizeof(*this->threads));
+    MyAssertSoft(this->threads, ERROR_NO_MEMORY, this->Destructor());
+
+    for (size_t i = 0; i < workerCount; i++)
+        pthread_mutex_init(&this->deques[i].mutex, nullptr);
+
+    this->workerCount = workerCount;
+
+    // worker 0 is whoever calls Run
+    for (size_t i = 1; i < workerCount; i++)
+    {
+        _WorkerStart* start = (_WorkerStart*)calloc(1, sizeof(*start));
+        MyAssertSoft(start, ERROR_NO_MEMORY, this->workerCount = i; this->Destructor());
+
+        *start = { this, i };
+
+        if (pthread_create(&this->threads[i], nullptr, _workerMain, start))
+        {
+            free(start);
+            this->workerCount = i;
+            this->Destructor();
+            return ERROR_NO_MEMORY;
+        }
+    }
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode WorkPool::Run(WorkTask* task)
+{
+    MyAssertSoft(task, ERROR_NULLPTR);
+    MyAssertSoft(this->deques, ERROR_NULLPTR);
+
+    pthread_mutex_lock(&this->runMutex);
+
+    WorkPool* outerPool   = CURRENT_POOL;
+    size_t    outerWorker = CURRENT_WORKER;
+
+    CURRENT_POOL   = this;
+    CURRENT_WORKER = 0;
+
+    _runTask(task);
+
+    CURRENT_POOL   = outerPool;
+    CURRENT_WORKER = outerWorker;
+
+    pthread_mutex_unlock(&this->runMutex);
+
+    return task->error;
+}
+
+ErrorCode WorkPool::Spawn(WorkTask* task)
+{
+    MyAssertSoft(task, ERROR_NULLPTR);
+
+    task->done = false;
+
+    if (CURRENT_POOL != this)
+    {
+        _runTask(task);
+        return EVERYTHING_FINE;
+    }
+
+    RETURN_ERROR(_pushTask(&this->deques[CURRENT_WORKER], task));
+
+    __atomic_add_fetch(&this->pending, 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&this->sleepMutex);
+    pthread_cond_signal(&this->sleepCondition);
+    pthread_mutex_unlock(&this->sleepMutex);
+
+    return EVERYTHING_FINE;
+}
+
+ErrorCode WorkPool::Wait(WorkTask* task)
+{
+    MyAssertSoft(task, ERROR_NULLPTR);
+
+    while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE))
+    {
+        WorkTask* other = CURRENT_POOL == this ? _findTask(this, CURRENT_WORKER) : nullptr;
+
+        if (other)
+            _runTask(other);
+        else
+            sched_yield();
+    }
+
+    return task->error;
+}
+
+ErrorCode WorkPool::Destructor()
+{
+    pthread_mutex_lock(&this->sleepMutex);
+    this->stop = true;
+    pthread_cond_broadcast(&this->sleepCondition);
+    pthread_mutex_unlock(&this->sleepMutex);
+
+    for (size_t i = 1; i < this->workerCount; i++)
+        pthread_join(this->threads[i], nullptr);
+
+    if (this->deques)
+    {
+        for (size_t i = 0; i < this->workerCount; i++)
+        {
+            pthread_mutex_destroy(&this->deques[i].mutex);
+            free(this->deques[i].tasks);
+        }
+    }
+
+    free(this->deques);
+    free(this->threads);
+
+    pthread_mutex_destroy(&this->runMutex);
+    pthread_mutex_destroy(&this->sleepMutex);
+    pthread_cond_destroy(&this->sleepCondition);
+
+    *this = {};
+
+    return EVERYTHING_FINE;
+}
+
+static void* _workerMain(void* arg)
+{
+    _WorkerStart start = *(_WorkerStart*)arg;
+    free(arg);
+
+    WorkPool* pool = start.pool;
+
+    CURRENT_POOL   = pool;
+    CURRENT_WORKER = start.index;
+
+    while (true)
+    {
+        WorkTask* task = _findTask(pool, start.index);
+
+        if (task)
+        {
+            _runTask(task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->sleepMutex);
+
+        while (!__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) && !pool->stop)
+            pthread_cond_wait(&pool->sleepCondition, &pool->sleepMutex);
+
+        bool stop = pool->stop;
+
+        pthread_mutex_unlock(&pool->sleepMutex);
+
+        if (stop)
+            break;
+    }
+
+    return nullptr;
+}
+
+static ErrorCode _pushTask(WorkDeque* deque, WorkTask* task)
+{
+    pthread_mutex_lock(&deque->mutex);
+
+    if (deque->tail == deque->capacity)
+    {
+        if (deque->head)
+        {
+            memmove(deque->tasks, deque->tasks + deque->head, (deque->tail - deque->head) * sizeof(*deque->tasks));
+            deque->tail -= deque->head;
+            deque->head  = 0;
+        }
+        else
+        {
+            size_t newCapacity = deque->capacity ? deque->capacity * 2 : DEQUE_START_CAPACITY;
+
+            WorkTask** newTasks = (WorkTask**)realloc(deque->tasks, newCapacity * sizeof(*newTasks));
+            MyAssertSoft(newTasks, ERROR_NO_MEMORY, pthread_mutex_unlock(&deque->mutex));
+
+            deque->tasks    = newTasks;
+            deque->capacity = newCapacity;
+        }
+    }
+
+    deque->tasks[deque->tail++] = task;
+
+    pthread_mutex_unlock(&deque->mutex);
+
+    return EVERYTHING_FINE;
+}
+
+static WorkTask* _popTask(WorkDeque* deque)
+{
+    pthread_mutex_lock(&deque->mutex);
+
+    WorkTask* task = deque->tail > deque->head ? deque->tasks[--deque->tail] : nullptr;
+
+    if (deque->tail == deque->head)
+        deque->head = deque->tail = 0;
+
+    pthread_mutex_unlock(&deque->mutex);
+
+    return task;
+}
+
+static WorkTask* _stealTask(WorkDeque* deque)
+{
+    pthread_mutex_lock(&deque->mutex);
+
+    WorkTask* task = deque->tail > deque->head ? deque->tasks[deque->head++] : nullptr;
+
+    if (deque->tail == deque->head)
+        deque->head = deque->tail = 0;
+
+    pthread_mutex_unlock(&deque->mutex);
+
+    return task;
+}
+
+// own newest task first, then the oldest task of someone else
+static WorkTask* _findTask(WorkPool* pool, size_t worker)
+{
+    WorkTask* task = _popTask(&pool->deques[worker]);
+
+    for (size_t i = 1; !task && i < pool->workerCount; i++)
+        task = _stealTask(&pool->deques[(worker + i) % pool->workerCount]);
+
+    if (task)
+        __atomic_sub_fetch(&pool->pending, 1, __ATOMIC_RELEASE);
+
+    return task;
+}
+
+static void _runTask(WorkTask* task)
+{
+    task->error = task->run(task->arg);
+
+    __atomic_store_n(&task->done, true, __ATOMIC_RELEASE);
+}
@@ -1,16 +1,115 @@
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include "Tree.hpp"
 #include "Differentiator.hpp"
 #include "RecursiveDescent.hpp"
 #include "LatexWriter.hpp"
 #include "Optimiser.hpp"
+#include "Derivatives.hpp"
+#include "EGraph.hpp"
 
 static const size_t MAX_EXPRESSION_LENGTH = 256;
 #define MAX_EXPRESSION_LENGTH_DEFINE "256"
 
+// where a derivative too big to be built is evaluated
+static const double NUMERIC_TABLE_START = -2;
+static const double NUMERIC_TABLE_STEP  = 0.5;
+static const size_t NUMERIC_TABLE_SIZE  = 9;
+
+static const size_t MAX_SYSTEM_SIZE = 16;
+
+static const char* SATURATION_STOP_NAMES[] = { "saturated", "node limit", "round limit", "time limit" };
+
+static ErrorCode _differentiateN(Tree* tree, char var, size_t order, FILE* texFile);
+
+static ErrorCode _taylorExpand(Tree* tree, char var, double x0, size_t order, FILE* texFile);
+
+static ErrorCode _differentiateIncremental(const char* inputPath, char var);
+
+static ErrorCode _differentiateEdited(char* expression, char var, DiffCache* cache);
+
+static ErrorCode _writeNumericDerivative(BudgetedDerivative* derivative, FILE* texFile);
+
+static ErrorCode _writeJacobian(char* expression, FILE* texFile);
+
+static ErrorCode _writeJacobianEntries(Jacobian* jacobian, FILE* texFile);
+
+static CostModel _costModel(const char* name);
+
 int main(int argc, const char* const argv[])
 {
+    // -n <order> finds derivatives up to that order, -v <var> chooses the variable,
+    // -s <tex|count|none> chooses what is done with the steps, -j <workers> differentiates in parallel,
+    // -t <x0> writes the Taylor polynomial of the -n order around x0 instead,
+    // -i <file|-> differentiates every line of the file, reusing what the lines have in common,
+    // -b <nodes> evaluates the derivative numerically if it would have more nodes,
+    // -e <nodes|cycles|tex> simplifies the derivative once more with an e-graph, minimising that cost,
+    // comma separated expressions are a system, their jacobian is written
+    size_t order = 1;
+    size_t workers = 1;
+    size_t budget = 0;
+    bool taylor = false;
+    double x0 = 0;
+    char var = 'x';
+    const char* steps = "tex";
+    const char* incrementalPath = nullptr;
+    const char* cost = nullptr;
+    while (argc >= 3)
+    {
+        if (strcmp(argv[1], "-n") == 0)
+        {
+            order = strtoul(argv[2], nullptr, 10);
+            MyAssertSoft(order, ERROR_BAD_VALUE);
+        }
+        else if (strcmp(argv[1], "-t") == 0)
+        {
+            char* end = nullptr;
+            x0 = strtod(argv[2], &end);
+            MyAssertSoft(end != argv[2] && !*end, ERROR_BAD_VALUE);
+            taylor = true;
+        }
+        else if (strcmp(argv[1], "-v") == 0)
+        {
+            MyAssertSoft(argv[2][0] && !argv[2][1], ERROR_BAD_VALUE);
+            var = argv[2][0];
+        }
+        else if (strcmp(argv[1], "-s") == 0)
+        {
+            MyAssertSoft(strcmp(argv[2], "tex") == 0 || strcmp(argv[2], "count") == 0 ||
+                         strcmp(argv[2], "none") == 0, ERROR_BAD_VALUE);
+            steps = argv[2];
+        }
+        else if (strcmp(argv[1], "-i") == 0)
+            incrementalPath = argv[2];
+        else if (strcmp(argv[1], "-j") == 0)
+        {
+            char* end = nullptr;
+            workers = strtoul(argv[2], &end, 10);
+            MyAssertSoft(end != argv[2] && !*end, ERROR_BAD_VALUE);
+        }
+        else if (strcmp(argv[1], "-b") == 0)
+        {
+            char* end = nullptr;
+            budget = strtoul(argv[2], &end, 10);
+            MyAssertSoft(end != argv[2] && !*end && budget, ERROR_BAD_VALUE);
+        }
+        else if (strcmp(argv[1], "-e") == 0)
+        {
+            MyAssertSoft(strcmp(argv[2], "nodes") == 0 || strcmp(argv[2], "cycles") == 0 ||
+                         strcmp(argv[2], "tex") == 0, ERROR_BAD_VALUE);
+            cost = argv[2];
+        }
+        else
+            break;
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (incrementalPath)
+        return _differentiateIncremental(incrementalPath, var);
+
     char* expression = nullptr;
     switch (argc)
     {
@@ -34,6 +133,31 @@ int main(int argc, const char* const argv[])
     MyAssertSoft(!texFileRes.error, texFileRes.error);
     FILE* texFile = texFileRes.value;
 
+    if (strchr(expression, ','))
+    {
+        ErrorCode error = _writeJacobian(expression, texFile);
+        free(expression);
+        MyAssertSoft(!error, error);
+
+        Tree::EndHtmlLogging();
+
+        #ifdef TEX_WRITE
+        return LatexFileEnd(texFile, "tex");
+        #endif
+
+        return 0;
+    }
+
+    StepCounts stepCounts = {};
+    StepObserver observer = {};
+
+    if (strcmp(steps, "count") == 0)
+        observer = CountingObserver(&stepCounts);
+    #ifdef TEX_WRITE
+    else if (strcmp(steps, "tex") == 0)
+        observer = LatexObserver(texFile);
+    #endif
+
     Tree tree = {};
 
     // PARSE EXPRESSION
@@ -42,21 +166,92 @@ int main(int argc, const char* const argv[])
     tree.Dump();
 
     // OPTIMISE BEFOR DIFF
-    error = Optimise(&tree, texFile);
+    error = Optimise(&tree, &observer);
     MyAssertSoft(!error, error, free(expression); tree.Destructor());
     tree.Dump();
 
+    if (taylor || order > 1)
+    {
+        error = taylor ? _taylorExpand(&tree, var, x0, order, texFile) : _differentiateN(&tree, var, order, texFile);
+        MyAssertSoft(!error, error, free(expression); tree.Destructor());
+
+        Tree::EndHtmlLogging();
+
+        error = tree.Destructor();
+        MyAssertSoft(!error, error, free(expression));
+        free(expression);
+
+        #ifdef TEX_WRITE
+        return LatexFileEnd(texFile, "tex");
+        #endif
+
+        return 0;
+    }
+
     // DIFF
-    TreeResult treeDiff1Res = Differentiate(&tree, texFile);
-    MyAssertSoft(!treeDiff1Res.error, treeDiff1Res.error, free(expression); tree.Destructor());
-    Tree treeDiff1 = treeDiff1Res.value;
+    DiffMemoStats memoStats = {};
+    BudgetedDerivativeResult derivativeRes = {};
+    if (workers == 1)
+        derivativeRes = DifferentiateWithBudget(&tree, var, budget, nullptr, &observer, &memoStats);
+    else
+    {
+        WorkPool pool = {};
+        error = pool.Init(workers);
+        MyAssertSoft(!error, error, free(expression); tree.Destructor());
+
+        derivativeRes = DifferentiateWithBudget(&tree, var, budget, &pool, &observer, &memoStats);
+
+        pool.Destructor();
+    }
+    MyAssertSoft(!derivativeRes.error, derivativeRes.error, free(expression); tree.Destructor());
+
+    if (derivativeRes.value.path == NUMERIC_DIFF_PATH)
+    {
+        error = _writeNumericDerivative(&derivativeRes.value, texFile);
+        MyAssertSoft(!error, error, free(expression); tree.Destructor(); derivativeRes.value.Destructor());
+
+        Tree::EndHtmlLogging();
+
+        error = derivativeRes.value.Destructor();
+        MyAssertSoft(!error, error, free(expression); tree.Destructor());
+
+        error = tree.Destructor();
+        MyAssertSoft(!error, error, free(expression));
+        free(expression);
+
+        #ifdef TEX_WRITE
+        return LatexFileEnd(texFile, "tex");
+        #endif
+
+        return 0;
+    }
+
+    Tree treeDiff1 = derivativeRes.value.tree;
     treeDiff1.Dump();
 
+    printf("Subtrees differentiated: %zu, repeated ones reused: %zu\n", memoStats.misses, memoStats.hits);
+
     // OPTIMISE AFTER DIFF
-    error = Optimise(&treeDiff1, texFile);
+    error = Optimise(&treeDiff1, &observer);
     MyAssertSoft(!error, error, free(expression); tree.Destructor(); treeDiff1.Destructor());
     treeDiff1.Dump();
 
+    if (cost)
+    {
+        SaturationReport report = {};
+        error = OptimiseByEGraph(&treeDiff1, _costModel(cost), nullptr, &report);
+        MyAssertSoft(!error, error, free(expression); tree.Destructor(); treeDiff1.Destructor());
+        treeDiff1.Dump();
+
+        printf("E-graph: %zu nodes in %zu classes after %zu rounds (%s), the derivative has %zu nodes\n",
+               report.nodes, report.classes, report.iterations, SATURATION_STOP_NAMES[report.stop], *treeDiff1.size);
+    }
+
+    if (strcmp(steps, "count") == 0)
+        printf("Steps: %zu derivatives of leaves, %zu found by rules, %zu reused, %zu simplifications\n",
+               stepCounts.leafDerivatives, stepCounts.foundDerivatives, stepCounts.repeatedDerivatives,
+               stepCounts.simplifications);
+
     Tree::EndHtmlLogging();
 
     #ifdef TEX_WRITE
@@ -78,3 +273,267 @@ int main(int argc, const char* const argv[])
 
     return 0;
 }
+
+static ErrorCode _differentiateN(Tree* tree, char var, size_t order, FILE* texFile)
+{
+    MyAssertSoft(tree, ERROR_NULLPTR);
+
+    DerivativesResult derivativesRes = DifferentiateN(tree, var, order);
+    RETURN_ERROR(derivativesRes.error);
+    Derivatives derivatives = derivativesRes.value;
+
+    printf("%5s %20s %14s\n", "order", "tree nodes", "shared nodes");
+    for (size_t k = 0; k <= order; k++)
+        printf("%5zu %20zu %14zu\n", k, derivatives.sizes[k], derivatives.instructions[k]);
+
+    TreeResult lastRes = DerivativeTree(&derivatives, order);
+    if (lastRes.error == ERROR_BAD_SIZE)
+    {
+        printf("The derivative of order %zu is too big to be written\n", order);
+        return derivatives.Destructor();
+    }
+    RETURN_ERROR(lastRes.error, derivatives.Destructor());
+    Tree last = lastRes.value;
+
+    last.Dump();
+
+    #ifdef TEX_WRITE
+    fprintf(texFile, "Производная порядка %zu\n\\newline\n\\[", order);
+    RETURN_ERROR(LatexWrite(last.root, texFile), last.Destructor(); derivatives.Destructor());
+    fprintf(texFile, "\\]\n");
+    #endif
+
+    RETURN_ERROR(last.Destructor(), derivatives.Destructor());
+
+    return derivatives.Destructor();
+}
+
+static ErrorCode _taylorExpand(Tree* tree, char var, double x0, size_t order, FILE* texFile)
+{
+    MyAssertSoft(tree, ERROR_NULLPTR);
+
+    TreeResult polynomialRes = TaylorExpand(tree, var, x0, order);
+    if (polynomialRes.error == ERROR_BAD_SIZE)
+    {
+        printf("The Taylor polynomial of order %zu is too big to be written\n", order);
+        return EVERYTHING_FINE;
+    }
+    RETURN_ERROR(polynomialRes.error);
+    Tree polynomial = polynomialRes.value;
+
+    polynomial.Dump();
+
+    printf("Taylor polynomial of order %zu at %c = %lg:\n", order, var, x0);
+    RETURN_ERROR(LatexWrite(polynomial.root, stdout), polynomial.Destructor());
+    printf("\n");
+
+    #ifdef TEX_WRITE
+    fprintf(texFile, "Разложение по формуле Тейлора в точке $%c = %lg$ до порядка %zu\n\\newline\n\\[",
+            var, x0, order);
+    RETURN_ERROR(LatexWrite(polynomial.root, texFile), polynomial.Destructor());
+    fprintf(texFile, "\\]\n");
+    #endif
+
+    return polynomial.Destructor();
+}
+
+static ErrorCode _differentiateIncremental(const char* inputPath, char var)
+{
+    MyAssertSoft(inputPath, ERROR_NULLPTR);
+
+    FILE* input = strcmp(inputPath, "-") == 0 ? stdin : fopen(inputPath, "r");
+    MyAssertSoft(input, ERROR_BAD_FILE);
+
+    DiffCache cache = {};
+    ErrorCode error = cache.Init();
+
+    char expression[MAX_EXPRESSION_LENGTH + 1] = "";
+
+    while (!error && fgets(expression, sizeof(expression), input))
+    {
+        expression[strcspn(expression, "\n")] = '\0';
+        if (!*expression)
+            continue;
+
+        error = _differentiateEdited(expression, var, &cache);
+    }
+
+    if (input != stdin)
+        fclose(input);
+
+    ErrorCode cacheError = cache.Destructor();
+
+    return error ? error : cacheError;
+}
+
+static ErrorCode _differentiateEdited(char* expression, char var, DiffCache* cache)
+{
+    MyAssertSoft(expression, ERROR_NULLPTR);
+
+    Tree tree = {};
+    RETURN_ERROR(ParseExpression(&tree, expression));
+    RETURN_ERROR(Optimise(&tree, nullptr), tree.Destructor());
+
+    // the cache takes the tree and keeps the derivative, only the changed part is simplified
+    DiffMemoStats stats = {};
+    TreeNodeResult derivativeRes = DifferentiateIncremental(&tree, var, cache, nullptr, &stats);
+    RETURN_ERROR(derivativeRes.error);
+    TreeNode* derivative = derivativeRes.value;
+
+    RETURN_ERROR(LatexWrite(derivative, stdout));
+    printf("\n");
+
+    printf("Subtrees differentiated: %zu, reused from the last formula: %zu (%zu of %zu nodes)\n",
+           stats.misses, stats.reused, stats.reusedNodes, derivative->nodeCount);
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _writeNumericDerivative(BudgetedDerivative* derivative, FILE* texFile)
+{
+    MyAssertSoft(derivative, ERROR_NULLPTR);
+
+    printf("The derivative is too big to be built, its values are found numerically:\n");
+    printf("%12s %20s\n", "x", "f'(x)");
+
+    #ifdef TEX_WRITE
+    fprintf(texFile, "Производная получилась слишком большой, найдём её значения численно\n\\newline\n");
+    #endif
+
+    for (size_t i = 0; i < NUMERIC_TABLE_SIZE; i++)
+    {
+        double x = NUMERIC_TABLE_START + (double)i * NUMERIC_TABLE_STEP;
+
+        EvalResult valueRes = Evaluate(derivative, x);
+        if (isnan(valueRes.value))
+            valueRes.error = ERROR_BAD_VALUE;
+
+        if (valueRes.error)
+            printf("%12lg %20s\n", x, "undefined");
+        else
+            printf("%12lg %20lg\n", x, valueRes.value);
+
+        #ifdef TEX_WRITE
+        if (valueRes.error)
+            fprintf(texFile, "$f'(%lg)$ не определена\n\\newline\n", x);
+        else
+            fprintf(texFile, "$f'(%lg) = %lg$\n\\newline\n", x, valueRes.value);
+        #endif
+    }
+
+    return EVERYTHING_FINE;
+}
+
+static ErrorCode _writeJacobian(char* expression, FILE* texFile)
+{
+    MyAssertSoft(expression, ERROR_NULLPTR);
+
+    Tree functions[MAX_SYSTEM_SIZE] = {};
+    Tree* trees[MAX_SYSTEM_SIZE] = {};
+    size_t count = 0;
+
+    RETURN_ERROR(ParseSystem(functions, MAX_SYSTEM_SIZE, &count, expression));
+
+    ErrorCode error = EVERYTHING_FINE;
+
+    for (size_t i = 0; i < count && !error; i++)
+    {
+        error = Optimise(&functions[i], nullptr);
+        trees[i] = &functions[i];
+    }
+
+    JacobianResult jacobianRes = {};
+    if (!error)
+    {
+        jacobianRes = FindJacobian(trees, count);
+        error = jacobianRes.error;
+    }
+
+    if (!error)
+    {
+        Jacobian* jacobian = &jacobianRes.value;
+
+        printf("Jacobian %zu x %zu, %zu entries are not structural zeros, all of them take %zu instructions\n",
+               jacobian->rows, jacobian->columns, jacobian->nonZero, jacobian->compiled.size);
+
+        error = _writeJacobianEntries(jacobian, texFile);
+
+        ErrorCode jacobianError = jacobian->Destructor();
+        if (!error)
+            error = jacobianError;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        ErrorCode treeError = functions[i].Destructor();
+        if (!error)
+            error = treeError;
+    }
+
+    return error;
+}
+
+static ErrorCode _writeJacobianEntries(Jacobian* jacobian, FILE* texFile)
+{
+    MyAssertSoft(jacobian, ERROR_NULLPTR);
+
+    #ifdef TEX_WRITE
+    fprintf(texFile, "Матрица Якоби по $");
+    for (size_t column = 0; column < jacobian->columns; column++)
+        fprintf(texFile, "%s%c", column ? ", " : "", jacobian->compiled.variables[column]);
+    fprintf(texFile, "$\n\\[\\begin{pmatrix}\n");
+    #endif
+
+    for (size_t row = 0; row < jacobian->rows; row++)
+    {
+        for (size_t column = 0; column < jacobian->columns; column++)
+        {
+            char var = jacobian->compiled.variables[column];
+
+            TreeResult entryRes = JacobianTree(jacobian, row, var);
+            if (entryRes.error == ERROR_BAD_SIZE)
+            {
+                printf("d f%zu / d%c is too big to be written\n", row + 1, var);
+
+                #ifdef TEX_WRITE
+                fprintf(texFile, "%s\\dots", column ? " & " : "");
+                #endif
+
+                continue;
+            }
+            RETURN_ERROR(entryRes.error);
+            Tree entry = entryRes.value;
+
+            printf("d f%zu / d%c = ", row + 1, var);
+            RETURN_ERROR(LatexWrite(entry.root, stdout), entry.Destructor());
+            printf("\n");
+
+            #ifdef TEX_WRITE
+            fprintf(texFile, "%s", column ? " & " : "");
+            RETURN_ERROR(LatexWrite(entry.root, texFile), entry.Destructor());
+            #endif
+
+            RETURN_ERROR(entry.Destructor());
+        }
+
+        #ifdef TEX_WRITE
+        fprintf(texFile, " \\\\\n");
+        #endif
+    }
+
+    #ifdef TEX_WRITE
+    fprintf(texFile, "\\end{pmatrix}\\]\n");
+    #endif
+
+    return EVERYTHING_FINE;
+}
+
+static CostModel _costModel(const char* name)
+{
+    if (strcmp(name, "cycles") == 0)
+        return EvaluationCyclesCost(nullptr);
+    if (strcmp(name, "tex") == 0)
+        return LatexLengthCost();
+
+    return NodeCountCost();
+}